@@ -43,6 +43,7 @@ int json_ais_read(const char *buf,
     /* collected but not actually used yet */
     bool scaled;
 
+    /* jsongen.py indexes these by name; keep its header_attributes in step */
 #define AIS_HEADER \
 	{"class",          t_check,    .dflt.check = "AIS"}, \
 	{"type",           t_uinteger, .addr.uinteger = &ais->type}, \
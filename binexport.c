@@ -0,0 +1,162 @@
+/****************************************************************************
+
+NAME
+   binexport.c - binary report records for local socket clients
+
+DESCRIPTION
+   A watcher that sets "binary":true in its ?WATCH gets TPV, SKY, GST,
+ATT, AIS, PPS and TOFF reports as length-prefixed records carrying the
+daemon's own structures, instead of JSON.  Other reports, and all command
+responses, stay JSON.  A record is only meaningful to a client built from
+the same gps.h for the same machine, so the header carries the API major
+version and record layout the payload was built for, and a check word
+that comes out different under the other byte order or if gps_data_t
+changed size.
+
+   The payloads hold what the JSON would have said, so a client sees the
+same gps_data_t either way: fields JSON leaves out for the fix mode are
+shipped as NaN, and the status is collapsed the way the JSON reader
+defaults it.
+
+PERMISSIONS
+   This file is Copyright (c) 2010 by the GPSD project
+   BSD terms apply: see the file COPYING in the distribution root for details.
+
+***************************************************************************/
+
+#include "gpsd_config.h"
+
+#ifdef SOCKET_EXPORT_ENABLE
+
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+#include "gpsd.h"
+
+static size_t binary_record(const enum binary_type_t type, const char *device,
+			    const void *payload, size_t length,
+			    char *buf, size_t buflen)
+/* write one record into buf; 0 if it won't fit */
+{
+    struct binary_header_t header;
+    size_t pathlen = strlen(device) + 1;
+
+    if (sizeof(header) + pathlen + length > buflen)
+	return 0;
+    header.magic = BINARY_MAGIC;
+    header.type = (unsigned char)type;
+    header.api = (unsigned char)GPSD_API_MAJOR_VERSION;
+    header.layout = (unsigned char)BINARY_LAYOUT;
+    header.length = (unsigned int)(pathlen + length);
+    header.check = BINARY_CHECK;
+    memcpy(buf, &header, sizeof(header));
+    memcpy(buf + sizeof(header), device, pathlen);
+    memcpy(buf + sizeof(header) + pathlen, payload, length);
+    return sizeof(header) + pathlen + length;
+}
+
+static size_t binary_tpv_dump(const struct gps_data_t *datap,
+			      char *buf, size_t buflen)
+{
+    struct binary_tpv_t tpv;
+
+    memset(&tpv, '\0', sizeof(tpv));
+    tpv.status = (datap->status == STATUS_DGPS_FIX) ? STATUS_DGPS_FIX
+							: STATUS_FIX;
+    tpv.fix = datap->fix;
+    if (tpv.fix.mode < MODE_3D) {
+	tpv.fix.altitude = NAN;
+	tpv.fix.epv = NAN;
+	tpv.fix.climb = NAN;
+	tpv.fix.epc = NAN;
+    }
+    if (tpv.fix.mode < MODE_2D) {
+	tpv.fix.latitude = NAN;
+	tpv.fix.longitude = NAN;
+	tpv.fix.epx = NAN;
+	tpv.fix.epy = NAN;
+	tpv.fix.track = NAN;
+	tpv.fix.speed = NAN;
+	tpv.fix.epd = NAN;
+	tpv.fix.eps = NAN;
+    }
+    return binary_record(binary_tpv, datap->dev.path, &tpv, sizeof(tpv),
+			 buf, buflen);
+}
+
+static size_t binary_sky_dump(const struct gps_data_t *datap,
+			      char *buf, size_t buflen)
+{
+    struct binary_sky_t sky;
+    int n = datap->satellites_visible;
+
+    if (n < 0)
+	n = 0;
+    else if (n > MAXCHANNELS)
+	n = MAXCHANNELS;
+    memset(&sky, '\0', sizeof(sky));
+    sky.skyview_time = datap->skyview_time;
+    sky.dop = datap->dop;
+    sky.satellites_visible = n;
+    memcpy(sky.skyview, datap->skyview, n * sizeof(struct satellite_t));
+    return binary_record(binary_sky, datap->dev.path, &sky,
+			 offsetof(struct binary_sky_t, skyview)
+			 + n * sizeof(struct satellite_t),
+			 buf, buflen);
+}
+
+size_t binary_data_report(const gps_mask_t changed,
+			  const struct gps_device_t *session,
+			  char *buf, size_t buflen)
+/* report a session state as binary records */
+{
+    const struct gps_data_t *datap = &session->gpsdata;
+    size_t len = 0;
+
+    if ((changed & REPORT_IS) != 0)
+	len += binary_tpv_dump(datap, buf + len, buflen - len);
+
+    if ((changed & GST_SET) != 0)
+	len += binary_record(binary_gst, datap->dev.path,
+			     &datap->gst, sizeof(datap->gst),
+			     buf + len, buflen - len);
+
+    if ((changed & SATELLITE_SET) != 0)
+	len += binary_sky_dump(datap, buf + len, buflen - len);
+
+#ifdef COMPASS_ENABLE
+    if ((changed & ATTITUDE_SET) != 0)
+	len += binary_record(binary_att, datap->dev.path,
+			     &datap->attitude, sizeof(datap->attitude),
+			     buf + len, buflen - len);
+#endif /* COMPASS_ENABLE */
+
+#ifdef AIVDM_ENABLE
+    if ((changed & AIS_SET) != 0)
+	len += binary_record(binary_ais, datap->dev.path,
+			     &datap->ais, sizeof(datap->ais),
+			     buf + len, buflen - len);
+#endif /* AIVDM_ENABLE */
+
+    return len;
+}
+
+size_t binary_timedelta_dump(const enum binary_type_t type,
+			     const char *device,
+			     const struct timedelta_t *td, int precision,
+			     char *buf, size_t buflen)
+/* report a PPS or TOFF event as a binary record */
+{
+    struct binary_timedelta_t payload;
+
+    memset(&payload, '\0', sizeof(payload));
+    payload.td = *td;
+    payload.precision = precision;
+    return binary_record(type, device, &payload, sizeof(payload),
+			 buf, buflen);
+}
+
+#endif /* SOCKET_EXPORT_ENABLE */
+
+/* end */
@@ -5,7 +5,8 @@
  *
  * Bitfield extraction functions.  In each, start is a bit index  - not
  * a byte index - and width is a bit width.  The width is bounded above by
- * 64 bits.
+ * 64 bits.  Decoders that walk a message field by field should use the
+ * streaming bitreader_t in bits.h instead, which loads a word at a time.
  *
  * The sbits() function assumes twos-complement arithmetic. ubits()
  * and sbits() assume no padding in integers.
@@ -26,18 +27,24 @@ uint64_t ubits(unsigned char buf[], unsigned int start, unsigned int width, bool
     unsigned end;
 
     assert(width <= sizeof(uint64_t) * CHAR_BIT);
-    for (i = start / CHAR_BIT;
-	 i < (start + width + CHAR_BIT - 1) / CHAR_BIT; i++) {
-	fld <<= CHAR_BIT;
-	fld |= (unsigned char)buf[i];
-    }
+    if (start % CHAR_BIT + width >= sizeof(uint64_t) * CHAR_BIT) {
+	/* a full 64 bits to shift through, so take it in two halves */
+	fld = ubits(buf, start, width - 32, false) << 32;
+	fld |= ubits(buf, start + width - 32, 32, false);
+    } else {
+	for (i = start / CHAR_BIT;
+	     i < (start + width + CHAR_BIT - 1) / CHAR_BIT; i++) {
+	    fld <<= CHAR_BIT;
+	    fld |= (unsigned char)buf[i];
+	}
 
-    end = (start + width) % CHAR_BIT;
-    if (end != 0) {
-	fld >>= (CHAR_BIT - end);
-    }
+	end = (start + width) % CHAR_BIT;
+	if (end != 0) {
+	    fld >>= (CHAR_BIT - end);
+	}
 
-    fld &= ~(~0ULL << width);
+	fld &= ~(~0ULL << width);
+    }
 
     /* was extraction as a little-endian requested? */
     if (le)
@@ -73,6 +80,17 @@ int64_t sbits(signed char buf[], unsigned int start, unsigned int width, bool le
     return (int64_t)fld;
 }
 
+void bitreader_refill_tail(struct bitreader_t *br)
+/* refill a byte at a time near the end of the buffer, zeros past it */
+{
+    while (br->count <= 56) {
+	if (br->next < br->len)
+	    br->cache |= (uint64_t)br->buf[br->next] << (56 - br->count);
+	br->next++;
+	br->count += CHAR_BIT;
+    }
+}
+
 union int_float {
     int32_t i;
     float f;
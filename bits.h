@@ -15,6 +15,9 @@
 #define _GPSD_BITS_H_
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
 #include <limits.h>
 
 /* number of bytes requited to contain a bit array of specified length */
@@ -61,4 +64,113 @@ extern void shiftleft(unsigned char *, int, unsigned short);
 extern uint64_t ubits(unsigned char buf[], unsigned int, unsigned int, bool);
 extern int64_t sbits(signed char buf[], unsigned int, unsigned int, bool);
 
+/*
+ * Streaming MSB-first bitfield extraction.  The cache holds the next
+ * count bits of the buffer left-aligned; a refill tops it up to at
+ * least 56 bits with a single unaligned big-endian load, so most
+ * fields cost a shift and a mask.  Reads past the end of the buffer
+ * yield zeros.  With a constant width the accessors inline down to
+ * the straight-line code for that width.
+ */
+struct bitreader_t {
+    const unsigned char *buf;
+    size_t len;			/* buffer length in bytes */
+    size_t next;		/* next byte to load into the cache */
+    uint64_t cache;		/* upcoming bits, left-aligned */
+    unsigned int count;		/* valid bits in the cache */
+};
+
+extern void bitreader_refill_tail(struct bitreader_t *);
+
+static inline uint64_t bits_load_be64(const unsigned char *p)
+/* unaligned big-endian 64-bit load */
+{
+    uint64_t w;
+
+    memcpy(&w, p, sizeof(w));
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    w = __builtin_bswap64(w);
+#elif !defined(__BYTE_ORDER__) || __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__
+    w = getbeu64(p, 0);
+#endif
+    return w;
+}
+
+static inline void bitreader_refill(struct bitreader_t *br)
+/* make at least 56 bits available; count must be below 56 */
+{
+    if (br->next + sizeof(uint64_t) <= br->len) {
+	br->cache |= bits_load_be64(br->buf + br->next) >> br->count;
+	br->next += (63 - br->count) / CHAR_BIT;
+	br->count |= 56;
+    } else
+	bitreader_refill_tail(br);
+}
+
+static inline void bitreader_seek(struct bitreader_t *br, size_t start)
+/* position the reader at bit start */
+{
+    br->next = start / CHAR_BIT;
+    br->cache = 0;
+    br->count = 0;
+    bitreader_refill(br);
+    br->cache <<= start % CHAR_BIT;
+    br->count -= start % CHAR_BIT;
+}
+
+static inline void bitreader_init(struct bitreader_t *br,
+				  const unsigned char *buf, size_t len)
+{
+    br->buf = buf;
+    br->len = len;
+    bitreader_seek(br, 0);
+}
+
+static inline size_t bitreader_tell(const struct bitreader_t *br)
+/* index of the next bit to be read */
+{
+    return br->next * CHAR_BIT - br->count;
+}
+
+static inline void bitreader_skip(struct bitreader_t *br, size_t width)
+{
+    bitreader_seek(br, bitreader_tell(br) + width);
+}
+
+static inline uint64_t bitreader_take(struct bitreader_t *br,
+				      unsigned int width)
+/* extract the next width bits, up to 56 */
+{
+    uint64_t fld;
+
+    if (br->count < width)
+	bitreader_refill(br);
+    /* the split shift keeps width 0 defined */
+    fld = (br->cache >> 1) >> (63 - width);
+    br->cache <<= width;
+    br->count -= width;
+    return fld;
+}
+
+static inline uint64_t bitreader_ubits(struct bitreader_t *br,
+				       unsigned int width)
+/* extract the next width bits, up to 64, as an unsigned value */
+{
+    if (width > 56) {
+	uint64_t fld = bitreader_take(br, width - 32) << 32;
+
+	return fld | bitreader_take(br, 32);
+    }
+    return bitreader_take(br, width);
+}
+
+static inline int64_t bitreader_sbits(struct bitreader_t *br,
+				      unsigned int width)
+/* extract the next width bits, 1 to 64, as a twos-complement value */
+{
+    uint64_t sign = 1ULL << (width - 1);
+
+    return (int64_t)((bitreader_ubits(br, width) ^ sign) - sign);
+}
+
 #endif /* _GPSD_BITS_H_ */
@@ -36,18 +36,100 @@
  * Parse the data from the device
  */
 
-static void from_sixbit_untrimmed(unsigned char *bitvec, unsigned int start,
+/*
+ * Six-bit value of each AIVDM armoring character: '0'-'W' are 0-39,
+ * '`'-'w' are 40-63.  Anything else keeps its low six bits after the
+ * same subtraction, as the character-at-a-time decoder always did.
+ */
+static const unsigned char sixbit_value[256] = {
+	 8,  9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23,
+	24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39,
+	40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55,
+	 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15,
+	16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31,
+	32, 33, 34, 35, 36, 37, 38, 39, 32, 33, 34, 35, 36, 37, 38, 39,
+	40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55,
+	56, 57, 58, 59, 60, 61, 62, 63,  0,  1,  2,  3,  4,  5,  6,  7,
+	 8,  9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23,
+	24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39,
+	40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55,
+	56, 57, 58, 59, 60, 61, 62, 63,  0,  1,  2,  3,  4,  5,  6,  7,
+	 8,  9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23,
+	24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39,
+	40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55,
+	56, 57, 58, 59, 60, 61, 62, 63,  0,  1,  2,  3,  4,  5,  6,  7,
+};
+
+bool ais_dearmor(const unsigned char *armor, size_t len,
+		 unsigned char *bits, size_t *bitlen, size_t maxbits)
+/* append an armored AIVDM payload to a bit buffer, false if it won't fit */
+{
+    size_t out = *bitlen / CHAR_BIT;
+    unsigned int have = *bitlen % CHAR_BIT;
+    uint32_t acc;
+    size_t i;
+
+    if (*bitlen + 6 * len > maxbits)
+	return false;
+
+    /* pick up the bits already in a partial last byte */
+    acc = (have != 0) ? (uint32_t)(bits[out] >> (CHAR_BIT - have)) : 0;
+
+    /* every four characters make exactly three bytes */
+    for (i = 0; i + 4 <= len; i += 4) {
+	acc = (acc << 24)
+	    | ((uint32_t)sixbit_value[armor[i]] << 18)
+	    | ((uint32_t)sixbit_value[armor[i + 1]] << 12)
+	    | ((uint32_t)sixbit_value[armor[i + 2]] << 6)
+	    | (uint32_t)sixbit_value[armor[i + 3]];
+	bits[out++] = (unsigned char)(acc >> (have + 16));
+	bits[out++] = (unsigned char)(acc >> (have + 8));
+	bits[out++] = (unsigned char)(acc >> have);
+	acc &= (1U << have) - 1;
+    }
+    for (; i < len; i++) {
+	acc = (acc << 6) | sixbit_value[armor[i]];
+	have += 6;
+	if (have >= CHAR_BIT) {
+	    have -= CHAR_BIT;
+	    bits[out++] = (unsigned char)(acc >> have);
+	    acc &= (1U << have) - 1;
+	}
+    }
+    /* zero the rest of the last byte, there may be stale data behind it */
+    if (have != 0)
+	bits[out] = (unsigned char)(acc << (CHAR_BIT - have));
+
+    *bitlen += 6 * len;
+    return true;
+}
+
+static void from_sixbit_untrimmed(struct bitreader_t *br, unsigned int start,
   int count, char *to)
-/* beginning at bitvec bit start, unpack count sixbit characters */
+/* beginning at bit start, unpack count sixbit characters */
 {
     const char sixchr[64] =
 	"@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_ !\"#$%&'()*+,-./0123456789:;<=>?";
     int i;
 
-    /* six-bit to ASCII */
-    for (i = 0; i < count; i++) {
+    /* six-bit to ASCII, eight characters to a 48-bit read */
+    bitreader_seek(br, start);
+    for (i = 0; i + 8 <= count; i += 8) {
+	uint64_t word = bitreader_ubits(br, 48);
+	int j;
+
+	for (j = 0; j < 8; j++) {
+	    char newchar = sixchr[(word >> (42 - 6 * j)) & 0x3f];
+	    if (newchar == '@') {
+		to[i + j] = '\0';
+		return;
+	    }
+	    to[i + j] = newchar;
+	}
+    }
+    for (; i < count; i++) {
 	char newchar;
-	newchar = sixchr[ubits(bitvec, start + 6 * i, 6U, false)];
+	newchar = sixchr[bitreader_ubits(br, 6U)];
 	if (newchar == '@')
 	    break;
 	else
@@ -73,27 +155,86 @@ static void trim_spaces_on_right_end(char* to)
     }
 }
 
-static void from_sixbit(unsigned char *bitvec, unsigned int start, int count,
+static void from_sixbit(struct bitreader_t *br, unsigned int start, int count,
   char *to)
-/* beginning at bitvec bit start, unpack count sixbit characters and remove trailing
+/* beginning at bit start, unpack count sixbit characters and remove trailing
  * spaces */
 {
-       from_sixbit_untrimmed(bitvec, start, count, to);
+       from_sixbit_untrimmed(br, start, count, to);
        trim_spaces_on_right_end(to);
 }
 
+static struct ais_type24a_t *ais_type24_probe(struct ais_type24_table_t *table,
+					      unsigned int mmsi)
+/* first of the slots an MMSI may live in */
+{
+    /* Fibonacci hashing spreads the low-order MMSI digits */
+    unsigned int h = (unsigned int)((mmsi * 2654435761U) >> 16);
+
+    return &table->ships[h % (AIS_TYPE24_SLOTS - AIS_TYPE24_PROBE + 1)];
+}
+
+void ais_type24_stash(struct ais_type24_table_t *table, unsigned int mmsi,
+		      const char *shipname)
+/* remember a 24A until its 24B turns up */
+{
+    struct ais_type24a_t *probe = ais_type24_probe(table, mmsi);
+    struct ais_type24a_t *slot = NULL;
+    int i;
+
+    for (i = 0; i < AIS_TYPE24_PROBE; i++) {
+	if (probe[i].mmsi == mmsi) {
+	    slot = &probe[i];
+	    break;
+	}
+	if (slot == NULL || (slot->mmsi != 0
+			     && (probe[i].mmsi == 0
+				 || probe[i].serial < slot->serial)))
+	    slot = &probe[i];
+    }
+    /* a full window gives up its oldest entry */
+    if (slot->mmsi != 0 && slot->mmsi != mmsi)
+	table->evicted++;
+    slot->mmsi = mmsi;
+    slot->serial = table->stashed++;
+    (void)strlcpy(slot->shipname, shipname, sizeof(slot->shipname));
+}
+
+bool ais_type24_match(struct ais_type24_table_t *table, unsigned int mmsi,
+		      char *shipname, size_t len)
+/* fetch and forget the stashed 24A shipname for an MMSI */
+{
+    struct ais_type24a_t *probe = ais_type24_probe(table, mmsi);
+    int i;
+
+    if (mmsi == 0)
+	return false;
+    for (i = 0; i < AIS_TYPE24_PROBE; i++)
+	if (probe[i].mmsi == mmsi) {
+	    (void)strlcpy(shipname, probe[i].shipname, len);
+	    /* prevent false match if a 24B is repeated */
+	    probe[i].mmsi = 0;
+	    table->matched++;
+	    return true;
+	}
+    return false;
+}
+
 bool ais_binary_decode(const struct gpsd_errout_t *errout,
 		       struct ais_t *ais,
 		       const unsigned char *bits, size_t bitlen,
-		       struct ais_type24_queue_t *type24_queue)
+		       struct ais_type24_table_t *type24_table)
 /* decode an AIS binary packet */
 {
     unsigned int u; int i;
+    struct bitreader_t br;
 
-#define UBITS(s, l)	ubits((unsigned char *)bits, s, l, false)
-#define SBITS(s, l)	sbits((signed char *)bits, s, l, false)
-#define UCHARS(s, to)	from_sixbit((unsigned char *)bits, s, sizeof(to)-1, to)
-#define ENDCHARS(s, to)	from_sixbit((unsigned char *)bits, s, (bitlen-(s))/6,to)
+    /* fields past the end of a short message read as zero */
+    bitreader_init(&br, bits, BITS_TO_BYTES(bitlen));
+#define UBITS(s, l)	(bitreader_seek(&br, s), bitreader_ubits(&br, l))
+#define SBITS(s, l)	(bitreader_seek(&br, s), bitreader_sbits(&br, l))
+#define UCHARS(s, to)	from_sixbit(&br, s, sizeof(to)-1, to)
+#define ENDCHARS(s, to)	from_sixbit(&br, s, (bitlen-(s))/6,to)
     ais->type = UBITS(0, 6);
     ais->repeat = UBITS(6, 2);
     ais->mmsi = UBITS(8, 30);
@@ -913,8 +1054,7 @@ bool ais_binary_decode(const struct gpsd_errout_t *errout,
     case 21:	/* Aid-to-Navigation Report */
 	RANGE_CHECK(272, 368);
 	ais->type21.aid_type = UBITS(38, 5);
-	from_sixbit_untrimmed((unsigned char *)bits,
-		    43, 20, ais->type21.name);
+	from_sixbit_untrimmed(&br, 43, 20, ais->type21.name);
 	ais->type21.accuracy     = UBITS(163, 1);
 	ais->type21.lon          = SBITS(164, 28);
 	ais->type21.lat          = SBITS(192, 27);
@@ -970,21 +1110,14 @@ bool ais_binary_decode(const struct gpsd_errout_t *errout,
 	switch (UBITS(38, 2)) {
 	case 0:
 	    RANGE_CHECK(160, 168);
-	    /* save incoming 24A shipname/MMSI pairs in a circular queue */
-	    {
-		struct ais_type24a_t *saveptr = &type24_queue->ships[type24_queue->index];
-
-		gpsd_log(errout, LOG_PROG,
-			 "AIVDM: 24A from %09u stashed.\n",
-			 ais->mmsi);
-		saveptr->mmsi = ais->mmsi;
-		UCHARS(40, saveptr->shipname);
-		++type24_queue->index;
-		type24_queue->index %= MAX_TYPE24_INTERLEAVE;
-	    }
 	    //ais->type24.a.spare	= UBITS(160, 8);
 
 	    UCHARS(40, ais->type24.shipname);
+	    /* save incoming 24A shipname/MMSI pairs by MMSI */
+	    ais_type24_stash(type24_table, ais->mmsi, ais->type24.shipname);
+	    gpsd_log(errout, LOG_PROG,
+		     "AIVDM: 24A from %09u stashed.\n",
+		     ais->mmsi);
 	    ais->type24.part = part_a;
 	    return true;
 	case 1:
@@ -1015,20 +1148,15 @@ bool ais_binary_decode(const struct gpsd_errout_t *errout,
 	    }
 	    //ais->type24.b.spare	    = UBITS(162, 8);
 
-	    /* search the 24A queue for a matching MMSI */
-	    for (i = 0; i < MAX_TYPE24_INTERLEAVE; i++) {
-		if (type24_queue->ships[i].mmsi == ais->mmsi) {
-		    (void)strlcpy(ais->type24.shipname,
-				  type24_queue->ships[i].shipname,
-				  sizeof(ais->type24.shipname));
-		    gpsd_log(errout, LOG_PROG,
-			     "AIVDM 24B from %09u matches a 24A.\n",
-			     ais->mmsi);
-		    /* prevent false match if a 24B is repeated */
-		    type24_queue->ships[i].mmsi = 0;
-		    ais->type24.part = both;
-		    return true;
-		}
+	    /* look for the 24A with a matching MMSI */
+	    if (ais_type24_match(type24_table, ais->mmsi,
+				 ais->type24.shipname,
+				 sizeof(ais->type24.shipname))) {
+		gpsd_log(errout, LOG_PROG,
+			 "AIVDM 24B from %09u matches a 24A.\n",
+			 ais->mmsi);
+		ais->type24.part = both;
+		return true;
 	    }
 
 	    /* no match, return Part B */
@@ -1730,6 +1730,18 @@ static gps_mask_t processSTI(int count, char *field[],
  *
  **************************************************************************/
 
+#define NMEA_TAG_HASHSIZE	64	/* power of 2, over twice the phrase count */
+
+static unsigned int nmea_tag_hash(const char *tag)
+/* hash a sentence tag into the phrase dispatch index */
+{
+    unsigned int h = 0;
+
+    while (*tag != '\0')
+	h = (h * 33) ^ (unsigned char)*tag++;
+    return h & (NMEA_TAG_HASHSIZE - 1);
+}
+
 gps_mask_t nmea_parse(char *sentence, struct gps_device_t * session)
 /* parse an NMEA sentence, unpack it into a session structure */
 {
@@ -1797,11 +1809,15 @@ gps_mask_t nmea_parse(char *sentence, struct gps_device_t * session)
 	{"VTG", 0,  false, NULL},	/* ignore Velocity Track made Good */
     };
 
+    /* nmea_phrase[] index plus one, by tag hash; 0 for an empty slot */
+    static unsigned char phrase_index[NMEA_TAG_HASHSIZE];
+    static bool phrases_indexed = false;
+
     int count;
     gps_mask_t retval = 0;
-    unsigned int i, thistag;
-    char *p, *e;
-    volatile char *t;
+    unsigned int i, h, thistag, tail;
+    size_t len;
+    char *p, *q, *e, *fend, *tag;
 #ifdef SKYTRAQ_ENABLE
     bool skytraq_sti = false;
 #endif
@@ -1814,44 +1830,39 @@ gps_mask_t nmea_parse(char *sentence, struct gps_device_t * session)
      * legal limit for NMEA, so we can cope by just tossing out overlong
      * packets.  This may be a generic bug of all Garmin chipsets.
      */
-    if (strlen(sentence) > NMEA_MAX) {
+    len = strlen(sentence);
+    if (len > NMEA_MAX) {
 	gpsd_log(&session->context->errout, LOG_WARN,
-		 "Overlong packet of %zd chars rejected.\n",
-		 strlen(sentence));
+		 "Overlong packet of %zd chars rejected.\n", len);
 	return ONLINE_SET;
     }
 
-    /* make an editable copy of the sentence */
-    (void)strlcpy((char *)session->nmea.fieldcopy, sentence, sizeof(session->nmea.fieldcopy) - 1);
-    /* discard the checksum part */
-    for (p = (char *)session->nmea.fieldcopy;
-	 (*p != '*') && (*p >= ' ');)
-	++p;
-    if (*p == '*')
-	*p++ = ',';		/* otherwise we drop the last field */
-#ifdef SKYTRAQ_ENABLE_UNUSED
-    /* $STI is special, no trailing *, or chacksum */
-    if ( 0 != strncmp( "STI,", sentence, 4) ) {
-	skytraq_sti = true;
-	*p++ = ',';		/* otherwise we drop the last field */
-    }
-#endif
-    *p = '\0';
-    e = p;
-
-    /* split sentence copy on commas, filling the field array */
+    /*
+     * Make an editable copy of the sentence and split it on commas in
+     * the same pass.  The copy stops at the checksum or the trailing
+     * CR-LF; the '*' terminates a field like a comma would, otherwise
+     * we drop the last field.  Field zero is the tag, 'G' not '$'.
+     */
+    q = (char *)session->nmea.fieldcopy;
+    fend = q + sizeof(session->nmea.fieldcopy) - 2;
+    p = sentence;
     count = 0;
-    t = p;			/* end of sentence */
-    p = (char *)session->nmea.fieldcopy + 1;	/* beginning of tag, 'G' not '$' */
-    /* while there is a search string and we haven't run off the buffer... */
-    while ((p != NULL) && (p <= t)) {
-	session->nmea.field[count] = p;	/* we have a field. record it */
-	if ((p = strchr(p, ',')) != NULL) {	/* search for the next delimiter */
-	    *p = '\0';		/* replace it with a NUL */
-	    count++;		/* bump the counters and continue */
-	    p++;
-	}
+    if ((*p != '*') && (*p >= ' '))
+	*q++ = *p++;
+    session->nmea.field[0] = q;
+    for (; (q < fend) && (*p != '*') && (*p >= ' '); p++) {
+	if (*p == ',') {
+	    *q++ = '\0';
+	    session->nmea.field[++count] = q;
+	} else
+	    *q++ = *p;
     }
+    if ((q < fend) && (*p == '*')) {
+	*q++ = '\0';
+	session->nmea.field[++count] = q;
+    }
+    *q = '\0';
+    e = q;
 
     /* point remaining fields at empty string, just in case */
     for (i = (unsigned int)count;
@@ -1863,37 +1874,72 @@ gps_mask_t nmea_parse(char *sentence, struct gps_device_t * session)
     /* sentences handlers will tell us when they have fractional time */
     session->nmea.latch_frac_time = false;
 
-    /* dispatch on field zero, the sentence tag */
-    for (thistag = i = 0;
-	 i < (unsigned)(sizeof(nmea_phrase) / sizeof(nmea_phrase[0])); ++i) {
-	char *s = session->nmea.field[0];
-	if (strlen(nmea_phrase[i].name) == 3
+    if (!phrases_indexed) {
+	for (i = 0; i < (unsigned)NITEMS(nmea_phrase); i++) {
+	    for (h = nmea_tag_hash(nmea_phrase[i].name);
+		 phrase_index[h] != 0;
+		 h = (h + 1) & (NMEA_TAG_HASHSIZE - 1))
+		continue;
+	    phrase_index[h] = (unsigned char)(i + 1);
+	}
+	phrases_indexed = true;
+    }
+
+    /*
+     * Dispatch on field zero, the sentence tag.  Three-letter phrases
+     * match after a two-character talker ID, longer ones match the
+     * whole tag.  A tag can match one of each (PGRMC and RMC); the
+     * entry earlier in nmea_phrase[] wins.  thistag is the table index
+     * plus one, because we rely on a zero value to mean "no previous
+     * tag" later.
+     */
+    thistag = tail = 0;
+    tag = session->nmea.field[0];
+    for (h = nmea_tag_hash(tag); (i = phrase_index[h]) != 0;
+	 h = (h + 1) & (NMEA_TAG_HASHSIZE - 1)) {
+	if (strcmp(nmea_phrase[i - 1].name, tag) == 0) {
+	    if (strlen(nmea_phrase[i - 1].name) != 3
 #ifdef SKYTRAQ_ENABLE
-	        /* $STI is special */
-		&& !skytraq_sti
+		/* $STI is special */
+		|| skytraq_sti
 #endif
-		) {
-	    s += 2;		/* skip talker ID */
-        }
-	if (strcmp(nmea_phrase[i].name, s) == 0) {
-	    if (nmea_phrase[i].decoder != NULL
-		&& (count >= nmea_phrase[i].nf)) {
-		retval =
-		    (nmea_phrase[i].decoder) (count,
-					      session->nmea.field,
-					      session);
-		if (nmea_phrase[i].cycle_continue)
-		    session->nmea.cycle_continue = true;
-		/*
-		 * Must force this to be nz, as we're going to rely on a zero
-		 * value to mean "no previous tag" later.
-		 */
-		thistag = i + 1;
-	    } else
-		retval = ONLINE_SET;	/* unknown sentence */
+		)
+		thistag = i;
 	    break;
 	}
     }
+    if (strlen(tag) == 5
+#ifdef SKYTRAQ_ENABLE
+	&& !skytraq_sti
+#endif
+	) {
+	/* skip talker ID */
+	for (h = nmea_tag_hash(tag + 2); (i = phrase_index[h]) != 0;
+	     h = (h + 1) & (NMEA_TAG_HASHSIZE - 1)) {
+	    if (strcmp(nmea_phrase[i - 1].name, tag + 2) == 0) {
+		tail = i;
+		break;
+	    }
+	}
+    }
+    if (tail != 0 && (thistag == 0 || tail < thistag))
+	thistag = tail;
+
+    if (thistag != 0) {
+	i = thistag - 1;
+	if (nmea_phrase[i].decoder != NULL
+	    && (count >= nmea_phrase[i].nf)) {
+	    retval =
+		(nmea_phrase[i].decoder) (count,
+					  session->nmea.field,
+					  session);
+	    if (nmea_phrase[i].cycle_continue)
+		session->nmea.cycle_continue = true;
+	} else {
+	    retval = ONLINE_SET;	/* unknown sentence */
+	    thistag = 0;
+	}
+    }
 
     /* prevent overaccumulation of sat reports */
     if (!str_starts_with(session->nmea.field[0] + 2, "GSV"))
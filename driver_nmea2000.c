@@ -5,8 +5,8 @@
  * BSD terms apply: see the file COPYING in the distribution root for details.
  */
 
-/* need this for strnlen() and struct ifreq */
-#define _DEFAULT_SOURCE
+/* need this for strnlen(), struct ifreq and recvmmsg() */
+#define _GNU_SOURCE
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -859,25 +859,17 @@ static gps_mask_t hnd_129809(unsigned char *bu, int len, PGN *pgn, struct gps_de
 
     if (decode_ais_header(session->context, bu, len, ais, 0xffffffffU) != 0) {
         int                   l;
-	int                   index   = session->driver.aivdm.context[0].type24_queue.index;
-	struct ais_type24a_t *saveptr = &session->driver.aivdm.context[0].type24_queue.ships[index];
-
-	gpsd_log(&session->context->errout, LOG_PROG,
-		 "NMEA2000: AIS message 24A from %09u stashed.\n",
-		 ais->mmsi);
 
 	for (l=0;l<AIS_SHIPNAME_MAXLEN;l++) {
 	    ais->type24.shipname[l] = (char) bu[ 5+l];
-	    saveptr->shipname[l] = (char) bu[ 5+l];
 	}
 	ais->type24.shipname[AIS_SHIPNAME_MAXLEN] = (char) 0;
-	saveptr->shipname[AIS_SHIPNAME_MAXLEN] = (char) 0;
-	
-	saveptr->mmsi = ais->mmsi;
 
-	index += 1;
-	index %= MAX_TYPE24_INTERLEAVE;
-	session->driver.aivdm.context[0].type24_queue.index = index;
+	ais_type24_stash(&session->driver.nmea2000.type24,
+			 ais->mmsi, ais->type24.shipname);
+	gpsd_log(&session->context->errout, LOG_PROG,
+		 "NMEA2000: AIS message 24A from %09u stashed.\n",
+		 ais->mmsi);
 
 	decode_ais_channel_info(bu, len, 200, session);
 
@@ -901,7 +893,7 @@ static gps_mask_t hnd_129810(unsigned char *bu, int len, PGN *pgn, struct gps_de
 	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
 
     if (decode_ais_header(session->context, bu, len, ais, 0xffffffffU) != 0) {
-        int l, i;
+        int l;
 
 	ais->type24.shiptype = (unsigned int) ((bu[ 5] >> 0) & 0xff);
 
@@ -941,34 +933,27 @@ static gps_mask_t hnd_129810(unsigned char *bu, int len, PGN *pgn, struct gps_de
 	    ais->type24.dim.to_starboard  = (unsigned int) (to_starboard/10);
 	}
 
-	for (i = 0; i < MAX_TYPE24_INTERLEAVE; i++) {
-	    if (session->driver.aivdm.context[0].type24_queue.ships[i].mmsi == ais->mmsi) {
-	        for (l=0;l<AIS_SHIPNAME_MAXLEN;l++) {
-		    ais->type24.shipname[l] = (char)(session->driver.aivdm.context[0].type24_queue.ships[i].shipname[l]);
-		}
-		ais->type24.shipname[AIS_SHIPNAME_MAXLEN] = (char) 0;
-
-		gpsd_log(&session->context->errout, LOG_PROG,
-			 "NMEA2000: AIS 24B from %09u matches a 24A.\n",
-			    ais->mmsi);
-		/* prevent false match if a 24B is repeated */
-		session->driver.aivdm.context[0].type24_queue.ships[i].mmsi = 0;
+	if (ais_type24_match(&session->driver.nmea2000.type24, ais->mmsi,
+			     ais->type24.shipname,
+			     sizeof(ais->type24.shipname))) {
+	    gpsd_log(&session->context->errout, LOG_PROG,
+		     "NMEA2000: AIS 24B from %09u matches a 24A.\n",
+		     ais->mmsi);
 #if NMEA2000_DEBUG_AIS
-		printf("AIS: MMSI:  %09u\n", ais->mmsi);
-		printf("AIS: name:  %-20.20s v:%-8.8s c:%-8.8s b:%6u s:%6u p:%6u s:%6u\n",
-		       ais->type24.shipname,
-		       ais->type24.vendorid,
-		       ais->type24.callsign,
-		       ais->type24.dim.to_bow,
-		       ais->type24.dim.to_stern,
-		       ais->type24.dim.to_port,
-		       ais->type24.dim.to_starboard);
+	    printf("AIS: MMSI:  %09u\n", ais->mmsi);
+	    printf("AIS: name:  %-20.20s v:%-8.8s c:%-8.8s b:%6u s:%6u p:%6u s:%6u\n",
+		   ais->type24.shipname,
+		   ais->type24.vendorid,
+		   ais->type24.callsign,
+		   ais->type24.dim.to_bow,
+		   ais->type24.dim.to_stern,
+		   ais->type24.dim.to_port,
+		   ais->type24.dim.to_starboard);
 #endif /* of #if NMEA2000_DEBUG_AIS */
 
-		decode_ais_channel_info(bu, len, 264, session);
-		ais->type24.part = both;
-		return(ONLINE_SET | AIS_SET);
-	    }
+	    decode_ais_channel_info(bu, len, 264, session);
+	    ais->type24.part = both;
+	    return(ONLINE_SET | AIS_SET);
 	}
 #if NMEA2000_DEBUG_AIS
 	printf("AIS: MMSI  :  %09u\n", ais->mmsi);
@@ -1325,22 +1310,173 @@ static PGN navpgn[] = {{ 59392, 0, 0, hnd_059392, &msg_059392[0]},
 
 
 
-static PGN *search_pgnlist(unsigned int pgn, PGN *pgnlist)
+/* indexed by session->driver.nmea2000.pgnlist; 0 means not yet known */
+static PGN *pgnlists[] = {NULL, gpspgn, aispgn, pwrpgn, navpgn};
+#define PGN_LISTS	(sizeof(pgnlists) / sizeof(pgnlists[0]))
+
+/*
+ * Every PGN we know, hashed once at open time, with its handler in
+ * each list that has it.  Open addressing with linear probing; PGN 0
+ * is never valid, so it marks an empty slot.
+ */
+#define PGN_HASH_SIZE	128	/* power of 2, over twice the distinct PGNs */
+static struct {
+    unsigned int pgn;
+    PGN *entry[PGN_LISTS];
+} pgn_hash[PGN_HASH_SIZE];
+static bool pgn_hash_ready = false;
+
+static unsigned int pgn_hash_index(unsigned int pgn)
 {
-    int l1;
-    PGN *work;
+    return ((pgn * 2654435761U) >> 16) & (PGN_HASH_SIZE - 1);
+}
+
+static void pgn_hash_init(void)
+/* build the PGN dispatch table from the lists */
+{
+    unsigned int list;
+
+    if (pgn_hash_ready)
+	return;
+    for (list = 1; list < PGN_LISTS; list++) {
+	PGN *work;
 
-    l1 = 0;
-    work = NULL;
-    while (pgnlist[l1].pgn != 0) {
-        if (pgnlist[l1].pgn == pgn) {
-	    work = &pgnlist[l1];
+	for (work = pgnlists[list]; work->pgn != 0; work++) {
+	    unsigned int h = pgn_hash_index(work->pgn);
+
+	    while (pgn_hash[h].pgn != 0 && pgn_hash[h].pgn != work->pgn)
+		h = (h + 1) & (PGN_HASH_SIZE - 1);
+	    pgn_hash[h].pgn = work->pgn;
+	    pgn_hash[h].entry[list] = work;
+	}
+    }
+    pgn_hash_ready = true;
+}
+
+static PGN *search_pgnlist(unsigned int pgn, unsigned int *list)
+/* find a PGN in list *list, or if that is 0 the first list that has it */
+{
+    unsigned int h = pgn_hash_index(pgn);
+
+    while (pgn_hash[h].pgn != 0) {
+	if (pgn_hash[h].pgn == pgn) {
+	    unsigned int l;
+
+	    if (*list != 0)
+		return pgn_hash[h].entry[*list];
+	    for (l = 1; l < PGN_LISTS; l++)
+		if (pgn_hash[h].entry[l] != NULL) {
+		    *list = l;
+		    return pgn_hash[h].entry[l];
+		}
+	    return NULL;
+	}
+	h = (h + 1) & (PGN_HASH_SIZE - 1);
+    }
+    return NULL;
+}
+
+static void fast_packet(struct can_frame *frame, PGN *work,
+			unsigned int source, struct gps_device_t *session)
+/* add a fast-packet frame to the pool, shipping the packet once complete */
+{
+    struct nmea2000_fast_t *pool = session->driver.nmea2000.fast;
+    struct nmea2000_fast_t *slot = NULL;
+    unsigned int seq = (frame->data[0] >> 5) & 0x07;
+    unsigned int counter = frame->data[0] & 0x1f;
+    size_t dlc = frame->can_dlc & 0x0f;
+    size_t first, n;
+    int i;
+
+    if (dlc > 8)
+	dlc = 8;
+    /*
+     * Packets are keyed by source, PGN and sequence counter so that
+     * interleaved fast-packets reassemble independently.
+     */
+    for (i = 0; i < NMEA2000_FAST_SLOTS; i++)
+	if (pool[i].frame != 0 && pool[i].source == source
+	    && pool[i].pgn == work->pgn && pool[i].seq == seq) {
+	    slot = &pool[i];
 	    break;
+	}
+
+    if (counter == 0) {
+	if (dlc < 2 || frame->data[1] > NMEA2000_FAST_MAX) {
+	    gpsd_log(&session->context->errout, LOG_ERROR,
+		     "NMEA2000: bad fast-packet header for pgn %6d\n",
+		     work->pgn);
+	    session->driver.nmea2000.fast_dropped++;
+	    return;
+	}
+	if (slot != NULL) {
+	    /* a restart; the frames we held are useless */
+	    session->driver.nmea2000.fast_dropped++;
 	} else {
-	    l1 = l1 + 1;
+	    /* take a free slot, else the least recently used one */
+	    for (i = 0; i < NMEA2000_FAST_SLOTS; i++) {
+		if (pool[i].frame == 0) {
+		    slot = &pool[i];
+		    break;
+		}
+		if (slot == NULL || pool[i].used < slot->used)
+		    slot = &pool[i];
+	    }
+	    if (slot->frame != 0) {
+		gpsd_log(&session->context->errout, LOG_INF,
+			 "NMEA2000: fast-packet pool full, evicting pgn %6d\n",
+			 slot->pgn);
+		session->driver.nmea2000.fast_evicted++;
 	    }
 	}
-    return work;
+#if NMEA2000_FAST_DEBUG
+	gpsd_log(&session->context->errout, LOG_ERROR,
+		 "Set idx    %2x    %2x %2x %6d\n",
+		 frame->data[0], source, frame->data[1], work->pgn);
+#endif /* of #if NMEA2000_FAST_DEBUG */
+	slot->source = source;
+	slot->pgn = work->pgn;
+	slot->seq = seq;
+	slot->len = frame->data[1];
+	slot->got = 0;
+	first = 2;
+	gpsd_log(&session->context->errout, LOG_DATA,
+		 "pgn %6d:%s \n", work->pgn, work->name);
+    } else if (slot == NULL || counter != slot->frame) {
+	gpsd_log(&session->context->errout, LOG_ERROR,
+		 "Fast error %2x %2x %2x %2x %6d\n",
+		 slot != NULL ? slot->frame : 0,
+		 frame->data[0],
+		 source,
+		 slot != NULL ? (unsigned int)slot->len : 0,
+		 work->pgn);
+	session->driver.nmea2000.fast_dropped++;
+	if (slot != NULL)
+	    slot->frame = 0;
+	return;
+    } else
+	first = 1;
+
+    if (dlc > first) {
+	n = MIN(dlc - first, slot->len - slot->got);
+	memcpy(slot->data + slot->got, frame->data + first, n);
+	slot->got += n;
+    }
+    slot->frame = counter + 1;
+    slot->used = ++session->driver.nmea2000.fast_serial;
+
+    if (slot->got == slot->len) {
+#if NMEA2000_FAST_DEBUG
+	gpsd_log(&session->context->errout, LOG_ERROR,
+		 "Fast done  %2x %2x %2x %2x %6d\n",
+		 slot->frame, frame->data[0], source,
+		 (unsigned int)slot->len, work->pgn);
+#endif /* of #if  NMEA2000_FAST_DEBUG */
+	session->driver.nmea2000.workpgn = (void *) work;
+	session->lexer.outbuflen = slot->len;
+	memcpy(session->lexer.outbuffer, slot->data, slot->len);
+	slot->frame = 0;
+    }
 }
 
 static void find_pgn(struct can_frame *frame, struct gps_device_t *session)
@@ -1425,28 +1561,11 @@ static void find_pgn(struct can_frame *frame, struct gps_device_t *session)
 
 	if (source_unit == session->driver.nmea2000.unit) {
 	    PGN *work;
-	    if (session->driver.nmea2000.pgnlist != NULL) {
-	        work = search_pgnlist(source_pgn, session->driver.nmea2000.pgnlist);
-	    } else {
-	        PGN *pgnlist;
+	    unsigned int list = session->driver.nmea2000.pgnlist;
 
-		pgnlist = &gpspgn[0];
-		work = search_pgnlist(source_pgn, pgnlist);
-		if (work == NULL) {
-		    pgnlist = &aispgn[0];
-		    work = search_pgnlist(source_pgn, pgnlist);
-		}
-		if (work == NULL) {
-		    pgnlist = &pwrpgn[0];
-		    work = search_pgnlist(source_pgn, pgnlist);
-		}
-		if (work == NULL) {
-		    pgnlist = &navpgn[0];
-		    work = search_pgnlist(source_pgn, pgnlist);
-		}
-		if ((work != NULL) && (work->type > 0)) {
-		    session->driver.nmea2000.pgnlist = pgnlist;
-		}
+	    work = search_pgnlist(source_pgn, &list);
+	    if ((work != NULL) && (work->type > 0)) {
+	        session->driver.nmea2000.pgnlist = list;
 	    }
 	    if (work != NULL) {
 	        if (work->fast == 0) {
@@ -1459,61 +1578,8 @@ static void find_pgn(struct can_frame *frame, struct gps_device_t *session)
 		    for (l2=0;l2<session->lexer.outbuflen;l2++) {
 		        session->lexer.outbuffer[l2]= frame->data[l2];
 		    }
-		} else if ((frame->data[0] & 0x1f) == 0) {
-		    unsigned int l2;
-
-		    session->driver.nmea2000.fast_packet_len = frame->data[1];
-		    session->driver.nmea2000.idx = frame->data[0];
-#if NMEA2000_FAST_DEBUG
-		    gpsd_log(&session->context->errout, LOG_ERROR,
-			     "Set idx    %2x    %2x %2x %6d\n",
-			     frame->data[0],
-			     session->driver.nmea2000.unit,
-			     frame->data[1],
-			     source_pgn);
-#endif /* of #if NMEA2000_FAST_DEBUG */
-		    session->lexer.inbuflen = 0;
-		    session->driver.nmea2000.idx += 1;
-		    for (l2=2;l2<8;l2++) {
-		        session->lexer.inbuffer[session->lexer.inbuflen++] = frame->data[l2];
-		    }
-		    gpsd_log(&session->context->errout, LOG_DATA,
-			     "pgn %6d:%s \n", work->pgn, work->name);
-		} else if (frame->data[0] == session->driver.nmea2000.idx) {
-		    unsigned int l2;
-
-		    for (l2=1;l2<8;l2++) {
-		        if (session->driver.nmea2000.fast_packet_len > session->lexer.inbuflen) {
-			    session->lexer.inbuffer[session->lexer.inbuflen++] = frame->data[l2];
-			}
-		    }
-		    if (session->lexer.inbuflen == session->driver.nmea2000.fast_packet_len) {
-#if NMEA2000_FAST_DEBUG
-		        gpsd_log(&session->context->errout, LOG_ERROR,
-				 "Fast done  %2x %2x %2x %2x %6d\n",
-				 session->driver.nmea2000.idx,
-				                                                   frame->data[0],
-				                                                   session->driver.nmea2000.unit,
-				                                                   (unsigned int) session->driver.nmea2000.fast_packet_len,
-				                                                   source_pgn);
-#endif /* of #if  NMEA2000_FAST_DEBUG */
-			session->driver.nmea2000.workpgn = (void *) work;
-		        session->lexer.outbuflen = session->driver.nmea2000.fast_packet_len;
-			for(l2=0;l2 < (unsigned int)session->lexer.outbuflen; l2++) {
-			    session->lexer.outbuffer[l2] = session->lexer.inbuffer[l2];
-			}
-			session->driver.nmea2000.fast_packet_len = 0;
-		    } else {
-		        session->driver.nmea2000.idx += 1;
-		    }
 		} else {
-		    gpsd_log(&session->context->errout, LOG_ERROR,
-			     "Fast error %2x %2x %2x %2x %6d\n",
-			     session->driver.nmea2000.idx,
-			     frame->data[0],
-			     session->driver.nmea2000.unit,
-			     (unsigned int) session->driver.nmea2000.fast_packet_len,
-				                                               source_pgn);
+		    fast_packet(frame, work, source_unit, session);
 		}
 	    } else {
 	        gpsd_log(&session->context->errout, LOG_WARN,
@@ -1541,20 +1607,69 @@ static void find_pgn(struct can_frame *frame, struct gps_device_t *session)
 }
 
 
+static unsigned int nmea2000_read(struct gps_device_t *session)
+/* fetch a batch of CAN frames into the session, return how many */
+{
+    struct can_frame *frames = session->driver.nmea2000.frames;
+    unsigned int n = 0;
+#ifdef HAVE_RECVMMSG
+    struct mmsghdr msgs[NMEA2000_BATCH];
+    struct iovec iov[NMEA2000_BATCH];
+    unsigned int i;
+    int status;
+
+    memset(msgs, 0, sizeof(msgs));
+    for (i = 0; i < NMEA2000_BATCH; i++) {
+	iov[i].iov_base = &frames[i];
+	iov[i].iov_len = sizeof(frames[i]);
+	msgs[i].msg_hdr.msg_iov = &iov[i];
+	msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    status = recvmmsg(session->gpsdata.gps_fd, msgs, NMEA2000_BATCH,
+		      MSG_DONTWAIT, NULL);
+    /* keep only whole frames, closing up the gaps */
+    for (i = 0; status > 0 && i < (unsigned int)status; i++)
+	if (msgs[i].msg_len == sizeof(struct can_frame)) {
+	    if (n != i)
+		frames[n] = frames[i];
+	    n++;
+	}
+#else
+    if (read(session->gpsdata.gps_fd, &frames[0], sizeof(frames[0]))
+	== (ssize_t)sizeof(frames[0]))
+	n = 1;
+#endif /* HAVE_RECVMMSG */
+    session->driver.nmea2000.nframes = n;
+    session->driver.nmea2000.nextframe = 0;
+    return n;
+}
+
 static ssize_t nmea2000_get(struct gps_device_t *session)
+/* decode frames until one completes a packet or the batch runs out */
 {
-    struct can_frame frame;
-    ssize_t          status;
+    ssize_t len = 0;
 
     session->lexer.outbuflen = 0;
-    status = read(session->gpsdata.gps_fd, &frame, sizeof(frame));
-    if (status == (ssize_t)sizeof(frame)) {
-        session->lexer.type = NMEA2000_PACKET;
-	find_pgn(&frame, session);
+    if (session->driver.nmea2000.nextframe >= session->driver.nmea2000.nframes
+	&& nmea2000_read(session) == 0)
+	return 0;
+
+    /*
+     * The batch is drained before returning without a packet, since
+     * frames left in it would not make the socket select as readable.
+     */
+    while (session->driver.nmea2000.nextframe
+	   < session->driver.nmea2000.nframes) {
+	struct can_frame *frame =
+	    &session->driver.nmea2000.frames[session->driver.nmea2000.nextframe++];
 
-        return frame.can_dlc & 0x0f;
+        session->lexer.type = NMEA2000_PACKET;
+	find_pgn(frame, session);
+	len += frame->can_dlc & 0x0f;
+	if (session->driver.nmea2000.workpgn != NULL)
+	    break;
     }
-    return 0;
+    return len;
 }
 
 static gps_mask_t nmea2000_parse_input(struct gps_device_t *session)
@@ -1694,6 +1809,7 @@ int nmea2000_open(struct gps_device_t *session)
 	return -1;
     }
 
+    pgn_hash_init();
     gpsd_switch_driver(session, "NMEA2000");
     session->gpsdata.gps_fd = sock;
     session->sourcetype = source_can;
@@ -26,6 +26,15 @@ Decodes of the following types have been verified: 1004, 1005, 1006,
 1008, 1012, 1013, 1029. There is good reason to believe the 1007 code
 is correct, as it's identical to 1008 up to where it ends.
 
+The Multiple Signal Messages (MSM) added in RTCM 10403.2 are decoded
+for MSM4 through MSM7 of every constellation.  An MSM carries a
+satellite mask, a signal mask and a cell mask saying which signals
+were observed on which satellite, followed by the satellite fields and
+then the cell fields, each field for every satellite or cell in turn.
+The MSM7 decode of the 1077/1087/1097/1107 stream in the regression
+tests gives plausible ranges and rates; MSM4-6 are covered only by
+synthetic test data.
+
 The 1033 decode was arrived at by looking at an rtcminspect dump and noting
 that it carries an information superset of the 1008.  There are additional
 Receiver and Firmware fields we're not certain to decode without access
@@ -39,6 +48,7 @@ BSD terms apply: see the file COPYING in the distribution root for details.
 *****************************************************************************/
 
 #include <string.h>
+#include <math.h>
 
 #include "gpsd.h"
 #include "bits.h"
@@ -54,16 +64,173 @@ BSD terms apply: see the file COPYING in the distribution root for details.
 #define ANTENNA_DEGREE_RESOLUTION	25e-6	/* DF062 */
 #define GPS_EPOCH_TIME_RESOLUTION	0.1	/* DF065 */
 #define PHASE_CORRECTION_RESOLUTION	0.5	/* DF069-070 */
+#define MSM_RANGE_MS		299792.458	/* meters per light-ms */
+#define MSM_ROUGH_RESOLUTION	(1.0 / 1024)	/* DF398, ms */
+#define MSM_FINE_RANGE		0x1p-24		/* DF400, ms */
+#define MSM_FINE_PHASE		0x1p-29		/* DF401, ms */
+#define MSM_FINE_RANGE_EXT	0x1p-29		/* DF405, ms */
+#define MSM_FINE_PHASE_EXT	0x1p-31		/* DF406, ms */
+#define MSM_FINE_RATE		0.0001		/* DF404, m/s */
+#define MSM_CNR_EXT		0.0625		/* DF408, dB-Hz */
 
 
 /* Other magic values */
 #define GPS_INVALID_PSEUDORANGE		0x80000	/* DF012, DF018 */
 #define GLONASS_INVALID_RANGEINCR	0x2000	/* DF047 */
 #define GLONASS_CHANNEL_BASE		7	/* DF040 */
+#define MSM_INVALID_ROUGH		255	/* DF397 */
+#define MSM_INVALID_RATE		-8192	/* DF399 */
+#define MSM_INVALID_FINE_RANGE		-16384	/* DF400 */
+#define MSM_INVALID_FINE_PHASE		-2097152	/* DF401 */
+#define MSM_INVALID_FINE_RATE		-16384	/* DF404 */
+#define MSM_INVALID_FINE_RANGE_EXT	-524288	/* DF405 */
+#define MSM_INVALID_FINE_PHASE_EXT	-8388608	/* DF406 */
 
 /* Large case statements make GNU indent very confused */
 /* *INDENT-OFF* */
 
+static void rtcm3_decode_msm(const struct gps_context_t *context,
+			     struct rtcm3_t *rtcm, struct bitreader_t *br)
+/* unpack an MSM4, MSM5, MSM6 or MSM7; no observations if it won't fit */
+{
+    struct rtcm3_msm_t *msm = &rtcm->rtcmtypes.rtcm3_msm;
+    const unsigned int kind = RTCM3_MSM(rtcm->type);
+    /* MSM5 and MSM7 add rates and satellite info, MSM6 and 7 resolution */
+    const bool rates = (kind == 5 || kind == 7);
+    const bool extended = (kind >= 6);
+    unsigned char satids[RTCM3_MAX_SATELLITES], sigids[32];
+    uint64_t satmask, cellmask;
+    uint32_t sigmask;
+    unsigned int i, j, bits;
+
+    /* the reader is just past the message type */
+#define ugrab(width)	bitreader_ubits(br, width)
+#define sgrab(width)	bitreader_sbits(br, width)
+    msm->station_id = (unsigned int)ugrab(12);
+    if (rtcm->type / 10 == 108) {
+	msm->glonass_day = (unsigned int)ugrab(3);
+	msm->tow = (unsigned int)ugrab(27);
+    } else
+	msm->tow = (unsigned int)ugrab(30);
+    msm->sync = (bool)ugrab(1);
+    msm->iods = (unsigned int)ugrab(3);
+    bitreader_skip(br, 7);	/* reserved */
+    msm->steering = (unsigned int)ugrab(2);
+    msm->extclock = (unsigned int)ugrab(2);
+    msm->smoothing = (bool)ugrab(1);
+    msm->interval = (unsigned int)ugrab(3);
+
+    /* masks are MSB first: the first bit is satellite or signal 1 */
+    satmask = ugrab(64);
+    sigmask = (uint32_t)ugrab(32);
+    msm->nsat = msm->nsig = msm->ncell = 0;
+    for (i = 0; i < 64; i++)
+	if ((satmask >> (63 - i)) & 1)
+	    satids[msm->nsat++] = (unsigned char)(i + 1);
+    for (i = 0; i < 32; i++)
+	if ((sigmask >> (31 - i)) & 1)
+	    sigids[msm->nsig++] = (unsigned char)(i + 1);
+    if (msm->nsat * msm->nsig > RTCM3_MSM_CELLS) {
+	gpsd_log(&context->errout, LOG_WARN,
+		 "RTCM3: type %u has %u satellites by %u signals\n",
+		 rtcm->type, msm->nsat, msm->nsig);
+	msm->nsat = msm->nsig = 0;
+	return;
+    }
+    bits = msm->nsat * msm->nsig;
+    cellmask = ugrab(bits);
+    for (i = 0; i < bits; i++)
+	if ((cellmask >> (bits - 1 - i)) & 1) {
+	    msm->cells[msm->ncell].sat = satids[i / msm->nsig];
+	    msm->cells[msm->ncell].signal = sigids[i % msm->nsig];
+	    msm->ncell++;
+	}
+
+    /* don't read satellite and cell fields past the end of the payload */
+    bits = (unsigned int)bitreader_tell(br) + msm->nsat * (rates ? 36 : 18)
+	+ msm->ncell * (extended ? 65 : 48) + msm->ncell * (rates ? 15 : 0);
+    if (bits > rtcm->length * 8 + 24) {
+	gpsd_log(&context->errout, LOG_WARN,
+		 "RTCM3: type %u needs %u bits, has %u\n",
+		 rtcm->type, bits, rtcm->length * 8 + 24);
+	msm->nsat = msm->nsig = msm->ncell = 0;
+	return;
+    }
+
+#define SAT	msm->sats[i]
+#define CELL	msm->cells[i]
+    /* satellite fields: rough range in ms, then extended info and rate */
+    for (i = 0; i < msm->nsat; i++) {
+	unsigned int ms = (unsigned int)ugrab(8);
+	SAT.ident = satids[i];
+	SAT.rough_range = (ms == MSM_INVALID_ROUGH) ? NAN : ms;
+	SAT.extended = 0;
+	SAT.rate = NAN;
+    }
+    if (rates)
+	for (i = 0; i < msm->nsat; i++)
+	    SAT.extended = (unsigned short)ugrab(4);
+    for (i = 0; i < msm->nsat; i++)
+	SAT.rough_range += ugrab(10) * MSM_ROUGH_RESOLUTION;
+    if (rates)
+	for (i = 0; i < msm->nsat; i++) {
+	    int rate = (int)sgrab(14);
+	    if (rate != MSM_INVALID_RATE)
+		SAT.rate = rate;
+	}
+
+    /* cell fields: fine pseudorange and phase range, in ms */
+    for (i = 0; i < msm->ncell; i++) {
+	int fine = (int)sgrab(extended ? 20 : 15);
+	if (fine == (extended ? MSM_INVALID_FINE_RANGE_EXT
+		     : MSM_INVALID_FINE_RANGE))
+	    CELL.pseudorange = NAN;
+	else
+	    CELL.pseudorange = fine * (extended ? MSM_FINE_RANGE_EXT
+				       : MSM_FINE_RANGE);
+    }
+    for (i = 0; i < msm->ncell; i++) {
+	int fine = (int)sgrab(extended ? 24 : 22);
+	if (fine == (extended ? MSM_INVALID_FINE_PHASE_EXT
+		     : MSM_INVALID_FINE_PHASE))
+	    CELL.phaserange = NAN;
+	else
+	    CELL.phaserange = fine * (extended ? MSM_FINE_PHASE_EXT
+				      : MSM_FINE_PHASE);
+    }
+    for (i = 0; i < msm->ncell; i++)
+	CELL.locktime = (unsigned short)ugrab(extended ? 10 : 4);
+    for (i = 0; i < msm->ncell; i++)
+	CELL.halfcycle = (bool)ugrab(1);
+    for (i = 0; i < msm->ncell; i++)
+	CELL.CNR = extended ? ugrab(10) * MSM_CNR_EXT : (double)ugrab(6);
+    for (i = 0; i < msm->ncell; i++) {
+	CELL.rate = NAN;
+	if (rates) {
+	    int fine = (int)sgrab(15);
+	    if (fine != MSM_INVALID_FINE_RATE)
+		CELL.rate = fine * MSM_FINE_RATE;
+	}
+    }
+
+    /* add each cell's fine values to its satellite's rough ones */
+    for (i = 0, j = 0; i < msm->ncell; i++) {
+	while (msm->sats[j].ident != CELL.sat)
+	    j++;
+	CELL.pseudorange = (CELL.pseudorange + msm->sats[j].rough_range)
+	    * MSM_RANGE_MS;
+	CELL.phaserange = (CELL.phaserange + msm->sats[j].rough_range)
+	    * MSM_RANGE_MS;
+	CELL.rate += msm->sats[j].rate;
+    }
+    for (i = 0; i < msm->nsat; i++)
+	SAT.rough_range *= MSM_RANGE_MS;
+#undef CELL
+#undef SAT
+#undef sgrab
+#undef ugrab
+}
+
 /* good source on message types:
  * https://software.rtcm-ntrip.org/export/HEAD/ntrip/trunk/BNC/src/bnchelp.html
  * Also look in the BNC source
@@ -74,13 +241,13 @@ void rtcm3_unpack(const struct gps_context_t *context,
 /* break out the raw bits into the scaled report-structure fields */
 {
     unsigned int n, n2, n3, n4;
-    int bitcount = 0;
+    struct bitreader_t br;
     unsigned int i;
     signed long temp;
     bool unknown = true;;
 
-#define ugrab(width)	(bitcount += width, ubits((unsigned char *)buf, bitcount-width, width, false))
-#define sgrab(width)	(bitcount += width, sbits((signed char *)buf, bitcount-width, width, false))
+#define ugrab(width)	bitreader_ubits(&br, width)
+#define sgrab(width)	bitreader_sbits(&br, width)
 #define GPS_PSEUDORANGE(fld, len) \
     {temp = (unsigned long)ugrab(len);		\
     if (temp == GPS_INVALID_PSEUDORANGE)	\
@@ -94,11 +261,16 @@ void rtcm3_unpack(const struct gps_context_t *context,
     else					\
 	fld.rangediff = temp * PSEUDORANGE_DIFF_RESOLUTION;
 
+    /* the lexer has checked the CRC, so the length can be trusted */
+    bitreader_init(&br, (unsigned char *)buf, 3);
     //assert(ugrab(8) == 0xD3);
     //assert(ugrab(6) == 0x00);
     ugrab(14);
-
     rtcm->length = (unsigned int)ugrab(10);
+
+    /* fields past the end of the payload read as zero */
+    bitreader_init(&br, (unsigned char *)buf, rtcm->length + 3);
+    bitreader_skip(&br, 24);
     rtcm->type = (unsigned int)ugrab(12);
 
     gpsd_log(&context->errout, LOG_RAW, "RTCM3: type %d payload length %d\n",
@@ -251,7 +423,7 @@ void rtcm3_unpack(const struct gps_context_t *context,
 	n = (unsigned long)ugrab(8);
 	(void)memcpy(rtcm->rtcmtypes.rtcm3_1007.descriptor, buf + 7, n);
 	rtcm->rtcmtypes.rtcm3_1007.descriptor[n] = '\0';
-	bitcount += 8 * n;
+	bitreader_skip(&br, 8 * n);
 	rtcm->rtcmtypes.rtcm3_1007.setup_id = ugrab(8);
 	unknown = false;
 	break;
@@ -262,12 +434,12 @@ void rtcm3_unpack(const struct gps_context_t *context,
 	n = (unsigned long)ugrab(8);
 	(void)memcpy(rtcm->rtcmtypes.rtcm3_1008.descriptor, buf + 7, n);
 	rtcm->rtcmtypes.rtcm3_1008.descriptor[n] = '\0';
-	bitcount += 8 * n;
+	bitreader_skip(&br, 8 * n);
 	rtcm->rtcmtypes.rtcm3_1008.setup_id = ugrab(8);
 	n2 = (unsigned long)ugrab(8);
 	(void)memcpy(rtcm->rtcmtypes.rtcm3_1008.serial, buf + 9 + n, n2);
 	rtcm->rtcmtypes.rtcm3_1008.serial[n2] = '\0';
-	//bitcount += 8 * n2;
+	//bitreader_skip(&br, 8 * n2);
 	unknown = false;
 	break;
 
@@ -465,20 +637,20 @@ void rtcm3_unpack(const struct gps_context_t *context,
 	n = (unsigned long)ugrab(8);
 	(void)memcpy(rtcm->rtcmtypes.rtcm3_1033.descriptor, buf + 7, n);
 	rtcm->rtcmtypes.rtcm3_1033.descriptor[n] = '\0';
-	bitcount += 8 * n;
+	bitreader_skip(&br, 8 * n);
 	rtcm->rtcmtypes.rtcm3_1033.setup_id = ugrab(8);
 	n2 = (unsigned long)ugrab(8);
 	(void)memcpy(rtcm->rtcmtypes.rtcm3_1033.serial, buf + 9 + n, n2);
 	rtcm->rtcmtypes.rtcm3_1033.serial[n2] = '\0';
-	bitcount += 8 * n2;
+	bitreader_skip(&br, 8 * n2);
 	n3 = (unsigned long)ugrab(8);
 	(void)memcpy(rtcm->rtcmtypes.rtcm3_1033.receiver, buf + 10+n+n2, n3);
 	rtcm->rtcmtypes.rtcm3_1033.receiver[n3] = '\0';
-	bitcount += 8 * n3;
+	bitreader_skip(&br, 8 * n3);
 	n4 = (unsigned long)ugrab(8);
 	(void)memcpy(rtcm->rtcmtypes.rtcm3_1033.firmware, buf + 11+n+n2+n3, n3);
 	rtcm->rtcmtypes.rtcm3_1033.firmware[n4] = '\0';
-	//bitcount += 8 * n4;
+	//bitreader_skip(&br, 8 * n4);
 	// TODO: next is receiver serial number
 	unknown = false;
 	break;
@@ -514,59 +686,36 @@ void rtcm3_unpack(const struct gps_context_t *context,
 	/* TODO: rtklib has C code for this one.  */
 	break;
 
+    /*
+     * RTCM 3.2 Multiple Signal Messages 4-7, for GPS (107x), GLONASS
+     * (108x), Galileo (109x), SBAS (110x), QZSS (111x) and BeiDou (112x)
+     */
     case 1074:
-	/* RTCM 3.x
-	 * GPS Multi Signal Message
-	 */
-	break;
-
+    case 1075:
+    case 1076:
     case 1077:
-        /* RTCM 3.x - 1077
-	 * Full GPS pseudo-ranges, carrier phases, Doppler and
-	 * signal strength (high resolution)
-         * length 438
-	 */
-	/* TODO: rtklib has C code for this one.  */
-	break;
-
+    case 1084:
+    case 1085:
+    case 1086:
     case 1087:
-        /* RTCM 3.x - 1087
-	 * Full GLONASS pseudo-ranges, carrier phases, Doppler and
-	 * signal strength (high resolution)
-         * length 417 or 427
-	 */
-	/* TODO: rtklib has C code for this one.  */
-	break;
-
+    case 1094:
+    case 1095:
+    case 1096:
     case 1097:
-        /* RTCM 3.x - 1097
-         * Full Galileo pseudo-ranges, carrier phases, Doppler and
-	 * signal strength (high resolution)
-         * length 96
-	 */
-	/* TODO: rtklib has C code for this one.  */
-	break;
-
+    case 1104:
+    case 1105:
+    case 1106:
     case 1107:
-        /* RTCM 3.x - 1107
-	 * 'Multiple Signal Message
-         * Full SBAS pseudo-ranges, carrier phases, Doppler and
-	 * signal strength (high resolution)
-         * length 96
-	 */
-	/* TODO: rtklib has C code for this one.  */
-	break;
-
     case 1114:
-	/* RTCM 3.x
-	 * QZSS Multi Signal Message
-	 */
-	break;
-
+    case 1115:
+    case 1116:
+    case 1117:
     case 1124:
-	/* RTCM 3.x
-	 * BeiDou Multi Signal Message
-	 */
+    case 1125:
+    case 1126:
+    case 1127:
+	rtcm3_decode_msm(context, rtcm, &br);
+	unknown = false;
 	break;
 
     default:
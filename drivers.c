@@ -1350,35 +1350,93 @@ const struct gps_type_t driver_isync = {
  *
  **************************************************************************/
 
+static struct aivdm_context_t *aivdm_context(struct gps_device_t *session,
+					     const char *talker, char channel,
+					     int seqid, int nfrags, int ifrag)
+/* find the reassembly slot for a fragment, NULL if it must be dropped */
+{
+    struct aivdm_context_t *slot, *victim = NULL;
+    timestamp_t now = timestamp();
+    int i;
+
+    for (i = 0; i < AIVDM_REASSEMBLY_SLOTS; i++) {
+	slot = &session->driver.aivdm.context[i];
+	if (slot->decoded_frags == 0)
+	    continue;
+	if (now - slot->stamp > AIVDM_FRAGMENT_TIMEOUT) {
+	    gpsd_log(&session->context->errout, LOG_INF,
+		     "AIVDM fragment %d/%d of %c%c/%c/%d timed out.\n",
+		     slot->decoded_frags, slot->nfrags,
+		     slot->talker[0], slot->talker[1],
+		     slot->channel, slot->seqid);
+	    slot->decoded_frags = 0;
+	    session->driver.aivdm.fragments_expired++;
+	    continue;
+	}
+	if (slot->seqid == seqid && slot->channel == channel
+	    && slot->talker[0] == talker[0] && slot->talker[1] == talker[1]) {
+	    if (ifrag == slot->decoded_frags + 1 && nfrags == slot->nfrags) {
+		slot->stamp = now;
+		return slot;
+	    }
+	    /* a restart or a gap; whatever we held is useless */
+	    gpsd_log(&session->context->errout, LOG_ERROR,
+		     "invalid fragment #%d received, expected #%d.\n",
+		     ifrag, slot->decoded_frags + 1);
+	    slot->decoded_frags = 0;
+	    session->driver.aivdm.fragments_dropped++;
+	    break;
+	}
+    }
+
+    if (ifrag != 1) {
+	gpsd_log(&session->context->errout, LOG_INF,
+		 "orphan AIVDM fragment #%d of %c%c/%c/%d dropped.\n",
+		 ifrag, talker[0], talker[1], channel, seqid);
+	session->driver.aivdm.fragments_dropped++;
+	return NULL;
+    }
+
+    /* first fragment: take a free slot, else the stalest one */
+    for (i = 0; i < AIVDM_REASSEMBLY_SLOTS; i++) {
+	slot = &session->driver.aivdm.context[i];
+	if (slot->decoded_frags == 0) {
+	    victim = slot;
+	    break;
+	}
+	if (victim == NULL || slot->stamp < victim->stamp)
+	    victim = slot;
+    }
+    if (victim->decoded_frags != 0) {
+	gpsd_log(&session->context->errout, LOG_INF,
+		 "AIVDM reassembly table full, evicting %c%c/%c/%d.\n",
+		 victim->talker[0], victim->talker[1],
+		 victim->channel, victim->seqid);
+	session->driver.aivdm.fragments_evicted++;
+    }
+    victim->talker[0] = talker[0];
+    victim->talker[1] = talker[1];
+    victim->channel = channel;
+    victim->seqid = seqid;
+    victim->nfrags = nfrags;
+    victim->decoded_frags = 0;
+    victim->stamp = now;
+    victim->bitlen = 0;
+    return victim;
+}
+
 static bool aivdm_decode(const char *buf, size_t buflen,
 		  struct gps_device_t *session,
 		  struct ais_t *ais,
 		  int debug)
 {
-#ifdef __UNUSED_DEBUG__
-    char *sixbits[64] = {
-	"000000", "000001", "000010", "000011", "000100",
-	"000101", "000110", "000111", "001000", "001001",
-	"001010", "001011", "001100", "001101", "001110",
-	"001111", "010000", "010001", "010010", "010011",
-	"010100", "010101", "010110", "010111", "011000",
-	"011001", "011010", "011011", "011100", "011101",
-	"011110", "011111", "100000", "100001", "100010",
-	"100011", "100100", "100101", "100110", "100111",
-	"101000", "101001", "101010", "101011", "101100",
-	"101101", "101110", "101111", "110000", "110001",
-	"110010", "110011", "110100", "110101", "110110",
-	"110111", "111000", "111001", "111010", "111011",
-	"111100", "111101", "111110", "111111",
-    };
-#endif /* __UNUSED_DEBUG__ */
     int nfrags, ifrag, nfields = 0;
-    unsigned char *field[NMEA_MAX*2];
-    unsigned char fieldcopy[NMEA_MAX*2+1];
-    unsigned char *data, *cp;
+    /* the first seven fields are all we use; they end at ',' or '*' */
+    const unsigned char *field[7];
+    const unsigned char *data, *cp;
+    size_t datalen;
     int pad;
     struct aivdm_context_t *ais_context;
-    int i;
 
     if (buflen == 0)
 	return false;
@@ -1391,30 +1449,24 @@ static bool aivdm_decode(const char *buf, size_t buflen,
     memset(ais, 0, sizeof(*ais));
 
     /* discard overlong sentences */
-    if (strlen(buf) > sizeof(fieldcopy)-1) {
+    if (strlen(buf) > NMEA_MAX*2) {
 	gpsd_log(&session->context->errout, LOG_ERROR,
 		 "overlong AIVDM packet.\n");
 	return false;
     }
 
-    /* extract packet fields */
-    (void)strlcpy((char *)fieldcopy, buf, sizeof(fieldcopy));
-    field[nfields++] = (unsigned char *)buf;
-    for (cp = fieldcopy;
-	 cp < fieldcopy + buflen; cp++)
+    /* find the packet fields in place */
+    field[nfields++] = (const unsigned char *)buf;
+    for (cp = (const unsigned char *)buf;
+	 cp < (const unsigned char *)buf + buflen && nfields < 7; cp++)
     {
 	if (
              (*cp == (unsigned char)',') ||
              (*cp == (unsigned char)'*')
            ) {
-	    *cp = '\0';
 	    field[nfields++] = cp + 1;
 	}
     }
-#ifdef __UNDEF_DEBUG_
-    for(int i=0;i<nfields;i++)
-        gpsd_log(&session->context->errout, LOG_DATA, "field [%d] [%s]\n",i,field[i]);
-#endif
 
     /* discard sentences with exiguous commas; catches run-ons */
     if (nfields < 7) {
@@ -1424,7 +1476,8 @@ static bool aivdm_decode(const char *buf, size_t buflen,
     }
 
     switch (field[4][0]) {
-    case '\0':
+    case ',':
+    case '*':
 	/*
 	 * Apparently an empty channel is normal for AIVDO sentences,
 	 * which makes sense as they don't come in over radio.  This
@@ -1433,23 +1486,20 @@ static bool aivdm_decode(const char *buf, size_t buflen,
 	if (!str_starts_with((const char *)field[0], "!AIVDO"))
 	    gpsd_log(&session->context->errout, LOG_INF,
 		     "invalid empty AIS channel. Assuming 'A'\n");
-	ais_context = &session->driver.aivdm.context[0];
 	session->driver.aivdm.ais_channel ='A';
 	break;
     case '1':
-	if (strcmp((char *)field[4], (char *)"12") == 0) {
+	if (field[4][1] == '2' && field[5] == field[4] + 3) {
 	    gpsd_log(&session->context->errout, LOG_INF,
 		     "ignoring bogus AIS channel '12'.\n");
 	    return false;
 	}
 	/* fall through */
     case 'A':
-	ais_context = &session->driver.aivdm.context[0];
 	session->driver.aivdm.ais_channel ='A';
 	break;
     case '2':
     case 'B':
-	ais_context = &session->driver.aivdm.context[1];
 	session->driver.aivdm.ais_channel ='B';
 	break;
     case 'C':
@@ -1465,55 +1515,49 @@ static bool aivdm_decode(const char *buf, size_t buflen,
     nfrags = atoi((char *)field[1]); /* number of fragments to expect */
     ifrag = atoi((char *)field[2]); /* fragment id */
     data = field[5];
+    datalen = (size_t)(field[6] - field[5]) - 1;
 
     pad = 0;
     if(isdigit(field[6][0]))
         pad = field[6][0] - '0'; /* number of padding bits ASCII encoded*/
-    gpsd_log(&session->context->errout, LOG_PROG,
-	     "nfrags=%d, ifrag=%d, decoded_frags=%d, data=%s, pad=%d\n",
-	     nfrags, ifrag, ais_context->decoded_frags, data, pad);
-
-    /* assemble the binary data */
 
-    /* check fragment ordering */
-    if (ifrag != ais_context->decoded_frags + 1) {
-	gpsd_log(&session->context->errout, LOG_ERROR,
-		 "invalid fragment #%d received, expected #%d.\n",
-		 ifrag, ais_context->decoded_frags + 1);
-	if (ifrag != 1)
-	    return false;
-        /* else, ifrag==1: Just discard all that was previously decoded and
-         * simply handle that packet */
-        ais_context->decoded_frags = 0;
-    }
-    if (ifrag == 1) {
-	(void)memset(ais_context->bits, '\0', sizeof(ais_context->bits));
+    /*
+     * Multipart messages are keyed by talker, channel and sequential
+     * message ID, so interleaved messages from several transponders
+     * or a multiplexer merging receivers reassemble independently.
+     */
+    if (nfrags <= 1) {
+	ais_context = &session->driver.aivdm.single;
 	ais_context->bitlen = 0;
+	ais_context->decoded_frags = 0;
+    } else {
+	char talker[2];
+	int seqid = -1;
+
+	talker[0] = (char)field[0][1];
+	talker[1] = (char)field[0][2];
+	if (isdigit(field[3][0]))
+	    seqid = atoi((char *)field[3]);
+	ais_context = aivdm_context(session, talker,
+				    session->driver.aivdm.ais_channel,
+				    seqid, nfrags, ifrag);
+	if (ais_context == NULL)
+	    return false;
     }
+    gpsd_log(&session->context->errout, LOG_PROG,
+	     "nfrags=%d, ifrag=%d, decoded_frags=%d, data=%.*s, pad=%d\n",
+	     nfrags, ifrag, ais_context->decoded_frags,
+	     (int)datalen, (const char *)data, pad);
+
+    /* assemble the binary data */
 
     /* wacky 6-bit encoding, shades of FIELDATA */
-    for (cp = data; cp < data + strlen((char *)data); cp++) {
-	unsigned char ch;
-	ch = *cp;
-	ch -= 48;
-	if (ch >= 40)
-	    ch -= 8;
-#ifdef __UNUSED_DEBUG__
-	gpsd_log(&session->context->errout, LOG_RAW,
-		 "%c: %s\n", *cp, sixbits[ch]);
-#endif /* __UNUSED_DEBUG__ */
-	for (i = 5; i >= 0; i--) {
-	    if ((ch >> i) & 0x01) {
-		ais_context->bits[ais_context->bitlen / 8] |=
-		    (1 << (7 - ais_context->bitlen % 8));
-	    }
-	    ais_context->bitlen++;
-	    if (ais_context->bitlen > sizeof(ais_context->bits)) {
-		gpsd_log(&session->context->errout, LOG_INF,
-			 "overlong AIVDM payload truncated.\n");
-		return false;
-	    }
-	}
+    if (!ais_dearmor(data, datalen, ais_context->bits, &ais_context->bitlen,
+		     sizeof(ais_context->bits) * CHAR_BIT)) {
+	gpsd_log(&session->context->errout, LOG_INF,
+		 "overlong AIVDM payload truncated.\n");
+	ais_context->decoded_frags = 0;
+	return false;
     }
     ais_context->bitlen -= pad;
 
@@ -1528,15 +1572,26 @@ static bool aivdm_decode(const char *buf, size_t buflen,
 				     (char *)ais_context->bits, clen));
 	}
 
-        /* clear waiting fragments count */
+        /* free the slot */
         ais_context->decoded_frags = 0;
+	if (nfrags > 1)
+	    gpsd_log(&session->context->errout, LOG_PROG,
+		     "AIVDM fragments: %lu dropped, %lu expired, "
+		     "%lu evicted; 24A: %lu stashed, %lu matched, "
+		     "%lu evicted\n",
+		     session->driver.aivdm.fragments_dropped,
+		     session->driver.aivdm.fragments_expired,
+		     session->driver.aivdm.fragments_evicted,
+		     session->driver.aivdm.type24.stashed,
+		     session->driver.aivdm.type24.matched,
+		     session->driver.aivdm.type24.evicted);
 
 	/* decode the assembled binary packet */
 	return ais_binary_decode(&session->context->errout,
 				 ais,
 				 ais_context->bits,
 				 ais_context->bitlen,
-				 &ais_context->type24_queue);
+				 &session->driver.aivdm.type24);
     }
 
     /* we're still waiting on another sentence */
@@ -36,9 +36,16 @@ extern "C" {
  *       structure has changed to make working with the satellites-used
  *       bits less confusing. (January 2015, release 3.12).
  * 6.1 - Add navdata_t for more (nmea2000) info.
+ * 6.2 - Add backlog policy to policy_t.
+ * 6.3 - Add gps_shm_updates(); shared-memory export is now a per-device
+ *       ring of updates.
+ * 6.4 - Add gps_read_batch().
+ * 6.5 - Add binary to policy_t and WATCH_BINARY, for binary report records.
+ * 6.6 - Add classes, fields and interval to policy_t, for report filtering.
+ * 6.7 - Add rtcm3_msm_t for RTCM3 MSM4 to MSM7 observations.
  */
 #define GPSD_API_MAJOR_VERSION	6	/* bump on incompatible changes */
-#define GPSD_API_MINOR_VERSION	1	/* bump on compatible changes */
+#define GPSD_API_MINOR_VERSION	7	/* bump on compatible changes */
 
 #define MAXCHANNELS	72	/* must be > 12 GPS + 12 GLONASS + 2 WAAS */
 #define MAXUSERDEVS	4	/* max devices per user */
@@ -319,6 +326,53 @@ struct rtcm3_correction_diff {
 				   Correction Difference (1015, 1017) */
 };
 
+/*
+ * Multiple Signal Messages, 1071-1127: types 107x are GPS, 108x GLONASS,
+ * 109x Galileo, 110x SBAS, 111x QZSS and 112x BeiDou, and the last digit
+ * is the MSM number.  MSM4 to MSM7 carry full observables and are decoded
+ * into struct rtcm3_msm_t; this says which one a type is, else 0.
+ */
+#define RTCM3_MSM(type)	(((type) >= 1071 && (type) <= 1127 \
+			  && (type) % 10 >= 4 && (type) % 10 <= 7) \
+			 ? (type) % 10 : 0)
+#define RTCM3_MSM_CELLS	64	/* satellites times signals, at most */
+
+struct rtcm3_msm_sat {
+    unsigned short ident;	/* Satellite ID, 1-64 */
+    unsigned short extended;	/* Extended satellite info (MSM5, MSM7) */
+    double rough_range;		/* Rough range in meters, NaN if invalid */
+    double rate;		/* Rough phase range rate in m/s (MSM5, MSM7) */
+};
+
+struct rtcm3_msm_cell {
+    unsigned short sat;		/* Satellite ID, 1-64 */
+    unsigned short signal;	/* Signal ID, 1-32 */
+    bool halfcycle;		/* Half-cycle ambiguity indicator */
+    unsigned short locktime;	/* Lock time indicator */
+    double pseudorange;		/* Full pseudorange in meters, or NaN */
+    double phaserange;		/* Full phase range in meters, or NaN */
+    double rate;		/* Phase range rate in m/s (MSM5, MSM7) */
+    double CNR;			/* Carrier-to-Noise Ratio, 0 if unknown */
+};
+
+struct rtcm3_msm_t {
+    unsigned int station_id;	/* Reference Station ID */
+    unsigned int tow;		/* Epoch time in ms: time of week, or
+				   GLONASS time of day */
+    unsigned int glonass_day;	/* GLONASS day of week (GLONASS only) */
+    bool sync;			/* Multiple Message Bit */
+    unsigned int iods;		/* Issue of Data Station */
+    unsigned int steering;	/* Clock Steering Indicator */
+    unsigned int extclock;	/* External Clock Indicator */
+    bool smoothing;		/* Divergence-free Smoothing Indicator */
+    unsigned int interval;	/* Smoothing Interval */
+    unsigned short nsat;		/* satellites in the satellite mask */
+    unsigned short nsig;		/* signals in the signal mask */
+    unsigned short ncell;	/* cells set in the cell mask */
+    struct rtcm3_msm_sat sats[RTCM3_MAX_SATELLITES];
+    struct rtcm3_msm_cell cells[RTCM3_MSM_CELLS];
+};
+
 struct rtcm3_t {
     /* header contents */
     unsigned type;	/* RTCM 3.x message type */
@@ -533,6 +587,8 @@ struct rtcm3_t {
 	    char receiver[RTCM3_MAX_DESCRIPTOR+1];	/* Receiver string */
 	    char firmware[RTCM3_MAX_DESCRIPTOR+1];	/* Firmware string */
 	} rtcm3_1033;
+	/* 1071-1127 were added in the 3.2 version */
+	struct rtcm3_msm_t rtcm3_msm;	/* see RTCM3_MSM() */
 	unsigned char data[1024];	/* Max RTCM3 msg length is 1023 bytes */
     } rtcmtypes;
 };
@@ -1911,6 +1967,42 @@ struct policy_t {
     bool timing;			/* requesting timing info */
     bool split24;			/* requesting split AIS Type 24s */
     bool pps;				/* requesting PPS in NMEA/raw modes */
+    bool binary;			/* requesting binary records for JSON */
+    int backlog;			/* what to do when we fall behind */
+#define BACKLOG_DROP		0	/* drop the oldest queued reports */
+#define BACKLOG_COALESCE	1	/* keep only the latest TPV and SKY */
+#define BACKLOG_DISCONNECT	2	/* hang up */
+    unsigned int classes;		/* report classes wanted, 0 for all */
+#define CLASS_TPV	0x0001u
+#define CLASS_SKY	0x0002u
+#define CLASS_GST	0x0004u
+#define CLASS_ATT	0x0008u
+#define CLASS_SUBFRAME	0x0010u
+#define CLASS_RTCM2	0x0020u
+#define CLASS_RTCM3	0x0040u
+#define CLASS_AIS	0x0080u
+#define CLASS_OSC	0x0100u
+#define CLASS_PPS	0x0200u
+#define CLASS_TOFF	0x0400u
+#define CLASS_PPSSTATS	0x0800u		/* only if asked for by name */
+#define CLASS_LATENCY	0x1000u		/* only if asked for by name */
+    unsigned int fields;		/* TPV fields wanted, 0 for all */
+#define TPV_STATUS	0x0001u
+#define TPV_TIME	0x0002u
+#define TPV_EPT		0x0004u
+#define TPV_LAT		0x0008u
+#define TPV_LON		0x0010u
+#define TPV_ALT		0x0020u
+#define TPV_EPX		0x0040u
+#define TPV_EPY		0x0080u
+#define TPV_EPV		0x0100u
+#define TPV_TRACK	0x0200u
+#define TPV_SPEED	0x0400u
+#define TPV_CLIMB	0x0800u
+#define TPV_EPD		0x1000u
+#define TPV_EPS		0x2000u
+#define TPV_EPC		0x4000u
+    double interval;			/* min seconds between TPV/SKY/GST/ATT */
     int loglevel;			/* requested log level of messages */
     char devpath[GPS_PATH_MAX];		/* specific device to watch */
     char remote[GPS_PATH_MAX];		/* ...if this was passthrough */
@@ -1954,6 +2046,7 @@ typedef int socket_t;
 #define WATCH_DEVICE	0x000800u	/* watch specific device */
 #define WATCH_SPLIT24	0x001000u	/* split AIS Type 24s */
 #define WATCH_PPS	0x002000u	/* enable PPS JSON */
+#define WATCH_BINARY	0x004000u	/* binary records in place of JSON */
 #define WATCH_NEWSTYLE	0x010000u	/* force JSON streaming */
 
 /*
@@ -2076,11 +2169,15 @@ extern int gps_open(const char *, const char *,
 extern int gps_close(struct gps_data_t *);
 extern int gps_send(struct gps_data_t *, const char *, ... );
 extern int gps_read(struct gps_data_t *);
+extern int gps_read_batch(struct gps_data_t *,
+			  void (*)(struct gps_data_t *));
 extern int gps_unpack(char *, struct gps_data_t *);
 extern bool gps_waiting(const struct gps_data_t *, int);
 extern int gps_stream(struct gps_data_t *, unsigned int, void *);
 extern int gps_mainloop(struct gps_data_t *, int,
 			void (*)(struct gps_data_t *));
+extern int gps_shm_updates(struct gps_data_t *, unsigned long *,
+			   void (*)(struct gps_data_t *));
 extern const char *gps_data(const struct gps_data_t *);
 extern const char *gps_errstr(const int);
 
@@ -13,27 +13,37 @@
 #ifdef __cplusplus
 extern "C" {
 #endif
-void json_data_report(const gps_mask_t,
-		      const struct gps_device_t *,
-		      const struct policy_t *,
-		      char *, size_t);
+size_t json_data_report(const gps_mask_t,
+			const struct gps_device_t *,
+			const struct policy_t *,
+			char *, size_t);
 char *json_stringify(char *, size_t, const char *);
-void json_tpv_dump(const struct gps_device_t *,
-		   const struct policy_t *, char *, size_t);
-void json_noise_dump(const struct gps_data_t *, char *, size_t);
-void json_sky_dump(const struct gps_data_t *, char *, size_t);
-void json_att_dump(const struct gps_data_t *, char *, size_t);
-void json_oscillator_dump(const struct gps_data_t *, char *, size_t);
-void json_subframe_dump(const struct gps_data_t *, char buf[], size_t);
-void json_device_dump(const struct gps_device_t *, char *, size_t);
-void json_watch_dump(const struct policy_t *, char *, size_t);
+size_t json_tpv_dump(const struct gps_device_t *,
+		     const struct policy_t *, char *, size_t);
+size_t json_noise_dump(const struct gps_data_t *, char *, size_t);
+size_t json_sky_dump(const struct gps_data_t *, char *, size_t);
+size_t json_att_dump(const struct gps_data_t *, char *, size_t);
+size_t json_oscillator_dump(const struct gps_data_t *, char *, size_t);
+size_t json_subframe_dump(const struct gps_data_t *, char buf[], size_t);
+size_t json_device_dump(const struct gps_device_t *, char *, size_t);
+#ifdef PPS_ENABLE
+size_t json_ppsstats_dump(const struct gps_device_t *,
+			  const struct pps_stats_t *, char *, size_t);
+#endif /* PPS_ENABLE */
+#ifdef TIMING_ENABLE
+size_t json_latency_dump(const struct gps_device_t *, unsigned long,
+			 char *, size_t);
+#endif /* TIMING_ENABLE */
+size_t json_device_metrics_dump(const struct gps_device_t *, char *, size_t);
+size_t json_watch_dump(const struct policy_t *, char *, size_t);
 int json_watch_read(const char *, struct policy_t *,
 		    const char **);
+extern const struct json_enum_t watch_class_map[], watch_field_map[];
 int json_device_read(const char *, struct devconfig_t *,
 		     const char **);
-void json_version_dump(char *, size_t);
-void json_aivdm_dump(const struct ais_t *, const char *, bool,
-		     char *, size_t);
+size_t json_version_dump(char *, size_t);
+size_t json_aivdm_dump(const struct ais_t *, const char *, bool,
+		       char *, size_t);
 int json_rtcm2_read(const char *, char *, size_t, struct rtcm2_t *,
 		    const char **);
 int json_rtcm3_read(const char *, char *, size_t, struct rtcm3_t *,
@@ -42,6 +52,7 @@ int json_ais_read(const char *, char *, size_t, struct ais_t *,
 		  const char **);
 int libgps_json_unpack(const char *, struct gps_data_t *,
 		       const char **);
+gps_mask_t libgps_tpv_mask(const struct gps_fix_t *);
 #ifdef __cplusplus
 }
 #endif
@@ -24,6 +24,7 @@
 #include <sys/types.h>
 #include <sys/time.h>		/* for select() */
 #include <sys/select.h>
+#include <sys/uio.h>		/* for writev() */
 #include <stdio.h>
 #include <stdint.h>		/* for uint32_t, etc. */
 #include <time.h>
@@ -54,6 +55,12 @@
 #include <unistd.h>
 
 #include "gpsd_config.h"
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif /* HAVE_SYS_EPOLL_H */
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#endif /* HAVE_SYS_EVENTFD_H */
 
 #include "gpsd.h"
 #include "sockaddr.h"
@@ -81,9 +88,9 @@
  * reclaim client fds.  COMMAND_TIMEOUT fends off programs
  * that open connections and just sit there, not issuing a WATCH or
  * doing anything else that triggers a device assignment.  Clients
- * in watcher or raw mode that don't read their data will get dropped
- * when throttled_write() fills up the outbound buffers and the
- * NOREAD_TIMEOUT expires.
+ * in watcher or raw mode that don't read their data will get their
+ * output queued by throttled_write(), and will get dropped when that
+ * queue has made no progress for NOREAD_TIMEOUT.
  *
  * RELEASE_TIMEOUT sets the amount of time we hold a device
  * open after the last subscriber closes it; this is nonzero so a
@@ -111,6 +118,15 @@
 
 #define QLEN			5
 
+/*
+ * Client output queueing, see throttled_write().  OUTQ_SIZE bytes and
+ * OUTQ_DEPTH reports of output can be queued per client; past the
+ * high-water mark (settable with -Q) the client's backlog policy applies.
+ */
+#define OUTQ_SIZE		16384
+#define OUTQ_DEPTH		64
+#define OUTQ_HIGHWATER		(OUTQ_SIZE * 3 / 4)
+
 /*
  * If ntpshm is enabled, we renice the process to this priority level.
  * For precise timekeeping increase priority.
@@ -146,8 +162,6 @@ static const int af_allowed = AF_INET;
 
 #define AFCOUNT 2
 
-static fd_set all_fds;
-static int maxfd;
 static int highwater;
 #ifndef FORCE_GLOBAL_ENABLE
 static bool listen_global = false;
@@ -232,7 +246,7 @@ static void typelist(void)
 
 static void usage(void)
 {
-    (void)printf("usage: gpsd [-b] [-D n] [-F sockfile] [-G] [-h] [-n] [-N] [-P pidfile] [-S port] device...\n\
+    (void)printf("usage: gpsd [-b] [-D n] [-F sockfile] [-G] [-h] [-n] [-N] [-P pidfile] [-Q bytes] [-S port] device...\n\
   Options include: \n\
   -b		     	    = bluetooth-safe: open data sources read-only\n\
   -D integer (default 0)    = set debug level \n\
@@ -246,6 +260,7 @@ static void usage(void)
 #endif /* FORCE_NOWAIT */
 "  -N			    = don't go into background\n\
   -P pidfile	      	    = set file to record process ID\n\
+  -Q integer (default %d) = client output queue high-water mark\n\
   -r               	    = use GPS time even if no fix\n\
   -S integer (default %s) = set port for daemon \n\
   -V			    = emit version and exit.\n"
@@ -260,7 +275,7 @@ in which case it specifies an input source for device, DGPS or ntrip data.\n"
 #endif /* NETFEED_ENABLE */
 "\n\
 The following driver types are compiled into this gpsd instance:\n",
-		 DEFAULT_GPSD_PORT);
+		 OUTQ_HIGHWATER, DEFAULT_GPSD_PORT);
     typelist();
 }
 
@@ -306,22 +321,167 @@ static socket_t filesock(char *filename)
  */
 static struct gps_device_t devices[MAX_DEVICES];
 
-static void adjust_max_fd(int fd, bool on)
-/* track the largest fd currently in use */
+/*
+ * Event dispatch.  Every descriptor the daemon waits on is registered
+ * as a watch carrying a handler, and a wakeup only runs the handlers
+ * of the descriptors that are actually ready; nothing here scans
+ * 0..FD_SETSIZE or the whole client table.
+ *
+ * Handlers run in phases - listeners, then devices, then clients -
+ * so that device data arriving in the same wakeup as a client command
+ * is processed first, exactly as the old select loop did.
+ *
+ * Where epoll is available the watches live in an epoll set.
+ * Listener and client sockets are edge-triggered and their handlers
+ * drain them.  Devices stay level-triggered, because gpsd_multipoll()
+ * may legitimately leave input queued for the next pass.  Without
+ * epoll, or if creating the epoll instance fails at runtime, we fall
+ * back to pselect() through gpsd_await_data(); only that path is
+ * limited to descriptors below FD_SETSIZE.  That path has no write
+ * set, so a watch wanting output is simply dispatched on every wakeup.
+ */
+enum watch_phase_t {PHASE_LISTENER, PHASE_DEVICE, PHASE_CLIENT};
+#define PHASE_COUNT	3
+
+struct watch_t {
+    socket_t fd;		/* descriptor being watched, -1 if none */
+    int phase;			/* when to run the handler in a wakeup */
+    int slot;			/* index in watches[], -1 if unregistered */
+    unsigned long wakeup;	/* last wakeup in which it was ready */
+    bool output;		/* also wake when writable */
+    void (*handler)(struct watch_t *);
+    void *arg;
+};
+
+#define MAX_WATCHES	(AFCOUNT + 2 + MAX_DEVICES + MAX_CLIENTS)
+static struct watch_t *watches[MAX_WATCHES];
+static int watchcount;
+static unsigned long wakeups;
+static struct watch_t device_watch[MAX_DEVICES];
+static int device_turn;		/* where the next device sweep starts */
+static fd_set all_fds;		/* only used by the pselect() fallback */
+static int maxfd;
+#ifdef HAVE_SYS_EPOLL_H
+static int epfd = -1;
+#endif /* HAVE_SYS_EPOLL_H */
+
+#define device_watch_of(devp)	(&device_watch[(devp) - devices])
+
+static void watch_init(struct watch_t *watch, int phase,
+		       void (*handler)(struct watch_t *), void *arg)
+{
+    watch->fd = -1;
+    watch->phase = phase;
+    watch->slot = -1;
+    watch->wakeup = 0;
+    watch->output = false;
+    watch->handler = handler;
+    watch->arg = arg;
+}
+
+static void unwatch_fd(struct watch_t *watch)
+/* stop waiting on a watch's descriptor; call before closing it */
 {
-    if (on) {
+    int slot = watch->slot;
+
+    if (slot < 0)
+	return;
+#ifdef HAVE_SYS_EPOLL_H
+    if (epfd >= 0)
+	/* fails harmlessly if the descriptor has already been closed */
+	(void)epoll_ctl(epfd, EPOLL_CTL_DEL, watch->fd, NULL);
+    else
+#endif /* HAVE_SYS_EPOLL_H */
+    {
+	FD_CLR(watch->fd, &all_fds);
+	if (watch->fd == maxfd) {
+	    int i;
+
+	    for (maxfd = i = 0; i < watchcount; i++)
+		if (watches[i] != watch && watches[i]->fd > maxfd)
+		    maxfd = watches[i]->fd;
+	}
+    }
+    watches[slot] = watches[--watchcount];
+    watches[slot]->slot = slot;
+    watch->slot = -1;
+    watch->fd = -1;
+    watch->output = false;
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+static uint32_t watch_events(const struct watch_t *watch)
+/* the epoll events a watch is interested in */
+{
+    uint32_t events = EPOLLIN;
+
+    if (watch->phase != PHASE_DEVICE)
+	events |= EPOLLET;
+    if (watch->output)
+	events |= EPOLLOUT;
+    return events;
+}
+#endif /* HAVE_SYS_EPOLL_H */
+
+static bool watch_fd(struct watch_t *watch, socket_t fd)
+/* start dispatching input on fd to the watch's handler */
+{
+    if (watch->slot >= 0) {
+	if (watch->fd == fd)
+	    return true;
+	unwatch_fd(watch);
+    }
+    if (BAD_SOCKET(fd) || watchcount >= MAX_WATCHES)
+	return false;
+#ifdef HAVE_SYS_EPOLL_H
+    if (epfd >= 0) {
+	struct epoll_event ev;
+
+	memset(&ev, '\0', sizeof(ev));
+	ev.events = watch_events(watch);
+	ev.data.ptr = watch;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == -1
+	    && (errno != EEXIST
+		|| epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev) == -1)) {
+	    gpsd_log(&context.errout, LOG_ERROR,
+		     "epoll_ctl(%d): %s\n", fd, strerror(errno));
+	    return false;
+	}
+    } else
+#endif /* HAVE_SYS_EPOLL_H */
+    {
+	if (fd >= (socket_t)FD_SETSIZE) {
+	    gpsd_log(&context.errout, LOG_ERROR,
+		     "descriptor %d is beyond FD_SETSIZE, can't select on it\n",
+		     fd);
+	    return false;
+	}
+	FD_SET(fd, &all_fds);
 	if (fd > maxfd)
 	    maxfd = fd;
     }
-    else {
-	if (fd == maxfd) {
-	    int tfd;
+    watch->fd = fd;
+    watch->slot = watchcount;
+    watches[watchcount++] = watch;
+    return true;
+}
 
-	    for (maxfd = tfd = 0; tfd < (int)FD_SETSIZE; tfd++)
-		if (FD_ISSET(tfd, &all_fds))
-		    maxfd = tfd;
-	}
+static void watch_output(struct watch_t *watch, bool on)
+/* ask for, or stop asking for, a wakeup when the descriptor is writable */
+{
+    if (watch->slot < 0 || watch->output == on)
+	return;
+    watch->output = on;
+#ifdef HAVE_SYS_EPOLL_H
+    if (epfd >= 0) {
+	struct epoll_event ev;
+
+	memset(&ev, '\0', sizeof(ev));
+	ev.events = watch_events(watch);
+	ev.data.ptr = watch;
+	(void)epoll_ctl(epfd, EPOLL_CTL_MOD, watch->fd, &ev);
     }
+#endif /* HAVE_SYS_EPOLL_H */
 }
 
 #ifdef SOCKET_EXPORT_ENABLE
@@ -515,18 +675,91 @@ static int passivesocks(char *service, char *tcp_or_udp,
 }
 /* *INDENT-ON* */
 
+/*
+ * Per-client output queueing.  Whatever the socket won't take at once
+ * is queued and drained as the socket becomes writable, so a client
+ * that stalls for a moment is no longer dropped at the first short
+ * write.  Reports are queued whole, never wrapping around the end of
+ * the buffer, and drained with writev() one iovec per report.  Once
+ * the queued bytes would pass the high-water mark the client's backlog
+ * policy decides what gives: the oldest reports, superseded TPV and
+ * SKY reports, or the connection.  A report already partly written is
+ * never dropped, as that would tear the stream.
+ */
+#if (OUTQ_SIZE & (OUTQ_SIZE - 1)) != 0
+#error OUTQ_SIZE must be a power of two
+#endif
+
+static size_t outq_highwater = OUTQ_HIGHWATER;
+
+enum report_class_t {REPORT_OTHER, REPORT_TPV, REPORT_SKY};
+
+struct outq_t
+{
+    char buf[OUTQ_SIZE];
+    size_t tail;		/* where the next report goes; wraps harmlessly */
+    struct {
+	size_t offset;		/* where in buf (mod OUTQ_SIZE) it starts */
+	size_t len;		/* zero once it has been dropped */
+	enum report_class_t class;
+    } report[OUTQ_DEPTH];
+    unsigned int first, count;	/* ring of queued reports */
+    size_t sent;		/* bytes of the first report already written */
+    size_t queued;		/* bytes still to be written */
+    time_t progress;		/* when the queue last moved */
+    unsigned long dropped;	/* reports the backlog policy gave up on */
+};
+
+/*
+ * The report classes a watcher can select, with the changed-mask bits
+ * that produce them.  The first INTERVAL_CLASSES are the periodic ones
+ * a watch interval thins out; the rest carry messages that each matter,
+ * so an interval never drops them.
+ */
+static const struct {
+    unsigned int class;
+    gps_mask_t mask;
+} watch_classes[] = {
+    {CLASS_TPV,		REPORT_IS},
+    {CLASS_SKY,		SATELLITE_SET},
+    {CLASS_GST,		GST_SET},
+    {CLASS_ATT,		ATTITUDE_SET},
+#define INTERVAL_CLASSES	4
+    {CLASS_SUBFRAME,	SUBFRAME_SET},
+    {CLASS_RTCM2,	RTCM2_SET},
+    {CLASS_RTCM3,	RTCM3_SET},
+    {CLASS_AIS,		AIS_SET},
+    {CLASS_OSC,		OSCILLATOR_SET},
+};
+
 struct subscriber_t
 {
     int fd;			/* client file descriptor. -1 if unused */
     time_t active;		/* when subscriber last polled for data */
     struct policy_t policy;	/* configurable bits */
-    pthread_mutex_t mutex;	/* serialize access to fd */
+    pthread_mutex_t mutex;	/* serialize access to fd and queue */
+    struct watch_t watch;	/* event dispatch for incoming commands */
+    struct outq_t outq;		/* output the socket hasn't taken yet */
+    /* when each device's periodic reports are next due under an interval */
+    timestamp_t due[MAX_DEVICES][INTERVAL_CLASSES];
+    struct {
+	unsigned long bytes_in;		/* command bytes read */
+	unsigned long bytes_out;	/* report bytes the socket took */
+	size_t queued_max;		/* deepest the queue has been */
+    } metrics;
 };
 
 #define subscribed(sub, devp)    (sub->policy.watcher && (sub->policy.devpath[0]=='\0' || strcmp(sub->policy.devpath, devp->gpsdata.dev.path)==0))
 
 static struct subscriber_t subscribers[MAX_CLIENTS];	/* indexed by client file descriptor */
 
+/* daemon-wide counters for METRICS, all bumped on the main loop */
+static struct {
+    unsigned long accepted;	/* client connections taken */
+    unsigned long refused;	/* connections turned away, no free slot */
+    unsigned long overflows;	/* clients dropped for falling behind */
+} metrics;
+
 static void lock_subscriber(struct subscriber_t *sub)
 {
     (void)pthread_mutex_lock(&sub->mutex);
@@ -564,6 +797,7 @@ static void detach_client(struct subscriber_t *sub)
 	return;
     }
     c_ip = netlib_sock2ip(sub->fd);
+    unwatch_fd(&sub->watch);
     (void)shutdown(sub->fd, SHUT_RDWR);
     gpsd_log(&context.errout, LOG_SPIN,
 	     "close(%d) in detach_client()\n",
@@ -572,8 +806,6 @@ static void detach_client(struct subscriber_t *sub)
     gpsd_log(&context.errout, LOG_INF,
 	     "detaching %s (sub %d, fd %d) in detach_client\n",
 	     c_ip, sub_index(sub), sub->fd);
-    FD_CLR(sub->fd, &all_fds);
-    adjust_max_fd(sub->fd, false);
     sub->active = 0;
     sub->policy.watcher = false;
     sub->policy.json = false;
@@ -582,16 +814,171 @@ static void detach_client(struct subscriber_t *sub)
     sub->policy.scaled = false;
     sub->policy.timing = false;
     sub->policy.split24 = false;
+    sub->policy.binary = false;
+    sub->policy.backlog = BACKLOG_DROP;
+    sub->policy.classes = 0;
+    sub->policy.fields = 0;
+    sub->policy.interval = 0;
+    memset(sub->due, '\0', sizeof(sub->due));
     sub->policy.devpath[0] = '\0';
+    sub->outq.count = 0;
+    sub->outq.queued = sub->outq.sent = 0;
+    sub->outq.dropped = 0;
+    memset(&sub->metrics, '\0', sizeof(sub->metrics));
     sub->fd = UNALLOCATED_FD;
     unlock_subscriber(sub);
 }
 
+#define OUTQ_AT(q, i)	(&(q)->report[((q)->first + (i)) % OUTQ_DEPTH])
+
+static void outq_settle(struct outq_t *q)
+/* retire dropped reports from the head of the queue */
+{
+    while (q->count > 0 && OUTQ_AT(q, 0)->len == 0) {
+	q->first = (q->first + 1) % OUTQ_DEPTH;
+	q->count--;
+    }
+}
+
+static void outq_drop(struct outq_t *q, unsigned int i)
+/* drop a queued report that hasn't begun to go out; settle afterwards */
+{
+    q->queued -= OUTQ_AT(q, i)->len;
+    OUTQ_AT(q, i)->len = 0;
+    q->dropped++;
+}
+
+static bool outq_drop_class(struct outq_t *q, enum report_class_t class)
+/* drop every queued report superseded by a new one of the same class */
+{
+    unsigned int i;
+    bool dropped = false;
+
+    for (i = (q->sent > 0) ? 1 : 0; i < q->count; i++)
+	if (OUTQ_AT(q, i)->len > 0 && OUTQ_AT(q, i)->class == class) {
+	    outq_drop(q, i);
+	    dropped = true;
+	}
+    outq_settle(q);
+    return dropped;
+}
+
+static bool outq_drop_oldest(struct outq_t *q)
+/* drop the oldest queued report that hasn't begun to go out */
+{
+    unsigned int i;
+
+    for (i = (q->sent > 0) ? 1 : 0; i < q->count; i++)
+	if (OUTQ_AT(q, i)->len > 0) {
+	    outq_drop(q, i);
+	    outq_settle(q);
+	    return true;
+	}
+    return false;
+}
+
+static bool outq_push(struct outq_t *q, const char *buf, size_t len,
+		      enum report_class_t class)
+/* append a report to the queue, if there's room */
+{
+    size_t used, pad;
+
+    if (q->count == 0)
+	q->tail = 0;
+    if (q->count >= OUTQ_DEPTH)
+	return false;
+    used = (q->count == 0) ? 0 : q->tail - OUTQ_AT(q, 0)->offset;
+    /* a report that won't fit before the end of the buffer starts over */
+    pad = q->tail % OUTQ_SIZE;
+    pad = (pad + len > OUTQ_SIZE) ? OUTQ_SIZE - pad : 0;
+    if (used + pad + len > OUTQ_SIZE)
+	return false;
+    q->tail += pad;
+    memcpy(q->buf + q->tail % OUTQ_SIZE, buf, len);
+    OUTQ_AT(q, q->count)->offset = q->tail;
+    OUTQ_AT(q, q->count)->len = len;
+    OUTQ_AT(q, q->count)->class = class;
+    q->count++;
+    q->tail += len;
+    q->queued += len;
+    return true;
+}
+
+static ssize_t outq_flush(struct subscriber_t *sub)
+/* write out as much queued output as the socket will take; call locked */
+{
+    struct outq_t *q = &sub->outq;
+    struct iovec iov[OUTQ_DEPTH];
+    unsigned int i;
+    int n = 0;
+    ssize_t status;
+    size_t left;
+
+    for (i = 0; i < q->count; i++) {
+	size_t skip = (i == 0) ? q->sent : 0;
+
+	if (OUTQ_AT(q, i)->len == 0)
+	    continue;
+	iov[n].iov_base = q->buf + OUTQ_AT(q, i)->offset % OUTQ_SIZE + skip;
+	iov[n].iov_len = OUTQ_AT(q, i)->len - skip;
+	n++;
+    }
+    if (n == 0)
+	return 0;
+
+    status = writev(sub->fd, iov, n);
+    if (status <= 0)
+	return status;
+
+    q->progress = time(NULL);
+    q->queued -= (size_t)status;
+    sub->metrics.bytes_out += (unsigned long)status;
+    for (left = (size_t)status; left > 0; ) {
+	size_t rest = OUTQ_AT(q, 0)->len - q->sent;
+
+	if (left < rest) {
+	    q->sent += left;
+	    break;
+	}
+	left -= rest;
+	OUTQ_AT(q, 0)->len = 0;
+	q->sent = 0;
+	outq_settle(q);
+    }
+    return status;
+}
+
+static enum report_class_t report_class(const char *buf, size_t len)
+/* classify a report for coalescing */
+{
+#define CLASS_PREFIX	"{\"class\":\""
+    const size_t plen = sizeof(CLASS_PREFIX) - 1;
+
+    if (len > 1 && (unsigned char)buf[0] == BINARY_MAGIC) {
+	if (buf[1] == binary_tpv)
+	    return REPORT_TPV;
+	if (buf[1] == binary_sky)
+	    return REPORT_SKY;
+	return REPORT_OTHER;
+    }
+    if (len < plen + 3 || strncmp(buf, CLASS_PREFIX, plen) != 0)
+	return REPORT_OTHER;
+    if (strncmp(buf + plen, "TPV", 3) == 0)
+	return REPORT_TPV;
+    if (strncmp(buf + plen, "SKY", 3) == 0)
+	return REPORT_SKY;
+    return REPORT_OTHER;
+#undef CLASS_PREFIX
+}
+
 static ssize_t throttled_write(struct subscriber_t *sub, char *buf,
 			       size_t len)
-/* write to client -- throttle if it's gone or we're close to buffer overrun */
+/* write to client -- queue what won't go, throttle if it falls behind */
 {
-    ssize_t status;
+    struct outq_t *q = &sub->outq;
+    enum report_class_t class;
+    ssize_t status = 0;
+    bool dropped = false, overflow = false;
 
     if (context.errout.debug >= LOG_CLIENT) {
 	if (isprint((unsigned char) buf[0]))
@@ -610,37 +997,101 @@ static ssize_t throttled_write(struct subscriber_t *sub, char *buf,
 	}
     }
 
-#if defined(PPS_ENABLE)
-    gpsd_acquire_reporting_lock();
-#endif /* PPS_ENABLE */
-    status = send(sub->fd, buf, len, 0);
-#if defined(PPS_ENABLE)
-    gpsd_release_reporting_lock();
+    lock_subscriber(sub);
+    if (q->count == 0) {
+	/* nothing queued, so try the fast path */
+	status = send(sub->fd, buf, len, 0);
+	if (status == (ssize_t) len) {
+	    sub->metrics.bytes_out += len;
+	    unlock_subscriber(sub);
+	    return status;
+	} else if (status == -1
+		   && errno != EAGAIN && errno != EWOULDBLOCK
+		   && errno != EINTR) {
+	    unlock_subscriber(sub);
+	    if (errno == EBADF)
+		gpsd_log(&context.errout, LOG_WARN,
+			 "client(%d) has vanished.\n", sub_index(sub));
+	    else
+		gpsd_log(&context.errout, LOG_INF,
+			 "client(%d) write: %s\n",
+			 sub_index(sub), strerror(errno));
+	    detach_client(sub);
+	    return status;
+	}
+	q->progress = time(NULL);
+	if (status > 0) {
+	    sub->metrics.bytes_out += (unsigned long)status;
+	    /* the rest of a torn report must go out, come what may */
+	    if (outq_push(q, buf, len, REPORT_OTHER)) {
+		q->sent = (size_t)status;
+		q->queued -= (size_t)status;
+	    } else
+		overflow = true;
+	    goto queued;
+	}
+    }
 
-#endif /* PPS_ENABLE */
-    if (status == (ssize_t) len)
-	return status;
-    else if (status > -1) {
+    class = report_class(buf, len);
+    while (q->queued + len > outq_highwater) {
+	if (sub->policy.backlog == BACKLOG_DISCONNECT) {
+	    overflow = true;
+	    break;
+	}
+	if (sub->policy.backlog == BACKLOG_COALESCE
+	    && class != REPORT_OTHER && outq_drop_class(q, class))
+	    continue;
+	if (!outq_drop_oldest(q))
+	    break;
+	dropped = true;
+    }
+    if (!overflow && !outq_push(q, buf, len, class)) {
+	if (sub->policy.backlog == BACKLOG_DISCONNECT)
+	    overflow = true;
+	else
+	    q->dropped++;
+	dropped = true;
+    }
+
+  queued:
+    if (q->queued > sub->metrics.queued_max)
+	sub->metrics.queued_max = q->queued;
+    watch_output(&sub->watch, q->count > 0);
+    unlock_subscriber(sub);
+
+    if (overflow) {
+	metrics.overflows++;
 	gpsd_log(&context.errout, LOG_INF,
-		 "short write disconnecting client(%d)\n",
+		 "client(%d) output queue overflow, disconnecting\n",
 		 sub_index(sub));
 	detach_client(sub);
-	return 0;
-    } else if (errno == EAGAIN || errno == EINTR)
-	return 0;		/* no data written, and errno says to retry */
-    else if (errno == EBADF)
-	gpsd_log(&context.errout, LOG_WARN,
-		 "client(%d) has vanished.\n", sub_index(sub));
-    else if (errno == EWOULDBLOCK
-	     && time(NULL) - sub->active > NOREAD_TIMEOUT)
-	gpsd_log(&context.errout, LOG_INF,
-		 "client(%d) timed out.\n", sub_index(sub));
-    else
+	return -1;
+    }
+    if (dropped)
+	gpsd_log(&context.errout, LOG_PROG,
+		 "client(%d) falling behind, %zu bytes queued\n",
+		 sub_index(sub), q->queued);
+    return (ssize_t) len;
+}
+
+static bool drain_client(struct subscriber_t *sub)
+/* write out queued output; false if the client had to be dropped */
+{
+    ssize_t status;
+
+    lock_subscriber(sub);
+    status = outq_flush(sub);
+    watch_output(&sub->watch, sub->outq.count > 0);
+    unlock_subscriber(sub);
+    if (status == -1
+	&& errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
 	gpsd_log(&context.errout, LOG_INF,
 		 "client(%d) write: %s\n",
 		 sub_index(sub), strerror(errno));
-    detach_client(sub);
-    return status;
+	detach_client(sub);
+	return false;
+    }
+    return true;
 }
 
 static void notify_watchers(struct gps_device_t *device,
@@ -662,6 +1113,53 @@ static void notify_watchers(struct gps_device_t *device,
 		(void)throttled_write(sub, buf, strlen(buf));
 	}
 }
+
+#if defined(NTP_ENABLE) || defined(PPS_ENABLE)
+static void notify_time_watchers(struct gps_device_t *device,
+				 const enum binary_type_t type,
+				 const struct timedelta_t *td, int precision)
+/* notify watchers of a device about a PPS or TOFF event */
+{
+    char buf[GPS_JSON_RESPONSE_MAX];
+    char bin[sizeof(struct binary_header_t) + GPS_PATH_MAX
+	     + sizeof(struct binary_timedelta_t)];
+    size_t len, binlen;
+    struct subscriber_t *sub;
+    /* PPS goes to all JSON watchers, TOFF only to those asking for PPS */
+    const bool onjson = (type == binary_pps);
+    const unsigned int class = (type == binary_pps) ? CLASS_PPS : CLASS_TOFF;
+
+    /* real_XXX - the time the GPS thinks it is at the PPS edge */
+    /* clock_XXX - the time the system clock thinks it is at the PPS edge */
+    if (type == binary_pps)
+	(void)snprintf(buf, sizeof(buf),
+		       "{\"class\":\"PPS\",\"device\":\"%s\",\"real_sec\":%ld, \"real_nsec\":%ld,\"clock_sec\":%ld,\"clock_nsec\":%ld,\"precision\":%d}\r\n",
+		       device->gpsdata.dev.path,
+		       td->real.tv_sec, td->real.tv_nsec,
+		       td->clock.tv_sec, td->clock.tv_nsec,
+		       precision);
+    else
+	(void)snprintf(buf, sizeof(buf),
+		       "{\"class\":\"TOFF\",\"device\":\"%s\",\"real_sec\":%ld, \"real_nsec\":%ld,\"clock_sec\":%ld,\"clock_nsec\":%ld}\r\n",
+		       device->gpsdata.dev.path,
+		       td->real.tv_sec, td->real.tv_nsec,
+		       td->clock.tv_sec, td->clock.tv_nsec);
+    len = strlen(buf);
+    binlen = binary_timedelta_dump(type, device->gpsdata.dev.path,
+				   td, precision, bin, sizeof(bin));
+
+    for (sub = subscribers; sub < subscribers + MAX_CLIENTS; sub++)
+	if (sub->active != 0 && subscribed(sub, device)
+	    && ((onjson && sub->policy.json) || sub->policy.pps)
+	    && (sub->policy.classes == 0
+		|| (sub->policy.classes & class) != 0)) {
+	    if (sub->policy.json && sub->policy.binary)
+		(void)throttled_write(sub, bin, binlen);
+	    else
+		(void)throttled_write(sub, buf, len);
+	}
+}
+#endif /* defined(NTP_ENABLE) || defined(PPS_ENABLE) */
 #endif /* SOCKET_EXPORT_ENABLE */
 
 static void deactivate_device(struct gps_device_t *device)
@@ -672,9 +1170,8 @@ static void deactivate_device(struct gps_device_t *device)
 		    "{\"class\":\"DEVICE\",\"path\":\"%s\",\"activated\":0}\r\n",
 		    device->gpsdata.dev.path);
 #endif /* SOCKET_EXPORT_ENABLE */
+    unwatch_fd(device_watch_of(device));
     if (!BAD_SOCKET(device->gpsdata.gps_fd)) {
-	FD_CLR(device->gpsdata.gps_fd, &all_fds);
-	adjust_max_fd(device->gpsdata.gps_fd, false);
 #ifdef NTPSHM_ENABLE
 	ntpshm_link_deactivate(device);
 #endif /* NTPSHM_ENABLE */
@@ -728,7 +1225,7 @@ static bool open_device( struct gps_device_t *device)
     gpsd_log(&context.errout, LOG_INF,
 	     "PPS:%s ntpshm_link_activate: %d\n",
 	     device->gpsdata.dev.path,
-	     device->shm_clock != NULL);
+	     device->clock_export.shm != NULL);
 #endif /* NTPSHM_ENABLE */
 
     gpsd_log(&context.errout, LOG_INF,
@@ -737,8 +1234,10 @@ static bool open_device( struct gps_device_t *device)
 	/* it is a /dev/ppsX, no need to select() it */
         return true;
     }
-    FD_SET(device->gpsdata.gps_fd, &all_fds);
-    adjust_max_fd(device->gpsdata.gps_fd, true);
+    if (!watch_fd(device_watch_of(device), device->gpsdata.gps_fd)) {
+	gpsd_deactivate(device);
+	return false;
+    }
     ++highwater;
     return true;
 }
@@ -784,6 +1283,91 @@ bool gpsd_add_device(const char *device_name, bool flag_nowait)
     return ret;
 }
 
+#ifdef SOCKET_EXPORT_ENABLE
+static bool json_metrics_dump(char *reply, size_t replylen, int *next)
+/* dump counters as a METRICS object, from entry *next; true if more follow */
+{
+#define METRICS_TAIL	32	/* room to keep for closing and flagging */
+    struct strcursor_t c;
+    char tbuf[JSON_DATE_MAX+1];
+    char entry[GPS_JSON_RESPONSE_MAX];
+    bool clients = false, truncated = false, more = false;
+    int shipped = 0;
+    size_t len;
+
+    /*
+     * Entries 0 to MAX_DEVICES-1 are devices, the rest clients.  An
+     * object ends before the first entry that won't fit, so that a
+     * client can read every one, and the caller asks for another
+     * starting there.  Only an entry too big for any object is lost.
+     */
+    if (replylen > GPS_JSON_RESPONSE_MAX)
+	replylen = GPS_JSON_RESPONSE_MAX;
+    strc_init(&c, reply, replylen);
+    strc_printf(&c,
+		"{\"class\":\"METRICS\",\"time\":\"%s\",\"wakeups\":%lu,"
+		"\"accepted\":%lu,\"refused\":%lu,\"overflows\":%lu,"
+		"\"devices\":[",
+		unix_to_iso8601(timestamp(), tbuf, sizeof(tbuf)), wakeups,
+		metrics.accepted, metrics.refused, metrics.overflows);
+    for (; *next < MAX_DEVICES + MAX_CLIENTS; ++*next) {
+	if (*next < MAX_DEVICES) {
+	    struct gps_device_t *devp = &devices[*next];
+
+	    if (!allocated_device(devp))
+		continue;
+	    len = json_device_metrics_dump(devp, entry, sizeof(entry));
+	} else {
+	    struct subscriber_t *sub = &subscribers[*next - MAX_DEVICES];
+	    int n;
+
+	    if (sub->active == 0)
+		continue;
+	    n = snprintf(entry, sizeof(entry),
+			 "{\"client\":%d,\"bytes_in\":%lu,\"bytes_out\":%lu,"
+			 "\"queued\":%zu,\"reports\":%u,\"queued_max\":%zu,"
+			 "\"dropped\":%lu}",
+			 sub_index(sub), sub->metrics.bytes_in,
+			 sub->metrics.bytes_out, sub->outq.queued,
+			 sub->outq.count, sub->metrics.queued_max,
+			 sub->outq.dropped);
+	    if (n <= 0)
+		continue;
+	    len = (size_t)n;
+	    if (!clients) {
+		strc_rstrip_char(&c, ',');
+		strc_puts(&c, "],\"clients\":[");
+		clients = true;
+	    }
+	}
+	if (c.len + len + 1 + METRICS_TAIL >= replylen) {
+	    /* an entry too big for an object of its own is skipped */
+	    if (shipped == 0)
+		truncated = true;
+	    else {
+		more = true;
+		break;
+	    }
+	} else {
+	    strc_putn(&c, entry, len);
+	    strc_puts(&c, ",");
+	    shipped++;
+	}
+    }
+    strc_rstrip_char(&c, ',');
+    if (!clients)
+	strc_puts(&c, "],\"clients\":[");
+    strc_puts(&c, "]");
+    if (more)
+	strc_puts(&c, ",\"more\":true");
+    if (truncated)
+	strc_puts(&c, ",\"truncated\":true");
+    strc_puts(&c, "}\r\n");
+    return more;
+#undef METRICS_TAIL
+}
+#endif /* SOCKET_EXPORT_ENABLE */
+
 #ifdef CONTROL_SOCKET_ENABLE
 static char *snarfline(char *p, char **out)
 /* copy the rest of the command line, before CR-LF */
@@ -939,11 +1523,64 @@ static void handle_control(int sfd, char *buf)
 	    ignore_return(write(sfd, "\n", 1));
 	}
 	ignore_return(write(sfd, "OK\n", 3));
+#ifdef SOCKET_EXPORT_ENABLE
+    } else if (strstr(buf, "?metrics")==buf) {
+	/* write back the METRICS objects followed by OK */
+	char reply[GPS_JSON_RESPONSE_MAX];
+	int next = 0;
+	bool more;
+
+	do {
+	    more = json_metrics_dump(reply, sizeof(reply), &next);
+	    ignore_return(write(sfd, reply, strlen(reply)));
+	} while (more);
+	ignore_return(write(sfd, "OK\n", 3));
+#endif /* SOCKET_EXPORT_ENABLE */
     } else {
 	/* unknown command */
 	ignore_return(write(sfd, "ERROR\n", 6));
     }
 }
+
+static void accept_control(struct watch_t *watch)
+/* accept control-socket connections and execute their commands */
+{
+    for (;;) {
+	sockaddr_t fsin;
+	socklen_t alen = (socklen_t) sizeof(fsin);
+	socket_t cfd = accept(watch->fd, (struct sockaddr *)&fsin, &alen);
+	char buf[BUFSIZ];
+	ssize_t rd;
+	int opts;
+
+	if (BAD_SOCKET(cfd)) {
+	    if (errno != EAGAIN && errno != EWOULDBLOCK)
+		gpsd_log(&context.errout, LOG_ERROR,
+			 "accept: %s\n", strerror(errno));
+	    return;
+	}
+	gpsd_log(&context.errout, LOG_INF,
+		 "control socket connect on fd %d\n", cfd);
+
+	/*
+	 * Control sessions are one-shot and local, so they are served
+	 * to completion right here.  The listener is non-blocking, which
+	 * some systems let accepted sockets inherit; undo that.
+	 */
+	if ((opts = fcntl(cfd, F_GETFL)) >= 0)
+	    (void)fcntl(cfd, F_SETFL, opts & ~O_NONBLOCK);
+	while ((rd = read(cfd, buf, sizeof(buf) - 1)) > 0) {
+	    buf[rd] = '\0';
+	    gpsd_log(&context.errout, LOG_CLIENT,
+		     "<= control(%d): %s\n", cfd, buf);
+	    /* coverity[tainted_data] Safe, never handed to exec */
+	    handle_control(cfd, buf);
+	}
+	gpsd_log(&context.errout, LOG_SPIN,
+		 "close(%d) of control socket\n", cfd);
+	(void)close(cfd);
+    }
+}
 #endif /* CONTROL_SOCKET_ENABLE */
 
 #ifdef SOCKET_EXPORT_ENABLE
@@ -982,8 +1619,10 @@ static bool awaken(struct gps_device_t *device)
 	    gpsd_log(&context.errout, LOG_RAW,
 			"flagging descriptor %d in assign_channel()\n",
 			device->gpsdata.gps_fd);
-	    FD_SET(device->gpsdata.gps_fd, &all_fds);
-	    adjust_max_fd(device->gpsdata.gps_fd, true);
+	    if (!watch_fd(device_watch_of(device), device->gpsdata.gps_fd)) {
+		gpsd_deactivate(device);
+		return false;
+	    }
 	    return true;
 	}
     }
@@ -1129,6 +1768,8 @@ static void handle_request(struct subscriber_t *sub,
 #ifndef TIMING_ENABLE
 	    sub->policy.timing = false;
 #endif /* TIMING_ENABLE */
+	    /* a new interval starts its schedule over */
+	    memset(sub->due, '\0', sizeof(sub->due));
 	    if (end == NULL)
 		buf += strlen(buf);
 	    else {
@@ -1357,6 +1998,17 @@ static void handle_request(struct subscriber_t *sub,
 	}
 	str_rstrip_char(reply, ',');
 	(void)strlcat(reply, "]}\r\n", replylen);
+    } else if (str_starts_with(buf, "METRICS;")) {
+	int next = 0;
+
+	buf += 8;
+	/* every object but the last goes out now, each on its own line */
+	while (json_metrics_dump(reply, replylen, &next))
+	    if (throttled_write(sub, reply, strlen(reply)) < 0) {
+		/* the client is gone */
+		reply[0] = '\0';
+		break;
+	    }
     } else if (str_starts_with(buf, "VERSION;")) {
 	buf += 8;
 	json_version_dump(reply, replylen);
@@ -1460,13 +2112,190 @@ static void pseudonmea_report(struct subscriber_t *sub,
 #endif /* AIVDM_ENABLE */
     }
 }
+
+/*
+ * The JSON for a report depends on the device, the reports a watcher's
+ * filters let through, the TPV fields it projected, and just three
+ * policy bits, scaled, timing and binary (binary watchers get JSON only
+ * for reports without a binary form).  So within one all_reports() call
+ * each distinct rendering is produced once, on first demand, and the
+ * same buffer is handed to every watcher that asks for it.  Binary
+ * records are keyed like a fourth policy bit.  Should a cycle need more
+ * renderings than there are slots, the last slot is rendered over.
+ */
+struct json_rendering_t {
+    bool valid;
+    gps_mask_t changed;		/* reports rendered */
+    unsigned int variant;	/* policy bits rendered for */
+    unsigned int fields;	/* TPV projection rendered for */
+    size_t len;
+    char buf[GPS_JSON_RESPONSE_MAX * 4];
+};
+static struct json_rendering_t json_renderings[16];
+#define BINARY_VARIANT	8
+
+static struct json_rendering_t *find_rendering(const gps_mask_t changed,
+					       const unsigned int variant,
+					       const unsigned int fields)
+/* find this cycle's slot for a rendering; not valid if it's yet to do */
+{
+    struct json_rendering_t *rp;
+
+    for (rp = json_renderings; rp < json_renderings + NITEMS(json_renderings);
+	 rp++)
+	if (!rp->valid
+	    || (rp->changed == changed && rp->variant == variant
+		&& rp->fields == fields))
+	    break;
+    if (rp == json_renderings + NITEMS(json_renderings)) {
+	rp--;
+	rp->valid = false;
+    }
+    if (!rp->valid) {
+	rp->changed = changed;
+	rp->variant = variant;
+	rp->fields = fields;
+    }
+    return rp;
+}
+
+static struct json_rendering_t *json_rendering(const gps_mask_t changed,
+					       struct gps_device_t *device,
+					       const struct policy_t *policy)
+/* render this cycle's JSON for a policy, or reuse the rendering */
+{
+    struct json_rendering_t *rp;
+
+    rp = find_rendering(changed,
+			(policy->scaled ? 1 : 0) | (policy->timing ? 2 : 0)
+			| (policy->binary ? 4 : 0),
+			policy->fields);
+    if (!rp->valid) {
+#ifdef TIMING_ENABLE
+	uint64_t stamp = latency_now();
+#endif /* TIMING_ENABLE */
+	rp->len = json_data_report(policy->binary
+				       ? changed & ~BINARY_REPORT_MASK
+				       : changed,
+				   device, policy, rp->buf, sizeof(rp->buf));
+	rp->valid = true;
+#ifdef TIMING_ENABLE
+	device->latency.current.stage[latency_encode] += latency_now() - stamp;
+#endif /* TIMING_ENABLE */
+    }
+    return rp;
+}
+
+static struct json_rendering_t *binary_rendering(const gps_mask_t changed,
+						 struct gps_device_t *device)
+/* render this cycle's binary records, or reuse the rendering */
+{
+    struct json_rendering_t *rp = find_rendering(changed, BINARY_VARIANT, 0);
+
+    if (!rp->valid) {
+#ifdef TIMING_ENABLE
+	uint64_t stamp = latency_now();
+#endif /* TIMING_ENABLE */
+	rp->len = binary_data_report(changed, device,
+				     rp->buf, sizeof(rp->buf));
+	rp->valid = true;
+#ifdef TIMING_ENABLE
+	device->latency.current.stage[latency_encode] += latency_now() - stamp;
+#endif /* TIMING_ENABLE */
+    }
+    return rp;
+}
+
+static void report_write(struct subscriber_t *sub,
+			 struct gps_device_t *device,
+			 struct json_rendering_t *rp)
+/* ship a rendering to one watcher, charging the time to the device */
+{
+#ifdef TIMING_ENABLE
+    uint64_t stamp = latency_now();
+#endif /* TIMING_ENABLE */
+
+    if (rp->len > 0)
+	(void)throttled_write(sub, rp->buf, rp->len);
+#ifdef TIMING_ENABLE
+    device->latency.current.stage[latency_send] += latency_now() - stamp;
+#else
+    (void)device;
+#endif /* TIMING_ENABLE */
+}
+
+static gps_mask_t watch_filter(struct subscriber_t *sub,
+			       const struct gps_device_t *device,
+			       gps_mask_t changed)
+/* drop the reports a watcher's classes and interval rule out */
+{
+    const struct policy_t *policy = &sub->policy;
+    int i;
+
+    if (policy->classes != 0)
+	for (i = 0; i < NITEMS(watch_classes); i++)
+	    if ((policy->classes & watch_classes[i].class) == 0)
+		changed &= ~watch_classes[i].mask;
+
+    if (policy->interval > 0) {
+	timestamp_t now = timestamp();
+	timestamp_t *due = sub->due[device - devices];
+
+	for (i = 0; i < INTERVAL_CLASSES; i++) {
+	    if ((changed & watch_classes[i].mask) == 0)
+		continue;
+	    if (now < due[i])
+		changed &= ~watch_classes[i].mask;
+	    else if (now - due[i] < policy->interval)
+		due[i] += policy->interval;	/* keep to the schedule */
+	    else
+		due[i] = now + policy->interval;	/* fell behind; restart */
+	}
+    }
+    return changed;
+}
+#endif /* SOCKET_EXPORT_ENABLE */
+
+#ifdef TIMING_ENABLE
+static void latency_commit(struct gps_device_t *device, gps_mask_t changed)
+/* file the finished packet's trace; ship a batch at cycle end or when full */
+{
+    struct latency_trace_t *trace = &device->latency.current;
+#ifdef SOCKET_EXPORT_ENABLE
+    struct subscriber_t *sub;
+    char buf[GPS_JSON_RESPONSE_MAX];
+    size_t len = 0;
 #endif /* SOCKET_EXPORT_ENABLE */
 
+    trace->total = latency_now() - trace->start;
+    device->latency.trace[device->latency.head++ % LATENCY_RING] = *trace;
+    if ((changed & REPORT_IS) == 0
+	&& device->latency.head - device->latency.reported < LATENCY_BATCH)
+	return;
+
+#ifdef SOCKET_EXPORT_ENABLE
+    for (sub = subscribers; sub < subscribers + MAX_CLIENTS; sub++) {
+	/* never implied by an empty class list; old clients don't know it */
+	if (sub->active == 0 || !subscribed(sub, device)
+	    || !sub->policy.watcher || !sub->policy.json
+	    || (sub->policy.classes & CLASS_LATENCY) == 0)
+	    continue;
+	if (len == 0)
+	    len = json_latency_dump(device, device->latency.reported,
+				    buf, sizeof(buf));
+	(void)throttled_write(sub, buf, len);
+    }
+#endif /* SOCKET_EXPORT_ENABLE */
+    device->latency.reported = device->latency.head;
+}
+#endif /* TIMING_ENABLE */
+
 static void all_reports(struct gps_device_t *device, gps_mask_t changed)
 /* report on the current packet from a specified device */
 {
 #ifdef SOCKET_EXPORT_ENABLE
     struct subscriber_t *sub;
+    int i;
 
     /* add any just-identified device to watcher lists */
     if ((changed & DRIVER_IS) != 0) {
@@ -1578,17 +2407,13 @@ static void all_reports(struct gps_device_t *device, gps_mask_t changed)
 #endif /* PPS_ENABLE */
 
 #ifdef NTPSHM_ENABLE
-	if (device->shm_clock != NULL) {
-	    (void)ntpshm_put(device, device->shm_clock, &td);
+	if (device->clock_export.shm != NULL) {
+	    (void)ntpshm_put(device, &device->clock_export, &td);
 	}
 #endif /* NTPSHM_ENABLE */
 
 #ifdef SOCKET_EXPORT_ENABLE
-	notify_watchers(device, false, true,
-			"{\"class\":\"TOFF\",\"device\":\"%s\",\"real_sec\":%ld, \"real_nsec\":%ld,\"clock_sec\":%ld,\"clock_nsec\":%ld}\r\n",
-			device->gpsdata.dev.path,
-			td.real.tv_sec, td.real.tv_nsec,
-			td.clock.tv_sec, td.clock.tv_nsec);
+	notify_time_watchers(device, binary_toff, &td, 0);
 #endif /* SOCKET_EXPORT_ENABLE */
 
     }
@@ -1626,10 +2451,14 @@ static void all_reports(struct gps_device_t *device, gps_mask_t changed)
 #ifdef SHM_EXPORT_ENABLE
     if ((changed & (REPORT_IS|GST_SET|SATELLITE_SET|SUBFRAME_SET|
 		    ATTITUDE_SET|RTCM2_SET|RTCM3_SET|AIS_SET)) != 0)
-	shm_update(&context, &device->gpsdata);
+	shm_update(&context, (int)(device - devices), &device->gpsdata);
 #endif /* SHM_EXPORT_ENABLE */
 
 #ifdef SOCKET_EXPORT_ENABLE
+    /* a new cycle needs fresh renderings */
+    for (i = 0; i < NITEMS(json_renderings); i++)
+	json_renderings[i].valid = false;
+
     /* update all subscribers associated with this device */
     for (sub = subscribers; sub < subscribers + MAX_CLIENTS; sub++) {
 	if (sub == NULL || sub->active == 0 || !subscribed(sub, device))
@@ -1669,7 +2498,8 @@ static void all_reports(struct gps_device_t *device, gps_mask_t changed)
 
 		if (sub->policy.json)
 		{
-		    char buf[GPS_JSON_RESPONSE_MAX * 4];
+		    struct json_rendering_t *json;
+		    gps_mask_t wanted;
 
 		    if ((changed & AIS_SET) != 0)
 			if (device->gpsdata.ais.type == 24
@@ -1677,17 +2507,24 @@ static void all_reports(struct gps_device_t *device, gps_mask_t changed)
 			    && !sub->policy.split24)
 			    continue;
 
-		    json_data_report(changed,
-				     device, &sub->policy,
-				     buf, sizeof(buf));
-		    if (buf[0] != '\0')
-			(void)throttled_write(sub, buf, strlen(buf));
+		    /* filter before rendering, so nothing unwanted is encoded */
+		    wanted = watch_filter(sub, device, changed);
+		    if (sub->policy.binary) {
+			json = binary_rendering(wanted, device);
+			report_write(sub, device, json);
+		    }
+		    json = json_rendering(wanted, device, &sub->policy);
+		    report_write(sub, device, json);
 
 		}
 	    }
 	}
     } /* subscribers */
 #endif /* SOCKET_EXPORT_ENABLE */
+
+#ifdef TIMING_ENABLE
+    latency_commit(device, changed);
+#endif /* TIMING_ENABLE */
 }
 
 #ifdef SOCKET_EXPORT_ENABLE
@@ -1695,48 +2532,279 @@ static int handle_gpsd_request(struct subscriber_t *sub, const char *buf)
 /* execute GPSD requests from a buffer */
 {
     char reply[GPS_JSON_RESPONSE_MAX + 1];
+    ssize_t status = 0;
 
-    reply[0] = '\0';
     if (buf[0] == '?') {
 	const char *end;
 	for (end = buf; *buf != '\0'; buf = end)
 	    if (isspace((unsigned char) *buf))
 		end = buf + 1;
-	    else
-		handle_request(sub, buf, &end,
-			       reply + strlen(reply),
-			       sizeof(reply) - strlen(reply));
+	    else {
+		/* each reply goes out before the next request runs */
+		reply[0] = '\0';
+		handle_request(sub, buf, &end, reply, sizeof(reply));
+		/* a request that wrote for itself may have lost the client */
+		if (sub->fd == UNALLOCATED_FD) {
+		    status = -1;
+		    break;
+		}
+		if (reply[0] != '\0') {
+		    status = throttled_write(sub, reply, strlen(reply));
+		    if (status < 0)
+			break;
+		}
+	    }
+    }
+    return (int)status;
+}
+
+static void service_client(struct watch_t *watch)
+/* drain queued output to a client, then execute its commands */
+{
+    struct subscriber_t *sub = (struct subscriber_t *)watch->arg;
+
+    if (sub->outq.count > 0 && !drain_client(sub))
+	return;
+
+    /* edge-triggered, so read until the socket runs dry */
+    while (watch->slot >= 0) {
+	char buf[BUFSIZ];
+	int buflen;
+
+	gpsd_log(&context.errout, LOG_PROG,
+		 "checking client(%d)\n",
+		 sub_index(sub));
+	buflen = (int)recv(sub->fd, buf, sizeof(buf) - 1, 0);
+	if (buflen < 0 && errno == EINTR)
+	    continue;
+	if (buflen < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+	    break;
+	if (buflen <= 0) {
+	    detach_client(sub);
+	    break;
+	}
+	sub->metrics.bytes_in += (unsigned long)buflen;
+	if (buf[buflen - 1] != '\n')
+	    buf[buflen++] = '\n';
+	buf[buflen] = '\0';
+	gpsd_log(&context.errout, LOG_CLIENT,
+		 "<= client(%d): %s\n", sub_index(sub), buf);
+
+	/*
+	 * When a command comes in, update subscriber.active to
+	 * timestamp() so we don't close the connection
+	 * after COMMAND_TIMEOUT seconds. This makes
+	 * COMMAND_TIMEOUT useful.
+	 */
+	sub->active = time(NULL);
+	if (handle_gpsd_request(sub, buf) < 0) {
+	    detach_client(sub);
+	    break;
+	}
+    }
+}
+
+static void accept_client(struct watch_t *watch)
+/* always be open to new client connections */
+{
+    for (;;) {
+	sockaddr_t fsin;
+	socklen_t alen = (socklen_t) sizeof(fsin);
+	socket_t ssock = accept(watch->fd, (struct sockaddr *)&fsin, &alen);
+	struct subscriber_t *client = NULL;
+	int opts;
+	static struct linger linger = { 1, RELEASE_TIMEOUT };
+	char *c_ip;
+
+	if (BAD_SOCKET(ssock)) {
+	    if (errno != EAGAIN && errno != EWOULDBLOCK)
+		gpsd_log(&context.errout, LOG_ERROR,
+			 "accept: %s\n", strerror(errno));
+	    return;
+	}
+
+	opts = fcntl(ssock, F_GETFL);
+	if (opts >= 0)
+	    (void)fcntl(ssock, F_SETFL, opts | O_NONBLOCK);
+
+	c_ip = netlib_sock2ip(ssock);
+	client = allocate_client();
+	if (client == NULL) {
+	    gpsd_log(&context.errout, LOG_ERROR,
+		     "Client %s connect on fd %d -"
+		     "no subscriber slots available\n", c_ip,
+		     ssock);
+	    metrics.refused++;
+	    (void)close(ssock);
+	} else if (setsockopt(ssock, SOL_SOCKET, SO_LINGER, (char *)&linger,
+			      (int)sizeof(struct linger)) == -1) {
+	    gpsd_log(&context.errout, LOG_ERROR,
+		     "Error: SETSOCKOPT SO_LINGER\n");
+	    (void)close(ssock);
+	} else if (!watch_fd(&client->watch, ssock)) {
+	    gpsd_log(&context.errout, LOG_ERROR,
+		     "Client %s connect on fd %d - can't watch it\n",
+		     c_ip, ssock);
+	    (void)close(ssock);
+	    client->fd = UNALLOCATED_FD;
+	} else {
+	    char announce[GPS_JSON_RESPONSE_MAX];
+	    client->fd = ssock;
+	    client->active = time(NULL);
+	    metrics.accepted++;
+	    gpsd_log(&context.errout, LOG_SPIN,
+		     "client %s (%d) connect on fd %d\n", c_ip,
+		     sub_index(client), ssock);
+	    json_version_dump(announce, sizeof(announce));
+	    (void)throttled_write(client, announce, strlen(announce));
+	}
     }
-    return (int)throttled_write(sub, reply, strlen(reply));
 }
 #endif /* SOCKET_EXPORT_ENABLE */
 
 #if defined(CONTROL_SOCKET_ENABLE) && defined(PPS_ENABLE) && defined(SOCKET_EXPORT_ENABLE)
+/*
+ * PPS events are recognized in the PPS threads, but only the main
+ * thread writes to client sockets, so a slow client can never hold up
+ * PPS edge handling.  Each device has a ring of pending events whose
+ * only producer is that device's PPS thread and whose only consumer
+ * is the main loop, so neither side takes a lock.  After queuing an
+ * event the producer kicks pps_wake, an eventfd (a pipe where there
+ * is none) that the main loop watches.
+ */
+#define PPS_QUEUE_DEPTH	8	/* events a device may have pending */
+struct pps_queue_t {
+    volatile unsigned int head;		/* next slot to fill; PPS thread */
+    volatile unsigned int tail;		/* next slot to ship; main thread */
+    volatile unsigned long overruns;	/* events lost to a full ring */
+    unsigned long overruns_seen;	/* overruns already logged */
+    struct timedelta_t td[PPS_QUEUE_DEPTH];
+};
+static struct pps_queue_t pps_queue[MAX_DEVICES];
+static int pps_wake[2] = {-1, -1};	/* read and write ends */
+static struct watch_t pps_watch;
+
 static void ship_pps_message(struct gps_device_t *session,
 				   struct timedelta_t *td)
-/* on PPS interrupt, ship a message to all clients */
+/* on PPS interrupt, queue a message to all clients; runs in the PPS thread */
 {
-    int precision = -20;
+    struct pps_queue_t *q = &pps_queue[session - devices];
+    unsigned int head = q->head;
+    uint64_t one = 1;
 
-    if ( source_usb == session->sourcetype) {
-        /* PPS over USB not so good */
-	precision = -10;
+    if (head - q->tail >= PPS_QUEUE_DEPTH) {
+	/* the main loop is badly behind; don't overwrite what it may read */
+	q->overruns++;
+	return;
     }
+    q->td[head % PPS_QUEUE_DEPTH] = *td;
+    /* the event must be in place before the consumer can see it */
+    memory_barrier();
+    q->head = head + 1;
 
-    /* real_XXX - the time the GPS thinks it is at the PPS edge */
-    /* clock_XXX - the time the system clock thinks it is at the PPS edge */
-    notify_watchers(session, true, true,
-		    "{\"class\":\"PPS\",\"device\":\"%s\",\"real_sec\":%ld, \"real_nsec\":%ld,\"clock_sec\":%ld,\"clock_nsec\":%ld,\"precision\":%d}\r\n",
-		    session->gpsdata.dev.path,
-		    td->real.tv_sec, td->real.tv_nsec,
-		    td->clock.tv_sec, td->clock.tv_nsec,
-                    precision);
+    if (pps_wake[1] != -1)
+	ignore_return(write(pps_wake[1], &one, sizeof(one)));
+}
 
-    /*
-     * PPS receipt resets the device's timeout.  This keeps PPS-only
-     * devices, which never deliver in-band data, from timing out.
-     */
-    session->gpsdata.online = timestamp();
+static void notify_ppsstats_watchers(struct gps_device_t *session)
+/* ship a device's PPS statistics to the watchers that asked for them */
+{
+    struct subscriber_t *sub;
+    struct pps_stats_t stats;
+    char buf[GPS_JSON_RESPONSE_MAX];
+    size_t len = 0;
+
+    for (sub = subscribers; sub < subscribers + MAX_CLIENTS; sub++) {
+	/* never implied by an empty class list; old clients don't know it */
+	if (sub->active == 0 || !subscribed(sub, session)
+	    || !sub->policy.json
+	    || (sub->policy.classes & CLASS_PPSSTATS) == 0)
+	    continue;
+	if (len == 0) {
+	    if (!pps_thread_stats(&session->pps_thread, &stats))
+		return;
+	    len = json_ppsstats_dump(session, &stats, buf, sizeof(buf));
+	}
+	(void)throttled_write(sub, buf, len);
+    }
+}
+
+static void ship_pps_events(struct watch_t *watch)
+/* ship the PPS events queued by the PPS threads */
+{
+    struct gps_device_t *session;
+    uint64_t count;
+
+    /* clear the wakeup before looking, so no later event is missed */
+    while (read(watch->fd, &count, sizeof(count)) > 0)
+	continue;
+
+    for (session = devices; session < devices + MAX_DEVICES; session++) {
+	struct pps_queue_t *q = &pps_queue[session - devices];
+	unsigned int tail = q->tail;
+	unsigned long overruns = q->overruns;
+	bool shipped = false;
+
+	if (overruns != q->overruns_seen) {
+	    gpsd_log(&context.errout, LOG_WARN,
+		     "PPS: %lu events on %s dropped, queue full\n",
+		     overruns - q->overruns_seen, session->gpsdata.dev.path);
+	    q->overruns_seen = overruns;
+	}
+	while (tail != q->head) {
+	    struct timedelta_t td;
+	    int precision = -20;
+
+	    /* don't read the event before seeing the index that covers it */
+	    memory_barrier();
+	    td = q->td[tail % PPS_QUEUE_DEPTH];
+	    memory_barrier();
+	    q->tail = ++tail;
+
+	    if (!allocated_device(session))
+		continue;
+
+	    if ( source_usb == session->sourcetype) {
+		/* PPS over USB not so good */
+		precision = -10;
+	    }
+
+	    notify_time_watchers(session, binary_pps, &td, precision);
+
+	    /*
+	     * PPS receipt resets the device's timeout.  This keeps PPS-only
+	     * devices, which never deliver in-band data, from timing out.
+	     */
+	    session->gpsdata.online = timestamp();
+	    shipped = true;
+	}
+	if (shipped && allocated_device(session))
+	    notify_ppsstats_watchers(session);
+    }
+}
+
+static void pps_wake_open(void)
+/* set up the descriptor the PPS threads use to wake the main loop */
+{
+#ifdef HAVE_SYS_EVENTFD_H
+    pps_wake[0] = pps_wake[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (pps_wake[0] == -1)
+#endif /* HAVE_SYS_EVENTFD_H */
+    {
+	if (pipe(pps_wake) == -1) {
+	    gpsd_log(&context.errout, LOG_ERROR,
+		     "PPS: can't create wakeup descriptor: %s\n",
+		     strerror(errno));
+	    pps_wake[0] = pps_wake[1] = -1;
+	    return;
+	}
+	(void)fcntl(pps_wake[0], F_SETFL, O_NONBLOCK);
+	(void)fcntl(pps_wake[1], F_SETFL, O_NONBLOCK);
+	(void)fcntl(pps_wake[0], F_SETFD, FD_CLOEXEC);
+	(void)fcntl(pps_wake[1], F_SETFD, FD_CLOEXEC);
+    }
+    watch_init(&pps_watch, PHASE_LISTENER, ship_pps_events, NULL);
+    (void)watch_fd(&pps_watch, pps_wake[0]);
 }
 #endif
 
@@ -1820,6 +2888,150 @@ static void netgnss_autoconnect(struct gps_context_t *context,
 }
 #endif /* __UNUSED_AUTOCONNECT__ */
 
+static void poll_device(struct gps_device_t *device, bool data_ready)
+/* consume input from a device and keep its watch in step */
+{
+    struct watch_t *watch = device_watch_of(device);
+    /* a zero-length read may make gpsd_multipoll() reopen the device */
+    bool reopen = device->zerokill;
+
+    switch (gpsd_multipoll(data_ready, device, all_reports, DEVICE_REAWAKE))
+    {
+    case DEVICE_READY:
+	if (reopen)
+	    unwatch_fd(watch);
+	if (!watch_fd(watch, device->gpsdata.gps_fd))
+	    deactivate_device(device);
+	break;
+    case DEVICE_UNREADY:
+	unwatch_fd(watch);
+	break;
+    case DEVICE_ERROR:
+    case DEVICE_EOF:
+	deactivate_device(device);
+	break;
+    default:
+	break;
+    }
+}
+
+static bool devices_pending(void)
+/* does any device have input left over from an exhausted budget? */
+{
+    struct gps_device_t *device;
+
+    for (device = devices; device < devices + MAX_DEVICES; device++)
+	if (allocated_device(device) && device->gpsdata.gps_fd > 0
+	    && device->multipoll.pending)
+	    return true;
+    return false;
+}
+
+static int await_watches(void)
+/* wait for input, then dispatch it to the watch handlers phase by phase */
+{
+    struct watch_t *ready[MAX_WATCHES];
+    int nready = 0, phase, i;
+    /* don't sleep on input that is already buffered */
+    bool nowait = devices_pending();
+
+    wakeups++;
+#ifdef HAVE_SYS_EPOLL_H
+    if (epfd >= 0) {
+	struct epoll_event events[MAX_WATCHES];
+
+	gpsd_log(&context.errout, LOG_RAW + 2, "epoll waits\n");
+	nready = epoll_pwait(epfd, events, MAX_WATCHES, nowait ? 0 : -1, NULL);
+	if (nready == -1) {
+	    if (errno == EINTR)
+		return AWAIT_NOT_READY;
+	    gpsd_log(&context.errout, LOG_ERROR,
+		     "epoll_pwait: %s\n", strerror(errno));
+	    return AWAIT_FAILED;
+	}
+	for (i = 0; i < nready; i++)
+	    ready[i] = (struct watch_t *)events[i].data.ptr;
+	gpsd_log(&context.errout, LOG_SPIN,
+		 "epoll_pwait() -> %d of %d watches at %f\n",
+		 nready, watchcount, timestamp());
+    } else
+#endif /* HAVE_SYS_EPOLL_H */
+    {
+	fd_set rfds, efds;
+
+	switch (gpsd_await_data(&rfds, &efds, maxfd, &all_fds, nowait,
+				&context.errout))
+	{
+	case AWAIT_GOT_INPUT:
+	    break;
+	case AWAIT_NOT_READY:
+	    /* drop watches whose descriptors have gone bad under us */
+	    for (i = watchcount - 1; i >= 0; i--) {
+		struct watch_t *watch = watches[i];
+
+		if (!FD_ISSET(watch->fd, &efds))
+		    continue;
+		if (watch->phase == PHASE_DEVICE) {
+		    struct gps_device_t *device = devices
+			+ (watch - device_watch);
+		    deactivate_device(device);
+		    free_device(device);
+		}
+#ifdef SOCKET_EXPORT_ENABLE
+		else if (watch->phase == PHASE_CLIENT)
+		    detach_client((struct subscriber_t *)watch->arg);
+#endif /* SOCKET_EXPORT_ENABLE */
+		else
+		    unwatch_fd(watch);
+	    }
+	    return AWAIT_NOT_READY;
+	case AWAIT_FAILED:
+	    return AWAIT_FAILED;
+	}
+	for (i = 0; i < watchcount; i++)
+	    if (FD_ISSET(watches[i]->fd, &rfds) || watches[i]->output)
+		ready[nready++] = watches[i];
+    }
+
+    for (i = 0; i < nready; i++)
+	ready[i]->wakeup = wakeups;
+
+    for (phase = 0; phase < PHASE_COUNT; phase++) {
+	if (phase == PHASE_DEVICE) {
+	    int n;
+
+	    /*
+	     * Devices are swept rather than dispatched, because one
+	     * that is not ready may still be due a reawake or have
+	     * input carried over from its last budget.  Each sweep
+	     * starts one device further on, so that no device is
+	     * always served first.
+	     */
+	    for (n = 0; n < MAX_DEVICES; n++) {
+		struct gps_device_t *device =
+		    &devices[(device_turn + n) % MAX_DEVICES];
+		bool data_ready;
+
+		if (!allocated_device(device) || device->gpsdata.gps_fd <= 0)
+		    continue;
+		data_ready = device_watch_of(device)->wakeup == wakeups;
+		if (data_ready || device->reawake > 0
+		    || device->multipoll.pending)
+		    poll_device(device, data_ready);
+	    }
+	    device_turn = (device_turn + 1) % MAX_DEVICES;
+	    continue;
+	}
+	for (i = 0; i < nready; i++)
+	    /* an earlier handler may have unregistered this watch */
+	    if (ready[i]->phase == phase && ready[i]->slot >= 0
+		&& ready[i]->handler != NULL)
+		ready[i]->handler(ready[i]);
+    }
+
+    return AWAIT_GOT_INPUT;
+}
+
 #ifdef PPS_ENABLE
 #define CONDITIONALLY_UNUSED
 #else
@@ -1832,6 +3044,7 @@ static void gpsd_terminate(struct gps_context_t *context CONDITIONALLY_UNUSED)
 
     for (dfd = 0; dfd < MAX_DEVICES; dfd++) {
 	if (allocated_device(&devices[dfd])) {
+	    unwatch_fd(&device_watch[dfd]);
 	    (void)gpsd_wrap(&devices[dfd]);
 	}
     }
@@ -1846,19 +3059,16 @@ int main(int argc, char *argv[])
 #ifdef SOCKET_EXPORT_ENABLE
     static char *gpsd_service = NULL;
     struct subscriber_t *sub;
+    static time_t last_sweep = 0;
 #endif /* SOCKET_EXPORT_ENABLE */
-    fd_set rfds;
-#ifdef CONTROL_SOCKET_ENABLE
-    fd_set control_fds;
-#endif /* CONTROL_SOCKET_ENABLE */
 #ifdef CONTROL_SOCKET_ENABLE
     static socket_t csock;
-    socket_t cfd;
     static char *control_socket = NULL;
+    static struct watch_t control_watch;
 #endif /* CONTROL_SOCKET_ENABLE */
-#if defined(SOCKET_EXPORT_ENABLE) || defined(CONTROL_SOCKET_ENABLE)
-    sockaddr_t fsin;
-#endif /* defined(SOCKET_EXPORT_ENABLE) || defined(CONTROL_SOCKET_ENABLE) */
+#ifdef SOCKET_EXPORT_ENABLE
+    static struct watch_t listen_watch[AFCOUNT];
+#endif /* SOCKET_EXPORT_ENABLE */
     static char *pid_file = NULL;
     struct gps_device_t *device;
     int i, option;
@@ -1876,7 +3086,7 @@ int main(int argc, char *argv[])
 #endif /* PPS_ENABLE && SOCKET_EXPORT_ENABLE */
 #endif /* CONTROL_SOCKET_ENABLE */
 
-    while ((option = getopt(argc, argv, "F:D:S:bGhlNnrP:V")) != -1) {
+    while ((option = getopt(argc, argv, "F:D:S:bGhlNnrP:Q:V")) != -1) {
 	switch (option) {
 	case 'D':
 	    context.errout.debug = (int)strtol(optarg, 0, 0);
@@ -1919,6 +3129,20 @@ int main(int argc, char *argv[])
 	case 'P':
 	    pid_file = optarg;
 	    break;
+	case 'Q':
+#ifdef SOCKET_EXPORT_ENABLE
+	    {
+		long mark = strtol(optarg, NULL, 0);
+
+		if (mark > 0 && mark <= OUTQ_SIZE)
+		    outq_highwater = (size_t)mark;
+		else
+		    gpsd_log(&context.errout, LOG_WARN,
+			     "-Q %s out of range, must be 1 to %d\n",
+			     optarg, OUTQ_SIZE);
+	    }
+#endif /* SOCKET_EXPORT_ENABLE */
+	    break;
 	case 'V':
 	    (void)printf("%s: %s (revision %s)\n", argv[0], VERSION, REVISION);
 	    exit(EXIT_SUCCESS);
@@ -1971,8 +3195,6 @@ int main(int argc, char *argv[])
 #if defined(SYSTEMD_ENABLE) && defined(CONTROL_SOCKET_ENABLE)
     if (sd_socket_count > 0) {
         csock = SD_SOCKET_FDS_START;
-        FD_SET(csock, &all_fds);
-        adjust_max_fd(csock, true);
     }
 #endif
 #ifdef CONTROL_SOCKET_ENABLE
@@ -1987,8 +3209,6 @@ int main(int argc, char *argv[])
 	    gpsd_log(&context.errout, LOG_SPIN,
 		     "control socket %s is fd %d\n",
 		     control_socket, csock);
-	FD_SET(csock, &all_fds);
-	adjust_max_fd(csock, true);
 	gpsd_log(&context.errout, LOG_PROG,
 		 "control socket opened at %s\n",
 		 control_socket);
@@ -2026,6 +3246,29 @@ int main(int argc, char *argv[])
     openlog("gpsd", LOG_PID, LOG_USER);
     gpsd_log(&context.errout, LOG_INF, "launching (Version %s)\n", VERSION);
 
+#ifdef HAVE_SYS_EPOLL_H
+    /* after daemonizing, so the epoll instance belongs to the daemon */
+    if ((epfd = epoll_create1(EPOLL_CLOEXEC)) == -1)
+	gpsd_log(&context.errout, LOG_WARN,
+		 "epoll_create1: %s, falling back to pselect()\n",
+		 strerror(errno));
+#endif /* HAVE_SYS_EPOLL_H */
+    for (i = 0; i < MAX_DEVICES; i++)
+	watch_init(&device_watch[i], PHASE_DEVICE, NULL, &devices[i]);
+#ifdef SOCKET_EXPORT_ENABLE
+    for (i = 0; i < AFCOUNT; i++)
+	watch_init(&listen_watch[i], PHASE_LISTENER, accept_client, NULL);
+    for (i = 0; i < NITEMS(subscribers); i++)
+	watch_init(&subscribers[i].watch, PHASE_CLIENT,
+		   service_client, &subscribers[i]);
+#endif /* SOCKET_EXPORT_ENABLE */
+#ifdef CONTROL_SOCKET_ENABLE
+    watch_init(&control_watch, PHASE_LISTENER, accept_control, NULL);
+#if defined(PPS_ENABLE) && defined(SOCKET_EXPORT_ENABLE)
+    pps_wake_open();
+#endif /* PPS_ENABLE && SOCKET_EXPORT_ENABLE */
+#endif /* CONTROL_SOCKET_ENABLE */
+
 #ifdef SOCKET_EXPORT_ENABLE
     if (!gpsd_service)
 	gpsd_service =
@@ -2195,13 +3438,30 @@ int main(int argc, char *argv[])
 
     signalled = 0;
 
+    /*
+     * Listeners are drained until EAGAIN, so they must not block.
+     * Re-registering them after a SIGHUP restart is harmless.
+     */
+#ifdef SOCKET_EXPORT_ENABLE
     for (i = 0; i < AFCOUNT; i++)
 	if (msocks[i] >= 0) {
-	    FD_SET(msocks[i], &all_fds);
-	    adjust_max_fd(msocks[i], true);
+	    int opts = fcntl(msocks[i], F_GETFL);
+
+	    if (opts >= 0)
+		(void)fcntl(msocks[i], F_SETFL, opts | O_NONBLOCK);
+	    if (!watch_fd(&listen_watch[i], msocks[i]))
+		exit(EXIT_FAILURE);
 	}
+#endif /* SOCKET_EXPORT_ENABLE */
 #ifdef CONTROL_SOCKET_ENABLE
-    FD_ZERO(&control_fds);
+    if (csock > -1) {
+	int opts = fcntl(csock, F_GETFL);
+
+	if (opts >= 0)
+	    (void)fcntl(csock, F_SETFL, opts | O_NONBLOCK);
+	if (!watch_fd(&control_watch, csock))
+	    exit(EXIT_FAILURE);
+    }
 #endif /* CONTROL_SOCKET_ENABLE */
 
     /* initialize the GPS context's time fields */
@@ -2222,148 +3482,16 @@ int main(int argc, char *argv[])
 	}
 
     while (0 == signalled) {
-	fd_set efds;
-
-	switch(gpsd_await_data(&rfds, &efds, maxfd, &all_fds, &context.errout))
+	switch(await_watches())
 	{
 	case AWAIT_GOT_INPUT:
 	    break;
 	case AWAIT_NOT_READY:
-	    for (device = devices; device < devices + MAX_DEVICES; device++)
-		/*
-		 * The file descriptor validity check is reqiured on some ARM
-		 * platforms to prevent a core dump.  This may be due to an
-		 * implimentation error in FD_ISSET().
-		 */
-		if (allocated_device(device)
-		    && (0 <= device->gpsdata.gps_fd && device->gpsdata.gps_fd < (socket_t)FD_SETSIZE)
-		    && FD_ISSET(device->gpsdata.gps_fd, &efds)) {
-		    deactivate_device(device);
-		    free_device(device);
-		}
 	    continue;
 	case AWAIT_FAILED:
 	    exit(EXIT_FAILURE);
 	}
 
-#ifdef SOCKET_EXPORT_ENABLE
-	/* always be open to new client connections */
-	for (i = 0; i < AFCOUNT; i++) {
-	    if (msocks[i] >= 0 && FD_ISSET(msocks[i], &rfds)) {
-		socklen_t alen = (socklen_t) sizeof(fsin);
-		socket_t ssock =
-		    accept(msocks[i], (struct sockaddr *)&fsin, &alen);
-
-		if (BAD_SOCKET(ssock))
-		    gpsd_log(&context.errout, LOG_ERROR,
-			     "accept: %s\n", strerror(errno));
-		else {
-		    struct subscriber_t *client = NULL;
-		    int opts = fcntl(ssock, F_GETFL);
-		    static struct linger linger = { 1, RELEASE_TIMEOUT };
-		    char *c_ip;
-
-		    if (opts >= 0)
-			(void)fcntl(ssock, F_SETFL, opts | O_NONBLOCK);
-
-		    c_ip = netlib_sock2ip(ssock);
-		    client = allocate_client();
-		    if (client == NULL) {
-			gpsd_log(&context.errout, LOG_ERROR,
-				 "Client %s connect on fd %d -"
-				 "no subscriber slots available\n", c_ip,
-				    ssock);
-			(void)close(ssock);
-		    } else
-			if (setsockopt
-			    (ssock, SOL_SOCKET, SO_LINGER, (char *)&linger,
-			     (int)sizeof(struct linger)) == -1) {
-			gpsd_log(&context.errout, LOG_ERROR,
-				 "Error: SETSOCKOPT SO_LINGER\n");
-			(void)close(ssock);
-		    } else {
-			char announce[GPS_JSON_RESPONSE_MAX];
-			FD_SET(ssock, &all_fds);
-			adjust_max_fd(ssock, true);
-			client->fd = ssock;
-			client->active = time(NULL);
-			gpsd_log(&context.errout, LOG_SPIN,
-				 "client %s (%d) connect on fd %d\n", c_ip,
-				 sub_index(client), ssock);
-			json_version_dump(announce, sizeof(announce));
-			(void)throttled_write(client, announce,
-					      strlen(announce));
-		    }
-		}
-		FD_CLR(msocks[i], &rfds);
-	    }
-	}
-#endif /* SOCKET_EXPORT_ENABLE */
-
-#ifdef CONTROL_SOCKET_ENABLE
-	/* also be open to new control-socket connections */
-	if (csock > -1 && FD_ISSET(csock, &rfds)) {
-	    socklen_t alen = (socklen_t) sizeof(fsin);
-	    socket_t ssock = accept(csock, (struct sockaddr *)&fsin, &alen);
-
-	    if (BAD_SOCKET(ssock))
-		gpsd_log(&context.errout, LOG_ERROR,
-			 "accept: %s\n", strerror(errno));
-	    else {
-		gpsd_log(&context.errout, LOG_INF,
-			 "control socket connect on fd %d\n",
-			 ssock);
-		FD_SET(ssock, &all_fds);
-		FD_SET(ssock, &control_fds);
-		adjust_max_fd(ssock, true);
-	    }
-	    FD_CLR(csock, &rfds);
-	}
-
-	/* read any commands that came in over the control socket */
-	for (cfd = 0; cfd < (int)FD_SETSIZE; cfd++)
-	    if (FD_ISSET(cfd, &control_fds)) {
-		char buf[BUFSIZ];
-		ssize_t rd;
-
-		while ((rd = read(cfd, buf, sizeof(buf) - 1)) > 0) {
-		    buf[rd] = '\0';
-		    gpsd_log(&context.errout, LOG_CLIENT,
-			     "<= control(%d): %s\n", cfd, buf);
-		    /* coverity[tainted_data] Safe, never handed to exec */
-		    handle_control(cfd, buf);
-		}
-		gpsd_log(&context.errout, LOG_SPIN,
-			 "close(%d) of control socket\n", cfd);
-		(void)close(cfd);
-		FD_CLR(cfd, &all_fds);
-		FD_CLR(cfd, &control_fds);
-		adjust_max_fd(cfd, false);
-	    }
-#endif /* CONTROL_SOCKET_ENABLE */
-
-	/* poll all active devices */
-	for (device = devices; device < devices + MAX_DEVICES; device++)
-	    if (allocated_device(device) && device->gpsdata.gps_fd > 0)
-		switch (gpsd_multipoll(FD_ISSET(device->gpsdata.gps_fd, &rfds),
-				       device, all_reports, DEVICE_REAWAKE))
-		{
-		case DEVICE_READY:
-		    FD_SET(device->gpsdata.gps_fd, &all_fds);
-		    adjust_max_fd(device->gpsdata.gps_fd, true);
-		    break;
-		case DEVICE_UNREADY:
-		    FD_CLR(device->gpsdata.gps_fd, &all_fds);
-		    adjust_max_fd(device->gpsdata.gps_fd, false);
-		    break;
-		case DEVICE_ERROR:
-		case DEVICE_EOF:
-		    deactivate_device(device);
-		    break;
-		default:
-		    break;
-		}
-
 #ifdef __UNUSED_AUTOCONNECT__
 	if (context.fixcnt > 0 && !context.autconnect) {
 	    for (device = devices; device < devices + MAX_DEVICES; device++) {
@@ -2379,52 +3507,22 @@ int main(int argc, char *argv[])
 #endif /* __UNUSED_AUTOCONNECT__ */
 
 #ifdef SOCKET_EXPORT_ENABLE
-	/* accept and execute commands for all clients */
-	for (sub = subscribers; sub < subscribers + MAX_CLIENTS; sub++) {
-	    if (sub->active == 0)
-		continue;
-
-	    lock_subscriber(sub);
-	    if (FD_ISSET(sub->fd, &rfds)) {
-		char buf[BUFSIZ];
-		int buflen;
-
-		unlock_subscriber(sub);
-
-		gpsd_log(&context.errout, LOG_PROG,
-			 "checking client(%d)\n",
-			 sub_index(sub));
-		if ((buflen =
-		     (int)recv(sub->fd, buf, sizeof(buf) - 1, 0)) <= 0) {
-		    detach_client(sub);
-		} else {
-		    if (buf[buflen - 1] != '\n')
-			buf[buflen++] = '\n';
-		    buf[buflen] = '\0';
-		    gpsd_log(&context.errout, LOG_CLIENT,
-			     "<= client(%d): %s\n", sub_index(sub), buf);
-
-		    /*
-		     * When a command comes in, update subscriber.active to
-		     * timestamp() so we don't close the connection
-		     * after COMMAND_TIMEOUT seconds. This makes
-		     * COMMAND_TIMEOUT useful.
-		     */
-		    sub->active = time(NULL);
-		    if (handle_gpsd_request(sub, buf) < 0)
-			detach_client(sub);
-		}
-	    } else {
-		unlock_subscriber(sub);
-
-		if (!sub->policy.watcher
+	/* client commands were executed by their watch handlers */
+	if (time(NULL) != last_sweep) {
+	    last_sweep = time(NULL);
+	    for (sub = subscribers; sub < subscribers + MAX_CLIENTS; sub++)
+		if (sub->active != 0 && !sub->policy.watcher
 		    && time(NULL) - sub->active > COMMAND_TIMEOUT) {
 		    gpsd_log(&context.errout, LOG_WARN,
 			     "client(%d) timed out on command wait.\n",
 			     sub_index(sub));
 		    detach_client(sub);
+		} else if (sub->active != 0 && sub->outq.count > 0
+			   && time(NULL) - sub->outq.progress > NOREAD_TIMEOUT) {
+		    gpsd_log(&context.errout, LOG_INF,
+			     "client(%d) timed out.\n", sub_index(sub));
+		    detach_client(sub);
 		}
-	    }
 	}
 
 	/*
@@ -25,6 +25,9 @@ extern "C" {
 #include <winsock2.h> /* for fd_set */
 #endif
 #include <time.h>    /* for time_t */
+#ifdef NMEA2000_ENABLE
+#include <linux/can.h>	/* for struct can_frame */
+#endif /* NMEA2000_ENABLE */
 
 #include "gps.h"
 #include "os_compat.h"
@@ -178,8 +181,13 @@ struct gps_lexer_t {
     unsigned int flags;
 #define LEXER_F_IGNORE_CHECKSUM	(1 << 0)
     size_t length;
-    unsigned char inbuffer[MAX_PACKET_LENGTH*2+1];
-    size_t inbuflen;
+    /*
+     * Input is consumed by advancing inbuffer through inbufstore, and
+     * only moved back to the front when a read needs the room.
+     */
+    unsigned char inbufstore[MAX_PACKET_LENGTH*2+1];
+    unsigned char *inbuffer;		/* start of unconsumed input */
+    size_t inbuflen;			/* bytes of input from inbuffer */
     unsigned char *inbufptr;
     /* outbuffer needs to be able to hold 4 GPGSV records at once */
     unsigned char outbuffer[MAX_PACKET_LENGTH*2+1];
@@ -191,6 +199,8 @@ struct gps_lexer_t {
 #ifdef TIMING_ENABLE
     timestamp_t start_time;		/* timestamp of first input */
     unsigned long start_char;		/* char counter at first input */
+    uint64_t read_ns;			/* in read(2) since last reset */
+    uint64_t lex_ns;			/* in packet_parse() since reset */
 #endif /* TIMING_ENABLE */
     /*
      * ISGPS200 decoding context.
@@ -215,6 +225,13 @@ struct gps_lexer_t {
     unsigned int json_depth;
     unsigned int json_after;
 #endif /* PASSTHROUGH_ENABLE */
+#ifdef NMEA0183_ENABLE
+    /* NMEA checksum accumulated as the sentence body arrives */
+    unsigned char nmea_sum;		/* XOR of inbuffer[1..nmea_summed) */
+    size_t nmea_summed;			/* 0 until the body starts */
+    unsigned char nmea_starsum;		/* nmea_sum before the last '*' */
+    size_t nmea_star;			/* offset of the last '*', or 0 */
+#endif /* NMEA0183_ENABLE */
 #ifdef STASH_ENABLE
     unsigned char stashbuffer[MAX_PACKET_LENGTH];
     size_t stashbuflen;
@@ -243,8 +260,6 @@ extern int packet_sniff(struct gps_lexer_t *);
 #define NTP_MIN_FIXES	3  /* # fixes to wait for before shipping NTP time */
 
 
-#define AIVDM_CHANNELS	2		/* A, B */
-
 struct gps_device_t;
 
 struct gps_context_t {
@@ -291,23 +306,52 @@ struct gps_context_t {
 
 /* state for resolving interleaved Type 24 packets */
 struct ais_type24a_t {
-    unsigned int mmsi;
+    unsigned int mmsi;		/* 0 if the slot is free */
+    unsigned long serial;	/* value of stashed when this arrived */
     char shipname[AIS_SHIPNAME_MAXLEN+1];
 };
-#define MAX_TYPE24_INTERLEAVE	8	/* max number of queued type 24s */
-struct ais_type24_queue_t {
-    struct ais_type24a_t ships[MAX_TYPE24_INTERLEAVE];
-    int index;
+#define AIS_TYPE24_SLOTS	64	/* 24As awaiting a 24B */
+#define AIS_TYPE24_PROBE	8	/* slots an MMSI may be stashed in */
+struct ais_type24_table_t {
+    struct ais_type24a_t ships[AIS_TYPE24_SLOTS];
+    unsigned long stashed;	/* 24As seen */
+    unsigned long matched;	/* 24Bs paired with their 24A */
+    unsigned long evicted;	/* 24As pushed out before their 24B came */
 };
 
-/* state for resolving AIVDM decodes */
+/* state for reassembling one AIVDM message */
+#define AIVDM_MAX_BITS		2048	/* longest payload kept */
 struct aivdm_context_t {
-    /* hold context for decoding AIDVM packet sequences */
-    int decoded_frags;		/* for tracking AIDVM parts in a multipart sequence */
-    unsigned char bits[2048];
+    /* the key: talker, channel and sequential message ID */
+    char talker[2];
+    char channel;
+    int seqid;
+    int nfrags;			/* fragments in the whole message */
+    int decoded_frags;		/* fragments assembled so far, 0 if free */
+    timestamp_t stamp;		/* arrival of the latest fragment */
+    unsigned char bits[AIVDM_MAX_BITS / CHAR_BIT];
     size_t bitlen; /* how many valid bits */
-    struct ais_type24_queue_t type24_queue;
 };
+#define AIVDM_REASSEMBLY_SLOTS	16	/* multipart messages in flight */
+#define AIVDM_FRAGMENT_TIMEOUT	10	/* seconds a partial message is kept */
+
+#ifdef NMEA2000_ENABLE
+/* state for reassembling one NMEA2000 fast-packet */
+#define NMEA2000_FAST_MAX	223	/* longest fast-packet payload */
+struct nmea2000_fast_t {
+    /* the key: source address, PGN and sequence counter */
+    unsigned int source;
+    unsigned int pgn;
+    unsigned int seq;
+    unsigned int frame;		/* next frame number expected, 0 if free */
+    unsigned long used;		/* serial of the latest frame, for eviction */
+    size_t len;			/* payload length announced in frame 0 */
+    size_t got;			/* payload bytes assembled so far */
+    unsigned char data[NMEA2000_FAST_MAX];
+};
+#define NMEA2000_FAST_SLOTS	8	/* fast-packets in flight */
+#define NMEA2000_BATCH		16	/* CAN frames fetched per read */
+#endif /* NMEA2000_ENABLE */
 
 #define MODE_NMEA	0
 #define MODE_BINARY	1
@@ -469,6 +513,82 @@ struct ntrip_stream_t
 #include "ppsthread.h"
 #endif /* PPS_ENABLE */
 
+#ifdef TIMING_ENABLE
+/*
+ * Where one packet's time went on its way from the device to clients.
+ * gpsd_poll() fills in the stages up to the error model and the daemon
+ * adds the rest; a packet that makes no report has no encode or send
+ * time.  The daemon keeps the last LATENCY_RING traces per device.
+ */
+enum latency_stage_t {
+    latency_read,		/* read(2) from the device */
+    latency_lex,		/* packet_parse() */
+    latency_parse,		/* the driver's parse_packet method */
+    latency_model,		/* gpsd_error_model() */
+    latency_encode,		/* rendering reports */
+    latency_send,		/* writing reports to clients */
+    latency_stages
+};
+
+struct latency_trace_t {
+    uint64_t start;			/* gpsd_poll() entry, monotonic ns */
+    uint64_t total;			/* start to the last client write */
+    uint64_t stage[latency_stages];	/* ns spent in each stage */
+    int type;				/* packet type */
+};
+
+#define LATENCY_RING	64
+#define LATENCY_BATCH	16	/* most traces in one LATENCY report */
+#endif /* TIMING_ENABLE */
+
+static inline uint64_t latency_now(void)
+/* monotonic nanoseconds, for charging time to pipeline stages */
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * Per-device counters for ?METRICS.  Only the main loop touches a
+ * device's counters, so bumping one is a plain increment and reading
+ * them back takes no lock.  They last as long as the device slot.
+ */
+#define METRIC_PACKET_TYPES	(SKY_PACKET + 1)
+#define METRIC_DRIVERS		32	/* drivers_identified is 32 bits */
+
+struct device_metrics_t {
+    unsigned long packets[METRIC_PACKET_TYPES];	/* by lexer type */
+    unsigned long bad;			/* packets failing checksum */
+    unsigned long bytes_in;		/* characters the lexer took */
+    unsigned long bytes_out;		/* written to the device */
+    struct {
+	unsigned long calls;
+	uint64_t ns;
+    } parse[METRIC_DRIVERS];		/* parse_packet, by driver index */
+};
+
+#ifdef NTPSHM_ENABLE
+/*
+ * One time-export channel: an NTP SHM segment and, for PPS, a chrony
+ * SOCK socket.  Whatever doesn't change from sample to sample is set up
+ * once when the channel is linked.  A chrony socket that isn't there yet,
+ * or goes away when chronyd restarts, is reconnected on a later sample.
+ */
+struct time_export_t {
+    volatile struct shmTime *shm;	/* NULL if not exporting */
+    int precision;			/* log(2) of jitter, for ntpd */
+    const char *device;			/* for log messages */
+# ifdef PPS_ENABLE
+    int chronyfd;			/* -1 while not connected */
+    char chrony_path[GPS_PATH_MAX];	/* empty if chrony isn't used */
+    time_t chrony_retry;		/* earliest reconnection attempt */
+    unsigned long chrony_lost;		/* samples chronyd didn't take */
+# endif /* PPS_ENABLE */
+};
+#endif /* NTPSHM_ENABLE */
+
 struct gps_device_t {
 /* session object, encapsulates all global state */
     struct gps_data_t gpsdata;
@@ -497,19 +617,33 @@ struct gps_device_t {
     time_t releasetime;
     bool zerokill;
     time_t reawake;
+    struct {
+	unsigned long wakeups;		/* calls that found data ready */
+	unsigned long packets;		/* packets handled in all wakeups */
+	unsigned int last;		/* packets handled on last wakeup */
+	unsigned int max;		/* most packets in one wakeup */
+	unsigned long exhausted;	/* wakeups that ran out of budget */
+	bool pending;			/* buffered input left over */
+    } multipoll;
+    struct device_metrics_t metrics;
 #ifdef TIMING_ENABLE
     timestamp_t sor;	/* timestamp start of this reporting cycle */
     unsigned long chars;	/* characters in the cycle */
+    struct {
+	struct latency_trace_t current;	/* the packet being handled */
+	struct latency_trace_t trace[LATENCY_RING];
+	unsigned long head;		/* traces ever committed */
+	unsigned long reported;		/* traces already shipped */
+    } latency;
 #endif /* TIMING_ENABLE */
 #ifdef NTP_ENABLE
     bool ship_to_ntpd;
 #ifdef NTPSHM_ENABLE
-    volatile struct shmTime *shm_clock;
-#endif /* NTPSHM_ENABLE */
+    struct time_export_t clock_export;	/* in-band time */
 # ifdef PPS_ENABLE
-    volatile struct shmTime *shm_pps;
-    int chronyfd;			/* for talking to chrony */
+    struct time_export_t pps_export;	/* written by the PPS thread */
 # endif /* PPS_ENABLE */
+#endif /* NTPSHM_ENABLE */
 #endif /* NTP_ENABLE */
 #ifdef PPS_ENABLE
     volatile struct pps_thread_t pps_thread;
@@ -692,13 +826,19 @@ struct gps_device_t {
 	    bool unit_valid;
 	    int mode;
 	    unsigned int mode_valid;
-	    unsigned int idx;
-//	    size_t ptr;
-	    size_t fast_packet_len;
 	    int type;
 	    void *workpgn;
-	    void *pgnlist;
+	    unsigned int pgnlist;	/* PGN list in use, 0 until known */
+	    struct nmea2000_fast_t fast[NMEA2000_FAST_SLOTS];
+	    unsigned long fast_serial;
+	    unsigned long fast_dropped;	/* frames out of sequence */
+	    unsigned long fast_evicted;	/* packets pushed out of a full pool */
+	    /* frames read from the socket but not yet decoded */
+	    struct can_frame frames[NMEA2000_BATCH];
+	    unsigned int nframes;
+	    unsigned int nextframe;
 	    unsigned char sid[8];
+	    struct ais_type24_table_t type24;
 	} nmea2000;
 #endif /* NMEA2000_ENABLE */
 	/*
@@ -717,8 +857,13 @@ struct gps_device_t {
 #endif /* BINARY_ENABLE */
 #ifdef AIVDM_ENABLE
 	struct {
-	    struct aivdm_context_t context[AIVDM_CHANNELS];
+	    struct aivdm_context_t single;	/* one-sentence messages */
+	    struct aivdm_context_t context[AIVDM_REASSEMBLY_SLOTS];
+	    struct ais_type24_table_t type24;
 	    char ais_channel;
+	    unsigned long fragments_dropped;	/* out of sequence */
+	    unsigned long fragments_expired;	/* timed out */
+	    unsigned long fragments_evicted;	/* pushed out of a full table */
 	} aivdm;
 #endif /* AIVDM_ENABLE */
     } driver;
@@ -782,11 +927,11 @@ extern unsigned int isgps_parity(isgps30bits_t);
 extern void isgps_output_magnavox(const isgps30bits_t *, unsigned int, FILE *);
 
 extern enum isgpsstat_t rtcm2_decode(struct gps_lexer_t *, unsigned int);
-extern void json_rtcm2_dump(const struct rtcm2_t *,
-			    const char *, char[], size_t);
+extern size_t json_rtcm2_dump(const struct rtcm2_t *,
+			      const char *, char[], size_t);
 extern void rtcm2_unpack(struct rtcm2_t *, char *);
-extern void json_rtcm3_dump(const struct rtcm3_t *,
-			    const char *, char[], size_t);
+extern size_t json_rtcm3_dump(const struct rtcm3_t *,
+			      const char *, char[], size_t);
 extern void rtcm3_unpack(const struct gps_context_t *,
 			 struct rtcm3_t *, char *);
 
@@ -888,7 +1033,12 @@ extern void ntp_latch(struct gps_device_t *device,  struct timedelta_t *td);
 #ifdef NTPSHM_ENABLE
 extern void ntpshm_context_init(struct gps_context_t *);
 extern void ntpshm_session_init(struct gps_device_t *);
-extern int ntpshm_put(struct gps_device_t *, volatile struct shmTime *, struct timedelta_t *);
+extern int ntpshm_put(struct gps_device_t *, struct time_export_t *, struct timedelta_t *);
+extern void time_export_init(struct time_export_t *, const char *,
+			     volatile struct shmTime *, int, const char *);
+extern bool time_export_put(const struct gpsd_errout_t *,
+			    struct time_export_t *, struct timedelta_t *, int);
+extern void time_export_close(struct time_export_t *);
 extern void ntpshm_link_deactivate(struct gps_device_t *);
 extern void ntpshm_link_activate(struct gps_device_t *);
 #endif /* NTPSHM_ENABLE */
@@ -907,15 +1057,87 @@ extern void clear_dop(struct dop_t *);
 
 /* shmexport.c */
 #define GPSD_SHM_KEY	0x47505344	/* "GPSD" */
-struct shmexport_t
+#define SHM_EXPORT_VERSION	3	/* bump on any layout change */
+#define SHM_EXPORT_SLOTS	16	/* updates kept per device */
+struct shmexport_slot_t
 {
-    int bookend1;
+    unsigned long lock;		/* seqlock; odd while being written */
+    unsigned long sequence;	/* update number, 0 if never written */
+    gps_mask_t set;		/* sections of gpsdata this update carries */
     struct gps_data_t gpsdata;
-    int bookend2;
+};
+struct shmexport_ring_t
+{
+    unsigned long head;		/* updates ever written to this ring */
+    struct shmexport_slot_t slot[SHM_EXPORT_SLOTS];
+};
+struct shmexport_t
+{
+    int version;		/* SHM_EXPORT_VERSION once initialized */
+    int devices;		/* number of rings */
+    int slots;			/* slots per ring */
+    unsigned long sequence;	/* number of the latest update */
+    unsigned int wakeup;	/* futex word, bumped after every update */
+    int waiters;		/* readers sleeping on wakeup */
+    struct shmexport_ring_t ring[MAX_DEVICES];
 };
 extern bool shm_acquire(struct gps_context_t *);
 extern void shm_release(struct gps_context_t *);
-extern void shm_update(struct gps_context_t *, struct gps_data_t *);
+extern void shm_update(struct gps_context_t *, int, struct gps_data_t *);
+
+/* binexport.c */
+/*
+ * Binary report records, shipped in place of JSON to watchers that ask
+ * for "binary":true.  Each is a header, the NUL-terminated path of
+ * the device, and a payload in the daemon's native structure layout,
+ * so only a client built from the same gps.h for the same machine can
+ * use it; the header carries the API major version, the record layout
+ * version, a byte-order and size check, and the length so the client
+ * can check.
+ */
+#define BINARY_MAGIC	0xb7	/* can't begin a JSON, NMEA or hexdump line */
+#define BINARY_LAYOUT	1	/* bump on any change to the records below */
+/* differs under the other byte order, or if gps_data_t changed size */
+#define BINARY_CHECK	(((unsigned int)sizeof(struct gps_data_t) << 8) | 0xa5)
+/* the reports that have a binary form */
+#define BINARY_REPORT_MASK	(REPORT_IS|GST_SET|SATELLITE_SET|ATTITUDE_SET|AIS_SET)
+enum binary_type_t {
+    binary_tpv = 1, binary_sky, binary_gst, binary_att, binary_ais,
+    binary_pps, binary_toff,
+};
+struct binary_header_t
+{
+    unsigned char magic;	/* BINARY_MAGIC */
+    unsigned char type;		/* enum binary_type_t */
+    unsigned char api;		/* GPSD_API_MAJOR_VERSION of the sender */
+    unsigned char layout;	/* BINARY_LAYOUT of the sender */
+    unsigned int length;	/* bytes of path and payload following */
+    unsigned int check;		/* BINARY_CHECK of the sender */
+};
+struct binary_tpv_t
+{
+    int status;
+    struct gps_fix_t fix;
+};
+struct binary_sky_t
+{
+    timestamp_t skyview_time;
+    struct dop_t dop;
+    int satellites_visible;
+    /* only the first satellites_visible entries are shipped */
+    struct satellite_t skyview[MAXCHANNELS];
+};
+struct binary_timedelta_t
+{
+    struct timedelta_t td;
+    int precision;
+};
+extern size_t binary_data_report(const gps_mask_t,
+				 const struct gps_device_t *,
+				 char *, size_t);
+extern size_t binary_timedelta_dump(const enum binary_type_t, const char *,
+				    const struct timedelta_t *, int,
+				    char *, size_t);
 
 /* dbusexport.c */
 #if defined(DBUS_EXPORT_ENABLE)
@@ -956,6 +1178,7 @@ extern int gpsd_await_data(fd_set *,
 			   fd_set *,
 			    const int,
 			    fd_set *,
+			    const bool,
 			    struct gpsd_errout_t *errout);
 extern gps_mask_t gpsd_poll(struct gps_device_t *);
 #define DEVICE_EOF	-3
@@ -963,6 +1186,9 @@ extern gps_mask_t gpsd_poll(struct gps_device_t *);
 #define DEVICE_UNREADY	-1
 #define DEVICE_READY	1
 #define DEVICE_UNCHANGED	0
+/* per-wakeup service budget for one device in gpsd_multipoll() */
+#define MULTIPOLL_PACKETS	32
+#define MULTIPOLL_SECONDS	0.005
 extern int gpsd_multipoll(const bool,
 			  struct gps_device_t *,
 			  void (*)(struct gps_device_t *, gps_mask_t),
@@ -977,7 +1203,13 @@ extern bool ubx_write(struct gps_device_t *, unsigned int, unsigned int,
 extern bool ais_binary_decode(const struct gpsd_errout_t *errout,
 			      struct ais_t *ais,
 			      const unsigned char *, size_t,
-			      struct ais_type24_queue_t *);
+			      struct ais_type24_table_t *);
+extern void ais_type24_stash(struct ais_type24_table_t *, unsigned int,
+			     const char *);
+extern bool ais_type24_match(struct ais_type24_table_t *, unsigned int,
+			     char *, size_t);
+extern bool ais_dearmor(const unsigned char *, size_t,
+			unsigned char *, size_t *, size_t);
 
 void gpsd_labeled_report(const int, const int,
 			 const char *, const char *, va_list);
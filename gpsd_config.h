@@ -32,6 +32,12 @@
 
 #define HAVE_SYS_SELECT_H 1
 
+#define HAVE_SYS_EPOLL_H 1
+
+#define HAVE_SYS_EVENTFD_H 1
+
+#define HAVE_LINUX_FUTEX_H 1
+
 #define HAVE_NETDB_H 1
 
 #define HAVE_NETINET_IN_H 1
@@ -64,6 +70,8 @@
 
 #define HAVE_FORK 1
 
+#define HAVE_RECVMMSG 1
+
 /* AIVDM support */
 #define AIVDM_ENABLE 1
 
@@ -117,12 +117,37 @@ char *json_stringify( char *to,
     return to;
 }
 
-void json_version_dump( char *reply, size_t replylen)
+static void attr_fixed(struct strcursor_t *c, const char *tag,
+		       double d, int places)
+/* append "tag":d, with d to the given number of decimal places */
 {
-    (void)snprintf(reply, replylen,
+    strc_putn(c, "\"", 1);
+    strc_puts(c, tag);
+    strc_putn(c, "\":", 2);
+    strc_fixed(c, d, places);
+    strc_putn(c, ",", 1);
+}
+
+static void attr_int(struct strcursor_t *c, const char *tag, long long v)
+/* append "tag":v, */
+{
+    strc_putn(c, "\"", 1);
+    strc_puts(c, tag);
+    strc_putn(c, "\":", 2);
+    strc_int(c, v);
+    strc_putn(c, ",", 1);
+}
+
+size_t json_version_dump( char *reply, size_t replylen)
+{
+    struct strcursor_t c;
+
+    strc_init(&c, reply, replylen);
+    strc_printf(&c,
 		   "{\"class\":\"VERSION\",\"release\":\"%s\",\"rev\":\"%s\",\"proto_major\":%d,\"proto_minor\":%d}\r\n",
 		   VERSION, REVISION,
 		   GPSD_PROTO_MAJOR_VERSION, GPSD_PROTO_MINOR_VERSION);
+    return c.len;
 }
 
 #ifdef TIMING_ENABLE
@@ -132,27 +157,31 @@ void json_version_dump( char *reply, size_t replylen)
 #endif /* TIMING_ENABLE */
 
 
-void json_tpv_dump(const struct gps_device_t *session,
-		   const struct policy_t *policy CONDITIONALLY_UNUSED,
-		   char *reply, size_t replylen)
+size_t json_tpv_dump(const struct gps_device_t *session,
+		     const struct policy_t *policy,
+		     char *reply, size_t replylen)
 {
+    struct strcursor_t c;
     const struct gps_data_t *gpsdata = &session->gpsdata;
+    /* a watcher may have projected TPV down to a few fields */
+    const unsigned int fields = (policy->fields != 0) ? policy->fields : ~0u;
 
     assert(replylen > sizeof(char *));
-    (void)strlcpy(reply, "{\"class\":\"TPV\",", replylen);
+    strc_init(&c, reply, replylen);
+    strc_puts(&c, "{\"class\":\"TPV\",");
     if (gpsdata->dev.path[0] != '\0')
-	str_appendf(reply, replylen, "\"device\":\"%s\",", gpsdata->dev.path);
-    if (gpsdata->status == STATUS_DGPS_FIX)
-	str_appendf(reply, replylen, "\"status\":2,");
-    str_appendf(reply, replylen, "\"mode\":%d,", gpsdata->fix.mode);
-    if (isnan(gpsdata->fix.time) == 0) {
+	strc_printf(&c, "\"device\":\"%s\",", gpsdata->dev.path);
+    if ((fields & TPV_STATUS) != 0 && gpsdata->status == STATUS_DGPS_FIX)
+	strc_puts(&c, "\"status\":2,");
+    attr_int(&c, "mode", gpsdata->fix.mode);
+    if ((fields & TPV_TIME) != 0 && isnan(gpsdata->fix.time) == 0) {
 	char tbuf[JSON_DATE_MAX+1];
-	str_appendf(reply, replylen,
+	strc_printf(&c,
 		       "\"time\":\"%s\",",
 		       unix_to_iso8601(gpsdata->fix.time, tbuf, sizeof(tbuf)));
     }
-    if (isnan(gpsdata->fix.ept) == 0)
-	str_appendf(reply, replylen, "\"ept\":%.3f,", gpsdata->fix.ept);
+    if (isnan(gpsdata->fix.ept) == 0 && (fields & TPV_EPT) != 0)
+	attr_fixed(&c, "ept", gpsdata->fix.ept, 3);
     /*
      * Suppressing TPV fields that would be invalid because the fix
      * quality doesn't support them is nice for cutting down on the
@@ -164,40 +193,49 @@ void json_tpv_dump(const struct gps_device_t *session,
      * chips, which are quite common.
      */
     if (gpsdata->fix.mode >= MODE_2D) {
-	if (isnan(gpsdata->fix.latitude) == 0)
-	    str_appendf(reply, replylen,
-			   "\"lat\":%.9f,", gpsdata->fix.latitude);
-	if (isnan(gpsdata->fix.longitude) == 0)
-	    str_appendf(reply, replylen,
-			   "\"lon\":%.9f,", gpsdata->fix.longitude);
-	if (gpsdata->fix.mode >= MODE_3D && isnan(gpsdata->fix.altitude) == 0)
-	    str_appendf(reply, replylen,
-			   "\"alt\":%.3f,", gpsdata->fix.altitude);
-	if (isnan(gpsdata->fix.epx) == 0)
-	    str_appendf(reply, replylen, "\"epx\":%.3f,", gpsdata->fix.epx);
-	if (isnan(gpsdata->fix.epy) == 0)
-	    str_appendf(reply, replylen, "\"epy\":%.3f,", gpsdata->fix.epy);
-	if ((gpsdata->fix.mode >= MODE_3D) && isnan(gpsdata->fix.epv) == 0)
-	    str_appendf(reply, replylen, "\"epv\":%.3f,", gpsdata->fix.epv);
-	if (isnan(gpsdata->fix.track) == 0)
-	    str_appendf(reply, replylen, "\"track\":%.4f,", gpsdata->fix.track);
-	if (isnan(gpsdata->fix.speed) == 0)
-	    str_appendf(reply, replylen, "\"speed\":%.3f,", gpsdata->fix.speed);
-	if ((gpsdata->fix.mode >= MODE_3D) && isnan(gpsdata->fix.climb) == 0)
-	    str_appendf(reply, replylen, "\"climb\":%.3f,", gpsdata->fix.climb);
-	if (isnan(gpsdata->fix.epd) == 0)
-	    str_appendf(reply, replylen, "\"epd\":%.4f,", gpsdata->fix.epd);
-	if (isnan(gpsdata->fix.eps) == 0)
-	    str_appendf(reply, replylen, "\"eps\":%.2f,", gpsdata->fix.eps);
-	if ((gpsdata->fix.mode >= MODE_3D) && isnan(gpsdata->fix.epc) == 0)
-	    str_appendf(reply, replylen, "\"epc\":%.2f,", gpsdata->fix.epc);
+	if (isnan(gpsdata->fix.latitude) == 0
+	    && (fields & TPV_LAT) != 0)
+	    attr_fixed(&c, "lat", gpsdata->fix.latitude, 9);
+	if (isnan(gpsdata->fix.longitude) == 0
+	    && (fields & TPV_LON) != 0)
+	    attr_fixed(&c, "lon", gpsdata->fix.longitude, 9);
+	if (gpsdata->fix.mode >= MODE_3D && isnan(gpsdata->fix.altitude) == 0
+	    && (fields & TPV_ALT) != 0)
+	    attr_fixed(&c, "alt", gpsdata->fix.altitude, 3);
+	if (isnan(gpsdata->fix.epx) == 0
+	    && (fields & TPV_EPX) != 0)
+	    attr_fixed(&c, "epx", gpsdata->fix.epx, 3);
+	if (isnan(gpsdata->fix.epy) == 0
+	    && (fields & TPV_EPY) != 0)
+	    attr_fixed(&c, "epy", gpsdata->fix.epy, 3);
+	if ((gpsdata->fix.mode >= MODE_3D) && isnan(gpsdata->fix.epv) == 0
+	    && (fields & TPV_EPV) != 0)
+	    attr_fixed(&c, "epv", gpsdata->fix.epv, 3);
+	if (isnan(gpsdata->fix.track) == 0
+	    && (fields & TPV_TRACK) != 0)
+	    attr_fixed(&c, "track", gpsdata->fix.track, 4);
+	if (isnan(gpsdata->fix.speed) == 0
+	    && (fields & TPV_SPEED) != 0)
+	    attr_fixed(&c, "speed", gpsdata->fix.speed, 3);
+	if ((gpsdata->fix.mode >= MODE_3D) && isnan(gpsdata->fix.climb) == 0
+	    && (fields & TPV_CLIMB) != 0)
+	    attr_fixed(&c, "climb", gpsdata->fix.climb, 3);
+	if (isnan(gpsdata->fix.epd) == 0
+	    && (fields & TPV_EPD) != 0)
+	    attr_fixed(&c, "epd", gpsdata->fix.epd, 4);
+	if (isnan(gpsdata->fix.eps) == 0
+	    && (fields & TPV_EPS) != 0)
+	    attr_fixed(&c, "eps", gpsdata->fix.eps, 2);
+	if ((gpsdata->fix.mode >= MODE_3D) && isnan(gpsdata->fix.epc) == 0
+	    && (fields & TPV_EPC) != 0)
+	    attr_fixed(&c, "epc", gpsdata->fix.epc, 2);
 #ifdef TIMING_ENABLE
 	if (policy->timing) {
 	    char rtime_str[TIMESPEC_LEN];
 	    struct timespec rtime_tmp;
 	    (void)clock_gettime(CLOCK_REALTIME, &rtime_tmp);
 	    timespec_str(&rtime_tmp, rtime_str, sizeof(rtime_str));
-	    str_appendf(reply, replylen, "\"rtime\":%s,", rtime_str);
+	    strc_printf(&c, "\"rtime\":%s,", rtime_str);
 #ifdef PPS_ENABLE
 	    if (session->pps_thread.ppsout_count) {
 		char ts_str[TIMESPEC_LEN];
@@ -206,11 +244,11 @@ void json_tpv_dump(const struct gps_device_t *session,
 		pps_thread_ppsout(&((struct gps_device_t *)session)->pps_thread,
 				  &timedelta);
 		timespec_str(&timedelta.clock, ts_str, sizeof(ts_str) );
-		str_appendf(reply, replylen, "\"pps\":%s,", ts_str);
+		strc_printf(&c, "\"pps\":%s,", ts_str);
                 /* TODO: add PPS precision to JSON output */
 	    }
 #endif /* PPS_ENABLE */
-	    str_appendf(reply, replylen,
+	    strc_printf(&c,
 			"\"sor\":%.9f,\"chars\":%lu,\"sats\":%2d,"
 			"\"week\":%u,\"tow\":%.3f,\"rollovers\":%d",
 			session->sor,
@@ -222,26 +260,30 @@ void json_tpv_dump(const struct gps_device_t *session,
 	}
 #endif /* TIMING_ENABLE */
     }
-    str_rstrip_char(reply, ',');
-    (void)strlcat(reply, "}\r\n", replylen);
+    strc_rstrip_char(&c, ',');
+    strc_puts(&c, "}\r\n");
+    return c.len;
 }
 
-void json_noise_dump(const struct gps_data_t *gpsdata,
-		   char *reply, size_t replylen)
+size_t json_noise_dump(const struct gps_data_t *gpsdata,
+		     char *reply, size_t replylen)
 {
+    struct strcursor_t c;
+
     assert(replylen > sizeof(char *));
-    (void)strlcpy(reply, "{\"class\":\"GST\",", replylen);
+    strc_init(&c, reply, replylen);
+    strc_puts(&c, "{\"class\":\"GST\",");
     if (gpsdata->dev.path[0] != '\0')
-	str_appendf(reply, replylen, "\"device\":\"%s\",", gpsdata->dev.path);
+	strc_printf(&c, "\"device\":\"%s\",", gpsdata->dev.path);
     if (isnan(gpsdata->fix.time) == 0) {
 	char tbuf[JSON_DATE_MAX+1];
-	str_appendf(reply, replylen,
+	strc_printf(&c,
 		   "\"time\":\"%s\",",
 		   unix_to_iso8601(gpsdata->gst.utctime, tbuf, sizeof(tbuf)));
     }
 #define ADD_GST_FIELD(tag, field) do {                     \
     if (isnan(gpsdata->gst.field) == 0)              \
-	str_appendf(reply, replylen, "\"" tag "\":%.3f,", gpsdata->gst.field); \
+	attr_fixed(&c, tag, gpsdata->gst.field, 3); \
     } while(0)
 
     ADD_GST_FIELD("rms",    rms_deviation);
@@ -254,90 +296,94 @@ void json_noise_dump(const struct gps_data_t *gpsdata,
 
 #undef ADD_GST_FIELD
 
-    str_rstrip_char(reply, ',');
-    (void)strlcat(reply, "}\r\n", replylen);
+    strc_rstrip_char(&c, ',');
+    strc_puts(&c, "}\r\n");
+    return c.len;
 }
 
-void json_sky_dump(const struct gps_data_t *datap,
-		   char *reply, size_t replylen)
+size_t json_sky_dump(const struct gps_data_t *datap,
+		     char *reply, size_t replylen)
 {
+    struct strcursor_t c;
     int i, reported = 0;
 
     assert(replylen > sizeof(char *));
-    (void)strlcpy(reply, "{\"class\":\"SKY\",", replylen);
+    strc_init(&c, reply, replylen);
+    strc_puts(&c, "{\"class\":\"SKY\",");
     if (datap->dev.path[0] != '\0')
-	str_appendf(reply, replylen, "\"device\":\"%s\",", datap->dev.path);
+	strc_printf(&c, "\"device\":\"%s\",", datap->dev.path);
     if (isnan(datap->skyview_time) == 0) {
 	char tbuf[JSON_DATE_MAX+1];
-	str_appendf(reply, replylen,
+	strc_printf(&c,
 		       "\"time\":\"%s\",",
 		       unix_to_iso8601(datap->skyview_time, tbuf, sizeof(tbuf)));
     }
     if (isnan(datap->dop.xdop) == 0)
-	str_appendf(reply, replylen, "\"xdop\":%.2f,", datap->dop.xdop);
+	attr_fixed(&c, "xdop", datap->dop.xdop, 2);
     if (isnan(datap->dop.ydop) == 0)
-	str_appendf(reply, replylen, "\"ydop\":%.2f,", datap->dop.ydop);
+	attr_fixed(&c, "ydop", datap->dop.ydop, 2);
     if (isnan(datap->dop.vdop) == 0)
-	str_appendf(reply, replylen, "\"vdop\":%.2f,", datap->dop.vdop);
+	attr_fixed(&c, "vdop", datap->dop.vdop, 2);
     if (isnan(datap->dop.tdop) == 0)
-	str_appendf(reply, replylen, "\"tdop\":%.2f,", datap->dop.tdop);
+	attr_fixed(&c, "tdop", datap->dop.tdop, 2);
     if (isnan(datap->dop.hdop) == 0)
-	str_appendf(reply, replylen, "\"hdop\":%.2f,", datap->dop.hdop);
+	attr_fixed(&c, "hdop", datap->dop.hdop, 2);
     if (isnan(datap->dop.gdop) == 0)
-	str_appendf(reply, replylen, "\"gdop\":%.2f,", datap->dop.gdop);
+	attr_fixed(&c, "gdop", datap->dop.gdop, 2);
     if (isnan(datap->dop.pdop) == 0)
-	str_appendf(reply, replylen, "\"pdop\":%.2f,", datap->dop.pdop);
+	attr_fixed(&c, "pdop", datap->dop.pdop, 2);
     /* insurance against flaky drivers */
     for (i = 0; i < datap->satellites_visible; i++)
 	if (datap->skyview[i].PRN)
 	    reported++;
     if (reported) {
-	(void)strlcat(reply, "\"satellites\":[", replylen);
+	strc_puts(&c, "\"satellites\":[");
 	for (i = 0; i < reported; i++) {
 	    if (datap->skyview[i].PRN) {
-		str_appendf(reply, replylen,
-			       "{\"PRN\":%d,\"el\":%d,\"az\":%d,\"ss\":%.0f,\"used\":%s},",
-			       datap->skyview[i].PRN,
-			       datap->skyview[i].elevation,
-			       datap->skyview[i].azimuth,
-			       datap->skyview[i].ss,
-			       datap->skyview[i].used ? "true" : "false");
+		strc_putn(&c, "{", 1);
+		attr_int(&c, "PRN", datap->skyview[i].PRN);
+		attr_int(&c, "el", datap->skyview[i].elevation);
+		attr_int(&c, "az", datap->skyview[i].azimuth);
+		attr_fixed(&c, "ss", datap->skyview[i].ss, 0);
+		strc_puts(&c, datap->skyview[i].used ?
+			  "\"used\":true}," : "\"used\":false},");
 	    }
 	}
-	str_rstrip_char(reply, ',');
-	(void)strlcat(reply, "]", replylen);
+	strc_rstrip_char(&c, ',');
+	strc_puts(&c, "]");
     }
-    str_rstrip_char(reply, ',');
-    (void)strlcat(reply, "}\r\n", replylen);
+    strc_rstrip_char(&c, ',');
+    strc_puts(&c, "}\r\n");
+    return c.len;
 }
 
-void json_device_dump(const struct gps_device_t *device,
-		      char *reply, size_t replylen)
+size_t json_device_dump(const struct gps_device_t *device,
+			char *reply, size_t replylen)
 {
+    struct strcursor_t c;
     struct classmap_t *cmp;
     char buf1[JSON_VAL_MAX * 2 + 1];
 
-    (void)strlcpy(reply, "{\"class\":\"DEVICE\",\"path\":\"", replylen);
-    (void)strlcat(reply, device->gpsdata.dev.path, replylen);
-    (void)strlcat(reply, "\",", replylen);
+    strc_init(&c, reply, replylen);
+    strc_puts(&c, "{\"class\":\"DEVICE\",\"path\":\"");
+    strc_puts(&c, device->gpsdata.dev.path);
+    strc_puts(&c, "\",");
     if (device->device_type != NULL) {
-	(void)strlcat(reply, "\"driver\":\"", replylen);
-	(void)strlcat(reply, device->device_type->type_name, replylen);
-	(void)strlcat(reply, "\",", replylen);
+	strc_puts(&c, "\"driver\":\"");
+	strc_puts(&c, device->device_type->type_name);
+	strc_puts(&c, "\",");
     }
     if (device->subtype[0] != '\0') {
-	(void)strlcat(reply, "\"subtype\":\"", replylen);
-	(void)strlcat(reply,
-		      json_stringify(buf1, sizeof(buf1), device->subtype),
-		      replylen);
-	(void)strlcat(reply, "\",", replylen);
+	strc_puts(&c, "\"subtype\":\"");
+	strc_puts(&c, json_stringify(buf1, sizeof(buf1), device->subtype));
+	strc_puts(&c, "\",");
     }
     /*
      * There's an assumption here: Anything that we type service_sensor is
      * a serial device with the usual control parameters.
      */
     if (device->gpsdata.online > 0) {	
-	str_appendf(reply, replylen,
+	strc_printf(&c,
 		       "\"activated\":\"%s\",",
 		       unix_to_iso8601(device->gpsdata.online, buf1, sizeof(buf1)));
 	if (device->observed != 0) {
@@ -346,13 +392,13 @@ void json_device_dump(const struct gps_device_t *device,
 		if ((device->observed & cmp->packetmask) != 0)
 		    mask |= cmp->typemask;
 	    if (mask != 0)
-		str_appendf(reply, replylen, "\"flags\":%d,", mask);
+		attr_int(&c, "flags", mask);
 	}
 	if (device->servicetype == service_sensor) {
 	    /* speed can be 0 if the device is not currently active */
 	    speed_t speed = gpsd_get_speed(device);
 	    if (speed != 0)
-		str_appendf(reply, replylen,
+		strc_printf(&c,
 			       "\"native\":%d,\"bps\":%d,\"parity\":\"%c\",\"stopbits\":%u,\"cycle\":%2.2f,",
 			       device->gpsdata.dev.driver_mode,
 			       (int)speed,
@@ -362,20 +408,38 @@ void json_device_dump(const struct gps_device_t *device,
 #ifdef RECONFIGURE_ENABLE
 	    if (device->device_type != NULL
 		&& device->device_type->rate_switcher != NULL)
-		str_appendf(reply, replylen,
+		strc_printf(&c,
 			       "\"mincycle\":%2.2f,",
 			       device->device_type->min_cycle);
 #endif /* RECONFIGURE_ENABLE */
 	}
     }
-    str_rstrip_char(reply, ',');
-    (void)strlcat(reply, "}\r\n", replylen);
+    strc_rstrip_char(&c, ',');
+    strc_puts(&c, "}\r\n");
+    return c.len;
 }
 
-void json_watch_dump(const struct policy_t *ccp,
-		     char *reply, size_t replylen)
+static void json_watch_names(struct strcursor_t *c, const char *name,
+			     unsigned int mask, const struct json_enum_t *map)
+/* dump the names of the bits set in a watch mask as a JSON array */
+{
+    const struct json_enum_t *mp;
+
+    strc_printf(c, "\"%s\":[", name);
+    for (mp = map; mp->name != NULL; mp++)
+	if ((mask & (unsigned int)mp->value) != 0)
+	    strc_printf(c, "\"%s\",", mp->name);
+    strc_rstrip_char(c, ',');
+    strc_puts(c, "],");
+}
+
+size_t json_watch_dump(const struct policy_t *ccp,
+		       char *reply, size_t replylen)
 {
-    (void)snprintf(reply, replylen,
+    struct strcursor_t c;
+
+    strc_init(&c, reply, replylen);
+    strc_printf(&c,
 		   "{\"class\":\"WATCH\",\"enable\":%s,\"json\":%s,\"nmea\":%s,\"raw\":%d,\"scaled\":%s,\"timing\":%s,\"split24\":%s,\"pps\":%s,",
 		   ccp->watcher ? "true" : "false",
 		   ccp->json ? "true" : "false",
@@ -385,19 +449,34 @@ void json_watch_dump(const struct policy_t *ccp,
 		   ccp->timing ? "true" : "false",
 		   ccp->split24 ? "true" : "false",
 		   ccp->pps ? "true" : "false");
+    if (ccp->binary)
+	strc_puts(&c, "\"binary\":true,");
+    if (ccp->classes != 0)
+	json_watch_names(&c, "classes", ccp->classes, watch_class_map);
+    if (ccp->fields != 0)
+	json_watch_names(&c, "fields", ccp->fields, watch_field_map);
+    if (ccp->interval > 0)
+	strc_printf(&c, "\"interval\":%.3f,", ccp->interval);
+    if (ccp->backlog == BACKLOG_COALESCE)
+	strc_puts(&c, "\"backlog\":\"coalesce\",");
+    else if (ccp->backlog == BACKLOG_DISCONNECT)
+	strc_puts(&c, "\"backlog\":\"disconnect\",");
     if (ccp->devpath[0] != '\0')
-	str_appendf(reply, replylen, "\"device\":\"%s\",", ccp->devpath);
-    str_rstrip_char(reply, ',');
-    (void)strlcat(reply, "}\r\n", replylen);
+	strc_printf(&c, "\"device\":\"%s\",", ccp->devpath);
+    strc_rstrip_char(&c, ',');
+    strc_puts(&c, "}\r\n");
+    return c.len;
 }
 
-void json_subframe_dump(const struct gps_data_t *datap,
-			char buf[], size_t buflen)
+size_t json_subframe_dump(const struct gps_data_t *datap,
+			  char buf[], size_t buflen)
 {
+    struct strcursor_t c;
     const struct subframe_t *subframe = &datap->subframe;
     const bool scaled = datap->policy.scaled;
 
-    (void)snprintf(buf, buflen, "{\"class\":\"SUBFRAME\",\"device\":\"%s\","
+    strc_init(&c, buf, buflen);
+    strc_printf(&c, "{\"class\":\"SUBFRAME\",\"device\":\"%s\","
 		   "\"tSV\":%u,\"TOW17\":%u,\"frame\":%u,\"scaled\":%s",
 		   datap->dev.path,
 		   (unsigned int)subframe->tSVID,
@@ -407,7 +486,7 @@ void json_subframe_dump(const struct gps_data_t *datap,
 
     if ( 1 == subframe->subframe_num ) {
 	if (scaled) {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			",\"EPHEM1\":{\"WN\":%u,\"IODC\":%u,\"L2\":%u,"
 			"\"ura\":%u,\"hlth\":%u,\"L2P\":%u,\"Tgd\":%g,"
 			"\"toc\":%lu,\"af2\":%.4g,\"af1\":%.6e,\"af0\":%.7e}",
@@ -423,7 +502,7 @@ void json_subframe_dump(const struct gps_data_t *datap,
 			subframe->sub1.d_af1,
 			subframe->sub1.d_af0);
 	} else {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			",\"EPHEM1\":{\"WN\":%u,\"IODC\":%u,\"L2\":%u,"
 			"\"ura\":%u,\"hlth\":%u,\"L2P\":%u,\"Tgd\":%d,"
 			"\"toc\":%u,\"af2\":%ld,\"af1\":%d,\"af0\":%d}",
@@ -441,7 +520,7 @@ void json_subframe_dump(const struct gps_data_t *datap,
 	}
     } else if ( 2 == subframe->subframe_num ) {
 	if (scaled) {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			",\"EPHEM2\":{\"IODE\":%u,\"Crs\":%.6e,\"deltan\":%.6e,"
 			"\"M0\":%.11e,\"Cuc\":%.6e,\"e\":%f,\"Cus\":%.6e,"
 			"\"sqrtA\":%.11g,\"toe\":%lu,\"FIT\":%u,\"AODO\":%u}",
@@ -457,7 +536,7 @@ void json_subframe_dump(const struct gps_data_t *datap,
 			(unsigned int)subframe->sub2.fit,
 			(unsigned int)subframe->sub2.u_AODO);
 	} else {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			",\"EPHEM2\":{\"IODE\":%u,\"Crs\":%d,\"deltan\":%d,"
 			"\"M0\":%ld,\"Cuc\":%d,\"e\":%ld,\"Cus\":%d,"
 			"\"sqrtA\":%lu,\"toe\":%lu,\"FIT\":%u,\"AODO\":%u}",
@@ -475,7 +554,7 @@ void json_subframe_dump(const struct gps_data_t *datap,
 	}
     } else if ( 3 == subframe->subframe_num ) {
 	if (scaled) {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 		",\"EPHEM3\":{\"IODE\":%3u,\"IDOT\":%.6g,\"Cic\":%.6e,"
 		"\"Omega0\":%.11e,\"Cis\":%.7g,\"i0\":%.11e,\"Crc\":%.7g,"
 		"\"omega\":%.11e,\"Omegad\":%.6e}",
@@ -489,7 +568,7 @@ void json_subframe_dump(const struct gps_data_t *datap,
 			subframe->sub3.d_omega,
 			subframe->sub3.d_Omegad );
 	} else {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 		",\"EPHEM3\":{\"IODE\":%u,\"IDOT\":%u,\"Cic\":%u,"
 		"\"Omega0\":%ld,\"Cis\":%d,\"i0\":%ld,\"Crc\":%d,"
 		"\"omega\":%ld,\"Omegad\":%ld}",
@@ -505,7 +584,7 @@ void json_subframe_dump(const struct gps_data_t *datap,
 	}
     } else if ( subframe->is_almanac ) {
 	if (scaled) {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			",\"ALMANAC\":{\"ID\":%d,\"Health\":%u,"
 			"\"e\":%g,\"toa\":%lu,"
 			"\"deltai\":%.10e,\"Omegad\":%.5e,\"sqrtA\":%.10g,"
@@ -524,7 +603,7 @@ void json_subframe_dump(const struct gps_data_t *datap,
 			subframe->sub5.almanac.d_af0,
 			subframe->sub5.almanac.d_af1);
 	} else {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			",\"ALMANAC\":{\"ID\":%d,\"Health\":%u,"
 			"\"e\":%u,\"toa\":%u,"
 			"\"deltai\":%d,\"Omegad\":%d,\"sqrtA\":%lu,"
@@ -544,7 +623,7 @@ void json_subframe_dump(const struct gps_data_t *datap,
 			(int)subframe->sub5.almanac.af1);
 	}
     } else if ( 4 == subframe->subframe_num ) {
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 	    ",\"pageid\":%u",
 		       (unsigned int)subframe->pageid);
 	switch (subframe->pageid ) {
@@ -553,16 +632,16 @@ void json_subframe_dump(const struct gps_data_t *datap,
 	{
 		int i;
 		/* decoding of ERD to SV is non trivial and not done yet */
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 		    ",\"ERD\":{\"ai\":%u,", subframe->sub4_13.ai);
 
 		/* 1-index loop to construct json, rather than giant snprintf */
 		for(i = 1 ; i <= 30; i++){
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 			"\"ERD%d\":%d,", i, subframe->sub4_13.ERD[i]);
 		}
-		str_rstrip_char(buf, ',');
-		str_appendf(buf, buflen, "}");
+		strc_rstrip_char(&c, ',');
+		strc_puts(&c, "}");
 		break;
 	}
 	case 55:
@@ -575,13 +654,13 @@ void json_subframe_dump(const struct gps_data_t *datap,
 	    {
 		char buf1[25 * 6];
 		(void)json_stringify(buf1, sizeof(buf1), subframe->sub4_17.str);
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 			       ",\"system_message\":\"%.144s\"", buf1);
 	    }
 	    break;
 	case 56:
 	    if (scaled) {
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 			",\"IONO\":{\"a0\":%.5g,\"a1\":%.5g,\"a2\":%.5g,"
 			"\"a3\":%.5g,\"b0\":%.5g,\"b1\":%.5g,\"b2\":%.5g,"
 			"\"b3\":%.5g,\"A1\":%.11e,\"A0\":%.11e,\"tot\":%.5g,"
@@ -604,7 +683,7 @@ void json_subframe_dump(const struct gps_data_t *datap,
 			    (unsigned int)subframe->sub4_18.DN,
 			    (int)subframe->sub4_18.lsf);
 	    } else {
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 			",\"IONO\":{\"a0\":%d,\"a1\":%d,\"a2\":%d,\"a3\":%d,"
 			"\"b0\":%d,\"b1\":%d,\"b2\":%d,\"b3\":%d,"
 			"\"A1\":%ld,\"A0\":%ld,\"tot\":%u,\"WNt\":%u,"
@@ -631,64 +710,67 @@ void json_subframe_dump(const struct gps_data_t *datap,
 	case 63:
 	{
 	    int i;
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   ",\"HEALTH\":{\"data_id\":%d,",
 			   (int)subframe->data_id);
 
 		/* 1-index loop to construct json, rather than giant snprintf */
 		for(i = 1 ; i <= 32; i++){
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 				   "\"SV%d\":%d,",
 				   i, (int)subframe->sub4_25.svf[i]);
 		}
 		for(i = 0 ; i < 8; i++){ /* 0-index */
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 				   "\"SVH%d\":%d,",
 				   i+25, (int)subframe->sub4_25.svhx[i]);
 		}
-		str_rstrip_char(buf, ',');
-		str_appendf(buf, buflen, "}");
+		strc_rstrip_char(&c, ',');
+		strc_puts(&c, "}");
 
 	    break;
 	    }
 	}
     } else if ( 5 == subframe->subframe_num ) {
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 	    ",\"pageid\":%u",
 		       (unsigned int)subframe->pageid);
 	if ( 51 == subframe->pageid ) {
 	    int i;
 	    /* subframe5, page 25 */
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 		",\"HEALTH2\":{\"toa\":%lu,\"WNa\":%u,",
 			   (unsigned long)subframe->sub5_25.l_toa,
 			   (unsigned int)subframe->sub5_25.WNa);
 		/* 1-index loop to construct json */
 		for(i = 1 ; i <= 24; i++){
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 				   "\"SV%d\":%d,", i, (int)subframe->sub5_25.sv[i]);
 		}
-		str_rstrip_char(buf, ',');
-		str_appendf(buf, buflen, "}");
+		strc_rstrip_char(&c, ',');
+		strc_puts(&c, "}");
 
 	}
     }
-    (void)strlcat(buf, "}\r\n", buflen);
+    strc_puts(&c, "}\r\n");
+    return c.len;
 }
 
 #if defined(RTCM104V2_ENABLE)
-void json_rtcm2_dump(const struct rtcm2_t *rtcm,
-		     const char *device,
-		     char buf[], size_t buflen)
+size_t json_rtcm2_dump(const struct rtcm2_t *rtcm,
+		       const char *device,
+		       char buf[], size_t buflen)
 /* dump the contents of a parsed RTCM104 message as JSON */
 {
+    struct strcursor_t c;
     char buf1[JSON_VAL_MAX * 2 + 1];
     unsigned int n;
 
-    (void)snprintf(buf, buflen, "{\"class\":\"RTCM2\",");
+    strc_init(&c, buf, buflen);
+    strc_puts(&c, "{\"class\":\"RTCM2\",");
     if (device != NULL && device[0] != '\0')
-	str_appendf(buf, buflen, "\"device\":\"%s\",", device);
-    str_appendf(buf, buflen,
+	strc_printf(&c, "\"device\":\"%s\",", device);
+    strc_printf(&c,
 		   "\"type\":%u,\"station_id\":%u,\"zcount\":%0.1f,\"seqnum\":%u,\"length\":%u,\"station_health\":%u,",
 		   rtcm->type, rtcm->refstaid, rtcm->zcount, rtcm->seqnum,
 		   rtcm->length, rtcm->stathlth);
@@ -696,22 +778,22 @@ void json_rtcm2_dump(const struct rtcm2_t *rtcm,
     switch (rtcm->type) {
     case 1:
     case 9:
-	(void)strlcat(buf, "\"satellites\":[", buflen);
+	strc_puts(&c, "\"satellites\":[");
 	for (n = 0; n < rtcm->gps_ranges.nentries; n++) {
 	    const struct gps_rangesat_t *rsp = &rtcm->gps_ranges.sat[n];
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "{\"ident\":%u,\"udre\":%u,\"iod\":%u,\"prc\":%0.3f,\"rrc\":%0.3f},",
 			   rsp->ident,
 			   rsp->udre, rsp->iod,
 			   rsp->prc, rsp->rrc);
 	}
-	str_rstrip_char(buf, ',');
-	(void)strlcat(buf, "]", buflen);
+	strc_rstrip_char(&c, ',');
+	strc_puts(&c, "]");
 	break;
 
     case 3:
 	if (rtcm->ecef.valid)
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"x\":%.2f,\"y\":%.2f,\"z\":%.2f,",
 			   rtcm->ecef.x, rtcm->ecef.y, rtcm->ecef.z);
 	break;
@@ -725,7 +807,7 @@ void json_rtcm2_dump(const struct rtcm2_t *rtcm,
 	     * actually documented in RTCM 2.1.
 	     */
 	    static char *navsysnames[] = { "GPS", "GLONASS", "GALILEO" };
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"system\":\"%s\",\"sense\":%1d,\"datum\":\"%s\",\"dx\":%.1f,\"dy\":%.1f,\"dz\":%.1f,",
 			   rtcm->reference.system >= NITEMS(navsysnames)
 			   ? "UNKNOWN"
@@ -738,10 +820,10 @@ void json_rtcm2_dump(const struct rtcm2_t *rtcm,
 	break;
 
     case 5:
-	(void)strlcat(buf, "\"satellites\":[", buflen);
+	strc_puts(&c, "\"satellites\":[");
 	for (n = 0; n < rtcm->conhealth.nentries; n++) {
 	    const struct consat_t *csp = &rtcm->conhealth.sat[n];
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "{\"ident\":%u,\"iodl\":%s,\"health\":%1u,\"snr\":%d,\"health_en\":%s,\"new_data\":%s,\"los_warning\":%s,\"tou\":%u},",
 			   csp->ident,
 			   JSON_BOOL(csp->iodl),
@@ -751,18 +833,18 @@ void json_rtcm2_dump(const struct rtcm2_t *rtcm,
 			   JSON_BOOL(csp->new_data),
 			   JSON_BOOL(csp->los_warning), csp->tou);
 	}
-	str_rstrip_char(buf, ',');
-	(void)strlcat(buf, "]", buflen);
+	strc_rstrip_char(&c, ',');
+	strc_puts(&c, "]");
 	break;
 
     case 6:			/* NOP msg */
 	break;
 
     case 7:
-	(void)strlcat(buf, "\"satellites\":[", buflen);
+	strc_puts(&c, "\"satellites\":[");
 	for (n = 0; n < rtcm->almanac.nentries; n++) {
 	    const struct station_t *ssp = &rtcm->almanac.station[n];
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "{\"lat\":%.4f,\"lon\":%.4f,\"range\":%u,\"frequency\":%.1f,\"health\":%u,\"station_id\":%u,\"bitrate\":%u},",
 			   ssp->latitude,
 			   ssp->longitude,
@@ -770,12 +852,12 @@ void json_rtcm2_dump(const struct rtcm2_t *rtcm,
 			   ssp->frequency,
 			   ssp->health, ssp->station_id, ssp->bitrate);
 	}
-	str_rstrip_char(buf, ',');
-	(void)strlcat(buf, "]", buflen);
+	strc_rstrip_char(&c, ',');
+	strc_puts(&c, "]");
 	break;
 
     case 13:
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"status\":%s,\"rangeflag\":%s,"
 		       "\"lat\":%.2f,\"lon\":%.2f,\"range\":%u,",
 		       JSON_BOOL(rtcm->xmitter.status),
@@ -786,7 +868,7 @@ void json_rtcm2_dump(const struct rtcm2_t *rtcm,
 	break;
 
     case 14:
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"week\":%u,\"hour\":%u,\"leapsecs\":%u,",
 		       rtcm->gpstime.week,
 		       rtcm->gpstime.hour,
@@ -794,17 +876,17 @@ void json_rtcm2_dump(const struct rtcm2_t *rtcm,
 	break;
 
     case 16:
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"message\":\"%s\"", json_stringify(buf1,
 							    sizeof(buf1),
 							    rtcm->message));
 	break;
 
     case 31:
-	(void)strlcat(buf, "\"satellites\":[", buflen);
+	strc_puts(&c, "\"satellites\":[");
 	for (n = 0; n < rtcm->glonass_ranges.nentries; n++) {
 	    const struct glonass_rangesat_t *rsp = &rtcm->glonass_ranges.sat[n];
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "{\"ident\":%u,\"udre\":%u,\"change\":%s,\"tod\":%u,\"prc\":%0.3f,\"rrc\":%0.3f},",
 			   rsp->ident,
 			   rsp->udre,
@@ -812,45 +894,101 @@ void json_rtcm2_dump(const struct rtcm2_t *rtcm,
 			   rsp->tod,
 			   rsp->prc, rsp->rrc);
 	}
-	str_rstrip_char(buf, ',');
-	(void)strlcat(buf, "]", buflen);
+	strc_rstrip_char(&c, ',');
+	strc_puts(&c, "]");
 	break;
 
     default:
-	(void)strlcat(buf, "\"data\":[", buflen);
+	strc_puts(&c, "\"data\":[");
 	for (n = 0; n < rtcm->length; n++)
-	    str_appendf(buf, buflen, "\"0x%08x\",", rtcm->words[n]);
-	str_rstrip_char(buf, ',');
-	(void)strlcat(buf, "]", buflen);
+	    strc_printf(&c, "\"0x%08x\",", rtcm->words[n]);
+	strc_rstrip_char(&c, ',');
+	strc_puts(&c, "]");
 	break;
     }
 
-    str_rstrip_char(buf, ',');
-    (void)strlcat(buf, "}\r\n", buflen);
+    strc_rstrip_char(&c, ',');
+    strc_puts(&c, "}\r\n");
+    return c.len;
 }
 #endif /* defined(RTCM104V2_ENABLE) */
 
 #if defined(RTCM104V3_ENABLE)
-void json_rtcm3_dump(const struct rtcm3_t *rtcm,
-		     const char *device,
-		     char buf[], size_t buflen)
+static void json_rtcm3_msm_dump(struct strcursor_t *c,
+				const struct rtcm3_t *rtcm)
+/* dump an RTCM3 Multiple Signal Message */
+{
+    const struct rtcm3_msm_t *msm = &rtcm->rtcmtypes.rtcm3_msm;
+    /* only MSM5 and MSM7 carry rates */
+    const bool rates = (RTCM3_MSM(rtcm->type) % 2 == 1);
+    unsigned int i;
+
+    strc_printf(c, "\"station_id\":%u,\"tow\":%u,", msm->station_id, msm->tow);
+    if (rtcm->type / 10 == 108)
+	strc_printf(c, "\"day\":%u,", msm->glonass_day);
+    strc_printf(c,
+		"\"sync\":%s,\"iods\":%u,\"steering\":%u,\"extclock\":%u,"
+		"\"smoothing\":%s,\"interval\":%u,"
+		"\"nsat\":%u,\"nsig\":%u,\"ncell\":%u,",
+		JSON_BOOL(msm->sync), msm->iods, msm->steering,
+		msm->extclock, JSON_BOOL(msm->smoothing), msm->interval,
+		msm->nsat, msm->nsig, msm->ncell);
+    strc_puts(c, "\"satellites\":[");
+    for (i = 0; i < msm->nsat; i++) {
+	strc_printf(c, "{\"ident\":%u,", msm->sats[i].ident);
+	if (isnan(msm->sats[i].rough_range) == 0)
+	    strc_printf(c, "\"range\":%.4f,", msm->sats[i].rough_range);
+	if (rates) {
+	    strc_printf(c, "\"ext\":%u,", msm->sats[i].extended);
+	    if (isnan(msm->sats[i].rate) == 0)
+		strc_printf(c, "\"rate\":%.0f,", msm->sats[i].rate);
+	}
+	strc_rstrip_char(c, ',');
+	strc_puts(c, "},");
+    }
+    strc_rstrip_char(c, ',');
+    strc_puts(c, "],\"signals\":[");
+    for (i = 0; i < msm->ncell; i++) {
+	const struct rtcm3_msm_cell *cell = &msm->cells[i];
+
+	strc_printf(c, "{\"ident\":%u,\"sig\":%u,", cell->sat, cell->signal);
+	if (isnan(cell->pseudorange) == 0)
+	    strc_printf(c, "\"prange\":%.4f,", cell->pseudorange);
+	if (isnan(cell->phaserange) == 0)
+	    strc_printf(c, "\"phase\":%.4f,", cell->phaserange);
+	strc_printf(c, "\"lockt\":%u,\"half\":%s,\"CNR\":%.4g,",
+		    cell->locktime, JSON_BOOL(cell->halfcycle), cell->CNR);
+	if (rates && isnan(cell->rate) == 0)
+	    strc_printf(c, "\"rate\":%.4f,", cell->rate);
+	strc_rstrip_char(c, ',');
+	strc_puts(c, "},");
+    }
+    strc_rstrip_char(c, ',');
+    strc_puts(c, "]");
+}
+
+size_t json_rtcm3_dump(const struct rtcm3_t *rtcm,
+		       const char *device,
+		       char buf[], size_t buflen)
 /* dump the contents of a parsed RTCM104v3 message as JSON */
 {
+    struct strcursor_t c;
     char buf1[JSON_VAL_MAX * 2 + 1];
     unsigned short i;
     unsigned int n;
 
-    (void)snprintf(buf, buflen, "{\"class\":\"RTCM3\",");
+    strc_init(&c, buf, buflen);
+    strc_puts(&c, "{\"class\":\"RTCM3\",");
     if (device != NULL && device[0] != '\0')
-	str_appendf(buf, buflen, "\"device\":\"%s\",", device);
-    str_appendf(buf, buflen, "\"type\":%u,", rtcm->type);
-    str_appendf(buf, buflen, "\"length\":%u,", rtcm->length);
+	strc_printf(&c, "\"device\":\"%s\",", device);
+    attr_int(&c, "type", rtcm->type);
+    attr_int(&c, "length", rtcm->length);
 
 #define CODE(x) (unsigned int)(x)
 #define INT(x) (unsigned int)(x)
     switch (rtcm->type) {
     case 1001:
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"station_id\":%u,\"tow\":%d,\"sync\":\"%s\","
 		       "\"smoothing\":\"%s\",\"interval\":\"%u\",",
 		       rtcm->rtcmtypes.rtcm3_1001.header.station_id,
@@ -858,10 +996,10 @@ void json_rtcm3_dump(const struct rtcm3_t *rtcm,
 		       JSON_BOOL(rtcm->rtcmtypes.rtcm3_1001.header.sync),
 		       JSON_BOOL(rtcm->rtcmtypes.rtcm3_1001.header.smoothing),
 		       rtcm->rtcmtypes.rtcm3_1001.header.interval);
-	(void)strlcat(buf, "\"satellites\":[", buflen);
+	strc_puts(&c, "\"satellites\":[");
 	for (i = 0; i < rtcm->rtcmtypes.rtcm3_1001.header.satcount; i++) {
 #define R1001 rtcm->rtcmtypes.rtcm3_1001.rtk_data[i]
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "{\"ident\":%u,\"ind\":%u,\"prange\":%8.2f,"
 			   "\"delta\":%6.4f,\"lockt\":%u},",
 			   R1001.ident,
@@ -871,12 +1009,12 @@ void json_rtcm3_dump(const struct rtcm3_t *rtcm,
 			   INT(R1001.L1.locktime));
 #undef R1001
 	}
-	str_rstrip_char(buf, ',');
-	(void)strlcat(buf, "]", buflen);
+	strc_rstrip_char(&c, ',');
+	strc_puts(&c, "]");
 	break;
 
     case 1002:
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"station_id\":%u,\"tow\":%d,\"sync\":\"%s\","
 		       "\"smoothing\":\"%s\",\"interval\":\"%u\",",
 		       rtcm->rtcmtypes.rtcm3_1002.header.station_id,
@@ -884,10 +1022,10 @@ void json_rtcm3_dump(const struct rtcm3_t *rtcm,
 		       JSON_BOOL(rtcm->rtcmtypes.rtcm3_1002.header.sync),
 		       JSON_BOOL(rtcm->rtcmtypes.rtcm3_1002.header.smoothing),
 		       rtcm->rtcmtypes.rtcm3_1002.header.interval);
-	(void)strlcat(buf, "\"satellites\":[", buflen);
+	strc_puts(&c, "\"satellites\":[");
 	for (i = 0; i < rtcm->rtcmtypes.rtcm3_1002.header.satcount; i++) {
 #define R1002 rtcm->rtcmtypes.rtcm3_1002.rtk_data[i]
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "{\"ident\":%u,\"ind\":%u,\"prange\":%8.2f,"
 			   "\"delta\":%6.4f,\"lockt\":%u,\"amb\":%u,"
 			   "\"CNR\":%.2f},",
@@ -900,12 +1038,12 @@ void json_rtcm3_dump(const struct rtcm3_t *rtcm,
 			   R1002.L1.CNR);
 #undef R1002
 	}
-	str_rstrip_char(buf, ',');
-	(void)strlcat(buf, "]", buflen);
+	strc_rstrip_char(&c, ',');
+	strc_puts(&c, "]");
 	break;
 
     case 1003:
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"station_id\":%u,\"tow\":%d,\"sync\":\"%s\","
 		       "\"smoothing\":\"%s\",\"interval\":\"%u\",",
 		       rtcm->rtcmtypes.rtcm3_1003.header.station_id,
@@ -913,10 +1051,10 @@ void json_rtcm3_dump(const struct rtcm3_t *rtcm,
 		       JSON_BOOL(rtcm->rtcmtypes.rtcm3_1003.header.sync),
 		       JSON_BOOL(rtcm->rtcmtypes.rtcm3_1003.header.smoothing),
 		       rtcm->rtcmtypes.rtcm3_1003.header.interval);
-	(void)strlcat(buf, "\"satellites\":[", buflen);
+	strc_puts(&c, "\"satellites\":[");
 	for (i = 0; i < rtcm->rtcmtypes.rtcm3_1003.header.satcount; i++) {
 #define R1003 rtcm->rtcmtypes.rtcm3_1003.rtk_data[i]
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "{\"ident\":%u,"
 			   "\"L1\":{\"ind\":%u,\"prange\":%8.2f,"
 			   "\"delta\":%6.4f,\"lockt\":%u},"
@@ -934,12 +1072,12 @@ void json_rtcm3_dump(const struct rtcm3_t *rtcm,
 			   INT(R1003.L2.locktime));
 #undef R1003
 	}
-	str_rstrip_char(buf, ',');
-	(void)strlcat(buf, "]", buflen);
+	strc_rstrip_char(&c, ',');
+	strc_puts(&c, "]");
 	break;
 
     case 1004:
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"station_id\":%u,\"tow\":%d,\"sync\":\"%s\","
 		       "\"smoothing\":\"%s\",\"interval\":\"%u\",",
 		       rtcm->rtcmtypes.rtcm3_1004.header.station_id,
@@ -947,10 +1085,10 @@ void json_rtcm3_dump(const struct rtcm3_t *rtcm,
 		       JSON_BOOL(rtcm->rtcmtypes.rtcm3_1004.header.sync),
 		       JSON_BOOL(rtcm->rtcmtypes.rtcm3_1004.header.smoothing),
 		       rtcm->rtcmtypes.rtcm3_1004.header.interval);
-	(void)strlcat(buf, "\"satellites\":[", buflen);
+	strc_puts(&c, "\"satellites\":[");
 	for (i = 0; i < rtcm->rtcmtypes.rtcm3_1004.header.satcount; i++) {
 #define R1004 rtcm->rtcmtypes.rtcm3_1004.rtk_data[i]
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "{\"ident\":%u,"
 			   "\"L1\":{\"ind\":%u,\"prange\":%8.2f,"
 			   "\"delta\":%6.4f,\"lockt\":%u,"
@@ -973,22 +1111,22 @@ void json_rtcm3_dump(const struct rtcm3_t *rtcm,
 			   R1004.L2.CNR);
 #undef R1004
 	}
-	str_rstrip_char(buf, ',');
-	(void)strlcat(buf, "]", buflen);
+	strc_rstrip_char(&c, ',');
+	strc_puts(&c, "]");
 	break;
 
     case 1005:
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"station_id\":%u,\"system\":[",
 		       rtcm->rtcmtypes.rtcm3_1005.station_id);
 	if ((rtcm->rtcmtypes.rtcm3_1005.system & 0x04)!=0)
-	    (void)strlcat(buf, "\"GPS\",", buflen);
+	    strc_puts(&c, "\"GPS\",");
 	if ((rtcm->rtcmtypes.rtcm3_1005.system & 0x02)!=0)
-	    (void)strlcat(buf, "\"GLONASS\",", buflen);
+	    strc_puts(&c, "\"GLONASS\",");
 	if ((rtcm->rtcmtypes.rtcm3_1005.system & 0x01)!=0)
-	    (void)strlcat(buf, "\"GALILEO\",", buflen);
-	str_rstrip_char(buf, ',');
-	str_appendf(buf, buflen,
+	    strc_puts(&c, "\"GALILEO\",");
+	strc_rstrip_char(&c, ',');
+	strc_printf(&c,
 		       "],\"refstation\":%s,\"sro\":%s,"
 		       "\"x\":%.4f,\"y\":%.4f,\"z\":%.4f,",
 		       JSON_BOOL(rtcm->rtcmtypes.rtcm3_1005.reference_station),
@@ -999,17 +1137,17 @@ void json_rtcm3_dump(const struct rtcm3_t *rtcm,
 	break;
 
     case 1006:
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"station_id\":%u,\"system\":[",
 		       rtcm->rtcmtypes.rtcm3_1006.station_id);
 	if ((rtcm->rtcmtypes.rtcm3_1006.system & 0x04)!=0)
-	    (void)strlcat(buf, "\"GPS\",", buflen);
+	    strc_puts(&c, "\"GPS\",");
 	if ((rtcm->rtcmtypes.rtcm3_1006.system & 0x02)!=0)
-	    (void)strlcat(buf, "\"GLONASS\",", buflen);
+	    strc_puts(&c, "\"GLONASS\",");
 	if ((rtcm->rtcmtypes.rtcm3_1006.system & 0x01)!=0)
-	    (void)strlcat(buf, "\"GALILEO\",", buflen);
-	str_rstrip_char(buf, ',');
-	str_appendf(buf, buflen,
+	    strc_puts(&c, "\"GALILEO\",");
+	strc_rstrip_char(&c, ',');
+	strc_printf(&c,
 		       "],\"refstation\":%s,\"sro\":%s,"
 		       "\"x\":%.4f,\"y\":%.4f,\"z\":%.4f,",
 		       JSON_BOOL(rtcm->rtcmtypes.rtcm3_1006.reference_station),
@@ -1017,13 +1155,11 @@ void json_rtcm3_dump(const struct rtcm3_t *rtcm,
 		       rtcm->rtcmtypes.rtcm3_1006.ecef_x,
 		       rtcm->rtcmtypes.rtcm3_1006.ecef_y,
 		       rtcm->rtcmtypes.rtcm3_1006.ecef_z);
-	str_appendf(buf, buflen,
-		       "\"h\":%.4f,",
-		       rtcm->rtcmtypes.rtcm3_1006.height);
+	attr_fixed(&c, "h", rtcm->rtcmtypes.rtcm3_1006.height, 4);
 	break;
 
     case 1007:
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"station_id\":%u,\"desc\":\"%s\",\"setup_id\":%u",
 		       rtcm->rtcmtypes.rtcm3_1007.station_id,
 		       rtcm->rtcmtypes.rtcm3_1007.descriptor,
@@ -1031,7 +1167,7 @@ void json_rtcm3_dump(const struct rtcm3_t *rtcm,
 	break;
 
     case 1008:
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"station_id\":%u,\"desc\":\"%s\","
 		       "\"setup_id\":%u,\"serial\":\"%s\"",
 		       rtcm->rtcmtypes.rtcm3_1008.station_id,
@@ -1041,7 +1177,7 @@ void json_rtcm3_dump(const struct rtcm3_t *rtcm,
 	break;
 
     case 1009:
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"station_id\":%u,\"tow\":%d,\"sync\":\"%s\","
 		       "\"smoothing\":\"%s\",\"interval\":\"%u\","
 		       "\"satcount\":\"%u\",",
@@ -1051,10 +1187,10 @@ void json_rtcm3_dump(const struct rtcm3_t *rtcm,
 		       JSON_BOOL(rtcm->rtcmtypes.rtcm3_1009.header.smoothing),
 		       rtcm->rtcmtypes.rtcm3_1009.header.interval,
 		       rtcm->rtcmtypes.rtcm3_1009.header.satcount);
-	(void)strlcat(buf, "\"satellites\":[", buflen);
+	strc_puts(&c, "\"satellites\":[");
 	for (i = 0; i < rtcm->rtcmtypes.rtcm3_1009.header.satcount; i++) {
 #define R1009 rtcm->rtcmtypes.rtcm3_1009.rtk_data[i]
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "{\"ident\":%u,\"ind\":%u,\"channel\":%u,"
 			   "\"prange\":%8.2f,\"delta\":%6.4f,\"lockt\":%u},",
 			   R1009.ident,
@@ -1065,12 +1201,12 @@ void json_rtcm3_dump(const struct rtcm3_t *rtcm,
 			   INT(R1009.L1.locktime));
 #undef R1009
 	}
-	str_rstrip_char(buf, ',');
-	(void)strlcat(buf, "]", buflen);
+	strc_rstrip_char(&c, ',');
+	strc_puts(&c, "]");
 	break;
 
     case 1010:
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"station_id\":%u,\"tow\":%d,\"sync\":\"%s\","
 		       "\"smoothing\":\"%s\",\"interval\":\"%u\",",
 		       rtcm->rtcmtypes.rtcm3_1010.header.station_id,
@@ -1078,10 +1214,10 @@ void json_rtcm3_dump(const struct rtcm3_t *rtcm,
 		       JSON_BOOL(rtcm->rtcmtypes.rtcm3_1010.header.sync),
 		       JSON_BOOL(rtcm->rtcmtypes.rtcm3_1010.header.smoothing),
 		       rtcm->rtcmtypes.rtcm3_1010.header.interval);
-	(void)strlcat(buf, "\"satellites\":[", buflen);
+	strc_puts(&c, "\"satellites\":[");
 	for (i = 0; i < rtcm->rtcmtypes.rtcm3_1010.header.satcount; i++) {
 #define R1010 rtcm->rtcmtypes.rtcm3_1010.rtk_data[i]
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "{\"ident\":%u,\"ind\":%u,\"channel\":%u,"
 			   "\"prange\":%8.2f,\"delta\":%6.4f,\"lockt\":%u,"
 			   "\"amb\":%u,\"CNR\":%.2f},",
@@ -1095,12 +1231,12 @@ void json_rtcm3_dump(const struct rtcm3_t *rtcm,
 			   R1010.L1.CNR);
 #undef R1010
 	}
-	str_rstrip_char(buf, ',');
-	(void)strlcat(buf, "]", buflen);
+	strc_rstrip_char(&c, ',');
+	strc_puts(&c, "]");
 	break;
 
     case 1011:
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"station_id\":%u,\"tow\":%d,\"sync\":\"%s\","
 		       "\"smoothing\":\"%s\",\"interval\":\"%u\",",
 		       rtcm->rtcmtypes.rtcm3_1011.header.station_id,
@@ -1108,10 +1244,10 @@ void json_rtcm3_dump(const struct rtcm3_t *rtcm,
 		       JSON_BOOL(rtcm->rtcmtypes.rtcm3_1011.header.sync),
 		       JSON_BOOL(rtcm->rtcmtypes.rtcm3_1011.header.smoothing),
 		       rtcm->rtcmtypes.rtcm3_1011.header.interval);
-	(void)strlcat(buf, "\"satellites\":[", buflen);
+	strc_puts(&c, "\"satellites\":[");
 	for (i = 0; i < rtcm->rtcmtypes.rtcm3_1011.header.satcount; i++) {
 #define R1011 rtcm->rtcmtypes.rtcm3_1011.rtk_data[i]
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "{\"ident\":%u,\"channel\":%u,"
 			   "\"L1\":{\"ind\":%u,"
 			   "\"prange\":%8.2f,\"delta\":%6.4f,\"lockt\":%u},"
@@ -1129,12 +1265,12 @@ void json_rtcm3_dump(const struct rtcm3_t *rtcm,
 			   INT(R1011.L2.locktime));
 #undef R1011
 	}
-	str_rstrip_char(buf, ',');
-	(void)strlcat(buf, "]", buflen);
+	strc_rstrip_char(&c, ',');
+	strc_puts(&c, "]");
 	break;
 
     case 1012:
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"station_id\":%u,\"tow\":%d,\"sync\":\"%s\","
 		       "\"smoothing\":\"%s\",\"interval\":\"%u\",",
 		       rtcm->rtcmtypes.rtcm3_1012.header.station_id,
@@ -1142,10 +1278,10 @@ void json_rtcm3_dump(const struct rtcm3_t *rtcm,
 		       JSON_BOOL(rtcm->rtcmtypes.rtcm3_1012.header.sync),
 		       JSON_BOOL(rtcm->rtcmtypes.rtcm3_1012.header.smoothing),
 		       rtcm->rtcmtypes.rtcm3_1012.header.interval);
-	(void)strlcat(buf, "\"satellites\":[", buflen);
+	strc_puts(&c, "\"satellites\":[");
 	for (i = 0; i < rtcm->rtcmtypes.rtcm3_1012.header.satcount; i++) {
 #define R1012 rtcm->rtcmtypes.rtcm3_1012.rtk_data[i]
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "{\"ident\":%u,\"channel\":%u,"
 			   "\"L1\":{\"ind\":%u,\"prange\":%8.2f,"
 			   "\"delta\":%6.4f,\"lockt\":%u,\"amb\":%u,"
@@ -1169,12 +1305,12 @@ void json_rtcm3_dump(const struct rtcm3_t *rtcm,
 			   R1012.L2.CNR);
 #undef R1012
 	}
-	str_rstrip_char(buf, ',');
-	(void)strlcat(buf, "]", buflen);
+	strc_rstrip_char(&c, ',');
+	strc_puts(&c, "]");
 	break;
 
     case 1013:
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"station_id\":%u,\"mjd\":%u,\"sec\":%u,"
 		       "\"leapsecs\":%u,",
 		       rtcm->rtcmtypes.rtcm3_1013.station_id,
@@ -1182,7 +1318,7 @@ void json_rtcm3_dump(const struct rtcm3_t *rtcm,
 		       rtcm->rtcmtypes.rtcm3_1013.sod,
 		       INT(rtcm->rtcmtypes.rtcm3_1013.leapsecs));
 	for (i = 0; i < (unsigned short)rtcm->rtcmtypes.rtcm3_1013.ncount; i++)
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "{\"id\":%u,\"sync\":\"%s\",\"interval\":%u}",
 			   rtcm->rtcmtypes.rtcm3_1013.announcements[i].id,
 			   JSON_BOOL(rtcm->rtcmtypes.rtcm3_1013.
@@ -1192,7 +1328,7 @@ void json_rtcm3_dump(const struct rtcm3_t *rtcm,
 	break;
 
     case 1014:
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"netid\":%u,\"subnetid\":%u,\"statcount\":%u"
 		       "\"master\":%u,\"aux\":%u,\"lat\":%f,\"lon\":%f,\"alt\":%f,",
 		       rtcm->rtcmtypes.rtcm3_1014.network_id,
@@ -1224,7 +1360,7 @@ void json_rtcm3_dump(const struct rtcm3_t *rtcm,
 	break;
 
     case 1029:
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"station_id\":%u,\"mjd\":%u,\"sec\":%u,"
 		       "\"len\":%zd,\"units\":%zd,\"msg\":\"%s\",",
 		       rtcm->rtcmtypes.rtcm3_1029.station_id,
@@ -1237,7 +1373,7 @@ void json_rtcm3_dump(const struct rtcm3_t *rtcm,
 	break;
 
     case 1033:
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"station_id\":%u,\"desc\":\"%s\","
 		       "\"setup_id\":%u,\"serial\":\"%s\","
 		       "\"receiver\":\"%s\",\"firmware\":\"%s\"",
@@ -1250,27 +1386,33 @@ void json_rtcm3_dump(const struct rtcm3_t *rtcm,
 	break;
 
     default:
-	(void)strlcat(buf, "\"data\":[", buflen);
+	if (RTCM3_MSM(rtcm->type) != 0) {
+	    json_rtcm3_msm_dump(&c, rtcm);
+	    break;
+	}
+	strc_puts(&c, "\"data\":[");
 	for (n = 0; n < rtcm->length; n++)
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"0x%02x\",",(unsigned int)rtcm->rtcmtypes.data[n]);
-	str_rstrip_char(buf, ',');
-	(void)strlcat(buf, "]", buflen);
+	strc_rstrip_char(&c, ',');
+	strc_puts(&c, "]");
 	break;
     }
 
-    str_rstrip_char(buf, ',');
-    (void)strlcat(buf, "}\r\n", buflen);
+    strc_rstrip_char(&c, ',');
+    strc_puts(&c, "}\r\n");
+    return c.len;
 #undef CODE
 #undef INT
 }
 #endif /* defined(RTCM104V3_ENABLE) */
 
 #if defined(AIVDM_ENABLE)
-void json_aivdm_dump(const struct ais_t *ais,
-		     const char *device, bool scaled,
-		     char *buf, size_t buflen)
+size_t json_aivdm_dump(const struct ais_t *ais,
+		       const char *device, bool scaled,
+		       char *buf, size_t buflen)
 {
+    struct strcursor_t c;
     char buf1[JSON_VAL_MAX * 2 + 1];
     char buf2[JSON_VAL_MAX * 2 + 1];
     char buf3[JSON_VAL_MAX * 2 + 1];
@@ -1573,12 +1715,14 @@ void json_aivdm_dump(const struct ais_t *ais,
 	"Reserved for future use",
     };
 
-    (void)snprintf(buf, buflen, "{\"class\":\"AIS\",");
+    strc_init(&c, buf, buflen);
+    strc_puts(&c, "{\"class\":\"AIS\",");
     if (device != NULL && device[0] != '\0')
-	str_appendf(buf, buflen, "\"device\":\"%s\",", device);
-    str_appendf(buf, buflen,
-		   "\"type\":%u,\"repeat\":%u,\"mmsi\":%u,\"scaled\":%s,",
-		   ais->type, ais->repeat, ais->mmsi, JSON_BOOL(scaled));
+	strc_printf(&c, "\"device\":\"%s\",", device);
+    attr_int(&c, "type", ais->type);
+    attr_int(&c, "repeat", ais->repeat);
+    attr_int(&c, "mmsi", ais->mmsi);
+    strc_puts(&c, scaled ? "\"scaled\":true," : "\"scaled\":false,");
     switch (ais->type) {
     case 1:			/* Position Report */
     case 2:
@@ -1616,44 +1760,41 @@ void json_aivdm_dump(const struct ais_t *ais,
 		(void)snprintf(speedlegend, sizeof(speedlegend),
 			       "%.1f", ais->type1.speed / 10.0);
 
-	    str_appendf(buf, buflen,
-			   "\"status\":%u,\"status_text\":\"%s\","
-			   "\"turn\":%s,\"speed\":%s,"
-			   "\"accuracy\":%s,\"lon\":%.4f,\"lat\":%.4f,"
-			   "\"course\":%.1f,\"heading\":%u,\"second\":%u,"
-			   "\"maneuver\":%u,\"raim\":%s,\"radio\":%u}\r\n",
-			   ais->type1.status,
-			   nav_legends[ais->type1.status],
-			   turnlegend,
-			   speedlegend,
-			   JSON_BOOL(ais->type1.accuracy),
-			   ais->type1.lon / AIS_LATLON_DIV,
-			   ais->type1.lat / AIS_LATLON_DIV,
-			   ais->type1.course / 10.0,
-			   ais->type1.heading,
-			   ais->type1.second,
-			   ais->type1.maneuver,
-			   JSON_BOOL(ais->type1.raim), ais->type1.radio);
+	    attr_int(&c, "status", ais->type1.status);
+	    strc_puts(&c, "\"status_text\":\"");
+	    strc_puts(&c, nav_legends[ais->type1.status]);
+	    strc_puts(&c, "\",\"turn\":");
+	    strc_puts(&c, turnlegend);
+	    strc_puts(&c, ",\"speed\":");
+	    strc_puts(&c, speedlegend);
+	    strc_puts(&c, ",\"accuracy\":");
+	    strc_puts(&c, JSON_BOOL(ais->type1.accuracy));
+	    strc_putn(&c, ",", 1);
+	    attr_fixed(&c, "lon", ais->type1.lon / AIS_LATLON_DIV, 4);
+	    attr_fixed(&c, "lat", ais->type1.lat / AIS_LATLON_DIV, 4);
+	    attr_fixed(&c, "course", ais->type1.course / 10.0, 1);
 	} else {
-	    str_appendf(buf, buflen,
-			   "\"status\":%u,\"status_text\":\"%s\","
-			   "\"turn\":%d,\"speed\":%u,"
-			   "\"accuracy\":%s,\"lon\":%d,\"lat\":%d,"
-			   "\"course\":%u,\"heading\":%u,\"second\":%u,"
-			   "\"maneuver\":%u,\"raim\":%s,\"radio\":%u}\r\n",
-			   ais->type1.status,
-			   nav_legends[ais->type1.status],
-			   ais->type1.turn,
-			   ais->type1.speed,
-			   JSON_BOOL(ais->type1.accuracy),
-			   ais->type1.lon,
-			   ais->type1.lat,
-			   ais->type1.course,
-			   ais->type1.heading,
-			   ais->type1.second,
-			   ais->type1.maneuver,
-			   JSON_BOOL(ais->type1.raim), ais->type1.radio);
+	    attr_int(&c, "status", ais->type1.status);
+	    strc_puts(&c, "\"status_text\":\"");
+	    strc_puts(&c, nav_legends[ais->type1.status]);
+	    strc_puts(&c, "\",");
+	    attr_int(&c, "turn", ais->type1.turn);
+	    attr_int(&c, "speed", ais->type1.speed);
+	    strc_puts(&c, "\"accuracy\":");
+	    strc_puts(&c, JSON_BOOL(ais->type1.accuracy));
+	    strc_putn(&c, ",", 1);
+	    attr_int(&c, "lon", ais->type1.lon);
+	    attr_int(&c, "lat", ais->type1.lat);
+	    attr_int(&c, "course", ais->type1.course);
 	}
+	attr_int(&c, "heading", ais->type1.heading);
+	attr_int(&c, "second", ais->type1.second);
+	attr_int(&c, "maneuver", ais->type1.maneuver);
+	strc_puts(&c, "\"raim\":");
+	strc_puts(&c, JSON_BOOL(ais->type1.raim));
+	strc_puts(&c, ",\"radio\":");
+	strc_int(&c, ais->type1.radio);
+	strc_puts(&c, "}\r\n");
 	break;
     case 4:			/* Base Station Report */
     case 11:			/* UTC/Date Response */
@@ -1661,7 +1802,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 	if (scaled) {
 	    // The use of %u instead of %04u for the year is to allow
 	    // out-of-band year values.
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"timestamp\":\"%04u-%02u-%02uT%02u:%02u:%02uZ\","
 			   "\"accuracy\":%s,\"lon\":%.4f,\"lat\":%.4f,"
 			   "\"epfd\":%u,\"epfd_text\":\"%s\","
@@ -1679,7 +1820,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 			   EPFD_DISPLAY(ais->type4.epfd),
 			   JSON_BOOL(ais->type4.raim), ais->type4.radio);
 	} else {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"timestamp\":\"%04u-%02u-%02uT%02u:%02u:%02uZ\","
 			   "\"accuracy\":%s,\"lon\":%d,\"lat\":%d,"
 			   "\"epfd\":%u,\"epfd_text\":\"%s\","
@@ -1702,7 +1843,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 	/* some fields have beem merged to an ISO8601 partial date */
 	if (scaled) {
             /* *INDENT-OFF* */
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"imo\":%u,\"ais_version\":%u,\"callsign\":\"%s\","
 			   "\"shipname\":\"%s\","
 			   "\"shiptype\":%u,\"shiptype_text\":\"%s\","
@@ -1733,7 +1874,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 			   ais->type5.dte);
             /* *INDENT-ON* */
 	} else {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"imo\":%u,\"ais_version\":%u,\"callsign\":\"%s\","
 			   "\"shipname\":\"%s\","
 			   "\"shiptype\":%u,\"shiptype_text\":\"%s\","
@@ -1768,7 +1909,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 	}
 	break;
     case 6:			/* Binary Message */
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"seqno\":%u,\"dest_mmsi\":%u,"
 		       "\"retransmit\":%s,\"dac\":%u,\"fid\":%u,",
 		       ais->type6.seqno,
@@ -1777,7 +1918,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 		       ais->type6.dac,
 		       ais->type6.fid);
 	if (!ais->type6.structured) {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"data\":\"%zd:%s\"}\r\n",
 			   ais->type6.bitcount,
 			   json_stringify(buf1, sizeof(buf1),
@@ -1789,7 +1930,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 	if (ais->type6.dac == 200) {
 	    switch (ais->type6.fid) {
 	    case 21:
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 			       "\"country\":\"%s\",\"locode\":\"%s\",\"section\":\"%s\",\"terminal\":\"%s\",\"hectometre\":\"%s\",\"eta\":\"%u-%uT%u:%u\",\"tugs\":%u,\"airdraught\":%u}",
 		    ais->type6.dac200fid21.country,
 		    ais->type6.dac200fid21.locode,
@@ -1804,7 +1945,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 		    ais->type6.dac200fid21.airdraught);
 		break;
 	    case 22:
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 			       "\"country\":\"%s\",\"locode\":\"%s\","
 			       "\"section\":\"%s\","
 			       "\"terminal\":\"%s\",\"hectometre\":\"%s\","
@@ -1823,7 +1964,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 			       rta_status[ais->type6.dac200fid22.status]);
 		break;
 	    case 55:
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 		    "\"crew\":%u,\"passengers\":%u,\"personnel\":%u}",
 
 		    ais->type6.dac200fid55.crew,
@@ -1835,37 +1976,25 @@ void json_aivdm_dump(const struct ais_t *ais,
 	else if (ais->type6.dac == 235 || ais->type6.dac == 250) {
 	    switch (ais->type6.fid) {
 	    case 10:	/* GLA - AtoN monitoring data */
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 			       "\"off_pos\":%s,\"alarm\":%s,"
 			       "\"stat_ext\":%u,",
 			       JSON_BOOL(ais->type6.dac235fid10.off_pos),
 			       JSON_BOOL(ais->type6.dac235fid10.alarm),
 			       ais->type6.dac235fid10.stat_ext);
 		if (scaled && ais->type6.dac235fid10.ana_int != 0)
-		    str_appendf(buf, buflen,
-				   "\"ana_int\":%.2f,",
-				   ais->type6.dac235fid10.ana_int*0.05);
+		    attr_fixed(&c, "ana_int", ais->type6.dac235fid10.ana_int*0.05, 2);
 		else
-		    str_appendf(buf, buflen,
-				   "\"ana_int\":%u,",
-				   ais->type6.dac235fid10.ana_int);
+		    attr_int(&c, "ana_int", ais->type6.dac235fid10.ana_int);
 		if (scaled && ais->type6.dac235fid10.ana_ext1 != 0)
-		    str_appendf(buf, buflen,
-				   "\"ana_ext1\":%.2f,",
-				   ais->type6.dac235fid10.ana_ext1*0.05);
+		    attr_fixed(&c, "ana_ext1", ais->type6.dac235fid10.ana_ext1*0.05, 2);
 		else
-		    str_appendf(buf, buflen,
-				   "\"ana_ext1\":%u,",
-				   ais->type6.dac235fid10.ana_ext1);
+		    attr_int(&c, "ana_ext1", ais->type6.dac235fid10.ana_ext1);
 		if (scaled && ais->type6.dac235fid10.ana_ext2 != 0)
-		    str_appendf(buf, buflen,
-				   "\"ana_ext2\":%.2f,",
-				   ais->type6.dac235fid10.ana_ext2*0.05);
+		    attr_fixed(&c, "ana_ext2", ais->type6.dac235fid10.ana_ext2*0.05, 2);
 		else
-		    str_appendf(buf, buflen,
-				   "\"ana_ext2\":%u,",
-				   ais->type6.dac235fid10.ana_ext2);
-		str_appendf(buf, buflen,
+		    attr_int(&c, "ana_ext2", ais->type6.dac235fid10.ana_ext2);
+		strc_printf(&c,
 			       "\"racon\":%u,"
 			       "\"racon_text\":\"%s\","
 			       "\"light\":%u,"
@@ -1874,8 +2003,8 @@ void json_aivdm_dump(const struct ais_t *ais,
 			       racon_status[ais->type6.dac235fid10.racon],
 			       ais->type6.dac235fid10.light,
 			       light_status[ais->type6.dac235fid10.light]);
-		str_rstrip_char(buf, ',');
-		(void)strlcat(buf, "}\r\n", buflen);
+		strc_rstrip_char(&c, ',');
+		strc_puts(&c, "}\r\n");
 		break;
 	    }
 	}
@@ -1884,7 +2013,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 	    switch (ais->type6.fid) {
 	    case 12:	/* IMO236 -Dangerous cargo indication */
 		/* some fields have beem merged to an ISO8601 partial date */
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 			       "\"lastport\":\"%s\",\"departure\":\"%02u-%02uT%02u:%02uZ\","
 			       "\"nextport\":\"%s\",\"eta\":\"%02u-%02uT%02u:%02uZ\","
 			       "\"dangerous\":\"%s\",\"imdcat\":\"%s\","
@@ -1910,16 +2039,16 @@ void json_aivdm_dump(const struct ais_t *ais,
 			       ais->type6.dac1fid12.unit);
 		break;
 	    case 15:	/* IMO236 - Extended Ship Static and Voyage Related Data */
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 		    "\"airdraught\":%u}\r\n",
 		    ais->type6.dac1fid15.airdraught);
 		break;
 	    case 16:	/* IMO236 - Number of persons on board */
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 			       "\"persons\":%u}\r\n", ais->type6.dac1fid16.persons);
 		break;
 	    case 18:	/* IMO289 - Clearance time to enter port */
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 			       "\"linkage\":%u,\"arrival\":\"%02u-%02uT%02u:%02uZ\",\"portname\":\"%s\",\"destination\":\"%s\",",
 			       ais->type6.dac1fid18.linkage,
 			       ais->type6.dac1fid18.month,
@@ -1931,18 +2060,18 @@ void json_aivdm_dump(const struct ais_t *ais,
 			       json_stringify(buf2, sizeof(buf2),
 					      ais->type6.dac1fid18.destination));
 		if (scaled)
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 				   "\"lon\":%.3f,\"lat\":%.3f}\r\n",
 				   ais->type6.dac1fid18.lon/AIS_LATLON3_DIV,
 				   ais->type6.dac1fid18.lat/AIS_LATLON3_DIV);
 		else
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 			       "\"lon\":%d,\"lat\":%d}\r\n",
 			       ais->type6.dac1fid18.lon,
 			       ais->type6.dac1fid18.lat);
 		break;
 	    case 20:        /* IMO289 - Berthing Data */
-                str_appendf(buf, buflen,
+                strc_printf(&c,
 			       "\"linkage\":%u,\"berth_length\":%u,"
 			       "\"position\":%u,\"position_text\":\"%s\","
 			       "\"arrival\":\"%u-%uT%u:%u\","
@@ -1997,7 +2126,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 			       json_stringify(buf1, sizeof(buf1),
 					      ais->type6.dac1fid20.berth_name));
 		if (scaled)
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 			       "\"berth_lon\":%.3f,"
 			       "\"berth_lat\":%.3f,"
 			       "\"berth_depth\":%.1f}\r\n",
@@ -2005,7 +2134,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 			       ais->type6.dac1fid20.berth_lat / AIS_LATLON3_DIV,
 			       ais->type6.dac1fid20.berth_depth * 0.1);
 		else
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 			       "\"berth_lon\":%d,"
 			       "\"berth_lat\":%d,"
 			       "\"berth_depth\":%u}\r\n",
@@ -2016,21 +2145,21 @@ void json_aivdm_dump(const struct ais_t *ais,
 	    case 23:    /* IMO289 - Area notice - addressed */
 		break;
 	    case 25:	/* IMO289 - Dangerous cargo indication */
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 			       "\"unit\":%u,\"amount\":%u,\"cargos\":[",
 			       ais->type6.dac1fid25.unit,
 			       ais->type6.dac1fid25.amount);
 		for (i = 0; i < (int)ais->type6.dac1fid25.ncargos; i++)
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 				   "{\"code\":%u,\"subtype\":%u},",
 
 				   ais->type6.dac1fid25.cargos[i].code,
 				   ais->type6.dac1fid25.cargos[i].subtype);
-		str_rstrip_char(buf, ',');
-		(void)strlcat(buf, "]}\r\n", buflen);
+		strc_rstrip_char(&c, ',');
+		strc_puts(&c, "]}\r\n");
 		break;
 	    case 28:	/* IMO289 - Route info - addressed */
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 			       "\"linkage\":%u,\"sender\":%u,"
 			       "\"rtype\":%u,"
 			       "\"rtype_text\":\"%s\","
@@ -2047,21 +2176,21 @@ void json_aivdm_dump(const struct ais_t *ais,
 			       ais->type6.dac1fid28.duration);
 		for (i = 0; i < ais->type6.dac1fid28.waycount; i++) {
 		    if (scaled)
-			str_appendf(buf, buflen,
+			strc_printf(&c,
 			    "{\"lon\":%.4f,\"lat\":%.4f},",
 			    ais->type6.dac1fid28.waypoints[i].lon / AIS_LATLON4_DIV,
 			    ais->type6.dac1fid28.waypoints[i].lat / AIS_LATLON4_DIV);
 		    else
-			str_appendf(buf, buflen,
+			strc_printf(&c,
 			    "{\"lon\":%d,\"lat\":%d},",
 			    ais->type6.dac1fid28.waypoints[i].lon,
 			    ais->type6.dac1fid28.waypoints[i].lat);
 		}
-		str_rstrip_char(buf, ',');
-		(void)strlcat(buf, "]}\r\n", buflen);
+		strc_rstrip_char(&c, ',');
+		strc_puts(&c, "]}\r\n");
 		break;
 	    case 30:	/* IMO289 - Text description - addressed */
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 		       "\"linkage\":%u,\"text\":\"%s\"}\r\n",
 		       ais->type6.dac1fid30.linkage,
 		       json_stringify(buf1, sizeof(buf1),
@@ -2069,23 +2198,23 @@ void json_aivdm_dump(const struct ais_t *ais,
 		break;
 	    case 14:	/* IMO236 - Tidal Window */
 	    case 32:	/* IMO289 - Tidal Window */
-	      str_appendf(buf, buflen,
+	      strc_printf(&c,
 		  "\"month\":%u,\"day\":%u,\"tidals\":[",
 		  ais->type6.dac1fid32.month,
 		  ais->type6.dac1fid32.day);
 	      for (i = 0; i < ais->type6.dac1fid32.ntidals; i++) {
 		  const struct tidal_t *tp =  &ais->type6.dac1fid32.tidals[i];
 		  if (scaled)
-		      str_appendf(buf, buflen,
+		      strc_printf(&c,
 			  "{\"lon\":%.3f,\"lat\":%.3f,",
 			  tp->lon / AIS_LATLON3_DIV,
 			  tp->lat / AIS_LATLON3_DIV);
 		  else
-		      str_appendf(buf, buflen,
+		      strc_printf(&c,
 			  "{\"lon\":%d,\"lat\":%d,",
 			  tp->lon,
 			  tp->lat);
-		  str_appendf(buf, buflen,
+		  strc_printf(&c,
 		      "\"from_hour\":%u,\"from_min\":%u,\"to_hour\":%u,\"to_min\":%u,\"cdir\":%u,",
 		      tp->from_hour,
 		      tp->from_min,
@@ -2093,32 +2222,32 @@ void json_aivdm_dump(const struct ais_t *ais,
 		      tp->to_min,
 		      tp->cdir);
 		  if (scaled)
-		      str_appendf(buf, buflen,
+		      strc_printf(&c,
 			  "\"cspeed\":%.1f},",
 			  tp->cspeed / 10.0);
 		  else
-		      str_appendf(buf, buflen,
+		      strc_printf(&c,
 			  "\"cspeed\":%u},",
 			  tp->cspeed);
 	      }
-	      str_rstrip_char(buf, ',');
-	      (void)strlcat(buf, "]}\r\n", buflen);
+	      strc_rstrip_char(&c, ',');
+	      strc_puts(&c, "]}\r\n");
 	      break;
 	    }
 	}
 	break;
     case 7:			/* Binary Acknowledge */
     case 13:			/* Safety Related Acknowledge */
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"mmsi1\":%u,\"mmsi2\":%u,\"mmsi3\":%u,\"mmsi4\":%u}\r\n",
 		       ais->type7.mmsi1,
 		       ais->type7.mmsi2, ais->type7.mmsi3, ais->type7.mmsi4);
 	break;
     case 8:			/* Binary Broadcast Message */
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"dac\":%u,\"fid\":%u,",ais->type8.dac, ais->type8.fid);
 	if (!ais->type8.structured) {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"data\":\"%zd:%s\"}\r\n",
 			   ais->type8.bitcount,
 			   json_stringify(buf1, sizeof(buf1),
@@ -2156,16 +2285,16 @@ void json_aivdm_dump(const struct ais_t *ais,
 		/* some fields have been merged to an ISO8601 partial date */
 		/* layout is almost identical to FID=31 from IMO289 */
 		if (scaled)
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 				   "\"lat\":%.3f,\"lon\":%.3f,",
 				   ais->type8.dac1fid11.lat / AIS_LATLON3_DIV,
 				   ais->type8.dac1fid11.lon / AIS_LATLON3_DIV);
 		else
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 				   "\"lat\":%d,\"lon\":%d,",
 				   ais->type8.dac1fid11.lat,
 				   ais->type8.dac1fid11.lon);
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 			       "\"timestamp\":\"%02uT%02u:%02uZ\","
 			       "\"wspeed\":%u,\"wgust\":%u,\"wdir\":%u,"
 			       "\"wgustdir\":%u,\"humidity\":%u,",
@@ -2178,7 +2307,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 			       ais->type8.dac1fid11.wgustdir,
 			       ais->type8.dac1fid11.humidity);
 		if (scaled)
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 				   "\"airtemp\":%.1f,\"dewpoint\":%.1f,"
 				   "\"pressure\":%u,\"pressuretend\":\"%s\",",
 				   ((signed int)ais->type8.dac1fid11.airtemp - DAC1FID11_AIRTEMP_OFFSET) / DAC1FID11_AIRTEMP_DIV,
@@ -2186,7 +2315,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 				   ais->type8.dac1fid11.pressure - DAC1FID11_PRESSURE_OFFSET,
 				   trends[ais->type8.dac1fid11.pressuretend]);
 		else
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 				   "\"airtemp\":%u,\"dewpoint\":%u,"
 				   "\"pressure\":%u,\"pressuretend\":%u,",
 				   ais->type8.dac1fid11.airtemp,
@@ -2195,24 +2324,16 @@ void json_aivdm_dump(const struct ais_t *ais,
 				   ais->type8.dac1fid11.pressuretend);
 
 		if (scaled)
-		    str_appendf(buf, buflen,
-				   "\"visibility\":%.1f,",
-				   ais->type8.dac1fid11.visibility / DAC1FID11_VISIBILITY_DIV);
+		    attr_fixed(&c, "visibility", ais->type8.dac1fid11.visibility / DAC1FID11_VISIBILITY_DIV, 1);
 		else
-		    str_appendf(buf, buflen,
-				   "\"visibility\":%u,",
-				   ais->type8.dac1fid11.visibility);
+		    attr_int(&c, "visibility", ais->type8.dac1fid11.visibility);
 		if (!scaled)
-		    str_appendf(buf, buflen,
-				   "\"waterlevel\":%d,",
-				   ais->type8.dac1fid11.waterlevel);
+		    attr_int(&c, "waterlevel", ais->type8.dac1fid11.waterlevel);
 		else
-		    str_appendf(buf, buflen,
-				   "\"waterlevel\":%.1f,",
-				   ((signed int)ais->type8.dac1fid11.waterlevel - DAC1FID11_WATERLEVEL_OFFSET) / DAC1FID11_WATERLEVEL_DIV);
+		    attr_fixed(&c, "waterlevel", ((signed int)ais->type8.dac1fid11.waterlevel - DAC1FID11_WATERLEVEL_OFFSET) / DAC1FID11_WATERLEVEL_DIV, 1);
 
 		if (scaled) {
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 				   "\"leveltrend\":\"%s\","
 				   "\"cspeed\":%.1f,\"cdir\":%u,"
 				   "\"cspeed2\":%.1f,\"cdir2\":%u,\"cdepth2\":%u,"
@@ -2245,7 +2366,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 				   ais->type8.dac1fid11.ice,
 				   ice[ais->type8.dac1fid11.ice]);
 		} else
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 				   "\"leveltrend\":%u,"
 				   "\"cspeed\":%u,\"cdir\":%u,"
 				   "\"cspeed2\":%u,\"cdir2\":%u,\"cdepth2\":%u,"
@@ -2277,10 +2398,10 @@ void json_aivdm_dump(const struct ais_t *ais,
 				   ais->type8.dac1fid11.salinity,
 				   ais->type8.dac1fid11.ice,
 				   ice[ais->type8.dac1fid11.ice]);
-		(void)strlcat(buf, "}\r\n", buflen);
+		strc_puts(&c, "}\r\n");
 		break;
 	    case 13:        /* IMO236 - Fairway closed */
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 			       "\"reason\":\"%s\",\"closefrom\":\"%s\","
 			       "\"closeto\":\"%s\",\"radius\":%u,"
 			       "\"extunit\":%u,"
@@ -2304,69 +2425,69 @@ void json_aivdm_dump(const struct ais_t *ais,
 			       ais->type8.dac1fid13.tminute);
 		break;
 	    case 15:        /* IMO236 - Extended ship and voyage */
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 			       "\"airdraught\":%u}\r\n",
 			       ais->type8.dac1fid15.airdraught);
 		break;
 	    case 16:	/* IMO289 - Number of persons on board */
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 			       "\"persons\":%u}\r\n", ais->type6.dac1fid16.persons);
 		break;
 	    case 17:        /* IMO289 - VTS-generated/synthetic targets */
-		(void)strlcat(buf, "\"targets\":[", buflen);
+		strc_puts(&c, "\"targets\":[");
 		for (i = 0; i < ais->type8.dac1fid17.ntargets; i++) {
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 				   "{\"idtype\":%u,\"idtype_text\":\"%s\",",
 				   ais->type8.dac1fid17.targets[i].idtype,
 				   idtypes[ais->type8.dac1fid17.targets[i].idtype]);
 		    switch (ais->type8.dac1fid17.targets[i].idtype) {
 		    case DAC1FID17_IDTYPE_MMSI:
-			str_appendf(buf, buflen,
+			strc_printf(&c,
 			    "\"%s\":\"%u\",",
 			    idtypes[ais->type8.dac1fid17.targets[i].idtype],
 			    ais->type8.dac1fid17.targets[i].id.mmsi);
 			break;
 		    case DAC1FID17_IDTYPE_IMO:
-			str_appendf(buf, buflen,
+			strc_printf(&c,
 			    "\"%s\":\"%u\",",
 			    idtypes[ais->type8.dac1fid17.targets[i].idtype],
 			    ais->type8.dac1fid17.targets[i].id.imo);
 			break;
 		    case DAC1FID17_IDTYPE_CALLSIGN:
-			str_appendf(buf, buflen,
+			strc_printf(&c,
 			    "\"%s\":\"%s\",",
 			    idtypes[ais->type8.dac1fid17.targets[i].idtype],
 			    json_stringify(buf1, sizeof(buf1),
 					   ais->type8.dac1fid17.targets[i].id.callsign));
 			break;
 		    default:
-			str_appendf(buf, buflen,
+			strc_printf(&c,
 			    "\"%s\":\"%s\",",
 			    idtypes[ais->type8.dac1fid17.targets[i].idtype],
 			    json_stringify(buf1, sizeof(buf1),
 					   ais->type8.dac1fid17.targets[i].id.other));
 		    }
 		    if (scaled)
-			str_appendf(buf, buflen,
+			strc_printf(&c,
 			    "\"lat\":%.3f,\"lon\":%.3f,",
 			    ais->type8.dac1fid17.targets[i].lat / AIS_LATLON3_DIV,
 			    ais->type8.dac1fid17.targets[i].lon / AIS_LATLON3_DIV);
 		    else
-			str_appendf(buf, buflen,
+			strc_printf(&c,
 			    "\"lat\":%d,\"lon\":%d,",
 			    ais->type8.dac1fid17.targets[i].lat,
 			    ais->type8.dac1fid17.targets[i].lon);
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 			"\"course\":%u,\"second\":%u,\"speed\":%u},",
 			ais->type8.dac1fid17.targets[i].course,
 			ais->type8.dac1fid17.targets[i].second,
 			ais->type8.dac1fid17.targets[i].speed);
 		}
-		str_rstrip_char(buf, ',');
-		(void)strlcat(buf, "]}\r\n", buflen);
+		strc_rstrip_char(&c, ',');
+		strc_puts(&c, "]}\r\n");
 		break;
 	    case 19:        /* IMO289 - Marine Traffic Signal */
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 			       "\"linkage\":%u,\"station\":\"%s\","
 			       "\"lon\":%.3f,\"lat\":%.3f,\"status\":%u,"
 			       "\"signal\":%u,\"signal_text\":\"%s\","
@@ -2396,7 +2517,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 	    case 25:        /* IMO289 - Dangerous Cargo Indication */
 		break;
 	    case 27:        /* IMO289 - Route information - broadcast */
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 			       "\"linkage\":%u,\"sender\":%u,"
 			       "\"rtype\":%u,"
 			       "\"rtype_text\":\"%s\","
@@ -2413,21 +2534,21 @@ void json_aivdm_dump(const struct ais_t *ais,
 			       ais->type8.dac1fid27.duration);
 		for (i = 0; i < ais->type8.dac1fid27.waycount; i++) {
 		    if (scaled)
-			str_appendf(buf, buflen,
+			strc_printf(&c,
 			    "{\"lon\":%.4f,\"lat\":%.4f},",
 			    ais->type8.dac1fid27.waypoints[i].lon / AIS_LATLON4_DIV,
 			    ais->type8.dac1fid27.waypoints[i].lat / AIS_LATLON4_DIV);
 		    else
-			str_appendf(buf, buflen,
+			strc_printf(&c,
 			    "{\"lon\":%d,\"lat\":%d},",
 			    ais->type8.dac1fid27.waypoints[i].lon,
 			    ais->type8.dac1fid27.waypoints[i].lat);
 		}
-		str_rstrip_char(buf, ',');
-		(void)strlcat(buf, "]}\r\n", buflen);
+		strc_rstrip_char(&c, ',');
+		strc_puts(&c, "]}\r\n");
 		break;
 	    case 29:        /* IMO289 - Text Description - broadcast */
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 		       "\"linkage\":%u,\"text\":\"%s\"}\r\n",
 		       ais->type8.dac1fid29.linkage,
 		       json_stringify(buf1, sizeof(buf1),
@@ -2437,19 +2558,19 @@ void json_aivdm_dump(const struct ais_t *ais,
 		/* some fields have been merged to an ISO8601 partial date */
 		/* layout is almost identical to FID=11 from IMO236 */
 		if (scaled)
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 				   "\"lat\":%.3f,\"lon\":%.3f,",
 				   ais->type8.dac1fid31.lat / AIS_LATLON3_DIV,
 				   ais->type8.dac1fid31.lon / AIS_LATLON3_DIV);
 		else
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 				   "\"lat\":%d,\"lon\":%d,",
 				   ais->type8.dac1fid31.lat,
 				   ais->type8.dac1fid31.lon);
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 			       "\"accuracy\":%s,",
 			       JSON_BOOL(ais->type8.dac1fid31.accuracy));
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 			       "\"timestamp\":\"%02uT%02u:%02uZ\","
 			       "\"wspeed\":%u,\"wgust\":%u,\"wdir\":%u,"
 			       "\"wgustdir\":%u,\"humidity\":%u,",
@@ -2462,7 +2583,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 			       ais->type8.dac1fid31.wgustdir,
 			       ais->type8.dac1fid31.humidity);
 		if (scaled)
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 				   "\"airtemp\":%.1f,\"dewpoint\":%.1f,"
 				   "\"pressure\":%u,\"pressuretend\":\"%s\","
 				   "\"visgreater\":%s,",
@@ -2472,7 +2593,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 				   trends[ais->type8.dac1fid31.pressuretend],
 				   JSON_BOOL(ais->type8.dac1fid31.visgreater));
 		else
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 				   "\"airtemp\":%d,\"dewpoint\":%d,"
 				   "\"pressure\":%u,\"pressuretend\":%u,"
 				   "\"visgreater\":%s,",
@@ -2483,24 +2604,16 @@ void json_aivdm_dump(const struct ais_t *ais,
 				   JSON_BOOL(ais->type8.dac1fid31.visgreater));
 
 		if (scaled)
-		    str_appendf(buf, buflen,
-				   "\"visibility\":%.1f,",
-				   ais->type8.dac1fid31.visibility / DAC1FID31_VISIBILITY_DIV);
+		    attr_fixed(&c, "visibility", ais->type8.dac1fid31.visibility / DAC1FID31_VISIBILITY_DIV, 1);
 		else
-		    str_appendf(buf, buflen,
-				   "\"visibility\":%u,",
-				   ais->type8.dac1fid31.visibility);
+		    attr_int(&c, "visibility", ais->type8.dac1fid31.visibility);
 		if (!scaled)
-		    str_appendf(buf, buflen,
-				   "\"waterlevel\":%d,",
-				   ais->type8.dac1fid31.waterlevel);
+		    attr_int(&c, "waterlevel", ais->type8.dac1fid31.waterlevel);
 		else
-		    str_appendf(buf, buflen,
-				   "\"waterlevel\":%.1f,",
-				   ((unsigned int)ais->type8.dac1fid31.waterlevel - DAC1FID31_WATERLEVEL_OFFSET) / DAC1FID31_WATERLEVEL_DIV);
+		    attr_fixed(&c, "waterlevel", ((unsigned int)ais->type8.dac1fid31.waterlevel - DAC1FID31_WATERLEVEL_OFFSET) / DAC1FID31_WATERLEVEL_DIV, 1);
 
 		if (scaled) {
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 				   "\"leveltrend\":\"%s\","
 				   "\"cspeed\":%.1f,\"cdir\":%u,"
 				   "\"cspeed2\":%.1f,\"cdir2\":%u,\"cdepth2\":%u,"
@@ -2530,7 +2643,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 				   ais->type8.dac1fid31.salinity / DAC1FID31_SALINITY_DIV,
 				   ice[ais->type8.dac1fid31.ice]);
 		} else
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 				   "\"leveltrend\":%u,"
 				   "\"cspeed\":%u,\"cdir\":%u,"
 				   "\"cspeed2\":%u,\"cdir2\":%u,\"cdepth2\":%u,"
@@ -2559,7 +2672,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 				   ais->type8.dac1fid31.preciptype,
 				   ais->type8.dac1fid31.salinity,
 				   ais->type8.dac1fid31.ice);
-		(void)strlcat(buf, "}\r\n", buflen);
+		strc_puts(&c, "}\r\n");
 		break;
 	    }
 	}
@@ -2690,7 +2803,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 			|| cp->ais == ais->type8.dac200fid10.shiptype
 			|| cp->code == 0)
 			break;
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 			       "\"vin\":\"%s\",\"length\":%u,\"beam\":%u,"
 			       "\"shiptype\":%u,\"shiptype_text\":\"%s\","
 			       "\"hazard\":%u,\"hazard_text\":\"%s\","
@@ -2716,7 +2829,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 	    case 23:	/* EMMA warning */
 		if (!ais->type8.structured)
 		    break;
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 			       "\"start\":\"%4u-%02u-%02uT%02u:%02u\","
 			       "\"end\":\"%4u-%02u-%02uT%02u:%02u\",",
 			       ais->type8.dac200fid23.start_year + 2000,
@@ -2730,20 +2843,20 @@ void json_aivdm_dump(const struct ais_t *ais,
 			       ais->type8.dac200fid23.end_hour,
 			       ais->type8.dac200fid23.end_minute);
 		if (scaled)
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 			"\"start_lon\":%.4f,\"start_lat\":%.4f,\"end_lon\":%.4f,\"end_lat\":%.4f,",
 			ais->type8.dac200fid23.start_lon / AIS_LATLON_DIV,
 			ais->type8.dac200fid23.start_lat / AIS_LATLON_DIV,
 			ais->type8.dac200fid23.end_lon / AIS_LATLON_DIV,
 			ais->type8.dac200fid23.end_lat / AIS_LATLON_DIV);
 		else
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 			"\"start_lon\":%d,\"start_lat\":%d,\"end_lon\":%d,\"end_lat\":%d,",
 			ais->type8.dac200fid23.start_lon,
 			ais->type8.dac200fid23.start_lat,
 			ais->type8.dac200fid23.end_lon,
 			ais->type8.dac200fid23.end_lat);
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 		    "\"type\":%u,\"type_text\":\"%s\",\"min\":%d,\"max\":%d,\"class\":%u,\"class_text\":\"%s\",\"wind\":%u,\"wind_text\":\"%s\"}\r\n",
 
 		    ais->type8.dac200fid23.type,
@@ -2756,30 +2869,30 @@ void json_aivdm_dump(const struct ais_t *ais,
 		    EMMA_WIND_DISPLAY(ais->type8.dac200fid23.wind));
 		break;
 	    case 24:	/* Inland AIS Water Levels */
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 		    "\"country\":\"%s\",\"gauges\":[",
 		    ais->type8.dac200fid24.country);
 		for (i = 0; i < ais->type8.dac200fid24.ngauges; i++) {
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 			"{\"id\":%u,\"level\":%d},",
 			ais->type8.dac200fid24.gauges[i].id,
 			ais->type8.dac200fid24.gauges[i].level);
 		}
-		str_rstrip_char(buf, ',');
-		(void)strlcat(buf, "]}\r\n", buflen);
+		strc_rstrip_char(&c, ',');
+		strc_puts(&c, "]}\r\n");
 		break;
 	    case 40:	/* Inland AIS Signal Strength */
 		if (scaled)
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 			"\"lon\":%.4f,\"lat\":%.4f,",
 			ais->type8.dac200fid40.lon / AIS_LATLON_DIV,
 			ais->type8.dac200fid40.lat / AIS_LATLON_DIV);
 		else
-		    str_appendf(buf, buflen,
+		    strc_printf(&c,
 			"\"lon\":%d,\"lat\":%d,",
 			ais->type8.dac200fid40.lon,
 			ais->type8.dac200fid40.lat);
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 		    "\"form\":%u,\"facing\":%u,\"direction\":%u,\"direction_text\":\"%s\",\"status\":%u,\"status_text\":\"%s\"}\r\n",
 		    ais->type8.dac200fid40.form,
 		    ais->type8.dac200fid40.facing,
@@ -2820,7 +2933,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 		(void)snprintf(speedlegend, sizeof(speedlegend),
 			       "%u", ais->type9.speed);
 
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"alt\":%s,\"speed\":%s,\"accuracy\":%s,"
 			   "\"lon\":%.4f,\"lat\":%.4f,\"course\":%.1f,"
 			   "\"second\":%u,\"regional\":%u,\"dte\":%u,"
@@ -2836,7 +2949,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 			   ais->type9.dte,
 			   JSON_BOOL(ais->type9.raim), ais->type9.radio);
 	} else {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"alt\":%u,\"speed\":%u,\"accuracy\":%s,"
 			   "\"lon\":%d,\"lat\":%d,\"course\":%u,"
 			   "\"second\":%u,\"regional\":%u,\"dte\":%u,"
@@ -2854,11 +2967,11 @@ void json_aivdm_dump(const struct ais_t *ais,
 	}
 	break;
     case 10:			/* UTC/Date Inquiry */
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"dest_mmsi\":%u}\r\n", ais->type10.dest_mmsi);
 	break;
     case 12:			/* Safety Related Message */
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"seqno\":%u,\"dest_mmsi\":%u,\"retransmit\":%s,\"text\":\"%s\"}\r\n",
 		       ais->type12.seqno,
 		       ais->type12.dest_mmsi,
@@ -2866,12 +2979,12 @@ void json_aivdm_dump(const struct ais_t *ais,
 		       json_stringify(buf1, sizeof(buf1), ais->type12.text));
 	break;
     case 14:			/* Safety Related Broadcast Message */
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"text\":\"%s\"}\r\n",
 		       json_stringify(buf1, sizeof(buf1), ais->type14.text));
 	break;
     case 15:			/* Interrogation */
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"mmsi1\":%u,\"type1_1\":%u,\"offset1_1\":%u,"
 		       "\"type1_2\":%u,\"offset1_2\":%u,\"mmsi2\":%u,"
 		       "\"type2_1\":%u,\"offset2_1\":%u}\r\n",
@@ -2884,7 +2997,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 		       ais->type15.type2_1, ais->type15.offset2_1);
 	break;
     case 16:
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"mmsi1\":%u,\"offset1\":%u,\"increment1\":%u,"
 		       "\"mmsi2\":%u,\"offset2\":%u,\"increment2\":%u}\r\n",
 		       ais->type16.mmsi1,
@@ -2895,7 +3008,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 	break;
     case 17:
 	if (scaled) {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"lon\":%.1f,\"lat\":%.1f,\"data\":\"%zd:%s\"}\r\n",
 			   ais->type17.lon / AIS_GNSS_LATLON_DIV,
 			   ais->type17.lat / AIS_GNSS_LATLON_DIV,
@@ -2904,7 +3017,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 					(char *)ais->type17.bitdata,
 					BITS_TO_BYTES(ais->type17.bitcount)));
 	} else {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"lon\":%d,\"lat\":%d,\"data\":\"%zd:%s\"}\r\n",
 			   ais->type17.lon,
 			   ais->type17.lat,
@@ -2916,7 +3029,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 	break;
     case 18:
 	if (scaled) {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"reserved\":%u,\"speed\":%.1f,\"accuracy\":%s,"
 			   "\"lon\":%.4f,\"lat\":%.4f,\"course\":%.1f,"
 			   "\"heading\":%u,\"second\":%u,\"regional\":%u,"
@@ -2938,7 +3051,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 			   JSON_BOOL(ais->type18.msg22),
 			   JSON_BOOL(ais->type18.raim), ais->type18.radio);
 	} else {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"reserved\":%u,\"speed\":%u,\"accuracy\":%s,"
 			   "\"lon\":%d,\"lat\":%d,\"course\":%u,"
 			   "\"heading\":%u,\"second\":%u,\"regional\":%u,"
@@ -2963,7 +3076,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 	break;
     case 19:
 	if (scaled) {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"reserved\":%u,\"speed\":%.1f,\"accuracy\":%s,"
 			   "\"lon\":%.4f,\"lat\":%.4f,\"course\":%.1f,"
 			   "\"heading\":%u,\"second\":%u,\"regional\":%u,"
@@ -2996,7 +3109,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 			   ais->type19.dte,
 			   JSON_BOOL(ais->type19.assigned));
 	} else {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"reserved\":%u,\"speed\":%u,\"accuracy\":%s,"
 			   "\"lon\":%d,\"lat\":%d,\"course\":%u,"
 			   "\"heading\":%u,\"second\":%u,\"regional\":%u,"
@@ -3031,7 +3144,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 	}
 	break;
     case 20:			/* Data Link Management Message */
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"offset1\":%u,\"number1\":%u,"
 		       "\"timeout1\":%u,\"increment1\":%u,"
 		       "\"offset2\":%u,\"number2\":%u,"
@@ -3058,7 +3171,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 	break;
     case 21:			/* Aid to Navigation */
 	if (scaled) {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"aid_type\":%u,\"aid_type_text\":\"%s\","
 			   "\"name\":\"%s\",\"lon\":%.4f,"
 			   "\"lat\":%.4f,\"accuracy\":%s,\"to_bow\":%u,"
@@ -3084,7 +3197,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 			   JSON_BOOL(ais->type21.raim),
 			   JSON_BOOL(ais->type21.virtual_aid));
 	} else {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"aid_type\":%u,\"aid_type_text\":\"%s\","
 			   "\"name\":\"%s\",\"accuracy\":%s,"
 			   "\"lon\":%d,\"lat\":%d,\"to_bow\":%u,"
@@ -3114,18 +3227,18 @@ void json_aivdm_dump(const struct ais_t *ais,
 	}
 	break;
     case 22:			/* Channel Management */
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"channel_a\":%u,\"channel_b\":%u,"
 		       "\"txrx\":%u,\"power\":%s,",
 		       ais->type22.channel_a,
 		       ais->type22.channel_b,
 		       ais->type22.txrx, JSON_BOOL(ais->type22.power));
 	if (ais->type22.addressed) {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"dest1\":%u,\"dest2\":%u,",
 			   ais->type22.mmsi.dest1, ais->type22.mmsi.dest2);
 	} else if (scaled) {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"ne_lon\":\"%f\",\"ne_lat\":\"%f\","
 			   "\"sw_lon\":\"%f\",\"sw_lat\":\"%f\",",
 			   ais->type22.area.ne_lon / AIS_CHANNEL_LATLON_DIV,
@@ -3134,14 +3247,14 @@ void json_aivdm_dump(const struct ais_t *ais,
 			   ais->type22.area.sw_lat /
 			   AIS_CHANNEL_LATLON_DIV);
 	} else {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"ne_lon\":%d,\"ne_lat\":%d,"
 			   "\"sw_lon\":%d,\"sw_lat\":%d,",
 			   ais->type22.area.ne_lon,
 			   ais->type22.area.ne_lat,
 			   ais->type22.area.sw_lon, ais->type22.area.sw_lat);
 	}
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"addressed\":%s,\"band_a\":%s,"
 		       "\"band_b\":%s,\"zonesize\":%u}\r\n",
 		       JSON_BOOL(ais->type22.addressed),
@@ -3150,7 +3263,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 	break;
     case 23:			/* Group Assignment Command */
 	if (scaled) {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"ne_lon\":\"%f\",\"ne_lat\":\"%f\","
 			   "\"sw_lon\":\"%f\",\"sw_lat\":\"%f\","
 			   "\"stationtype\":%u,\"stationtype_text\":\"%s\","
@@ -3166,7 +3279,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 			   SHIPTYPE_DISPLAY(ais->type23.shiptype),
 			   ais->type23.interval, ais->type23.quiet);
 	} else {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"ne_lon\":%d,\"ne_lat\":%d,"
 			   "\"sw_lon\":%d,\"sw_lat\":%d,"
 			   "\"stationtype\":%u,\"stationtype_text\":\"%s\","
@@ -3186,18 +3299,18 @@ void json_aivdm_dump(const struct ais_t *ais,
     case 24:			/* Class B CS Static Data Report */
 	if (ais->type24.part != both) {
 	    static char *partnames[] = {"AB", "A", "B"};
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"part\":\"%s\",",
 			   json_stringify(buf1, sizeof(buf1),
 					  partnames[ais->type24.part]));
 	}
 	if (ais->type24.part != part_b)
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"shipname\":\"%s\",",
 			   json_stringify(buf1, sizeof(buf1),
 				      ais->type24.shipname));
 	if (ais->type24.part != part_a) {
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"shiptype\":%u,\"shiptype_text\":\"%s\","
 			   "\"vendorid\":\"%s\",\"model\":%u,\"serial\":%u,"
 			   "\"callsign\":\"%s\",",
@@ -3210,11 +3323,11 @@ void json_aivdm_dump(const struct ais_t *ais,
 			   json_stringify(buf2, sizeof(buf2),
 					  ais->type24.callsign));
 	    if (AIS_AUXILIARY_MMSI(ais->mmsi)) {
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 			       "\"mothership_mmsi\":%u",
 			       ais->type24.mothership_mmsi);
 	    } else {
-		str_appendf(buf, buflen,
+		strc_printf(&c,
 			       "\"to_bow\":%u,\"to_stern\":%u,"
 			       "\"to_port\":%u,\"to_starboard\":%u",
 			       ais->type24.dim.to_bow,
@@ -3223,11 +3336,11 @@ void json_aivdm_dump(const struct ais_t *ais,
 			       ais->type24.dim.to_starboard);
 	    }
 	}
-	str_rstrip_char(buf, ',');
-	(void)strlcat(buf, "}\r\n", buflen);
+	strc_rstrip_char(&c, ',');
+	strc_puts(&c, "}\r\n");
 	break;
     case 25:			/* Binary Message, Single Slot */
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"addressed\":%s,\"structured\":%s,\"dest_mmsi\":%u,"
 		       "\"app_id\":%u,\"data\":\"%zd:%s\"}\r\n",
 		       JSON_BOOL(ais->type25.addressed),
@@ -3240,7 +3353,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 				    BITS_TO_BYTES(ais->type25.bitcount)));
 	break;
     case 26:			/* Binary Message, Multiple Slot */
-	str_appendf(buf, buflen,
+	strc_printf(&c,
 		       "\"addressed\":%s,\"structured\":%s,\"dest_mmsi\":%u,"
 		       "\"app_id\":%u,\"data\":\"%zd:%s\",\"radio\":%u}\r\n",
 		       JSON_BOOL(ais->type26.addressed),
@@ -3255,7 +3368,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 	break;
     case 27:			/* Long Range AIS Broadcast message */
 	if (scaled)
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"status\":\"%s\","
 			   "\"accuracy\":%s,\"lon\":%.1f,\"lat\":%.1f,"
 			   "\"speed\":%u,\"course\":%u,\"raim\":%s,\"gnss\":%s}\r\n",
@@ -3268,7 +3381,7 @@ void json_aivdm_dump(const struct ais_t *ais,
 			   JSON_BOOL(ais->type27.raim),
 			   JSON_BOOL(ais->type27.gnss));
 	else
-	    str_appendf(buf, buflen,
+	    strc_printf(&c,
 			   "\"status\":%u,"
 			   "\"accuracy\":%s,\"lon\":%d,\"lat\":%d,"
 			   "\"speed\":%u,\"course\":%u,\"raim\":%s,\"gnss\":%s}\r\n",
@@ -3282,177 +3395,291 @@ void json_aivdm_dump(const struct ais_t *ais,
 			   JSON_BOOL(ais->type27.gnss));
 	break;
     default:
-	str_rstrip_char(buf, ',');
-	(void)strlcat(buf, "}\r\n", buflen);
+	strc_rstrip_char(&c, ',');
+	strc_puts(&c, "}\r\n");
 	break;
     }
+    return c.len;
 }
 #endif /* defined(AIVDM_ENABLE) */
 
 #ifdef COMPASS_ENABLE
-void json_att_dump(const struct gps_data_t *gpsdata,
-		   char *reply, size_t replylen)
+size_t json_att_dump(const struct gps_data_t *gpsdata,
+		     char *reply, size_t replylen)
 /* dump the contents of an attitude_t structure as JSON */
 {
+    struct strcursor_t c;
+
     assert(replylen > sizeof(char *));
-    (void)strlcpy(reply, "{\"class\":\"ATT\",", replylen);
-    str_appendf(reply, replylen, "\"device\":\"%s\",", gpsdata->dev.path);
+    strc_init(&c, reply, replylen);
+    strc_puts(&c, "{\"class\":\"ATT\",");
+    strc_printf(&c, "\"device\":\"%s\",", gpsdata->dev.path);
     if (isnan(gpsdata->attitude.heading) == 0) {
-	str_appendf(reply, replylen,
-		       "\"heading\":%.2f,", gpsdata->attitude.heading);
+	attr_fixed(&c, "heading", gpsdata->attitude.heading, 2);
 	if (gpsdata->attitude.mag_st != '\0')
-	    str_appendf(reply, replylen,
+	    strc_printf(&c,
 			   "\"mag_st\":\"%c\",", gpsdata->attitude.mag_st);
 
     }
     if (isnan(gpsdata->attitude.pitch) == 0) {
-	str_appendf(reply, replylen,
-		       "\"pitch\":%.2f,", gpsdata->attitude.pitch);
+	attr_fixed(&c, "pitch", gpsdata->attitude.pitch, 2);
 	if (gpsdata->attitude.pitch_st != '\0')
-	    str_appendf(reply, replylen,
+	    strc_printf(&c,
 			   "\"pitch_st\":\"%c\",",
 			   gpsdata->attitude.pitch_st);
 
     }
     if (isnan(gpsdata->attitude.yaw) == 0) {
-	str_appendf(reply, replylen,
-		       "\"yaw\":%.2f,", gpsdata->attitude.yaw);
+	attr_fixed(&c, "yaw", gpsdata->attitude.yaw, 2);
 	if (gpsdata->attitude.yaw_st != '\0')
-	    str_appendf(reply, replylen,
+	    strc_printf(&c,
 			   "\"yaw_st\":\"%c\",", gpsdata->attitude.yaw_st);
 
     }
     if (isnan(gpsdata->attitude.roll) == 0) {
-	str_appendf(reply, replylen,
-		       "\"roll\":%.2f,", gpsdata->attitude.roll);
+	attr_fixed(&c, "roll", gpsdata->attitude.roll, 2);
 	if (gpsdata->attitude.roll_st != '\0')
-	    str_appendf(reply, replylen,
+	    strc_printf(&c,
 			   "\"roll_st\":\"%c\",", gpsdata->attitude.roll_st);
 
     }
 
     if (isnan(gpsdata->attitude.dip) == 0)
-	str_appendf(reply, replylen,
-		       "\"dip\":%.3f,", gpsdata->attitude.dip);
+	attr_fixed(&c, "dip", gpsdata->attitude.dip, 3);
 
     if (isnan(gpsdata->attitude.mag_len) == 0)
-	str_appendf(reply, replylen,
-		       "\"mag_len\":%.3f,", gpsdata->attitude.mag_len);
+	attr_fixed(&c, "mag_len", gpsdata->attitude.mag_len, 3);
     if (isnan(gpsdata->attitude.mag_x) == 0)
-	str_appendf(reply, replylen,
-		       "\"mag_x\":%.3f,", gpsdata->attitude.mag_x);
+	attr_fixed(&c, "mag_x", gpsdata->attitude.mag_x, 3);
     if (isnan(gpsdata->attitude.mag_y) == 0)
-	str_appendf(reply, replylen,
-		       "\"mag_y\":%.3f,", gpsdata->attitude.mag_y);
+	attr_fixed(&c, "mag_y", gpsdata->attitude.mag_y, 3);
     if (isnan(gpsdata->attitude.mag_z) == 0)
-	str_appendf(reply, replylen,
-		       "\"mag_z\":%.3f,", gpsdata->attitude.mag_z);
+	attr_fixed(&c, "mag_z", gpsdata->attitude.mag_z, 3);
 
     if (isnan(gpsdata->attitude.acc_len) == 0)
-	str_appendf(reply, replylen,
-		       "\"acc_len\":%.3f,", gpsdata->attitude.acc_len);
+	attr_fixed(&c, "acc_len", gpsdata->attitude.acc_len, 3);
     if (isnan(gpsdata->attitude.acc_x) == 0)
-	str_appendf(reply, replylen,
-		       "\"acc_x\":%.3f,", gpsdata->attitude.acc_x);
+	attr_fixed(&c, "acc_x", gpsdata->attitude.acc_x, 3);
     if (isnan(gpsdata->attitude.acc_y) == 0)
-	str_appendf(reply, replylen,
-		       "\"acc_y\":%.3f,", gpsdata->attitude.acc_y);
+	attr_fixed(&c, "acc_y", gpsdata->attitude.acc_y, 3);
     if (isnan(gpsdata->attitude.acc_z) == 0)
-	str_appendf(reply, replylen,
-		       "\"acc_z\":%.3f,", gpsdata->attitude.acc_z);
+	attr_fixed(&c, "acc_z", gpsdata->attitude.acc_z, 3);
 
     if (isnan(gpsdata->attitude.gyro_x) == 0)
-	str_appendf(reply, replylen,
-		       "\"gyro_x\":%.3f,", gpsdata->attitude.gyro_x);
+	attr_fixed(&c, "gyro_x", gpsdata->attitude.gyro_x, 3);
     if (isnan(gpsdata->attitude.gyro_y) == 0)
-	str_appendf(reply, replylen,
-		       "\"gyro_y\":%.3f,", gpsdata->attitude.gyro_y);
+	attr_fixed(&c, "gyro_y", gpsdata->attitude.gyro_y, 3);
 
     if (isnan(gpsdata->attitude.temp) == 0)
-	str_appendf(reply, replylen,
-		       "\"temp\":%.3f,", gpsdata->attitude.temp);
+	attr_fixed(&c, "temp", gpsdata->attitude.temp, 3);
     if (isnan(gpsdata->attitude.depth) == 0)
-	str_appendf(reply, replylen,
-		       "\"depth\":%.3f,", gpsdata->attitude.depth);
+	attr_fixed(&c, "depth", gpsdata->attitude.depth, 3);
 
-    str_rstrip_char(reply, ',');
-    (void)strlcat(reply, "}\r\n", replylen);
+    strc_rstrip_char(&c, ',');
+    strc_puts(&c, "}\r\n");
+    return c.len;
 }
 #endif /* COMPASS_ENABLE */
 
 #ifdef OSCILLATOR_ENABLE
-void json_oscillator_dump(const struct gps_data_t *datap,
-			  char *reply, size_t replylen)
+size_t json_oscillator_dump(const struct gps_data_t *datap,
+			    char *reply, size_t replylen)
 /* dump the contents of an oscillator_t structure as JSON */
 {
-    (void)snprintf(reply, replylen,
+    struct strcursor_t c;
+
+    strc_init(&c, reply, replylen);
+    strc_printf(&c,
 		   "{\"class\":\"OSC\",\"device\":\"%s\",\"running\":%s,\"reference\":%s,\"disciplined\":%s,\"delta\":%d}\r\n",
 		   datap->dev.path,
 		   JSON_BOOL(datap->osc.running),
 		   JSON_BOOL(datap->osc.reference),
 		   JSON_BOOL(datap->osc.disciplined),
 		   datap->osc.delta);
+    return c.len;
 }
 #endif /* OSCILLATOR_ENABLE */
 
-void json_data_report(const gps_mask_t changed,
+#ifdef PPS_ENABLE
+static void json_pps_hist_dump(struct strcursor_t *c, const char *name,
+			       const struct pps_hist_t hist[2])
+/* dump both halves of a rolling PPS histogram as one JSON object */
+{
+    struct pps_hist_t sum = hist[0];
+    int b, top;
+
+    pps_hist_merge(&sum, &hist[1]);
+    strc_printf(c, "\"%s\":{\"count\":%lu,\"max\":%lld,"
+		   "\"p50\":%lld,\"p99\":%lld,\"hist\":[",
+		name, sum.count, sum.max,
+		pps_hist_quantile(&sum, 0.5), pps_hist_quantile(&sum, 0.99));
+    /* trailing empty buckets are left off */
+    for (top = PPS_HIST_BUCKETS; top > 0 && sum.bucket[top - 1] == 0; top--)
+	continue;
+    for (b = 0; b < top; b++)
+	strc_printf(c, "%s%lu", b > 0 ? "," : "", sum.bucket[b]);
+    strc_printf(c, "]}");
+}
+
+size_t json_ppsstats_dump(const struct gps_device_t *session,
+			  const struct pps_stats_t *stats,
+			  char *reply, size_t replylen)
+/* dump a device's PPS statistics as JSON */
+{
+    struct strcursor_t c;
+
+    strc_init(&c, reply, replylen);
+    strc_printf(&c,
+		"{\"class\":\"PPSSTATS\",\"device\":\"%s\",\"window\":%d,"
+		"\"edges\":%lu,\"accepted\":%lu,\"rejected\":%lu,"
+		"\"unusable\":%lu,",
+		session->gpsdata.dev.path, PPS_STATS_WINDOW,
+		stats->edges, stats->accepted, stats->rejected,
+		stats->unusable);
+    json_pps_hist_dump(&c, "jitter", stats->jitter);
+    strc_printf(&c, ",");
+    json_pps_hist_dump(&c, "disagree", stats->disagree);
+    strc_printf(&c, ",");
+    json_pps_hist_dump(&c, "delay", stats->delay);
+    strc_printf(&c, "}\r\n");
+    return c.len;
+}
+#endif /* PPS_ENABLE */
+
+#ifdef TIMING_ENABLE
+size_t json_latency_dump(const struct gps_device_t *session,
+			 unsigned long from, char *reply, size_t replylen)
+/* dump a device's latency traces from number from on, as JSON */
+{
+    static const char *stage_names[latency_stages] = {
+	"read", "lex", "parse", "model", "encode", "send",
+    };
+    struct strcursor_t c;
+    unsigned long n, head = session->latency.head;
+    int i;
+
+    /* only the newest traces fit in one report */
+    if (head - from > LATENCY_BATCH)
+	from = head - LATENCY_BATCH;
+
+    strc_init(&c, reply, replylen);
+    strc_printf(&c,
+		"{\"class\":\"LATENCY\",\"device\":\"%s\",\"packets\":[",
+		session->gpsdata.dev.path);
+    for (n = from; n < head; n++) {
+	const struct latency_trace_t *trace =
+	    &session->latency.trace[n % LATENCY_RING];
+
+	strc_printf(&c, "{\"type\":%d,\"start\":%llu.%09llu,\"total\":%llu",
+		    trace->type,
+		    (unsigned long long)(trace->start / 1000000000ULL),
+		    (unsigned long long)(trace->start % 1000000000ULL),
+		    (unsigned long long)trace->total);
+	for (i = 0; i < latency_stages; i++)
+	    strc_printf(&c, ",\"%s\":%llu",
+			stage_names[i], (unsigned long long)trace->stage[i]);
+	strc_printf(&c, "},");
+    }
+    strc_rstrip_char(&c, ',');
+    strc_printf(&c, "]}\r\n");
+    return c.len;
+}
+#endif /* TIMING_ENABLE */
+
+size_t json_device_metrics_dump(const struct gps_device_t *session,
+				char *reply, size_t replylen)
+/* dump a device's counters as a JSON object, for METRICS */
+{
+    const struct device_metrics_t *m = &session->metrics;
+    const struct gps_type_t **dp;
+    struct strcursor_t c;
+    int i, used;
+
+    strc_init(&c, reply, replylen);
+    strc_printf(&c, "{\"path\":\"%s\",\"bytes_in\":%lu,\"bytes_out\":%lu,"
+		"\"bad\":%lu,\"wakeups\":%lu,\"exhausted\":%lu,\"packets\":[",
+		session->gpsdata.dev.path, m->bytes_in, m->bytes_out, m->bad,
+		session->multipoll.wakeups, session->multipoll.exhausted);
+    /* trailing types never seen are left off */
+    for (used = METRIC_PACKET_TYPES; used > 0; used--)
+	if (m->packets[used - 1] != 0)
+	    break;
+    for (i = 0; i < used; i++)
+	strc_printf(&c, "%lu,", m->packets[i]);
+    strc_rstrip_char(&c, ',');
+    strc_puts(&c, "],\"parse\":[");
+    for (dp = gpsd_drivers, i = 0; *dp && i < METRIC_DRIVERS; dp++, i++)
+	if (m->parse[i].calls > 0)
+	    strc_printf(&c, "{\"driver\":\"%s\",\"calls\":%lu,\"ns\":%llu},",
+			(*dp)->type_name, m->parse[i].calls,
+			(unsigned long long)m->parse[i].ns);
+    strc_rstrip_char(&c, ',');
+    strc_puts(&c, "]}");
+    return c.len;
+}
+
+size_t json_data_report(const gps_mask_t changed,
 		 const struct gps_device_t *session,
 		 const struct policy_t *policy,
 		 char *buf, size_t buflen)
 /* report a session state in JSON */
 {
     const struct gps_data_t *datap = &session->gpsdata;
+    size_t len = 0;
+
     buf[0] = '\0';
 
     if ((changed & REPORT_IS) != 0) {
-	json_tpv_dump(session, policy, buf+strlen(buf), buflen-strlen(buf));
+	len += json_tpv_dump(session, policy, buf + len, buflen - len);
     }
 
     if ((changed & GST_SET) != 0) {
-	json_noise_dump(datap, buf+strlen(buf), buflen-strlen(buf));
+	len += json_noise_dump(datap, buf + len, buflen - len);
     }
 
     if ((changed & SATELLITE_SET) != 0) {
-	json_sky_dump(datap, buf+strlen(buf), buflen-strlen(buf));
+	len += json_sky_dump(datap, buf + len, buflen - len);
     }
 
     if ((changed & SUBFRAME_SET) != 0) {
-	json_subframe_dump(datap, buf+strlen(buf), buflen-strlen(buf));
+	len += json_subframe_dump(datap, buf + len, buflen - len);
     }
 
 #ifdef COMPASS_ENABLE
     if ((changed & ATTITUDE_SET) != 0) {
-	json_att_dump(datap, buf+strlen(buf), buflen-strlen(buf));
+	len += json_att_dump(datap, buf + len, buflen - len);
     }
 #endif /* COMPASS_ENABLE */
 
 #ifdef RTCM104V2_ENABLE
     if ((changed & RTCM2_SET) != 0) {
-	json_rtcm2_dump(&datap->rtcm2, datap->dev.path,
-			buf+strlen(buf), buflen-strlen(buf));
+	len += json_rtcm2_dump(&datap->rtcm2, datap->dev.path,
+			buf + len, buflen - len);
     }
 #endif /* RTCM104V2_ENABLE */
 
 #ifdef RTCM104V3_ENABLE
     if ((changed & RTCM3_SET) != 0) {
-	json_rtcm3_dump(&datap->rtcm3, datap->dev.path,
-			buf+strlen(buf), buflen-strlen(buf));
+	len += json_rtcm3_dump(&datap->rtcm3, datap->dev.path,
+			buf + len, buflen - len);
     }
 #endif /* RTCM104V3_ENABLE */
 
 #ifdef AIVDM_ENABLE
     if ((changed & AIS_SET) != 0) {
-	json_aivdm_dump(&datap->ais, datap->dev.path,
+	len += json_aivdm_dump(&datap->ais, datap->dev.path,
 			policy->scaled,
-			buf+strlen(buf), buflen-strlen(buf));
+			buf + len, buflen - len);
     }
 #endif /* AIVDM_ENABLE */
 
 #ifdef OSCILLATOR_ENABLE
     if ((changed & OSCILLATOR_SET) != 0) {
-	json_oscillator_dump(datap, buf+strlen(buf), buflen-strlen(buf));
+	len += json_oscillator_dump(datap, buf + len, buflen - len);
     }
 #endif /* OSCILLATOR_ENABLE */
+
+    return len;
 }
 
 #undef JSON_BOOL
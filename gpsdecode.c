@@ -8,6 +8,7 @@
 #include <string.h>
 #include <stdarg.h>
 #include <unistd.h>
+#include <time.h>
 
 #include "gpsd.h"
 #include "bits.h"
@@ -644,6 +645,58 @@ static void decode(FILE *fpin, FILE*fpout)
     }
 }
 
+static void benchmark(FILE *fpin, unsigned int passes)
+/* time repeated decodes of the input without dumping anything */
+{
+    static struct gps_device_t session;
+    FILE *tmp = tmpfile();
+    unsigned long packets = 0, ais = 0, bytes = 0;
+    struct timespec start, end;
+    double elapsed;
+    unsigned int pass;
+    int c;
+
+    if (tmp == NULL) {
+	(void)fputs("gpsdecode: can't create temporary file\n", stderr);
+	exit(EXIT_FAILURE);
+    }
+    /* the input may be a pipe, so it can't be rewound */
+    while ((c = fgetc(fpin)) != EOF)
+	(void)fputc(c, tmp);
+    (void)fflush(tmp);
+
+    gpsd_time_init(&context, time(NULL));
+    context.readonly = true;
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+    for (pass = 0; pass < passes; pass++) {
+	(void)lseek(fileno(tmp), 0, SEEK_SET);
+	gpsd_init(&session, &context, NULL);
+	gpsd_clear(&session);
+	session.gpsdata.gps_fd = fileno(tmp);
+	session.gpsdata.dev.baudrate = 38400;
+	for (;;) {
+	    gps_mask_t changed = gpsd_poll(&session);
+
+	    if (changed == ERROR_SET || changed == NODATA_IS)
+		break;
+	    if ((changed & PACKET_SET) != 0)
+		packets++;
+	    if ((changed & AIS_SET) != 0)
+		ais++;
+	}
+	bytes += (unsigned long)ftell(tmp);
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &end);
+    (void)fclose(tmp);
+
+    elapsed = (end.tv_sec - start.tv_sec)
+	+ (end.tv_nsec - start.tv_nsec) / 1e9;
+    (void)printf("%u passes: %lu packets, %lu AIS messages in %.3f s; "
+		 "%.0f packets/s, %.0f AIS/s, %.1f MB/s\n",
+		 passes, packets, ais, elapsed,
+		 packets / elapsed, ais / elapsed, bytes / elapsed / 1e6);
+}
+
 #ifdef SOCKET_EXPORT_ENABLE
 static void encode(FILE *fpin, FILE *fpout)
 /* JSON format on fpin to JSON on fpout - idempotency test */
@@ -691,12 +744,18 @@ static void encode(FILE *fpin, FILE *fpout)
 int main(int argc, char **argv)
 {
     int c;
-    enum { doencode, dodecode } mode = dodecode;
+    enum { doencode, dodecode, dobenchmark } mode = dodecode;
+    unsigned int passes = 0;
 
     gps_context_init(&context, "gpsdecode");
 
-    while ((c = getopt(argc, argv, "cdejmnpst:uvVD:")) != EOF) {
+    while ((c = getopt(argc, argv, "b:cdejmnpst:uvVD:")) != EOF) {
 	switch (c) {
+	case 'b':
+	    mode = dobenchmark;
+	    passes = (unsigned int)atoi(optarg);
+	    break;
+
 	case 'c':
 	    json = false;
 	    break;
@@ -764,7 +823,9 @@ int main(int argc, char **argv)
     //argc -= optind;
     //argv += optind;
 
-    if (mode == doencode) {
+    if (mode == dobenchmark)
+	benchmark(stdin, passes);
+    else if (mode == doencode) {
 #ifdef SOCKET_EXPORT_ENABLE
 	encode(stdin, stdout);
 #else
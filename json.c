@@ -24,7 +24,17 @@ default values to be used when an expected attribute is omitted.
 actually have a span of multiple specifications with different
 syntactically distinguishable types (e.g. string vs. real vs. integer
 vs. boolean, but not signed integer vs. unsigned integer).  The parser
-will match the right spec against the actual data.
+will match the right spec against the actual data.  The specs for one
+attribute must be adjacent in the template; a second, separate spec
+for a name may shadow the first.
+
+   A template's {NULL} terminator may carry a byname index: the
+positions of all its specs, sorted by attribute name with ties in
+template order, followed by the rank of each spec in that order.
+Names that aren't at the spec just past the previous match are then
+found by binary search.  jsongen.py emits these indexes for the
+templates it generates; templates without one are scanned linearly
+from just past the previous match.
 
    The dialect this parses has some limitations.  First, it cannot
 recognize the JSON "null" value.  Secondly, arrays may not have
@@ -68,6 +78,7 @@ PERMISSIONS
 #include <stdbool.h>
 #include <stdarg.h>
 #include <ctype.h>
+#include <limits.h>
 
 #include "os_compat.h"
 #ifdef SOCKET_EXPORT_ENABLE
@@ -105,7 +116,9 @@ static void json_trace(int errlevel, const char *fmt, ...)
     }
 }
 
-# define json_debug_trace(args) (void) json_trace args
+/* test the level here, so the per-character traces cost one compare */
+# define json_debug_trace(args) \
+	do { if (debuglevel > 0) json_trace args; } while (0)
 #else
 # define json_debug_trace(args) do { } while (0)
 #endif /* CLIENTDEBUG_ENABLE */
@@ -161,6 +174,150 @@ static char *json_target_address(const struct json_attr_t *cursor,
 }
 
 
+static int json_default(const struct json_attr_t *cursor,
+			const struct json_array_t *parent, int offset)
+/* stuff a field with its default in case it's omitted in the JSON input */
+{
+    char *lptr;
+
+    if (cursor->nodefault)
+	return 0;
+    lptr = json_target_address(cursor, parent, offset);
+    if (lptr != NULL)
+	switch (cursor->type) {
+	case t_integer:
+	    memcpy(lptr, &cursor->dflt.integer, sizeof(int));
+	    break;
+	case t_uinteger:
+	    memcpy(lptr, &cursor->dflt.uinteger, sizeof(unsigned int));
+	    break;
+	case t_short:
+	    memcpy(lptr, &cursor->dflt.shortint, sizeof(short));
+	    break;
+	case t_ushort:
+	    memcpy(lptr, &cursor->dflt.ushortint,
+		   sizeof(unsigned short));
+	    break;
+	case t_time:
+	case t_real:
+	    memcpy(lptr, &cursor->dflt.real, sizeof(double));
+	    break;
+	case t_string:
+	    if (parent != NULL
+		&& parent->element_type != t_structobject
+		&& offset > 0)
+		return JSON_ERR_NOPARSTR;
+	    lptr[0] = '\0';
+	    break;
+	case t_boolean:
+	    memcpy(lptr, &cursor->dflt.boolean, sizeof(bool));
+	    break;
+	case t_character:
+	    lptr[0] = cursor->dflt.character;
+	    break;
+	case t_object:	/* silences a compiler warning */
+	case t_structobject:
+	case t_array:
+	case t_check:
+	case t_ignore:
+	    break;
+	}
+    return 0;
+}
+
+static const struct json_attr_t *json_find_attr(const struct json_attr_t *attrs,
+						const struct json_attr_t *hint,
+						const unsigned char *byname,
+						int nattrs,
+						const char *name)
+/* find the first spec for an attribute name */
+{
+    const struct json_attr_t *cursor;
+
+    if (byname != NULL) {
+	int lo = 0, hi = nattrs;
+
+	/*
+	 * Try the hint first.  The second half of the index holds each
+	 * spec's rank in the first half; a hit is the first spec of its
+	 * name unless the one sorted just before it has the same name.
+	 */
+	if (hint->attribute != NULL && strcmp(hint->attribute, name) == 0) {
+	    int rank = byname[nattrs + (hint - attrs)];
+
+	    if (rank == 0
+		|| strcmp(attrs[byname[rank - 1]].attribute, name) != 0)
+		return hint;
+	}
+	/* the leftmost match in the index is the first spec of the name */
+	while (lo < hi) {
+	    int mid = (lo + hi) / 2;
+
+	    if (strcmp(attrs[byname[mid]].attribute, name) < 0)
+		lo = mid + 1;
+	    else
+		hi = mid;
+	}
+	if (lo < nattrs && strcmp(attrs[byname[lo]].attribute, name) == 0)
+	    return attrs + byname[lo];
+	return NULL;
+    }
+
+    /*
+     * Emitters generally ship attributes in template order, so start
+     * looking just past the previous match and wrap around; in the
+     * usual case the first comparison hits.
+     */
+    for (cursor = hint; cursor->attribute != NULL; cursor++)
+	if (cursor->attribute[0] == name[0]
+	    && strcmp(cursor->attribute, name) == 0)
+	    goto found;
+    for (cursor = attrs; cursor < hint; cursor++)
+	if (cursor->attribute[0] == name[0]
+	    && strcmp(cursor->attribute, name) == 0)
+	    goto found;
+    return NULL;
+  found:
+    /*
+     * A span of specs for one name must be entered at its start.
+     * Specs for one name must form a single span, or the hint can
+     * pick a later one.
+     */
+    while (cursor > attrs && strcmp(cursor[-1].attribute, name) == 0)
+	--cursor;
+    return cursor;
+}
+
+/* attributes per template whose defaults can be deferred until after parse */
+#define JSON_ATTRS_DEFERRED	128
+#define JSON_SEEN(seen, n)	(((seen)[(n) / CHAR_BIT] & (1 << ((n) % CHAR_BIT))) != 0)
+
+static size_t json_target_size(const struct json_attr_t *cursor)
+/* how many bytes a spec stores at its target address */
+{
+    switch (cursor->type) {
+    case t_integer:
+	return sizeof(int);
+    case t_uinteger:
+	return sizeof(unsigned int);
+    case t_short:
+	return sizeof(short);
+    case t_ushort:
+	return sizeof(unsigned short);
+    case t_time:
+    case t_real:
+	return sizeof(double);
+    case t_string:
+	return cursor->len;
+    case t_boolean:
+	return sizeof(bool);
+    case t_character:
+	return sizeof(char);
+    default:
+	return 0;
+    }
+}
+
 static int json_internal_read_object(const char *cp,
 				     const struct json_attr_t *attrs,
 				     const struct json_array_t *parent,
@@ -181,59 +338,38 @@ static int json_internal_read_object(const char *cp,
     char valbuf[JSON_VAL_MAX + 1], *pval = NULL;
     bool value_quoted = false;
     char uescape[5];		/* enough space for 4 hex digits and a NUL */
-    const struct json_attr_t *cursor;
-    int substatus, n, maxlen = 0;
+    const struct json_attr_t *cursor, *hint = attrs;
+    const unsigned char *byname;
+    int substatus, n, nattrs, maxlen = 0;
     unsigned int u;
     const struct json_enum_t *mp;
     char *lptr;
+    /* which of the first JSON_ATTRS_DEFERRED specs got a value */
+    unsigned char seen[JSON_ATTRS_DEFERRED / CHAR_BIT];
+    /* where parsed values went, so deferred defaults can't clobber them */
+    struct {
+	char *lo, *hi;
+    } stored[JSON_ATTRS_DEFERRED];
+    int nstored = 0;
 
     if (end != NULL)
 	*end = NULL;		/* give it a well-defined value on parse failure */
 
-    /* stuff fields with defaults in case they're omitted in the JSON input */
-    for (cursor = attrs; cursor->attribute != NULL; cursor++)
-	if (!cursor->nodefault) {
-	    lptr = json_target_address(cursor, parent, offset);
-	    if (lptr != NULL)
-		switch (cursor->type) {
-		case t_integer:
-		    memcpy(lptr, &cursor->dflt.integer, sizeof(int));
-		    break;
-		case t_uinteger:
-		    memcpy(lptr, &cursor->dflt.uinteger, sizeof(unsigned int));
-		    break;
-		case t_short:
-		    memcpy(lptr, &cursor->dflt.shortint, sizeof(short));
-		    break;
-		case t_ushort:
-		    memcpy(lptr, &cursor->dflt.ushortint,
-		           sizeof(unsigned short));
-		    break;
-		case t_time:
-		case t_real:
-		    memcpy(lptr, &cursor->dflt.real, sizeof(double));
-		    break;
-		case t_string:
-		    if (parent != NULL
-			&& parent->element_type != t_structobject
-			&& offset > 0)
-			return JSON_ERR_NOPARSTR;
-		    lptr[0] = '\0';
-		    break;
-		case t_boolean:
-		    memcpy(lptr, &cursor->dflt.boolean, sizeof(bool));
-		    break;
-		case t_character:
-		    lptr[0] = cursor->dflt.character;
-		    break;
-		case t_object:	/* silences a compiler warning */
-		case t_structobject:
-		case t_array:
-		case t_check:
-		case t_ignore:
-		    break;
-		}
-	}
+    /*
+     * Defaults are written after the parse, and only for fields the
+     * input didn't set.  Specs past the end of the seen map are
+     * defaulted up front the old way.
+     */
+    memset(seen, '\0', sizeof(seen));
+    for (cursor = attrs;
+	 cursor->attribute != NULL && cursor < attrs + JSON_ATTRS_DEFERRED;
+	 cursor++)
+	continue;
+    for (; cursor->attribute != NULL; cursor++)
+	if ((substatus = json_default(cursor, parent, offset)) != 0)
+	    return substatus;
+    byname = cursor->byname;
+    nattrs = (int)(cursor - attrs);
 
     json_debug_trace((1, "JSON parse of '%s' begins.\n", cp));
 
@@ -286,19 +422,15 @@ static int json_internal_read_object(const char *cp,
 		*pattr++ = '\0';
 		json_debug_trace((1, "Collected attribute name %s\n",
 				  attrbuf));
-		for (cursor = attrs; cursor->attribute != NULL; cursor++) {
-		    json_debug_trace((2, "Checking against %s\n",
-				      cursor->attribute));
-		    if (strcmp(cursor->attribute, attrbuf) == 0)
-			break;
-		}
-		if (cursor->attribute == NULL) {
+		cursor = json_find_attr(attrs, hint, byname, nattrs, attrbuf);
+		if (cursor == NULL) {
 		    json_debug_trace((1,
 				      "Unknown attribute name '%s' (attributes begin with '%s').\n",
 				      attrbuf, attrs->attribute));
 		    /* don't update end here, leave at attribute start */
 		    return JSON_ERR_BADATTR;
 		}
+		hint = cursor + 1;
 		state = await_value;
 		if (cursor->type == t_string)
 		    maxlen = (int)cursor->len - 1;
@@ -477,6 +609,15 @@ static int json_internal_read_object(const char *cp,
 		(void)snprintf(valbuf, sizeof(valbuf), "%d", mp->value);
 	    }
 	    lptr = json_target_address(cursor, parent, offset);
+	    if (cursor < attrs + JSON_ATTRS_DEFERRED) {
+		seen[(cursor - attrs) / CHAR_BIT] |=
+		    1 << ((cursor - attrs) % CHAR_BIT);
+		if (lptr != NULL && nstored < JSON_ATTRS_DEFERRED) {
+		    stored[nstored].lo = lptr;
+		    stored[nstored].hi = lptr + json_target_size(cursor);
+		    nstored++;
+		}
+	    }
 	    if (lptr != NULL)
 		switch (cursor->type) {
 		case t_integer:
@@ -571,6 +712,27 @@ static int json_internal_read_object(const char *cp,
     }
 
   good_parse:
+    /*
+     * Now default whatever the input left out.  Specs may alias one
+     * another's storage (several specs for one name, or members of a
+     * C union), so skip any default that would land on a parsed value.
+     */
+    for (n = 0; attrs[n].attribute != NULL && n < JSON_ATTRS_DEFERRED; n++)
+	if (!JSON_SEEN(seen, n) && !attrs[n].nodefault) {
+	    int k;
+
+	    lptr = json_target_address(&attrs[n], parent, offset);
+	    if (lptr != NULL)
+		for (k = 0; k < nstored; k++)
+		    if (lptr < stored[k].hi
+			&& lptr + json_target_size(&attrs[n]) > stored[k].lo)
+			break;
+	    if (lptr != NULL && k < nstored)
+		continue;
+	    if ((substatus = json_default(&attrs[n], parent, offset)) != 0)
+		return substatus;
+	}
+
     /* in case there's another object following, consume trailing WS */
     while (isspace((unsigned char) *cp))
 	++cp;
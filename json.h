@@ -83,6 +83,7 @@ struct json_attr_t {
     size_t len;
     const struct json_enum_t *map;
     bool nodefault;
+    const unsigned char *byname;	/* terminator only: specs sorted by name */
 };
 
 #define JSON_ATTR_MAX	31	/* max chars in JSON attribute name */
@@ -932,6 +932,38 @@ ais_specs = (
 # You should not need to modify anything below this line.
 
 
+# Attribute names the header macros in ais_json.c expand to, in
+# template order.  These must be kept in step with the macros.
+header_attributes = {
+    "AIS_HEADER": ("class", "type", "device", "repeat", "scaled", "mmsi"),
+    "AIS_TYPE6": ("seqno", "dest_mmsi", "retransmit", "dac", "fid"),
+    "AIS_TYPE8": ("dac", "fid"),
+}
+
+
+def byname_index(initname, attributes):
+    "Declare the sorted-by-name index json.c looks attributes up with."
+    if len(attributes) > 255:
+        sys.stderr.write("%s has too many attributes to index\n" % initname)
+        raise SystemExit(1)
+    # Ties stay in template order, so a lookup lands on the first spec.
+    # The rank of each spec in that order follows, so json.c can tell
+    # whether the spec it hit is the first one of its name.
+    order = sorted(range(len(attributes)), key=lambda i: (attributes[i], i))
+    rank = [0] * len(order)
+    for (n, i) in enumerate(order):
+        rank[i] = n
+    report = "    static const unsigned char %s_byname[] = {" % initname
+    for (n, i) in enumerate(order + rank):
+        if n % 12 == 0:
+            report += "\n\t"
+        else:
+            report += " "
+        report += "%d," % i
+    report += "\n    };\n"
+    return report
+
+
 def generate(spec):
     report = ""
     leader = " " * 39
@@ -956,6 +988,8 @@ def generate(spec):
     for (attr, itype, arrayparts) in spec["fieldmap"]:
         if itype == 'array':
             (innerstruct, lengthfield, elements) = arrayparts
+            report += byname_index("%s_%s_subtype" % (initname, attr),
+                                   [t[0] for t in elements])
             report += ("    const struct json_attr_t %s_%s_subtype[] = {\n"
                        % (initname, attr))
             for (subattr, subitype, default) in elements:
@@ -971,12 +1005,18 @@ def generate(spec):
                     sys.stderr.write(
                         "explicit length specification required\n")
                     raise SystemExit(1)
-            report += """\
-        {NULL}
+            report += ("""\
+        {NULL, .byname = %s_%s_subtype_byname}
     };
-"""
+""" % (initname, attr))
     # Generate the main structure definition describing this parse.
     # It may have object subarrays.
+    names = []
+    for header in spec.get("headers", ()):
+        names += header_attributes[header]
+    for (attr, itype, default) in spec["fieldmap"]:
+        names.append(attr[attr.rfind(".") + 1:])
+    report += byname_index(initname, names)
     report += "    const struct json_attr_t %s[] = {\n" % initname
     if "headers" in spec:
         for header in spec["headers"]:
@@ -1010,9 +1050,9 @@ def generate(spec):
             else:
                 report += leader + ".dflt.%s = %s},\n" % (itype, default)
     report += """\
-        {NULL}
+        {NULL, .byname = %s_byname}
     };
-"""
+""" % initname
     print(report)
 
 if __name__ == '__main__':
@@ -22,6 +22,8 @@ extern int gps_sock_open(const char *, const char *,
 extern int gps_sock_close(struct gps_data_t *);
 extern int gps_sock_send(struct gps_data_t *, const char *);
 extern int gps_sock_read(struct gps_data_t *);
+extern int gps_sock_read_batch(struct gps_data_t *,
+			       void (*)(struct gps_data_t *));
 extern bool gps_sock_waiting(const struct gps_data_t *, int);
 extern int gps_sock_stream(struct gps_data_t *, unsigned int, void *);
 extern const char *gps_sock_data(const struct gps_data_t *);
@@ -33,6 +35,8 @@ extern bool gps_shm_waiting(const struct gps_data_t *, int);
 extern int gps_shm_read(struct gps_data_t *);
 extern int gps_shm_mainloop(struct gps_data_t *, int,
 			      void (*)(struct gps_data_t *));
+extern void gps_shm_copy(struct gps_data_t *, const struct gps_data_t *,
+			 gps_mask_t);
 
 extern int gps_dbus_open(struct gps_data_t *);
 extern int gps_dbus_mainloop(struct gps_data_t *, int,
@@ -40,6 +44,7 @@ extern int gps_dbus_mainloop(struct gps_data_t *, int,
 
 extern int json_ais_read(const char *, char *, size_t, struct ais_t *,
 			 const char **);
+extern int gps_unpack_binary(const char *, size_t, struct gps_data_t *);
 
 /* debugging apparatus for the client library */
 #ifdef CLIENTDEBUG_ENABLE
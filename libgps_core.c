@@ -171,6 +171,39 @@ int gps_read(struct gps_data_t *gpsdata CONDITIONALLY_UNUSED)
     return status;
 }
 
+int gps_read_batch(struct gps_data_t *gpsdata CONDITIONALLY_UNUSED,
+		   void (*hook)(struct gps_data_t *gpsdata) CONDITIONALLY_UNUSED)
+/* read once, then hand every complete message buffered to hook */
+{
+    int status = -1;
+
+    libgps_debug_trace((DEBUG_CALLS, "gps_read_batch() begins\n"));
+
+#ifdef SHM_EXPORT_ENABLE
+    if (BAD_SOCKET((intptr_t)(gpsdata->gps_fd))) {
+	int got;
+
+	status = 0;
+	while ((got = gps_shm_read(gpsdata)) > 0) {
+	    (*hook)(gpsdata);
+	    status++;
+	}
+	if (got == -1 && status == 0)
+	    status = -1;
+    }
+#endif /* SHM_EXPORT_ENABLE */
+
+#ifdef SOCKET_EXPORT_ENABLE
+    if (status == -1 && !BAD_SOCKET((intptr_t)(gpsdata->gps_fd))) {
+        status = gps_sock_read_batch(gpsdata, hook);
+    }
+#endif /* SOCKET_EXPORT_ENABLE */
+
+    libgps_debug_trace((DEBUG_CALLS, "gps_read_batch() -> %d\n", status));
+
+    return status;
+}
+
 int gps_send(struct gps_data_t *gpsdata CONDITIONALLY_UNUSED, const char *fmt CONDITIONALLY_UNUSED, ...)
 /* send a command to the gpsd instance */
 {
@@ -431,155 +431,215 @@ int json_oscillator_read(const char *buf, struct gps_data_t *gpsdata,
     return status;
 }
 
+gps_mask_t libgps_tpv_mask(const struct gps_fix_t *fix)
+/* which parts of a fix a TPV report carried */
+{
+    gps_mask_t mask = 0;
+
+    if (isnan(fix->time) == 0)
+	mask |= TIME_SET;
+    if (isnan(fix->ept) == 0)
+	mask |= TIMERR_SET;
+    if (isnan(fix->longitude) == 0)
+	mask |= LATLON_SET;
+    if (isnan(fix->altitude) == 0)
+	mask |= ALTITUDE_SET;
+    if (isnan(fix->epx) == 0 && isnan(fix->epy) == 0)
+	mask |= HERR_SET;
+    if (isnan(fix->epv) == 0)
+	mask |= VERR_SET;
+    if (isnan(fix->track) == 0)
+	mask |= TRACK_SET;
+    if (isnan(fix->speed) == 0)
+	mask |= SPEED_SET;
+    if (isnan(fix->climb) == 0)
+	mask |= CLIMB_SET;
+    if (isnan(fix->epd) == 0)
+	mask |= TRACKERR_SET;
+    if (isnan(fix->eps) == 0)
+	mask |= SPEEDERR_SET;
+    if (isnan(fix->epc) == 0)
+	mask |= CLIMBERR_SET;
+    if (fix->mode != MODE_NOT_SEEN)
+	mask |= MODE_SET;
+    return mask;
+}
+
 int libgps_json_unpack(const char *buf,
 		       struct gps_data_t *gpsdata, const char **end)
 /* the only entry point - unpack a JSON object into gpsdata_t substructures */
 {
     int status;
-    char *classtag = strstr(buf, "\"class\":");
-
-    if (classtag == NULL)
+    const char *classtag;
+    size_t taglen;
+
+    /*
+     * The daemon always ships the class first, so look there before
+     * searching the whole response, then switch on the tag itself.
+     */
+    if (str_starts_with(buf, "{\"class\":\""))
+	classtag = buf + 10;
+    else if ((classtag = strstr(buf, "\"class\":\"")) != NULL)
+	classtag += 9;
+    else
 	return -1;
-    if (str_starts_with(classtag, "\"class\":\"TPV\"")) {
-	status = json_tpv_read(buf, gpsdata, end);
-	gpsdata->set = STATUS_SET;
-	if (isnan(gpsdata->fix.time) == 0)
-	    gpsdata->set |= TIME_SET;
-	if (isnan(gpsdata->fix.ept) == 0)
-	    gpsdata->set |= TIMERR_SET;
-	if (isnan(gpsdata->fix.longitude) == 0)
-	    gpsdata->set |= LATLON_SET;
-	if (isnan(gpsdata->fix.altitude) == 0)
-	    gpsdata->set |= ALTITUDE_SET;
-	if (isnan(gpsdata->fix.epx) == 0 && isnan(gpsdata->fix.epy) == 0)
-	    gpsdata->set |= HERR_SET;
-	if (isnan(gpsdata->fix.epv) == 0)
-	    gpsdata->set |= VERR_SET;
-	if (isnan(gpsdata->fix.track) == 0)
-	    gpsdata->set |= TRACK_SET;
-	if (isnan(gpsdata->fix.speed) == 0)
-	    gpsdata->set |= SPEED_SET;
-	if (isnan(gpsdata->fix.climb) == 0)
-	    gpsdata->set |= CLIMB_SET;
-	if (isnan(gpsdata->fix.epd) == 0)
-	    gpsdata->set |= TRACKERR_SET;
-	if (isnan(gpsdata->fix.eps) == 0)
-	    gpsdata->set |= SPEEDERR_SET;
-	if (isnan(gpsdata->fix.epc) == 0)
-	    gpsdata->set |= CLIMBERR_SET;
-	if (isnan(gpsdata->fix.epc) == 0)
-	    gpsdata->set |= CLIMBERR_SET;
-	if (gpsdata->fix.mode != MODE_NOT_SEEN)
-	    gpsdata->set |= MODE_SET;
-	return status;
-    } else if (str_starts_with(classtag, "\"class\":\"GST\"")) {
-	status = json_noise_read(buf, gpsdata, end);
-	if (status == 0) {
-	    gpsdata->set &= ~UNION_SET;
-	    gpsdata->set |= GST_SET;
+    for (taglen = 0; classtag[taglen] != '"'; taglen++)
+	if (classtag[taglen] == '\0')
+	    return -1;
+#define CLASS_IS(name)	(taglen == sizeof(name) - 1 \
+			 && memcmp(classtag, name, taglen) == 0)
+
+    switch (classtag[0]) {
+    case 'A':
+	if (CLASS_IS("ATT")) {
+	    status = json_att_read(buf, gpsdata, end);
+	    if (status == 0) {
+		gpsdata->set &= ~UNION_SET;
+		gpsdata->set |= ATTITUDE_SET;
+	    }
+	    return status;
 	}
-	return status;
-    } else if (str_starts_with(classtag, "\"class\":\"SKY\"")) {
-	status = json_sky_read(buf, gpsdata, end);
-	if (status == 0)
-	    gpsdata->set |= SATELLITE_SET;
-	return status;
-    } else if (str_starts_with(classtag, "\"class\":\"ATT\"")) {
-	status = json_att_read(buf, gpsdata, end);
-	if (status == 0) {
-	    gpsdata->set &= ~UNION_SET;
-	    gpsdata->set |= ATTITUDE_SET;
+#ifdef AIVDM_ENABLE
+	if (CLASS_IS("AIS")) {
+	    status = json_ais_read(buf,
+				   gpsdata->dev.path, sizeof(gpsdata->dev.path),
+				   &gpsdata->ais, end);
+	    if (status == 0) {
+		gpsdata->set &= ~UNION_SET;
+		gpsdata->set |= AIS_SET;
+	    }
+	    return status;
 	}
-	return status;
-    } else if (str_starts_with(classtag, "\"class\":\"DEVICES\"")) {
-	status = json_devicelist_read(buf, gpsdata, end);
-	if (status == 0) {
-	    gpsdata->set &= ~UNION_SET;
-	    gpsdata->set |= DEVICELIST_SET;
+#endif /* AIVDM_ENABLE */
+	break;
+    case 'D':
+	if (CLASS_IS("DEVICES")) {
+	    status = json_devicelist_read(buf, gpsdata, end);
+	    if (status == 0) {
+		gpsdata->set &= ~UNION_SET;
+		gpsdata->set |= DEVICELIST_SET;
+	    }
+	    return status;
 	}
-	return status;
-    } else if (str_starts_with(classtag, "\"class\":\"DEVICE\"")) {
-	status = json_device_read(buf, &gpsdata->dev, end);
-	if (status == 0)
-	    gpsdata->set |= DEVICE_SET;
-	return status;
-    } else if (str_starts_with(classtag, "\"class\":\"WATCH\"")) {
-	status = json_watch_read(buf, &gpsdata->policy, end);
-	if (status == 0) {
-	    gpsdata->set &= ~UNION_SET;
-	    gpsdata->set |= POLICY_SET;
+	if (CLASS_IS("DEVICE")) {
+	    status = json_device_read(buf, &gpsdata->dev, end);
+	    if (status == 0)
+		gpsdata->set |= DEVICE_SET;
+	    return status;
 	}
-	return status;
-    } else if (str_starts_with(classtag, "\"class\":\"VERSION\"")) {
-	status = json_version_read(buf, gpsdata, end);
-	if (status ==  0) {
-	    gpsdata->set &= ~UNION_SET;
-	    gpsdata->set |= VERSION_SET;
+	break;
+    case 'E':
+	if (CLASS_IS("ERROR")) {
+	    status = json_error_read(buf, gpsdata, end);
+	    if (status == 0) {
+		gpsdata->set &= ~UNION_SET;
+		gpsdata->set |= ERROR_SET;
+	    }
+	    return status;
 	}
-	return status;
+	break;
+    case 'G':
+	if (CLASS_IS("GST")) {
+	    status = json_noise_read(buf, gpsdata, end);
+	    if (status == 0) {
+		gpsdata->set &= ~UNION_SET;
+		gpsdata->set |= GST_SET;
+	    }
+	    return status;
+	}
+	break;
+    case 'O':
+	if (CLASS_IS("OSC")) {
+	    status = json_oscillator_read(buf, gpsdata, end);
+	    if (status == 0) {
+		gpsdata->set &= ~UNION_SET;
+		gpsdata->set |= OSCILLATOR_SET;
+	    }
+	    return status;
+	}
+	break;
+    case 'P':
+	if (CLASS_IS("PPS")) {
+	    status = json_pps_read(buf, gpsdata, end);
+	    if (status == 0) {
+		gpsdata->set &= ~UNION_SET;
+		gpsdata->set |= PPS_SET;
+	    }
+	    return status;
+	}
+	break;
+    case 'R':
 #ifdef RTCM104V2_ENABLE
-    } else if (str_starts_with(classtag, "\"class\":\"RTCM2\"")) {
-	status = json_rtcm2_read(buf,
-				 gpsdata->dev.path, sizeof(gpsdata->dev.path),
-				 &gpsdata->rtcm2, end);
-	if (status == 0) {
-	    gpsdata->set &= ~UNION_SET;
-	    gpsdata->set |= RTCM2_SET;
+	if (CLASS_IS("RTCM2")) {
+	    status = json_rtcm2_read(buf,
+				     gpsdata->dev.path, sizeof(gpsdata->dev.path),
+				     &gpsdata->rtcm2, end);
+	    if (status == 0) {
+		gpsdata->set &= ~UNION_SET;
+		gpsdata->set |= RTCM2_SET;
+	    }
+	    return status;
 	}
-	return status;
 #endif /* RTCM104V2_ENABLE */
 #ifdef RTCM104V3_ENABLE
-    } else if (str_starts_with(classtag, "\"class\":\"RTCM3\"")) {
-	status = json_rtcm3_read(buf,
-				 gpsdata->dev.path, sizeof(gpsdata->dev.path),
-				 &gpsdata->rtcm3, end);
-	if (status == 0) {
-	    gpsdata->set &= ~UNION_SET;
-	    gpsdata->set |= RTCM3_SET;
+	if (CLASS_IS("RTCM3")) {
+	    status = json_rtcm3_read(buf,
+				     gpsdata->dev.path, sizeof(gpsdata->dev.path),
+				     &gpsdata->rtcm3, end);
+	    if (status == 0) {
+		gpsdata->set &= ~UNION_SET;
+		gpsdata->set |= RTCM3_SET;
+	    }
+	    return status;
 	}
-	return status;
 #endif /* RTCM104V3_ENABLE */
-#ifdef AIVDM_ENABLE
-    } else if (str_starts_with(classtag, "\"class\":\"AIS\"")) {
-	status = json_ais_read(buf,
-			       gpsdata->dev.path, sizeof(gpsdata->dev.path),
-			       &gpsdata->ais, end);
-	if (status == 0) {
-	    gpsdata->set &= ~UNION_SET;
-	    gpsdata->set |= AIS_SET;
+	break;
+    case 'S':
+	if (CLASS_IS("SKY")) {
+	    status = json_sky_read(buf, gpsdata, end);
+	    if (status == 0)
+		gpsdata->set |= SATELLITE_SET;
+	    return status;
 	}
-	return status;
-#endif /* AIVDM_ENABLE */
-    } else if (str_starts_with(classtag, "\"class\":\"ERROR\"")) {
-	status = json_error_read(buf, gpsdata, end);
-	if (status == 0) {
-	    gpsdata->set &= ~UNION_SET;
-	    gpsdata->set |= ERROR_SET;
+	break;
+    case 'T':
+	if (CLASS_IS("TPV")) {
+	    status = json_tpv_read(buf, gpsdata, end);
+	    gpsdata->set = STATUS_SET | libgps_tpv_mask(&gpsdata->fix);
+	    return status;
 	}
-	return status;
-    } else if (str_starts_with(classtag, "\"class\":\"TOFF\"")) {
-	status = json_pps_read(buf, gpsdata, end);
-	if (status == 0) {
-	    gpsdata->set &= ~UNION_SET;
-	    gpsdata->set |= TOFF_SET;
+	if (CLASS_IS("TOFF")) {
+	    status = json_pps_read(buf, gpsdata, end);
+	    if (status == 0) {
+		gpsdata->set &= ~UNION_SET;
+		gpsdata->set |= TOFF_SET;
+	    }
+	    return status;
 	}
-	return status;
-    } else if (str_starts_with(classtag, "\"class\":\"PPS\"")) {
-	status = json_pps_read(buf, gpsdata, end);
-	if (status == 0) {
-	    gpsdata->set &= ~UNION_SET;
-	    gpsdata->set |= PPS_SET;
+	break;
+    case 'V':
+	if (CLASS_IS("VERSION")) {
+	    status = json_version_read(buf, gpsdata, end);
+	    if (status ==  0) {
+		gpsdata->set &= ~UNION_SET;
+		gpsdata->set |= VERSION_SET;
+	    }
+	    return status;
 	}
-	return status;
-    } else if (str_starts_with(classtag, "\"class\":\"OSC\"")) {
-	status = json_oscillator_read(buf, gpsdata, end);
-	if (status == 0) {
-	    gpsdata->set &= ~UNION_SET;
-	    gpsdata->set |= OSCILLATOR_SET;
+	break;
+    case 'W':
+	if (CLASS_IS("WATCH")) {
+	    status = json_watch_read(buf, &gpsdata->policy, end);
+	    if (status == 0) {
+		gpsdata->set &= ~UNION_SET;
+		gpsdata->set |= POLICY_SET;
+	    }
+	    return status;
 	}
-	return status;
-    } else
-	return -1;
+	break;
+    }
+#undef CLASS_IS
+    return -1;
 }
 
 
@@ -9,6 +9,15 @@ won't be able to filter by device, and won't get device activation/deactivation
 notifications.  But both client and daemon will avoid all the marshalling and
 unmarshalling overhead.
 
+   Updates are read from per-device rings in the order the daemon wrote
+them (see shmexport.c).  Only the sections of gps_data_t named in an
+update's mask are copied into the client's structure, so state from
+earlier updates accumulates the same way it does over the socket.
+The first read after opening folds in every update still in the rings,
+so it returns the daemon's current state as it always has.
+On Linux a reader waiting for data sleeps on the futex word the daemon
+bumps after each update, instead of polling the segment.
+
 PERMISSIONS
    This file is Copyright (c) 2010 by the GPSD project
    BSD terms apply: see the file COPYING in the distribution root for details.
@@ -17,6 +26,8 @@ PERMISSIONS
 
 /* sys/ipc.h needs _XOPEN_SOURCE, 500 means X/Open 1995 */
 #define _XOPEN_SOURCE 500
+/* syscall() needs _DEFAULT_SOURCE */
+#define _DEFAULT_SOURCE
 
 #include "gpsd_config.h"
 
@@ -29,6 +40,12 @@ PERMISSIONS
 #include <sys/time.h>
 #include <sys/ipc.h>
 #include <sys/shm.h>
+#ifdef HAVE_LINUX_FUTEX_H
+#include <limits.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif /* HAVE_LINUX_FUTEX_H */
 
 #include "gpsd.h"
 #include "libgps.h"
@@ -36,9 +53,59 @@ PERMISSIONS
 struct privdata_t
 {
     void *shmseg;
-    int tick;
+    unsigned long tick;		/* number of the last update read */
 };
 
+/* how many times to retry a slot that is being rewritten under us */
+#define SHM_READ_RETRIES	16
+
+static size_t shm_union_size(gps_mask_t set)
+/* how much of the tail union an update with this mask uses */
+{
+    size_t size = 0;
+
+#define UNION_MEMBER(mask, member) \
+    if ((set & (mask)) != 0 && sizeof(((struct gps_data_t *)0)->member) > size) \
+	size = sizeof(((struct gps_data_t *)0)->member)
+    UNION_MEMBER(RTCM2_SET, rtcm2);
+    UNION_MEMBER(RTCM3_SET, rtcm3);
+    UNION_MEMBER(SUBFRAME_SET, subframe);
+    UNION_MEMBER(AIS_SET, ais);
+    UNION_MEMBER(ATTITUDE_SET, attitude);
+    UNION_MEMBER(NAVDATA_SET, navdata);
+    UNION_MEMBER(RAW_IS, raw);
+    UNION_MEMBER(GST_SET, gst);
+    UNION_MEMBER(OSCILLATOR_SET, osc);
+    UNION_MEMBER(VERSION_SET, version);
+    UNION_MEMBER(LOGMESSAGE_SET|ERROR_SET, error);
+    UNION_MEMBER(TOFF_SET, toff);
+    UNION_MEMBER(PPS_SET, pps);
+#undef UNION_MEMBER
+    return size;
+}
+
+void gps_shm_copy(struct gps_data_t *to, const struct gps_data_t *from,
+		  gps_mask_t set)
+/* copy the sections of an update named by its mask */
+{
+    /* mask, fix, status, DOPs: always */
+    (void)memcpy((void *)to, (const void *)from,
+		 offsetof(struct gps_data_t, skyview_time));
+    if ((set & SATELLITE_SET) != 0)
+	(void)memcpy((void *)&to->skyview_time, (const void *)&from->skyview_time,
+		     offsetof(struct gps_data_t, dev)
+		     - offsetof(struct gps_data_t, skyview_time));
+    /* which device shipped it: always */
+    to->dev = from->dev;
+    if ((set & POLICY_SET) != 0)
+	to->policy = from->policy;
+    if ((set & DEVICELIST_SET) != 0)
+	to->devices = from->devices;
+    /* only the union member in use, and not the rest of a big union */
+    (void)memcpy((void *)&to->rtcm2, (const void *)&from->rtcm2,
+		 shm_union_size(set));
+}
+
 
 int gps_shm_open(struct gps_data_t *gpsdata)
 /* open a shared-memory connection to the daemon */
@@ -50,7 +117,7 @@ int gps_shm_open(struct gps_data_t *gpsdata)
     libgps_debug_trace((DEBUG_CALLS, "gps_shm_open()\n"));
 
     gpsdata->privdata = NULL;
-    shmid = shmget((key_t)shmkey, sizeof(struct gps_data_t), 0);
+    shmid = shmget((key_t)shmkey, sizeof(struct shmexport_t), 0);
     if (shmid == -1) {
 	/* daemon isn't running or failed to create shared segment */
 	return -1;
@@ -66,6 +133,17 @@ int gps_shm_open(struct gps_data_t *gpsdata)
 	gpsdata->privdata = NULL;
 	return -2;
     }
+    if (((struct shmexport_t *)PRIVATE(gpsdata)->shmseg)->version
+	!= SHM_EXPORT_VERSION) {
+	/* segment from a daemon with a different layout */
+	libgps_debug_trace((DEBUG_CALLS, "SHM export version mismatch\n"));
+	(void)shmdt((const void *)PRIVATE(gpsdata)->shmseg);
+	free(gpsdata->privdata);
+	gpsdata->privdata = NULL;
+	return -1;
+    }
+    /* nothing read yet, so the first read catches up on everything */
+    PRIVATE(gpsdata)->tick = 0;
 #ifndef USE_QT
     gpsdata->gps_fd = SHM_PSEUDO_FD;
 #else
@@ -82,67 +160,118 @@ bool gps_shm_waiting(const struct gps_data_t *gpsdata, int timeout)
     volatile bool newdata = false;
     timestamp_t endtime = timestamp() + (((double)timeout)/1000000);
 
-    /* busy-waiting sucks, but there's not really an alternative */
+#ifdef HAVE_LINUX_FUTEX_H
     for (;;) {
-	volatile int bookend1, bookend2;
+	unsigned int wakeup;
+	timestamp_t remaining;
+	struct timespec ts;
+
+	/*
+	 * Announce ourselves before sampling the wakeup word, so that
+	 * shm_update() either sees a waiter and wakes us or bumps the
+	 * word before we sample it; FUTEX_WAIT then returns at once.
+	 */
+	(void)__sync_fetch_and_add(&shared->waiters, 1);
 	memory_barrier();
-	bookend1 = shared->bookend1;
+	wakeup = shared->wakeup;
 	memory_barrier();
-	bookend2 = shared->bookend2;
+	if (shared->sequence > PRIVATE(gpsdata)->tick)
+	    newdata = true;
+	else if ((remaining = endtime - timestamp()) > 0) {
+	    ts.tv_sec = (time_t)remaining;
+	    ts.tv_nsec = (long)((remaining - ts.tv_sec) * 1e9);
+	    (void)syscall(SYS_futex, &shared->wakeup, FUTEX_WAIT, wakeup,
+			  &ts, NULL, 0);
+	}
+	(void)__sync_fetch_and_sub(&shared->waiters, 1);
+	if (newdata || (timestamp() >= endtime))
+	    break;
+    }
+#else
+    /* busy-waiting sucks, but there's not really an alternative */
+    for (;;) {
 	memory_barrier();
-	if (bookend1 == bookend2 && bookend1 > PRIVATE(gpsdata)->tick)
+	if (shared->sequence > PRIVATE(gpsdata)->tick)
 	    newdata = true;
 	if (newdata || (timestamp() >= endtime))
 	    break;
     }
+#endif /* HAVE_LINUX_FUTEX_H */
 
     return newdata;
 }
 
-int gps_shm_read(struct gps_data_t *gpsdata)
-/* read an update from the shared-memory segment */
+static volatile struct shmexport_slot_t *shm_next(
+	volatile struct shmexport_t *shared, unsigned long since)
+/* find the oldest update still in the rings that is newer than since */
 {
-    if (gpsdata->privdata == NULL)
-	return -1;
-    else
-    {
-	int before, after;
-	void *private_save = gpsdata->privdata;
-	volatile struct shmexport_t *shared = (struct shmexport_t *)PRIVATE(gpsdata)->shmseg;
-	struct gps_data_t noclobber;
+    volatile struct shmexport_slot_t *next = NULL;
+    int i, j;
 
-	/*
-	 * Following block of instructions must not be reordered,
-	 * otherwise havoc will ensue.  The memory_barrier() call
-	 * should prevent reordering of the data accesses.
-	 *
-	 * This is a simple optimistic-concurrency technique.  We wrote
-	 * the second bookend first, then the data, then the first bookend.
-	 * Reader copies what it sees in normal order; that way, if we
-	 * start to write the segment during the read, the second bookend will
-	 * get clobbered first and the data can be detected as bad.
-	 */
-	before = shared->bookend1;
-	memory_barrier();
-	(void)memcpy((void *)&noclobber,
-		     (void *)&shared->gpsdata,
-		     sizeof(struct gps_data_t));
-	memory_barrier();
-	after = shared->bookend2;
+    for (i = 0; i < MAX_DEVICES; i++)
+	for (j = 0; j < SHM_EXPORT_SLOTS; j++) {
+	    volatile struct shmexport_slot_t *slot = &shared->ring[i].slot[j];
+	    unsigned long sequence = slot->sequence;
 
-	if (before != after)
-	    return 0;
-	else {
-	    (void)memcpy((void *)gpsdata,
-			 (void *)&noclobber,
-			 sizeof(struct gps_data_t));
+	    if (sequence > since
+		&& (next == NULL || sequence < next->sequence))
+		next = slot;
+	}
+    return next;
+}
+
+static int shm_take(struct gps_data_t *gpsdata, unsigned long *since)
+/* copy out the update following *since; 1 if found, 0 if none */
+{
+    volatile struct shmexport_t *shared = (struct shmexport_t *)PRIVATE(gpsdata)->shmseg;
+    volatile struct shmexport_slot_t *slot;
+    void *private_save = gpsdata->privdata;
+    struct gps_data_t noclobber;
+
+    while ((slot = shm_next(shared, *since)) != NULL) {
+	unsigned long sequence = slot->sequence;
+	int retries;
+
+	for (retries = 0; retries < SHM_READ_RETRIES; retries++) {
+	    unsigned long before, after;
+	    gps_mask_t set;
+
+	    /*
+	     * Following block of instructions must not be reordered,
+	     * otherwise havoc will ensue.  The memory_barrier() call
+	     * should prevent reordering of the data accesses.
+	     *
+	     * This is the read side of the sequence lock in
+	     * shmexport.c.  An odd lock word means the daemon is
+	     * writing the slot; a lock word that changed while we
+	     * copied means the copy may be torn.
+	     */
+	    before = slot->lock;
+	    memory_barrier();
+	    if ((before & 1) != 0)
+		continue;
+	    if (slot->sequence != sequence)
+		break;
+	    set = slot->set;
+	    gps_shm_copy(&noclobber, (const struct gps_data_t *)&slot->gpsdata,
+			 set);
+	    memory_barrier();
+	    after = slot->lock;
+	    if (before != after)
+		continue;
+
+	    gps_shm_copy(gpsdata, &noclobber, set);
 	    gpsdata->privdata = private_save;
 #ifndef USE_QT
 	    gpsdata->gps_fd = SHM_PSEUDO_FD;
 #else
 	    gpsdata->gps_fd = (void *)(intptr_t)SHM_PSEUDO_FD;
 #endif /* USE_QT */
-	    PRIVATE(gpsdata)->tick = after;
+	    if (sequence > *since + 1)
+		/* the daemon lapped us and overwrote these */
+		libgps_debug_trace((DEBUG_CALLS, "SHM updates %lu-%lu lost\n",
+				    *since + 1, sequence - 1));
+	    *since = sequence;
 	    if ((gpsdata->set & REPORT_IS)!=0) {
 		if (gpsdata->fix.mode >= 2)
 		    gpsdata->status = STATUS_FIX;
@@ -150,9 +279,51 @@ int gps_shm_read(struct gps_data_t *gpsdata)
 		    gpsdata->status = STATUS_NO_FIX;
 		gpsdata->set = STATUS_SET;
 	    }
-	    return (int)sizeof(struct gps_data_t);
+	    return 1;
 	}
+	if (slot->sequence == sequence)
+	    /* still being written; try again on the next call */
+	    return 0;
+	/* overwritten before we could get it; move past it */
+	libgps_debug_trace((DEBUG_CALLS, "SHM update %lu lost\n", sequence));
+	*since = sequence;
+    }
+    return 0;
+}
+
+int gps_shm_read(struct gps_data_t *gpsdata)
+/* read the next update from the shared-memory segment */
+{
+    bool first;
+
+    if (gpsdata->privdata == NULL)
+	return -1;
+    first = (PRIVATE(gpsdata)->tick == 0);
+    if (shm_take(gpsdata, &PRIVATE(gpsdata)->tick) == 0)
+	return 0;
+    if (first)
+	/* accumulate the rest of the rings; the latest update wins */
+	while (shm_take(gpsdata, &PRIVATE(gpsdata)->tick) > 0)
+	    continue;
+    return (int)sizeof(struct gps_data_t);
+}
+
+int gps_shm_updates(struct gps_data_t *gpsdata, unsigned long *since,
+		    void (*hook)(struct gps_data_t *gpsdata))
+/* hand every update newer than *since to hook, oldest first */
+{
+    int count = 0;
+
+    if (gpsdata->privdata == NULL)
+	return -1;
+    while (shm_take(gpsdata, since) > 0) {
+	++count;
+	if (hook != NULL)
+	    (*hook)(gpsdata);
     }
+    if (*since > PRIVATE(gpsdata)->tick)
+	PRIVATE(gpsdata)->tick = *since;
+    return count;
 }
 
 void gps_shm_close(struct gps_data_t *gpsdata)
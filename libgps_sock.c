@@ -5,6 +5,7 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdbool.h>
 #include <fcntl.h>
 #include <string.h>
@@ -43,8 +44,12 @@
 struct privdata_t
 {
     bool newstyle;
-    /* data buffered from the last read */
+    /* data buffered from the last read, not yet unpacked */
     ssize_t waiting;
+    /* where that data starts; compacted to the front only when needed */
+    ssize_t start;
+    /* where the last message unpacked starts, for gps_data() */
+    ssize_t message;
     char buffer[GPS_JSON_RESPONSE_MAX * 2];
 #ifdef LIBGPS_DEBUG
     int waitcount;
@@ -118,6 +123,8 @@ int gps_sock_open(const char *host, const char *port,
 	return -1;
     PRIVATE(gpsdata)->newstyle = false;
     PRIVATE(gpsdata)->waiting = 0;
+    PRIVATE(gpsdata)->start = 0;
+    PRIVATE(gpsdata)->message = 0;
     PRIVATE(gpsdata)->buffer[0] = 0;
 
 #ifdef LIBGPS_DEBUG
@@ -178,88 +185,289 @@ int gps_sock_close(struct gps_data_t *gpsdata)
 #endif
 }
 
-int gps_sock_read(struct gps_data_t *gpsdata)
-/* wait for and read data being streamed from the daemon */
+static char *sock_next_end(struct privdata_t *priv)
+/* find the last byte of the first complete response buffered, if any */
 {
-    char *eol;
-    ssize_t response_length;
-    int status = -1;
-
-    gpsdata->set &= ~PACKET_SET;
-    for (eol = PRIVATE(gpsdata)->buffer;
-	 *eol != '\n' && eol < PRIVATE(gpsdata)->buffer + PRIVATE(gpsdata)->waiting; eol++)
-	continue;
-    if (*eol != '\n')
-	eol = NULL;
+    char *base = priv->buffer + priv->start;
+
+    if (priv->waiting > 0 && (unsigned char)base[0] == BINARY_MAGIC) {
+	struct binary_header_t header;
+
+	if ((size_t)priv->waiting < sizeof(header))
+	    return NULL;
+	memcpy(&header, base, sizeof(header));
+	/*
+	 * The length is only as good as the sender.  One that could
+	 * never fit in the buffer is garbage; take it and everything
+	 * up to the next line as one response, which won't unpack.
+	 */
+	if (header.length <= sizeof(priv->buffer) - sizeof(header)) {
+	    if ((size_t)priv->waiting < sizeof(header) + header.length)
+		return NULL;
+	    return base + sizeof(header) + header.length - 1;
+	}
+	libgps_debug_trace((DEBUG_CALLS,
+			    "gps_read() binary record length %u rejected\n",
+			    header.length));
+    }
+    return (char *)memchr(base, '\n', (size_t)priv->waiting);
+}
 
-    errno = 0;
+static int sock_fill(struct gps_data_t *gpsdata, char **last)
+/* read more data; return -1 on end of data or hard error, 0 otherwise */
+{
+    struct privdata_t *priv = PRIVATE(gpsdata);
+    int status;
+    char *end;
+
+    /*
+     * Messages are unpacked in place, so the buffer is only shuffled
+     * when the space after the partial message is too short for a
+     * complete response.  A partial message that fills the buffer
+     * can never be terminated; throw it away.
+     */
+    if ((size_t)priv->waiting == sizeof(priv->buffer)) {
+	libgps_debug_trace((DEBUG_CALLS,
+			    "gps_read() discarding overlong response\n"));
+	priv->waiting = 0;
+    }
+    if (priv->waiting == 0)
+	priv->start = 0;
+    else if (sizeof(priv->buffer) - (size_t)(priv->start + priv->waiting)
+	     < GPS_JSON_RESPONSE_MAX) {
+	memmove(priv->buffer, priv->buffer + priv->start,
+		(size_t)priv->waiting);
+	priv->start = 0;
+    }
+    end = priv->buffer + priv->start + priv->waiting;
 
-    if (eol == NULL) {
 #ifndef USE_QT
-	/* read data: return -1 if no data waiting or buffered, 0 otherwise */
-	status = (int)recv(gpsdata->gps_fd,
-			   PRIVATE(gpsdata)->buffer + PRIVATE(gpsdata)->waiting,
-			   sizeof(PRIVATE(gpsdata)->buffer) - PRIVATE(gpsdata)->waiting, 0);
+    /* read data: return -1 if no data waiting or buffered, 0 otherwise */
+    status = (int)recv(gpsdata->gps_fd, end,
+		       sizeof(priv->buffer) - (size_t)(end - priv->buffer), 0);
 #else
-	status =
-	    ((QTcpSocket *) (gpsdata->gps_fd))->read(PRIVATE(gpsdata)->buffer +
-						     PRIVATE(gpsdata)->waiting,
-						     sizeof(PRIVATE(gpsdata)->buffer) -
-						     PRIVATE(gpsdata)->waiting);
+    status =
+	((QTcpSocket *) (gpsdata->gps_fd))->read(end,
+						 sizeof(priv->buffer) -
+						 (end - priv->buffer));
 #endif
 #ifdef HAVE_WINSOCK2_H
-	int wserr = WSAGetLastError();
+    int wserr = WSAGetLastError();
 #endif /* HAVE_WINSOCK2_H */
-	/* if we just received data from the socket, it's in the buffer */
-	if (status > -1)
-	    PRIVATE(gpsdata)->waiting += status;
-	/* buffer is empty - implies no data was read */
-	if (PRIVATE(gpsdata)->waiting == 0) {
-	    /*
-	     * If we received 0 bytes, other side of socket is closing.
-	     * Return -1 as end-of-data indication.
-	     */
-	    // cppcheck-suppress duplicateBranch
-	    if (status == 0)
-		return -1;
+    /* if we just received data from the socket, it's in the buffer */
+    if (status > -1)
+	priv->waiting += status;
+    /* buffer is empty - implies no data was read */
+    if (priv->waiting == 0) {
+	/*
+	 * If we received 0 bytes, other side of socket is closing.
+	 * Return -1 as end-of-data indication.
+	 */
+	// cppcheck-suppress duplicateBranch
+	if (status == 0)
+	    return -1;
 #ifndef USE_QT
-	    /* count transient errors as success, we'll retry later */
+	/* count transient errors as success, we'll retry later */
 #ifdef HAVE_WINSOCK2_H
-	    else if (wserr == WSAEINTR || wserr == WSAEWOULDBLOCK)
-		return 0;
+	else if (wserr == WSAEINTR || wserr == WSAEWOULDBLOCK)
+	    return 0;
 #else
-	    else if (errno == EINTR || errno == EAGAIN
-		     || errno == EWOULDBLOCK)
-		return 0;
+	else if (errno == EINTR || errno == EAGAIN
+		 || errno == EWOULDBLOCK)
+	    return 0;
 #endif /* HAVE_WINSOCK2_H */
 #endif
-	    /* hard error return of -1, pass it along */
-	    else
-		return -1;
+	/* hard error return of -1, pass it along */
+	else
+	    return -1;
+    }
+    /* only the bytes just received can end a partial line */
+    if (status > 0) {
+	if ((unsigned char)priv->buffer[priv->start] == BINARY_MAGIC)
+	    *last = sock_next_end(priv);
+	else
+	    *last = (char *)memchr(end, '\n', (size_t)status);
+    }
+    return 0;
+}
+
+int gps_unpack_binary(const char *buf, size_t buflen,
+		      struct gps_data_t *gpsdata)
+/* unpack a binary report record of buflen bytes into a status structure */
+{
+    struct binary_header_t header;
+    const char *device = buf + sizeof(header), *payload;
+    size_t length;
+
+    if (buflen < sizeof(header))
+	return 0;
+    memcpy(&header, buf, sizeof(header));
+    if (header.length != buflen - sizeof(header)) {
+	libgps_debug_trace((DEBUG_CALLS,
+			    "gps_unpack_binary() bad record length %u\n",
+			    header.length));
+	return 0;
+    }
+    if (header.api != GPSD_API_MAJOR_VERSION
+	|| header.layout != BINARY_LAYOUT
+	|| header.check != BINARY_CHECK) {
+	libgps_debug_trace((DEBUG_CALLS,
+			    "gps_unpack_binary() API %d layout %d record "
+			    "(check %#x) ignored\n",
+			    header.api, header.layout, header.check));
+	return 0;
+    }
+    payload = (const char *)memchr(device, '\0', header.length);
+    if (payload == NULL)
+	return 0;
+    payload++;
+    length = header.length - (size_t)(payload - device);
+
+    switch (header.type) {
+    case binary_tpv:
+	if (length == sizeof(struct binary_tpv_t)) {
+	    struct binary_tpv_t tpv;
+
+	    memcpy(&tpv, payload, sizeof(tpv));
+	    gpsdata->status = tpv.status;
+	    gpsdata->fix = tpv.fix;
+	    gpsdata->set = STATUS_SET | libgps_tpv_mask(&gpsdata->fix);
 	}
-	/* there's buffered data waiting to be returned */
-	for (eol = PRIVATE(gpsdata)->buffer;
-	     *eol != '\n' && eol < PRIVATE(gpsdata)->buffer + PRIVATE(gpsdata)->waiting; eol++)
-	    continue;
-	if (*eol != '\n')
-	    eol = NULL;
-	if (eol == NULL)
-	    return 0;
+	break;
+    case binary_sky:
+	if (length >= offsetof(struct binary_sky_t, skyview)
+	    && length <= sizeof(struct binary_sky_t)) {
+	    struct binary_sky_t sky;
+	    int i;
+
+	    memset(&sky, '\0', sizeof(sky));
+	    memcpy(&sky, payload, length);
+	    gpsdata->skyview_time = sky.skyview_time;
+	    gpsdata->dop = sky.dop;
+	    memcpy(gpsdata->skyview, sky.skyview, sizeof(gpsdata->skyview));
+	    /* count the way the JSON reader does */
+	    gpsdata->satellites_used = 0;
+	    gpsdata->satellites_visible = 0;
+	    for (i = 0; i < MAXCHANNELS; i++) {
+		if (gpsdata->skyview[i].PRN > 0)
+		    gpsdata->satellites_visible++;
+		if (gpsdata->skyview[i].used)
+		    gpsdata->satellites_used++;
+	    }
+	    gpsdata->set |= SATELLITE_SET;
+	}
+	break;
+    case binary_gst:
+	if (length == sizeof(gpsdata->gst)) {
+	    memcpy(&gpsdata->gst, payload, sizeof(gpsdata->gst));
+	    gpsdata->set &= ~UNION_SET;
+	    gpsdata->set |= GST_SET;
+	}
+	break;
+    case binary_att:
+	if (length == sizeof(gpsdata->attitude)) {
+	    memcpy(&gpsdata->attitude, payload, sizeof(gpsdata->attitude));
+	    gpsdata->set &= ~UNION_SET;
+	    gpsdata->set |= ATTITUDE_SET;
+	}
+	break;
+    case binary_ais:
+	if (length == sizeof(gpsdata->ais)) {
+	    memcpy(&gpsdata->ais, payload, sizeof(gpsdata->ais));
+	    gpsdata->set &= ~UNION_SET;
+	    gpsdata->set |= AIS_SET;
+	}
+	break;
+    case binary_pps:
+    case binary_toff:
+	if (length == sizeof(struct binary_timedelta_t)) {
+	    struct binary_timedelta_t td;
+
+	    memcpy(&td, payload, sizeof(td));
+	    /* the JSON reader puts TOFF here too */
+	    gpsdata->pps = td.td;
+	    gpsdata->set &= ~UNION_SET;
+	    gpsdata->set |= (header.type == binary_pps) ? PPS_SET : TOFF_SET;
+	}
+	break;
+    default:
+	libgps_debug_trace((DEBUG_CALLS,
+			    "gps_unpack_binary() unknown record type %d\n",
+			    header.type));
+	return 0;
     }
+    (void)strlcpy(gpsdata->dev.path, device, sizeof(gpsdata->dev.path));
+    return 0;
+}
+
+static int sock_unpack(struct gps_data_t *gpsdata, char *last)
+/* unpack the buffered response ending at last and consume it */
+{
+    struct privdata_t *priv = PRIVATE(gpsdata);
+    char *response = priv->buffer + priv->start;
+    ssize_t response_length = last - response + 1;
+    int status;
 
-    assert(eol != NULL);
-    *eol = '\0';
-    response_length = eol - PRIVATE(gpsdata)->buffer + 1;
     gpsdata->online = timestamp();
-    status = gps_unpack(PRIVATE(gpsdata)->buffer, gpsdata);
-    memmove(PRIVATE(gpsdata)->buffer,
-	    PRIVATE(gpsdata)->buffer + response_length, PRIVATE(gpsdata)->waiting - response_length);
-    PRIVATE(gpsdata)->waiting -= response_length;
+    if ((unsigned char)response[0] == BINARY_MAGIC)
+	status = gps_unpack_binary(response, (size_t)response_length,
+				   gpsdata);
+    else {
+	*last = '\0';
+	status = gps_unpack(response, gpsdata);
+    }
+    priv->message = priv->start;
+    priv->start += response_length;
+    priv->waiting -= response_length;
     gpsdata->set |= PACKET_SET;
 
     return (status == 0) ? (int)response_length : status;
 }
 
+int gps_sock_read(struct gps_data_t *gpsdata)
+/* wait for and read data being streamed from the daemon */
+{
+    char *last;
+    int status;
+
+    gpsdata->set &= ~PACKET_SET;
+    errno = 0;
+    last = sock_next_end(PRIVATE(gpsdata));
+    if (last == NULL) {
+	status = sock_fill(gpsdata, &last);
+	if (last == NULL)
+	    return status;
+    }
+    return sock_unpack(gpsdata, last);
+}
+
+int gps_sock_read_batch(struct gps_data_t *gpsdata,
+			void (*hook)(struct gps_data_t *gpsdata))
+/* read once, then hand every complete message buffered to hook */
+{
+    char *last;
+    int status, count = 0;
+
+    gpsdata->set &= ~PACKET_SET;
+    errno = 0;
+    last = sock_next_end(PRIVATE(gpsdata));
+    if (last == NULL) {
+	status = sock_fill(gpsdata, &last);
+	if (status == -1)
+	    return -1;
+    }
+    while (last != NULL) {
+	gpsdata->set &= ~PACKET_SET;
+	status = sock_unpack(gpsdata, last);
+	if (status < 0)
+	    return status;
+	(*hook)(gpsdata);
+	count++;
+	last = sock_next_end(PRIVATE(gpsdata));
+    }
+    return count;
+}
+
 int gps_unpack(char *buf, struct gps_data_t *gpsdata)
 /* unpack a gpsd response into a status structure, buf must be writeable.
  * gps_unpack() currently returns 0 in all cases, but should it ever need to
@@ -292,7 +500,7 @@ int gps_unpack(char *buf, struct gps_data_t *gpsdata)
 const char *gps_sock_data(const struct gps_data_t *gpsdata)
 /* return the contents of the client data buffer */
 {
-    return PRIVATE(gpsdata)->buffer;
+    return PRIVATE(gpsdata)->buffer + PRIVATE(gpsdata)->message;
 }
 
 int gps_sock_send(struct gps_data_t *gpsdata, const char *buf)
@@ -345,6 +553,8 @@ int gps_sock_stream(struct gps_data_t *gpsdata, unsigned int flags, void *d)
 	    (void)strlcat(buf, "\"split24\":false,", sizeof(buf));
 	if (flags & WATCH_PPS)
 	    (void)strlcat(buf, "\"pps\":false,", sizeof(buf));
+	if (flags & WATCH_BINARY)
+	    (void)strlcat(buf, "\"binary\":false,", sizeof(buf));
 	str_rstrip_char(buf, ',');
 	(void)strlcat(buf, "};", sizeof(buf));
 	libgps_debug_trace((DEBUG_CALLS, "gps_stream() disable command: %s\n", buf));
@@ -367,6 +577,8 @@ int gps_sock_stream(struct gps_data_t *gpsdata, unsigned int flags, void *d)
 	    (void)strlcat(buf, "\"split24\":true,", sizeof(buf));
 	if (flags & WATCH_PPS)
 	    (void)strlcat(buf, "\"pps\":true,", sizeof(buf));
+	if (flags & WATCH_BINARY)
+	    (void)strlcat(buf, "\"binary\":true,", sizeof(buf));
 	if (flags & WATCH_DEVICE)
 	    str_appendf(buf, sizeof(buf), "\"device\":\"%s\",", (char *)d);
 	str_rstrip_char(buf, ',');
@@ -383,14 +595,8 @@ int gps_sock_mainloop(struct gps_data_t *gpsdata, int timeout,
     for (;;) {
 	if (!gps_waiting(gpsdata, timeout)) {
 	    return -1;
-	} else {
-	    int status = gps_read(gpsdata);
-
-	    if (status == -1)
-		return -1;
-	    if (status > 0)
-		(*hook)(gpsdata);
-	}
+	} else if (gps_sock_read_batch(gpsdata, hook) == -1)
+	    return -1;
     }
     //return 0;
 }
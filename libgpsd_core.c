@@ -57,7 +57,11 @@ ssize_t gpsd_write(struct gps_device_t *session,
 		   const size_t len)
 /* pass low-level data to devices straight through */
 {
-    return session->context->serial_write(session, buf, len);
+    ssize_t status = session->context->serial_write(session, buf, len);
+
+    if (status > 0)
+	session->metrics.bytes_out += (unsigned long)status;
+    return status;
 }
 
 static void basic_report(const char *buf)
@@ -337,6 +341,8 @@ void gpsd_init(struct gps_device_t *session, struct gps_context_t *context,
     session->sor = 0.0;
     session->chars = 0;
 #endif /* TIMING_ENABLE */
+    memset(&session->multipoll, 0, sizeof(session->multipoll));
+    memset(&session->metrics, 0, sizeof(session->metrics));
     /* tty-level initialization */
     gpsd_tty_init(session);
     /* necessary in case we start reading in the middle of a GPGSV sequence */
@@ -379,6 +385,7 @@ void gpsd_deactivate(struct gps_device_t *session)
 #endif /* PPS_ENABLE */
     /* mark it inactivated */
     session->gpsdata.online = (timestamp_t)0;
+    session->multipoll.pending = false;
 }
 
 #ifdef PPS_ENABLE
@@ -598,6 +605,7 @@ int gpsd_activate(struct gps_device_t *session, const int mode)
 			     "Probe found \"%s\" driver...\n",
 			     (*dp)->type_name);
 		    session->device_type = *dp;
+		    session->driver_index = (unsigned int)(dp - gpsd_drivers);
 		    gpsd_assert_sync(session);
 		    goto foundit;
 		} else
@@ -1028,6 +1036,7 @@ int gpsd_await_data(fd_set *rfds,
 		    fd_set *efds,
 		     const int maxfd,
 		     fd_set *all_fds,
+		     const bool nowait,
 		     struct gpsd_errout_t *errout)
 /* await data from any socket in the all_fds set */
 {
@@ -1047,10 +1056,18 @@ int gpsd_await_data(fd_set *rfds,
      * pselect() is preferable to vanilla select, to eliminate
      * the once-per-second wakeup when no sensors are attached.
      * This cuts power consumption.
+     *
+     * nowait asks for a poll without blocking, for callers that still
+     * hold buffered input from a device whose budget ran out in
+     * gpsd_multipoll().
      */
     errno = 0;
 
-    status = pselect(maxfd + 1, rfds, NULL, NULL, NULL, NULL);
+    if (nowait) {
+	struct timespec zero = {0, 0};
+	status = pselect(maxfd + 1, rfds, NULL, NULL, &zero, NULL);
+    } else
+	status = pselect(maxfd + 1, rfds, NULL, NULL, NULL, NULL);
     if (status == -1) {
 	if (errno == EINTR)
 	    return AWAIT_NOT_READY;
@@ -1134,10 +1151,17 @@ gps_mask_t gpsd_poll(struct gps_device_t *session)
 {
     ssize_t newlen;
     bool driver_change = false;
+    unsigned long chars = session->lexer.char_counter;
+    uint64_t stamp;
 
     gps_clear_fix(&session->newdata);
 
 #ifdef TIMING_ENABLE
+    /* start this packet's latency trace; the lexer times its own stages */
+    memset(&session->latency.current, '\0', sizeof(session->latency.current));
+    session->latency.current.start = latency_now();
+    session->lexer.read_ns = session->lexer.lex_ns = 0;
+
     /*
      * Input just became available from a sensor, but no read from the
      * device has yet been done.
@@ -1216,11 +1240,17 @@ gps_mask_t gpsd_poll(struct gps_device_t *session)
     } else {
 	newlen = generic_get(session);
     }
+    session->metrics.bytes_in += session->lexer.char_counter - chars;
 
     /* update the scoreboard structure from the GPS */
     gpsd_log(&session->context->errout, LOG_RAW + 2,
 	     "%s sent %zd new characters\n",
 	     session->gpsdata.dev.path, newlen);
+#ifdef TIMING_ENABLE
+    session->latency.current.stage[latency_read] = session->lexer.read_ns;
+    session->latency.current.stage[latency_lex] = session->lexer.lex_ns;
+    session->latency.current.type = session->lexer.type;
+#endif /* TIMING_ENABLE */
     if (newlen < 0) {		/* read error */
 	gpsd_log(&session->context->errout, LOG_INF,
 		 "GPS on %s returned error %zd (%lf sec since data)\n",
@@ -1245,6 +1275,13 @@ gps_mask_t gpsd_poll(struct gps_device_t *session)
 	gpsd_log(&session->context->errout, LOG_RAW,
 		 "packet sniff on %s finds type %d\n",
 		 session->gpsdata.dev.path, session->lexer.type);
+	if (session->lexer.outbuflen > 0) {
+	    if (session->lexer.type == BAD_PACKET)
+		session->metrics.bad++;
+	    else if (session->lexer.type >= 0
+		     && session->lexer.type < METRIC_PACKET_TYPES)
+		session->metrics.packets[session->lexer.type]++;
+	}
 	if (session->lexer.type == COMMENT_PACKET) {
 	    if (strcmp((const char *)session->lexer.outbuffer, "# EOF\n") == 0) {
 		gpsd_log(&session->context->errout, LOG_PROG,
@@ -1384,8 +1421,18 @@ gps_mask_t gpsd_poll(struct gps_device_t *session)
 	/* Get data from current packet into the fix structure */
 	if (session->lexer.type != COMMENT_PACKET)
 	    if (session->device_type != NULL
-		&& session->device_type->parse_packet != NULL)
+		&& session->device_type->parse_packet != NULL) {
+		stamp = latency_now();
 		received |= session->device_type->parse_packet(session);
+		stamp = latency_now() - stamp;
+		if (session->driver_index < METRIC_DRIVERS) {
+		    session->metrics.parse[session->driver_index].calls++;
+		    session->metrics.parse[session->driver_index].ns += stamp;
+		}
+#ifdef TIMING_ENABLE
+		session->latency.current.stage[latency_parse] = stamp;
+#endif /* TIMING_ENABLE */
+	    }
 
 #ifdef RECONFIGURE_ENABLE
 	/*
@@ -1399,7 +1446,12 @@ gps_mask_t gpsd_poll(struct gps_device_t *session)
 	    && session->last_controller != NULL
 	    && STICKY(session->last_controller))
 	{
+	    const struct gps_type_t **dp;
+
 	    session->device_type = session->last_controller;
+	    for (dp = gpsd_drivers; *dp; dp++)
+		if (*dp == session->device_type)
+		    session->driver_index = (unsigned int)(dp - gpsd_drivers);
 	    gpsd_log(&session->context->errout, LOG_PROG,
 		     "reverted to %s driver...\n",
 		     session->device_type->type_name);
@@ -1442,7 +1494,13 @@ gps_mask_t gpsd_poll(struct gps_device_t *session)
 	gps_merge_fix(&session->gpsdata.fix,
 		      session->gpsdata.set, &session->newdata);
 #ifndef NOFLOATS_ENABLE
+#ifdef TIMING_ENABLE
+	stamp = latency_now();
+#endif /* TIMING_ENABLE */
 	gpsd_error_model(session, &session->gpsdata.fix, &session->oldfix);
+#ifdef TIMING_ENABLE
+	session->latency.current.stage[latency_model] = latency_now() - stamp;
+#endif /* TIMING_ENABLE */
 #endif /* NOFLOATS_ENABLE */
 
 
@@ -1491,9 +1549,16 @@ int gpsd_multipoll(const bool data_ready,
 		   float reawake_time)
 /* consume and handle packets from a specified device */
 {
-    if (data_ready)
+    if (data_ready || device->multipoll.pending)
     {
 	int fragments;
+	unsigned int packets = 0;
+	/* resuming buffered input left over from an exhausted budget */
+	bool carried = device->multipoll.pending;
+	timestamp_t deadline = timestamp() + MULTIPOLL_SECONDS;
+
+	device->multipoll.pending = false;
+	device->multipoll.wakeups++;
 
 	gpsd_log(&device->context->errout, LOG_RAW + 1,
 		 "polling %d\n", device->gpsdata.gps_fd);
@@ -1536,8 +1601,10 @@ int gpsd_multipoll(const bool data_ready,
 		/*
 		 * No data on the first fragment read means the device
 		 * fd may have been in an end-of-file condition on select.
+		 * A carried-over call was not prompted by select, so
+		 * an empty read then says nothing about the fd.
 		 */
-		if (fragments == 0) {
+		if (fragments == 0 && !carried) {
 		    gpsd_log(&device->context->errout, LOG_DATA,
 			     "%s returned zero bytes\n",
 			     device->gpsdata.dev.path);
@@ -1605,21 +1672,30 @@ int gpsd_multipoll(const bool data_ready,
 	    /* handle data contained in this packet */
 	    if (device->lexer.type != BAD_PACKET)
 		handler(device, changed);
+	    packets++;
 
-#ifdef __future__
 	    /*
-	     * Bernd Ocklin suggests:
-	     * Exit when a full packet was received and parsed.
-	     * This allows other devices to be serviced even if
-	     * this device delivers a full packet at every single
-	     * read.
-	     * Otherwise we can sit here for a long time without
-	     * any for-loop exit condition being met.
+	     * A device that delivers a full packet on every read
+	     * could otherwise keep us here indefinitely, starving
+	     * other devices and clients.  Once this device has used
+	     * up its budget, leave the rest of its input for a later
+	     * pass; the caller comes back without waiting on select
+	     * while multipoll.pending is set.
 	     */
-	    if ((changed & PACKET_SET) != 0)
-               break;
-#endif /* __future__ */
+	    if (packets >= MULTIPOLL_PACKETS || timestamp() >= deadline) {
+		device->multipoll.pending = true;
+		device->multipoll.exhausted++;
+		gpsd_log(&device->context->errout, LOG_PROG,
+			 "%s used its budget after %u packets\n",
+			 device->gpsdata.dev.path, packets);
+		break;
+	    }
 	}
+
+	device->multipoll.packets += packets;
+	device->multipoll.last = packets;
+	if (packets > device->multipoll.max)
+	    device->multipoll.max = packets;
     }
     else if (device->reawake>0 && time(NULL) >device->reawake) {
 	/* device may have had a zero-length read */
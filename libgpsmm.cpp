@@ -7,6 +7,10 @@
  */
 
 #include <cstdlib>
+#include <cerrno>
+#ifndef USE_QT
+#include <sys/select.h>
+#endif /* USE_QT */
 #include "libgpsmm.h"
 #include "gpsd_config.h"
 
@@ -95,3 +99,110 @@ gpsmm::~gpsmm()
 	delete to_user;
     }
 }
+
+#if __cplusplus >= 201103L
+gps::session::session(const char *host, const char *port)
+    : state_(new state())
+{
+    if (gps_open(host, port, &state_->data) != 0)
+	state_.reset();
+}
+
+gps::session &gps::session::operator=(gps::session &&other) noexcept
+{
+    if (this != &other) {
+	if (state_ != nullptr)
+	    (void)gps_close(&state_->data);
+	state_ = std::move(other.state_);
+    }
+    return *this;
+}
+
+gps::session::~session()
+{
+    if (state_ != nullptr)
+	(void)gps_close(&state_->data);
+}
+
+bool gps::session::stream(int flags)
+{
+    return state_ != nullptr && gps_stream(&state_->data, flags, NULL) != -1;
+}
+
+bool gps::session::send(const char *request)
+{
+    return state_ != nullptr && gps_send(&state_->data, request) != -1;
+}
+
+bool gps::session::waiting(int timeout)
+{
+    return state_ != nullptr && gps_waiting(&state_->data, timeout);
+}
+
+bool gps::session::wait(void)
+{
+#ifndef USE_QT
+    /*
+     * gps_waiting() says yes at once while part of a message is
+     * buffered, so on a socket wait for the rest on the descriptor.
+     */
+    if (state_->data.gps_fd >= 0) {
+	fd_set rfds;
+
+	FD_ZERO(&rfds);
+	FD_SET(state_->data.gps_fd, &rfds);
+	return select(state_->data.gps_fd + 1, &rfds, NULL, NULL, NULL) == 1
+	    || errno == EINTR;
+    }
+#endif /* USE_QT */
+    (void)gps_waiting(&state_->data, 1000000);
+    return true;
+}
+
+const struct gps_data_t *gps::session::read(void)
+{
+    int status;
+
+    if (state_ == nullptr)
+	return nullptr;
+    for (;;) {
+	state_->data.set = 0;
+	status = gps_read(&state_->data);
+	if (status > 0)
+	    return &state_->data;
+	if (status < 0 || !wait())
+	    return nullptr;
+    }
+}
+
+void gps::session::notify(observer &target, const struct gps_data_t &data)
+{
+    if ((data.set & SATELLITE_SET) != 0)
+	target.on_sky(sky_view(data));
+    else if ((data.set & AIS_SET) != 0)
+	target.on_ais(data.ais);
+    else if ((data.set & MODE_SET) != 0)
+	target.on_fix(data.fix, data);
+    else
+	target.on_other(data);
+}
+
+void gps::session::deliver(struct gps_data_t *gpsdata)
+{
+    state *sp = reinterpret_cast<state *>(gpsdata);
+
+    notify(*sp->target, *gpsdata);
+    gpsdata->set = 0;
+}
+
+int gps::session::dispatch(observer &target)
+{
+    if (state_ == nullptr)
+	return -1;
+    state_->target = &target;
+    state_->data.set = 0;
+    if (!wait())
+	return -1;
+    return gps_read_batch(&state_->data, deliver);
+}
+#endif /* __cplusplus >= 201103L */
@@ -55,4 +55,107 @@ class LIBQGPSMMSHARED_EXPORT gpsmm {
 		struct gps_data_t * gps_state() { return &_gps_state; }
 		struct gps_data_t* backup(void) { *to_user=*gps_state(); return to_user;}; //return the backup copy
 };
+
+#if __cplusplus >= 201103L
+#include <memory>
+
+#ifndef USE_QT
+#define GPSMM_EXPORT
+#else
+#define GPSMM_EXPORT LIBQGPSMMSHARED_EXPORT
+#endif
+
+/*
+ * A C++11 interface alongside gpsmm.  A gps::session owns its
+ * connection and can be moved but not copied.  Reads hand out const
+ * references into the state libgps keeps, so no gps_data_t is copied
+ * per message.  Take updates one at a time with read(), as a range
+ * with updates(), or have dispatch() push each buffered message to an
+ * observer as a fix, a sky_view or an ais_message.
+ */
+namespace gps {
+	typedef struct gps_fix_t fix;		// what a TPV report carries
+	typedef struct ais_t ais_message;	// what an AIS report carries
+
+	// what a SKY report carries, viewed in place
+	class GPSMM_EXPORT sky_view {
+	public:
+		explicit sky_view(const struct gps_data_t &data) : data_(&data) {}
+		const struct satellite_t *begin(void) const { return data_->skyview; }
+		const struct satellite_t *end(void) const { return data_->skyview + size(); }
+		int size(void) const {
+			int n = data_->satellites_visible;
+			return n < 0 ? 0 : (n > MAXCHANNELS ? MAXCHANNELS : n);
+		}
+		int used(void) const { return data_->satellites_used; }
+		const struct dop_t &dop(void) const { return data_->dop; }
+		timestamp_t time(void) const { return data_->skyview_time; }
+	private:
+		const struct gps_data_t *data_;
+	};
+
+	// override the reports you want; the rest go to on_other()
+	class GPSMM_EXPORT observer {
+	public:
+		virtual ~observer() {}
+		virtual void on_fix(const fix &, const struct gps_data_t &) {}
+		virtual void on_sky(const sky_view &) {}
+		virtual void on_ais(const ais_message &) {}
+		virtual void on_other(const struct gps_data_t &) {}
+	};
+
+	class GPSMM_EXPORT session {
+	public:
+		session(const char *host, const char *port);
+		session(session &&other) noexcept : state_(std::move(other.state_)) {}
+		session &operator=(session &&other) noexcept;
+		session(const session &) = delete;
+		session &operator=(const session &) = delete;
+		~session();
+		bool is_open(void) const { return state_ != nullptr; }
+		bool stream(int flags);	// set watcher and policy flags
+		bool send(const char *request);	// put a command to gpsd
+		bool waiting(int timeout);	// blocking check for data waiting
+		// block for the next message; nullptr on error or end of data.
+		// Its set member holds only the bits that message changed.
+		const struct gps_data_t *read(void);
+		// block for input, then hand every complete message buffered
+		// to an observer; returns how many, or -1 on error
+		int dispatch(observer &);
+		const struct gps_data_t &data(void) const { return state_->data; }
+
+		// each update as a range, until a read fails
+		class iterator {
+		public:
+			explicit iterator(session *s) : s_(s), d_(nullptr) { next(); }
+			const struct gps_data_t &operator*(void) const { return *d_; }
+			iterator &operator++(void) { next(); return *this; }
+			bool operator!=(const iterator &o) const { return s_ != o.s_; }
+		private:
+			void next(void) {
+				if (s_ != nullptr && (d_ = s_->read()) == nullptr)
+					s_ = nullptr;
+			}
+			session *s_;
+			const struct gps_data_t *d_;
+		};
+		struct range {
+			session *s;
+			iterator begin(void) const { return iterator(s); }
+			iterator end(void) const { return iterator(nullptr); }
+		};
+		range updates(void) { return range{this}; }
+	private:
+		// the gps_data_t comes first, so libgps callbacks can find target
+		struct state {
+			struct gps_data_t data;
+			observer *target;
+		};
+		std::unique_ptr<state> state_;
+		bool wait(void);
+		static void deliver(struct gps_data_t *);
+		static void notify(observer &, const struct gps_data_t &);
+	};
+}
+#endif /* __cplusplus >= 201103L */
 #endif // _GPSD_GPSMM_H_
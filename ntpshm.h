@@ -80,6 +80,7 @@ struct timedelta_t {
 struct shmTime *shm_get(int, bool, bool);
 extern char *ntp_name(const int);
 enum segstat_t ntp_read(struct shmTime *, struct shm_stat_t *, const bool);
+bool ntp_leap_month(time_t);
 void ntp_write(volatile struct shmTime *, struct timedelta_t *, int, int);
 
 #endif /* GPSD_NTPSHM_H */
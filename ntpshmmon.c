@@ -18,6 +18,7 @@
 #include "gps.h"	/* for safe_atof() */
 #include "gpsd_config.h"
 #include "ntpshm.h"
+#include "ppsthread.h"	/* for the PPS histogram helpers */
 #include "revision.h"
 #include "timespec.h"
 
@@ -25,21 +26,72 @@
 
 static struct shmTime *segments[NTPSEGMENTS + 1];
 
+/* per-segment statistics, kept only with -j */
+static struct segstats_t {
+    bool have_offset;
+    long long offset;		/* last real - clock, ns */
+    struct pps_hist_t jitter;	/* change in offset between samples */
+    struct pps_hist_t delay;	/* time from clock stamp to our read */
+} segstats[NTPSEGMENTS + 1];
+
+static void stats_count(int i, const struct shm_stat_t *shm_stat)
+/* fold one new sample into its segment's histograms */
+{
+    struct segstats_t *st = &segstats[i];
+    long long offset = timespec_diff_ns(shm_stat->tvr, shm_stat->tvt);
+
+    if (st->have_offset)
+	pps_hist_add(&st->jitter, offset - st->offset);
+    st->offset = offset;
+    st->have_offset = true;
+    pps_hist_add(&st->delay, timespec_diff_ns(shm_stat->tvc, shm_stat->tvt));
+}
+
+static void stats_dump(void)
+/* report and clear the histograms of every segment that saw samples */
+{
+    int i;
+
+    for (i = 0; i < NTPSEGMENTS; i++) {
+	struct segstats_t *st = &segstats[i];
+
+	if (st->delay.count == 0)
+	    continue;
+	(void)printf("jitter %s %lu %lld %lld %lld\n", ntp_name(i),
+		     st->jitter.count,
+		     pps_hist_quantile(&st->jitter, 0.5),
+		     pps_hist_quantile(&st->jitter, 0.99),
+		     st->jitter.max);
+	(void)printf("delay %s %lu %lld %lld %lld\n", ntp_name(i),
+		     st->delay.count,
+		     pps_hist_quantile(&st->delay, 0.5),
+		     pps_hist_quantile(&st->delay, 0.99),
+		     st->delay.max);
+	memset(&st->jitter, 0, sizeof(st->jitter));
+	memset(&st->delay, 0, sizeof(st->delay));
+    }
+}
+
 int main(int argc, char **argv)
 {
     int option;
     int	i;
     bool killall = false;
     bool verbose = false;
+    bool stats = false;
     int nsamples = INT_MAX;
     time_t timeout = (time_t)0, starttime = time(NULL);
+    time_t stats_start = starttime;
     /* a copy of all old segments */
     struct shm_stat_t	shm_stat_old[NTPSEGMENTS + 1];;
 
     memset( shm_stat_old, 0 ,sizeof( shm_stat_old));
 
-    while ((option = getopt(argc, argv, "hn:st:vV")) != -1) {
+    while ((option = getopt(argc, argv, "hjn:st:vV")) != -1) {
 	switch (option) {
+	case 'j':
+	    stats = true;
+	    break;
 	case 'n':
 	    nsamples = atoi(optarg);
 	    break;
@@ -59,8 +111,9 @@ int main(int argc, char **argv)
 	case 'h':
 	    (void)fprintf(
 	        stderr,
-                "usage: ntpshmmon [-s] [-n max] [-t timeout] [-v] [-h] [-V]\n"
+                "usage: ntpshmmon [-j] [-s] [-n max] [-t timeout] [-v] [-h] [-V]\n"
                 "  -h           print this help\n"
+                "  -j           report jitter and delay statistics\n"
                 "  -n nsamples  exit after nsamples\n"
                 "  -s           remove SHMs and exit\n"
                 "  -t nseconds  exit after nseconds\n"
@@ -134,6 +187,8 @@ int main(int argc, char **argv)
 		       (long)shm_stat.tvr.tv_sec, shm_stat.tvr.tv_nsec,
 		       (long)shm_stat.tvt.tv_sec, shm_stat.tvt.tv_nsec,
 		       shm_stat.leap, shm_stat.precision);
+		if (stats)
+		    stats_count(i, &shm_stat);
 		--nsamples;
 		/* save the new time stamp */
 		shm_stat_old[i] = shm_stat; /* structure copy */
@@ -174,6 +229,11 @@ int main(int argc, char **argv)
          *
          * and, of course, nanosleep() may sleep a lot longer than we ask...
 	 */
+	if (stats && time(NULL) >= stats_start + PPS_STATS_WINDOW) {
+	    stats_dump();
+	    stats_start = time(NULL);
+	}
+
 	if ( timeout ) {
 	    /* do not read time unless it matters */
 	    if ( time(NULL) > (starttime + timeout ) ) {
@@ -188,6 +248,8 @@ int main(int argc, char **argv)
 	nanosleep(&delay, NULL);
     } while ( 0 < nsamples );
 
+    if (stats)
+	stats_dump();
     exit(EXIT_SUCCESS);
 }
 
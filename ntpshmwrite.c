@@ -24,12 +24,32 @@
 
 #define LEAP_NOWARNING  0x0     /* normal, no leap second warning */
 
+bool ntp_leap_month(time_t sec)
+/* is sec in June or December?  Cheaper than gmtime_r() on every sample */
+{
+    long long days, doe, yoe, doy;
+
+    /* days since 0000-03-01, so each year ends with the leap day */
+    days = (long long)sec / 86400 - ((long long)sec % 86400 < 0) + 719468;
+    doe = days % 146097;	/* day of the 400-year era */
+    if (doe < 0)
+	doe += 146097;
+    yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    /* months counted from March: June is 3, December is 9 */
+    switch ((5 * doy + 2) / 153) {
+    case 3:
+    case 9:
+	return true;
+    default:
+	return false;
+    }
+}
+
 void ntp_write(volatile struct shmTime *shmseg,
 	       struct timedelta_t *td, int precision, int leap_notify)
 /* put a received fix time into shared memory for NTP */
 {
-    struct tm tm;
-
     /*
      * insist that leap seconds only happen in june and december
      * GPS emits leap pending for 3 months prior to insertion
@@ -39,8 +59,7 @@ void ntp_write(volatile struct shmTime *shmseg,
      * ITU-R TF.460-6, Section 2.1, says laep seconds can be primarily
      * in Jun/Dec but may be in March or September
      */
-    (void)gmtime_r( &(td->real.tv_sec), &tm);
-    if ( 5 != tm.tm_mon && 11 != tm.tm_mon ) {
+    if (!ntp_leap_month(td->real.tv_sec)) {
         /* Not june, not December, no way */
         leap_notify = LEAP_NOWARNING;
     }
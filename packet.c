@@ -209,6 +209,59 @@ static bool character_pushback(struct gps_lexer_t *lexer, unsigned int newstate)
     return false;
 }
 
+#ifdef NMEA0183_ENABLE
+static void nmea_sum_reset(struct gps_lexer_t *lexer)
+/* forget the running checksum, the packet start has moved */
+{
+    lexer->nmea_sum = 0;
+    lexer->nmea_summed = 0;
+    lexer->nmea_star = 0;
+}
+
+static void nmea_sum_update(struct gps_lexer_t *lexer, unsigned char c)
+/* fold the NMEA body character just read into the running checksum */
+{
+    size_t pos = lexer->inbufptr - 1 - lexer->inbuffer;
+
+    /* first body character, or the buffer was rearranged under us */
+    if (lexer->nmea_summed != pos) {
+	size_t n;
+
+	lexer->nmea_sum = 0;
+	for (n = 1; n < pos; n++)
+	    lexer->nmea_sum ^= lexer->inbuffer[n];
+	if (lexer->nmea_star >= pos)
+	    lexer->nmea_star = 0;
+    }
+    if (c == '*') {
+	lexer->nmea_starsum = lexer->nmea_sum;
+	lexer->nmea_star = pos;
+    }
+    lexer->nmea_sum ^= c;
+    lexer->nmea_summed = pos + 1;
+}
+
+#ifdef AIVDM_ENABLE
+static bool aivdm_sentence(const unsigned char *buf)
+/* is this an AIVDM/AIVDO sentence from one of the talkers we decode? */
+{
+    if (buf[0] != '!' || buf[3] != 'V' || buf[4] != 'D'
+	|| (buf[5] != 'M' && buf[5] != 'O'))
+	return false;
+    switch ((buf[1] << 8) | buf[2]) {
+    case ('A' << 8) | 'I':	/* Mobile AIS station */
+    case ('B' << 8) | 'S':	/* Base AIS station */
+    case ('A' << 8) | 'B':	/* NMEA 4.0 Base AIS station */
+    case ('A' << 8) | 'N':	/* NMEA 4.0 Aid to Navigation AIS station */
+    case ('S' << 8) | 'A':	/* NMEA 4.0 Physical Shore AIS Station */
+	return true;
+    default:
+	return false;
+    }
+}
+#endif /* AIVDM_ENABLE */
+#endif /* NMEA0183_ENABLE */
+
 static bool nextstate(struct gps_lexer_t *lexer, unsigned char c)
 {
     static int n = 0;
@@ -543,6 +596,8 @@ static bool nextstate(struct gps_lexer_t *lexer, unsigned char c)
 #endif
 	} else if (!isprint(c))
 	    (void) character_pushback(lexer, GROUND_STATE);
+	else
+	    nmea_sum_update(lexer, c);
 	break;
     case NMEA_CR:
 	if (c == '\n')
@@ -1544,12 +1599,17 @@ static void packet_accept(struct gps_lexer_t *lexer, int packet_type)
 }
 
 static void packet_discard(struct gps_lexer_t *lexer)
-/* shift the input buffer to discard all data up to current input pointer */
+/* discard all data up to current input pointer */
 {
     size_t discard = lexer->inbufptr - lexer->inbuffer;
     size_t remaining = lexer->inbuflen - discard;
-    lexer->inbufptr = memmove(lexer->inbuffer, lexer->inbufptr, remaining);
+    if (remaining == 0)
+	lexer->inbufptr = lexer->inbufstore;
+    lexer->inbuffer = lexer->inbufptr;
     lexer->inbuflen = remaining;
+#ifdef NMEA0183_ENABLE
+    nmea_sum_reset(lexer);
+#endif /* NMEA0183_ENABLE */
     if (lexer->errout.debug >= LOG_RAW+1) {
 	char scratchbuf[MAX_PACKET_LENGTH*4+1];
 	gpsd_log(&lexer->errout, LOG_RAW + 1,
@@ -1582,14 +1642,24 @@ static void packet_stash(struct gps_lexer_t *lexer)
 static void packet_unstash(struct gps_lexer_t *lexer)
 /* return stash to start of input buffer */
 {
-    size_t available = sizeof(lexer->inbuffer) - lexer->inbuflen;
+    size_t available = sizeof(lexer->inbufstore) - lexer->inbuflen;
     size_t stashlen = lexer->stashbuflen;
 
     if (stashlen <= available) {
-	memmove(lexer->inbuffer + stashlen, lexer->inbuffer, lexer->inbuflen);
+	/* usually there is room in front of the unconsumed input */
+	if ((size_t)(lexer->inbuffer - lexer->inbufstore) < stashlen) {
+	    memmove(lexer->inbufstore + stashlen, lexer->inbuffer,
+		    lexer->inbuflen);
+	    lexer->inbuffer = lexer->inbufstore + stashlen;
+	}
+	lexer->inbuffer -= stashlen;
+	lexer->inbufptr = lexer->inbuffer;
 	memcpy(lexer->inbuffer, lexer->stashbuffer, stashlen);
 	lexer->inbuflen += stashlen;
 	lexer->stashbuflen = 0;
+#ifdef NMEA0183_ENABLE
+	nmea_sum_reset(lexer);
+#endif /* NMEA0183_ENABLE */
 	if (lexer->errout.debug >= LOG_RAW+1) {
 	    char scratchbuf[MAX_PACKET_LENGTH*4+1];
 	    gpsd_log(&lexer->errout, LOG_RAW+1,
@@ -1607,10 +1677,16 @@ static void packet_unstash(struct gps_lexer_t *lexer)
 #endif /* STASH_ENABLE */
 
 static void character_discard(struct gps_lexer_t *lexer)
-/* shift the input buffer to discard one character and reread data */
+/* discard one character and reread data */
 {
-    memmove(lexer->inbuffer, lexer->inbuffer + 1, (size_t)-- lexer->inbuflen);
+    if (--lexer->inbuflen == 0)
+	lexer->inbuffer = lexer->inbufstore;
+    else
+	lexer->inbuffer++;
     lexer->inbufptr = lexer->inbuffer;
+#ifdef NMEA0183_ENABLE
+    nmea_sum_reset(lexer);
+#endif /* NMEA0183_ENABLE */
     if (lexer->errout.debug >= LOG_RAW+1) {
 	char scratchbuf[MAX_PACKET_LENGTH*4+1];
 	gpsd_log(&lexer->errout, LOG_RAW + 1,
@@ -1636,6 +1712,7 @@ void lexer_init(struct gps_lexer_t *lexer)
 #endif /* PASSTHROUGH_ENABLE */
 #ifdef TIMING_ENABLE
     lexer->start_time = 0.0;
+    lexer->read_ns = lexer->lex_ns = 0;
 #endif /* TIMING_ENABLE */
     packet_reset(lexer);
     errout_reset(&lexer->errout);
@@ -1673,6 +1750,7 @@ void packet_parse(struct gps_lexer_t *lexer)
 	    if (!str_starts_with((const char *)lexer->inbuffer, "$PASHR,")
 		&& !(lexer->flags & LEXER_F_IGNORE_CHECKSUM))
 	    {
+		static const char hexdigits[] = "0123456789ABCDEF";
 		bool checksum_ok = true;
 		char csum[3] = { '0', '0', '0' };
 		char *end;
@@ -1682,13 +1760,28 @@ void packet_parse(struct gps_lexer_t *lexer)
 		 */
 		for (end = (char *)lexer->inbufptr - 1; isspace((unsigned char) *end); end--)
 		    continue;
-		while (strchr("0123456789ABCDEF", *end))
+		/* the checksum is compared case-blind, so scan it that way */
+		while (isxdigit((unsigned char) *end))
 		    --end;
 		if (*end == '*') {
-		    unsigned int n, crc = 0;
-		    for (n = 1; (char *)lexer->inbuffer + n < end; n++)
-			crc ^= lexer->inbuffer[n];
-		    (void)snprintf(csum, sizeof(csum), "%02X", crc);
+		    size_t star = end - (char *)lexer->inbuffer;
+		    unsigned int crc;
+		    /*
+		     * The body states accumulated the checksum as the
+		     * sentence came in.  Only sentences whose '*' was
+		     * seen by some other state (TNT) need the loop.
+		     */
+		    if (star == lexer->nmea_star)
+			crc = lexer->nmea_starsum;
+		    else {
+			unsigned int n;
+			crc = 0;
+			for (n = 1; n < star; n++)
+			    crc ^= lexer->inbuffer[n];
+		    }
+		    csum[0] = hexdigits[(crc >> 4) & 0x0f];
+		    csum[1] = hexdigits[crc & 0x0f];
+		    csum[2] = '\0';
 		    checksum_ok = (csum[0] == toupper((unsigned char) end[1])
 				   && csum[1] == toupper((unsigned char) end[2]));
 		}
@@ -1704,25 +1797,7 @@ void packet_parse(struct gps_lexer_t *lexer)
 	    }
 	    /* checksum passed or not present */
 #ifdef AIVDM_ENABLE
-	    if (str_starts_with((char *)lexer->inbuffer, "!AIVDM"))
-		packet_accept(lexer, AIVDM_PACKET);
-	    else if (str_starts_with((char *)lexer->inbuffer, "!AIVDO"))
-		packet_accept(lexer, AIVDM_PACKET);
-	    else if (str_starts_with((char *)lexer->inbuffer, "!BSVDM"))
-		packet_accept(lexer, AIVDM_PACKET);
-	    else if (str_starts_with((char *)lexer->inbuffer, "!BSVDO"))
-		packet_accept(lexer, AIVDM_PACKET);
-	    else if (str_starts_with((char *)lexer->inbuffer, "!ABVDM"))
-		packet_accept(lexer, AIVDM_PACKET);
-	    else if (str_starts_with((char *)lexer->inbuffer, "!ABVDO"))
-		packet_accept(lexer, AIVDM_PACKET);
-	    else if (str_starts_with((char *)lexer->inbuffer, "!ANVDM"))
-		packet_accept(lexer, AIVDM_PACKET);
-	    else if (str_starts_with((char *)lexer->inbuffer, "!ANVDO"))
-		packet_accept(lexer, AIVDM_PACKET);
-	    else if (str_starts_with((char *)lexer->inbuffer, "!SAVDM"))
-		packet_accept(lexer, AIVDM_PACKET);
-	    else if (str_starts_with((char *)lexer->inbuffer, "!SAVDO"))
+	    if (aivdm_sentence(lexer->inbuffer))
 		packet_accept(lexer, AIVDM_PACKET);
 	    else
 #endif /* AIVDM_ENABLE */
@@ -2336,14 +2411,61 @@ void packet_parse(struct gps_lexer_t *lexer)
 
 #undef getword
 
+static void packet_compact(struct gps_lexer_t *lexer)
+/* make room for a read by moving unconsumed input to the buffer front */
+{
+    size_t consumed = lexer->inbuffer - lexer->inbufstore;
+    size_t room = sizeof(lexer->inbufstore) - consumed - lexer->inbuflen;
+
+    /*
+     * Moving only once half the buffer has been consumed, or when a
+     * read would get less than a quarter of it, keeps the copying
+     * proportional to the input instead of to input times buffer size.
+     */
+    if (consumed == 0
+	|| (consumed < sizeof(lexer->inbufstore) / 2
+	    && room >= sizeof(lexer->inbufstore) / 4))
+	return;
+    memmove(lexer->inbufstore, lexer->inbuffer, lexer->inbuflen);
+    lexer->inbufptr -= consumed;
+    lexer->inbuffer = lexer->inbufstore;
+}
+
 ssize_t packet_get(int fd, struct gps_lexer_t *lexer)
 /* grab a packet; return -1=>I/O error, 0=>EOF, or a length */
 {
     ssize_t recvd;
+#ifdef TIMING_ENABLE
+    uint64_t stamp = latency_now();
+#endif /* TIMING_ENABLE */
 
+    /*
+     * A single read can bring in many packets' worth of input.  Drain
+     * packets already sitting in the buffer before going back to the
+     * device, so a busy source costs one read(2) per buffer fill
+     * rather than one per packet.
+     */
+    if (packet_buffered_input(lexer) > 0) {
+	/* coverity[tainted_data] */
+	packet_parse(lexer);
+#ifdef TIMING_ENABLE
+	lexer->lex_ns += latency_now() - stamp;
+#endif /* TIMING_ENABLE */
+	if (lexer->outbuflen > 0)
+	    return (ssize_t) lexer->outbuflen;
+    }
+
+    packet_compact(lexer);
     errno = 0;
+#ifdef TIMING_ENABLE
+    stamp = latency_now();
+#endif /* TIMING_ENABLE */
     recvd = read(fd, lexer->inbuffer + lexer->inbuflen,
-		 sizeof(lexer->inbuffer) - (lexer->inbuflen));
+		 sizeof(lexer->inbufstore) - (lexer->inbuffer - lexer->inbufstore)
+		 - lexer->inbuflen);
+#ifdef TIMING_ENABLE
+    lexer->read_ns += latency_now() - stamp;
+#endif /* TIMING_ENABLE */
     if (recvd == -1) {
 	if ((errno == EAGAIN) || (errno == EINTR)) {
 	    gpsd_log(&lexer->errout, LOG_RAW + 2, "no bytes ready\n");
@@ -2378,11 +2500,17 @@ ssize_t packet_get(int fd, struct gps_lexer_t *lexer)
 	return recvd;
 
     /* Otherwise, consume from the packet input buffer */
+#ifdef TIMING_ENABLE
+    stamp = latency_now();
+#endif /* TIMING_ENABLE */
     /* coverity[tainted_data] */
     packet_parse(lexer);
+#ifdef TIMING_ENABLE
+    lexer->lex_ns += latency_now() - stamp;
+#endif /* TIMING_ENABLE */
 
     /* if input buffer is full, discard */
-    if (sizeof(lexer->inbuffer) == (lexer->inbuflen)) {
+    if (sizeof(lexer->inbufstore) == (lexer->inbuflen)) {
 	/* coverity[tainted_data] */
 	packet_discard(lexer);
 	lexer->state = GROUND_STATE;
@@ -2423,7 +2551,10 @@ void packet_reset(struct gps_lexer_t *lexer)
     lexer->type = BAD_PACKET;
     lexer->state = GROUND_STATE;
     lexer->inbuflen = 0;
-    lexer->inbufptr = lexer->inbuffer;
+    lexer->inbufptr = lexer->inbuffer = lexer->inbufstore;
+#ifdef NMEA0183_ENABLE
+    nmea_sum_reset(lexer);
+#endif /* NMEA0183_ENABLE */
 #ifdef BINARY_ENABLE
     isgps_init(lexer);
 #endif /* BINARY_ENABLE */
@@ -82,6 +82,7 @@
 #include <sys/timepps.h>
 #endif
 
+#include "compiler.h"	/* for memory_barrier() */
 #include "timespec.h"
 #include "ppsthread.h"
 #include "os_compat.h"
@@ -647,6 +648,78 @@ static int get_edge_rfc2783(struct inner_context_t *inner_context,
 }
 #endif  /* defined(HAVE_SYS_TIMEPPS_H) */
 
+void pps_hist_add(struct pps_hist_t *hist, long long ns)
+/* count a sample, in nanoseconds, into a histogram */
+{
+    int b = 0;
+
+    if (ns < 0)
+	ns = -ns;
+    while (b < PPS_HIST_BUCKETS - 1 && (ns >> (b + 1)) != 0)
+	b++;
+    hist->bucket[b]++;
+    hist->count++;
+    if (ns > hist->max)
+	hist->max = ns;
+}
+
+void pps_hist_merge(struct pps_hist_t *to, const struct pps_hist_t *from)
+/* add one histogram's counts into another */
+{
+    int b;
+
+    for (b = 0; b < PPS_HIST_BUCKETS; b++)
+	to->bucket[b] += from->bucket[b];
+    to->count += from->count;
+    if (from->max > to->max)
+	to->max = from->max;
+}
+
+long long pps_hist_quantile(const struct pps_hist_t *hist, double q)
+/* upper bound, in nanoseconds, of the bucket holding quantile q */
+{
+    unsigned long seen = 0, want = (unsigned long)ceil(q * hist->count);
+    int b;
+
+    if (hist->count == 0)
+	return 0;
+    for (b = 0; b < PPS_HIST_BUCKETS - 1; b++) {
+	seen += hist->bucket[b];
+	if (seen >= want)
+	    break;
+    }
+    /* the top bucket is open-ended, and no bucket exceeds the maximum */
+    if (b == PPS_HIST_BUCKETS - 1 || hist->max < (1LL << (b + 1)) - 1)
+	return hist->max;
+    return (1LL << (b + 1)) - 1;
+}
+
+static void pps_stats_roll(struct pps_stats_t *stats, time_t now)
+/* start a new histogram half once the current one has run its window */
+{
+    int w;
+
+    if (now - stats->window_start < PPS_STATS_WINDOW)
+	return;
+    w = stats->window ^= 1;
+    memset(&stats->jitter[w], 0, sizeof(stats->jitter[w]));
+    memset(&stats->disagree[w], 0, sizeof(stats->disagree[w]));
+    memset(&stats->delay[w], 0, sizeof(stats->delay[w]));
+    stats->window_start = now;
+}
+
+static void pps_stats_publish(volatile struct pps_thread_t *pps_thread,
+			      const struct pps_stats_t *stats)
+/* copy the thread's statistics out for pps_thread_stats() */
+{
+    /* a reader that sees an odd or changed sequence number retries */
+    pps_thread->stats_seq++;
+    memory_barrier();
+    memcpy((void *)&pps_thread->stats, stats, sizeof(*stats));
+    memory_barrier();
+    pps_thread->stats_seq++;
+}
+
 /* gpsd_ppsmonitor()
  *
  * the core loop of the PPS thread.
@@ -672,6 +745,11 @@ static void *gpsd_ppsmonitor(void *arg)
     int state_last = 0;
     /* edge, used as index into pulse to find previous edges */
     int edge = 0;       /* 0 = clear edge, 1 = assert edge */
+    /* cycle to the nanosecond, for the jitter statistics */
+    long long cycle_ns = 0;
+    /* statistics are kept here and published after each change */
+    struct pps_stats_t stats;
+    bool stats_dirty = false;
 
 #if defined(TIOCMIWAIT)
     int edge_tio = 0;
@@ -691,6 +769,8 @@ static void *gpsd_ppsmonitor(void *arg)
 #endif /* defined(HAVE_SYS_TIMEPPS_H) */
     bool not_a_tty = false;
 
+    memset(&stats, 0, sizeof(stats));
+
     /* Acknowledge that we've grabbed the inner_context data */
     ((volatile struct inner_context_t *)arg)->pps_thread = NULL;
 
@@ -765,6 +845,11 @@ static void *gpsd_ppsmonitor(void *arg)
 	char *log = NULL;
         char *edge_str = "";
 
+	if (stats_dirty) {
+	    pps_stats_publish(thread_context, &stats);
+	    stats_dirty = false;
+	}
+
 	if (++unchanged == 10) {
             /* last ten edges no good, stop spinning, just wait 10 seconds */
 	    unchanged = 0;
@@ -803,6 +888,7 @@ static void *gpsd_ppsmonitor(void *arg)
 
 	    /* calculate cycle and duration from previous edges */
 	    cycle_tio = timespec_diff_ns(clock_ts_tio, pulse_tio[edge_tio]);
+	    cycle_ns = cycle_tio;
 	    cycle_tio /= 1000;  /* nsec to usec */
 	    duration_tio = timespec_diff_ns(clock_ts_tio,
 			pulse_tio[edge_tio ? 0 : 1])/1000;
@@ -869,6 +955,7 @@ static void *gpsd_ppsmonitor(void *arg)
 
             /* compute time from previous saved similar edge */
 	    cycle_kpps = timespec_diff_ns(clock_ts_kpps, pulse_kpps[edge_kpps]);
+	    cycle_ns = cycle_kpps;
 	    cycle_kpps /= 1000;
             /* compute time from previous saved dis-similar edge */
 	    duration_kpps = timespec_diff_ns(clock_ts_kpps, prev_clock_ts)/1000;
@@ -878,6 +965,14 @@ static void *gpsd_ppsmonitor(void *arg)
 	    pulse_kpps[edge_kpps ? 0 : 1] = prev_clock_ts;
             /* sanity checks are later */
 
+#if defined(TIOCMIWAIT)
+	    /* both methods saw this edge; how far apart do they put it? */
+	    if (!not_a_tty && !inner_context.pps_canwait
+		&& 0 != clock_ts_tio.tv_sec)
+		pps_hist_add(&stats.disagree[stats.window],
+			     timespec_diff_ns(clock_ts_kpps, clock_ts_tio));
+#endif /* TIOCMIWAIT */
+
             /* use this data */
 	    state = edge_kpps;
 	    edge = edge_kpps;
@@ -903,6 +998,10 @@ static void *gpsd_ppsmonitor(void *arg)
 			thread_context->devicename);
 	    break;
 	}
+	stats.edges++;
+	pps_stats_roll(&stats, clock_ts.tv_sec);
+	stats_dirty = true;
+
 	/*
          * End of Stge One
 	 * we now know this about the exact moment of current pulse:
@@ -1105,6 +1204,7 @@ static void *gpsd_ppsmonitor(void *arg)
 	}
 
 	if ( !ok ) {
+	    stats.rejected++;
             /* can not use this pulse, reject and retry */
 	    thread_context->log_hook(thread_context, THREAD_PROG,
 			"PPS:%s %.10s rejected %.100s",
@@ -1114,6 +1214,11 @@ static void *gpsd_ppsmonitor(void *arg)
 
         /* we have validated a goood cycle, mark it */
 	unchanged = 0;
+	/* jitter is the error from the nominal 0.2, 1 or 2 second cycle */
+	pps_hist_add(&stats.jitter[stats.window],
+		     cycle_ns - (201000 > cycle ? 200000000LL
+				 : 1100000 > cycle ? 1000000000LL
+				 : 2000000000LL));
 	/* offset is the skew from expected to observed pulse time */
 	struct timespec offset;
 	/* offset as a printable string */
@@ -1165,6 +1270,7 @@ static void *gpsd_ppsmonitor(void *arg)
 			edge_str,
 			delay_str);
 	    log1 = "system clock went backwards";
+	    stats.unusable++;
 	} else if ( ( 2 < delay.tv_sec)
 	  || ( 1 == delay.tv_sec && 100000000 < delay.tv_nsec ) ) {
 	    /* system clock could be slewing so allow up to 1.1 sec delay */
@@ -1175,8 +1281,15 @@ static void *gpsd_ppsmonitor(void *arg)
 			edge_str,
 			delay_str);
 	    log1 = "timestamp out of range";
+	    stats.unusable++;
 	} else {
 	    last_second_used = last_fixtime.real.tv_sec;
+	    stats.accepted++;
+	    pps_hist_add(&stats.delay[stats.window],
+			 (long long)delay.tv_sec * 1000000000LL + delay.tv_nsec);
+	    /* so the report hook can read statistics including this pulse */
+	    pps_stats_publish(thread_context, &stats);
+	    stats_dirty = false;
 	    if (thread_context->report_hook != NULL)
 		log1 = thread_context->report_hook(thread_context, &ppstimes);
 	    else
@@ -1282,6 +1395,25 @@ void pps_thread_fixin(volatile struct pps_thread_t *pps_thread,
     thread_unlock(pps_thread);
 }
 
+bool pps_thread_stats(volatile struct pps_thread_t *pps_thread,
+		      struct pps_stats_t *stats)
+/* lock-free snapshot of the thread's statistics, false if there are none */
+{
+    int tries;
+
+    /* the thread updates at most a few times a second, so this settles */
+    for (tries = 0; tries < 10; tries++) {
+	unsigned long seq = pps_thread->stats_seq;
+
+	memory_barrier();
+	memcpy(stats, (void *)&pps_thread->stats, sizeof(*stats));
+	memory_barrier();
+	if ((seq & 1) == 0 && seq == pps_thread->stats_seq)
+	    return seq != 0;
+    }
+    return false;
+}
+
 int pps_thread_ppsout(volatile struct pps_thread_t *pps_thread,
 		       volatile struct timedelta_t *td)
 /* return the delta at the time of the last PPS - only way we pass data out */
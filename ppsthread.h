@@ -6,6 +6,7 @@
 #ifndef PPSTHREAD_H
 #define PPSTHREAD_H
 
+#include <stdbool.h>
 #include <time.h>
 
 #ifndef TIMEDELTA_DEFINED
@@ -16,6 +17,33 @@ struct timedelta_t {
 };
 #endif /* TIMEDELTA_DEFINED */
 
+/*
+ * Rolling statistics kept by the PPS thread.  Histogram bucket i counts
+ * samples of at least 2^i and less than 2^(i+1) nanoseconds; bucket 0
+ * also takes anything shorter.  Each histogram has two halves that
+ * take turns covering PPS_STATS_WINDOW seconds, and the older half is
+ * cleared when they swap, so their sum spans the last one to two windows.
+ */
+#define PPS_HIST_BUCKETS	32	/* up to 2^32 ns, about 4 seconds */
+#define PPS_STATS_WINDOW	64	/* seconds per histogram half */
+struct pps_hist_t {
+    unsigned long count;
+    long long max;			/* ns */
+    unsigned long bucket[PPS_HIST_BUCKETS];
+};
+
+struct pps_stats_t {
+    unsigned long edges;		/* edges seen */
+    unsigned long accepted;		/* pulses reported */
+    unsigned long rejected;		/* failed cycle, duration or fix checks */
+    unsigned long unusable;		/* fix-to-PPS delay out of range */
+    time_t window_start;		/* when the current half began */
+    int window;				/* index of the current half */
+    struct pps_hist_t jitter[2];	/* edge-to-edge cycle error */
+    struct pps_hist_t disagree[2];	/* KPPS vs. TIOCMIWAIT timestamp */
+    struct pps_hist_t delay[2];		/* in-band fix to PPS edge */
+};
+
 /*
  * Set context, devicefd, and devicename at initialization time, before
  * you call pps_thread_activate().  The context pointer can be used to
@@ -39,6 +67,9 @@ struct pps_thread_t {
     struct timedelta_t fix_in;	/* real & clock time when in-band fix received */
     struct timedelta_t pps_out;	/* real & clock time of last PPS event */
     int ppsout_count;
+    /* written only by the PPS thread; odd stats_seq means mid-update */
+    unsigned long stats_seq;
+    struct pps_stats_t stats;
 };
 
 #define THREAD_ERROR	0
@@ -53,6 +84,11 @@ extern void pps_thread_fixin(volatile struct pps_thread_t *,
 				     volatile struct timedelta_t *);
 extern int pps_thread_ppsout(volatile struct pps_thread_t *,
 			      volatile struct timedelta_t *);
+extern bool pps_thread_stats(volatile struct pps_thread_t *,
+			     struct pps_stats_t *);
+extern void pps_hist_add(struct pps_hist_t *, long long);
+extern void pps_hist_merge(struct pps_hist_t *, const struct pps_hist_t *);
+extern long long pps_hist_quantile(const struct pps_hist_t *, double);
 int pps_check_fake(const char *);
 char *pps_get_first(void);
 
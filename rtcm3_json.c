@@ -14,6 +14,7 @@ PERMISSIONS
 ***************************************************************************/
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
 #include <string.h>
 #include <stddef.h>
@@ -23,6 +24,14 @@ PERMISSIONS
 #ifdef SOCKET_EXPORT_ENABLE
 #include "gps_json.h"
 
+static unsigned int json_rtcm3_type(const char *buf)
+/* message type of an RTCM3 report, 0 if there isn't one */
+{
+    const char *tp = strstr(buf, "\"type\":");
+
+    return (tp == NULL) ? 0 : (unsigned int)atoi(tp + 7);
+}
+
 int json_rtcm3_read(const char *buf,
 		    char *path, size_t pathlen, struct rtcm3_t *rtcm3,
 		    const char **endptr)
@@ -38,7 +47,7 @@ int json_rtcm3_read(const char *buf,
 	{"device",         t_string,   .addr.string = path, .len = pathlen}, \
 	{"length",         t_uinteger, .addr.uinteger = &rtcm3->length},
 
-    int status = 0, satcount = 0;
+    int status = 0, satcount = 0, cellcount = 0;
 
 #define RTCM3FIELD(type, fld)	STRUCTOBJECT(struct rtcm3_ ## type ## _t, fld)
     const struct json_attr_t rtcm1001_satellite[] = {
@@ -82,6 +91,30 @@ int json_rtcm3_read(const char *buf,
 	{"CNR",       t_real,     RTCM3FIELD(1010, L1.CNR)},
 	{NULL},
     };
+    const struct json_attr_t msm_satellite[] = {
+	{"ident",     t_ushort,   STRUCTOBJECT(struct rtcm3_msm_sat, ident)},
+	{"range",     t_real,     STRUCTOBJECT(struct rtcm3_msm_sat, rough_range),
+	                             .dflt.real = NAN},
+	{"ext",       t_ushort,   STRUCTOBJECT(struct rtcm3_msm_sat, extended)},
+	{"rate",      t_real,     STRUCTOBJECT(struct rtcm3_msm_sat, rate),
+	                             .dflt.real = NAN},
+	{NULL},
+    };
+
+    const struct json_attr_t msm_signal[] = {
+	{"ident",     t_ushort,   STRUCTOBJECT(struct rtcm3_msm_cell, sat)},
+	{"sig",       t_ushort,   STRUCTOBJECT(struct rtcm3_msm_cell, signal)},
+	{"prange",    t_real,     STRUCTOBJECT(struct rtcm3_msm_cell, pseudorange),
+	                             .dflt.real = NAN},
+	{"phase",     t_real,     STRUCTOBJECT(struct rtcm3_msm_cell, phaserange),
+	                             .dflt.real = NAN},
+	{"lockt",     t_ushort,   STRUCTOBJECT(struct rtcm3_msm_cell, locktime)},
+	{"half",      t_boolean,  STRUCTOBJECT(struct rtcm3_msm_cell, halfcycle)},
+	{"CNR",       t_real,     STRUCTOBJECT(struct rtcm3_msm_cell, CNR)},
+	{"rate",      t_real,     STRUCTOBJECT(struct rtcm3_msm_cell, rate),
+	                             .dflt.real = NAN},
+	{NULL},
+    };
 #undef RTCM3FIELD
 
 #define R1001	&rtcm3->rtcmtypes.rtcm3_1001.header
@@ -196,6 +229,29 @@ int json_rtcm3_read(const char *buf,
     };
 #undef R1033
 
+#define RMSM	rtcm3->rtcmtypes.rtcm3_msm
+    const struct json_attr_t json_rtcm3_msm[] = {
+	RTCM3_HEADER
+	{"station_id", t_uinteger, .addr.uinteger = &RMSM.station_id},
+	{"tow",        t_uinteger, .addr.uinteger = &RMSM.tow},
+	{"day",        t_uinteger, .addr.uinteger = &RMSM.glonass_day},
+        {"sync",       t_boolean,  .addr.boolean = &RMSM.sync},
+	{"iods",       t_uinteger, .addr.uinteger = &RMSM.iods},
+	{"steering",   t_uinteger, .addr.uinteger = &RMSM.steering},
+	{"extclock",   t_uinteger, .addr.uinteger = &RMSM.extclock},
+        {"smoothing",  t_boolean,  .addr.boolean = &RMSM.smoothing},
+	{"interval",   t_uinteger, .addr.uinteger = &RMSM.interval},
+	{"nsat",       t_ignore},
+	{"nsig",       t_ushort,   .addr.ushortint = &RMSM.nsig},
+	{"ncell",      t_ignore},
+        {"satellites", t_array,    STRUCTARRAY(RMSM.sats,
+					    msm_satellite, &satcount)},
+        {"signals",    t_array,    STRUCTARRAY(RMSM.cells,
+					    msm_signal, &cellcount)},
+	{NULL},
+    };
+#undef RMSM
+
     const struct json_attr_t json_rtcm3_fallback[] = {
 	RTCM3_HEADER
 	{"data",     t_array, .addr.array.element_type = t_string,
@@ -232,6 +288,12 @@ int json_rtcm3_read(const char *buf,
 	status = json_read_object(buf, json_rtcm1014, endptr);
     } else if (strstr(buf, "\"type\":1033,") != NULL) {
 	status = json_read_object(buf, json_rtcm1033, endptr);
+    } else if (RTCM3_MSM(json_rtcm3_type(buf)) != 0) {
+	status = json_read_object(buf, json_rtcm3_msm, endptr);
+	if (status == 0) {
+	    rtcm3->rtcmtypes.rtcm3_msm.nsat = (unsigned short)satcount;
+	    rtcm3->rtcmtypes.rtcm3_msm.ncell = (unsigned short)cellcount;
+	}
     } else {
 	int n;
 	status = json_read_object(buf, json_rtcm3_fallback, endptr);
@@ -17,6 +17,7 @@ PERMISSIONS
 
 #include <math.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "gpsd.h"
 #ifdef SOCKET_EXPORT_ENABLE
@@ -73,12 +74,78 @@ int json_device_read(const char *buf,
     return 0;
 }
 
+/* *INDENT-OFF* */
+const struct json_enum_t watch_class_map[] = {
+    {"TPV",		CLASS_TPV},
+    {"SKY",		CLASS_SKY},
+    {"GST",		CLASS_GST},
+    {"ATT",		CLASS_ATT},
+    {"SUBFRAME",	CLASS_SUBFRAME},
+    {"RTCM2",		CLASS_RTCM2},
+    {"RTCM3",		CLASS_RTCM3},
+    {"AIS",		CLASS_AIS},
+    {"OSC",		CLASS_OSC},
+    {"PPS",		CLASS_PPS},
+    {"TOFF",		CLASS_TOFF},
+    {"PPSSTATS",	CLASS_PPSSTATS},
+    {"LATENCY",		CLASS_LATENCY},
+    {NULL},
+};
+
+const struct json_enum_t watch_field_map[] = {
+    {"status",		TPV_STATUS},
+    {"time",		TPV_TIME},
+    {"ept",		TPV_EPT},
+    {"lat",		TPV_LAT},
+    {"lon",		TPV_LON},
+    {"alt",		TPV_ALT},
+    {"epx",		TPV_EPX},
+    {"epy",		TPV_EPY},
+    {"epv",		TPV_EPV},
+    {"track",		TPV_TRACK},
+    {"speed",		TPV_SPEED},
+    {"climb",		TPV_CLIMB},
+    {"epd",		TPV_EPD},
+    {"eps",		TPV_EPS},
+    {"epc",		TPV_EPC},
+    {NULL},
+};
+/* *INDENT-ON* */
+
+static int json_watch_mask(char **names, int count,
+			   const struct json_enum_t *map, unsigned int *mask)
+/* turn a list of names into a bitmask; unknown names are an error */
+{
+    const struct json_enum_t *mp;
+    unsigned int bits = 0;
+    int i;
+
+    for (i = 0; i < count; i++) {
+	for (mp = map; mp->name != NULL; mp++)
+	    if (strcmp(names[i], mp->name) == 0)
+		break;
+	if (mp->name == NULL)
+	    return JSON_ERR_BADENUM;
+	bits |= (unsigned int)mp->value;
+    }
+    *mask = bits;
+    return 0;
+}
+
 int json_watch_read(const char *buf,
 		    struct policy_t *ccp,
 		    const char **endptr)
 {
-    bool dummy_pps_flag;
+    char *classptrs[16], *fieldptrs[16];
+    char classstore[128], fieldstore[128];
+    int classcount = 0, fieldcount = 0;
     /* *INDENT-OFF* */
+    const struct json_enum_t backlog_map[] = {
+	{"drop",	BACKLOG_DROP},
+	{"coalesce",	BACKLOG_COALESCE},
+	{"disconnect",	BACKLOG_DISCONNECT},
+	{NULL},
+    };
     struct json_attr_t chanconfig_attrs[] = {
 	{"class",          t_check,    .dflt.check = "WATCH"},
 
@@ -94,18 +161,42 @@ int json_watch_read(const char *buf,
 	{"timing",         t_boolean,  .addr.boolean = &ccp->timing},
 	{"split24",        t_boolean,  .addr.boolean = &ccp->split24},
 	{"pps",            t_boolean,  .addr.boolean = &ccp->pps},
+	{"binary",         t_boolean,  .addr.boolean = &ccp->binary},
+	{"classes",        t_array,    .addr.array.element_type = t_string,
+	                                  .addr.array.arr.strings.ptrs = classptrs,
+	                                  .addr.array.arr.strings.store = classstore,
+	                                  .addr.array.arr.strings.storelen = sizeof(classstore),
+	                                  .addr.array.count = &classcount,
+	                                  .addr.array.maxlen = NITEMS(classptrs)},
+	{"fields",         t_array,    .addr.array.element_type = t_string,
+	                                  .addr.array.arr.strings.ptrs = fieldptrs,
+	                                  .addr.array.arr.strings.store = fieldstore,
+	                                  .addr.array.arr.strings.storelen = sizeof(fieldstore),
+	                                  .addr.array.count = &fieldcount,
+	                                  .addr.array.maxlen = NITEMS(fieldptrs)},
+	{"interval",       t_real,     .addr.real = &ccp->interval,
+	                                  .dflt.real = 0},
+	{"backlog",        t_integer,  .addr.integer = &ccp->backlog,
+	                                  .map = backlog_map,
+	                                  .nodefault = true},
 	{"device",         t_string,   .addr.string = ccp->devpath,
 	                                  .len = sizeof(ccp->devpath)},
 	{"remote",         t_string,   .addr.string = ccp->remote,
 	                                  .len = sizeof(ccp->remote)},
-	{"pps",            t_boolean,  .addr.boolean = &dummy_pps_flag,
-                                          .nodefault = false},
 	{NULL},
     };
     /* *INDENT-ON* */
     int status;
 
     status = json_read_object(buf, chanconfig_attrs, endptr);
+    if (status == 0)
+	status = json_watch_mask(classptrs, classcount,
+				 watch_class_map, &ccp->classes);
+    if (status == 0)
+	status = json_watch_mask(fieldptrs, fieldcount,
+				 watch_field_map, &ccp->fields);
+    if (status == 0 && !(ccp->interval >= 0))
+	status = JSON_ERR_BADNUM;
     return status;
 }
 
@@ -9,6 +9,13 @@ won't be able to filter by device, and won't get device activation/deactivation
 notifications.  But both client and daemon will avoid all the marshalling and
 unmarshalling overhead.
 
+   Each device slot has its own ring of the last SHM_EXPORT_SLOTS updates,
+numbered from a single sequence shared by all rings, so a reader that falls
+a little behind can still collect every update in order.  Each ring slot is
+guarded by a seqlock, and only the sections of gps_data_t named by the
+update's mask are written.  After each update the wakeup word in the
+segment header is bumped; on Linux readers sleep on it as a futex.
+
 PERMISSIONS
    This file is Copyright (c) 2010 by the GPSD project
    BSD terms apply: see the file COPYING in the distribution root for details.
@@ -17,6 +24,8 @@ PERMISSIONS
 
 /* sys/ipc.h needs _XOPEN_SOURCE, 500 means X/Open 1995 */
 #define _XOPEN_SOURCE 500
+/* syscall() needs _DEFAULT_SOURCE */
+#define _DEFAULT_SOURCE
 
 #include "gpsd_config.h"
 
@@ -29,6 +38,12 @@ PERMISSIONS
 #include <sys/time.h>
 #include <sys/ipc.h>
 #include <sys/shm.h>
+#ifdef HAVE_LINUX_FUTEX_H
+#include <limits.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif /* HAVE_LINUX_FUTEX_H */
 
 #include "gpsd.h"
 #include "libgps.h" /* for SHM_PSEUDO_FD */
@@ -40,6 +55,21 @@ bool shm_acquire(struct gps_context_t *context)
     long shmkey = getenv("GPSD_SHM_KEY") ? strtol(getenv("GPSD_SHM_KEY"), NULL, 0) : GPSD_SHM_KEY;
 
     int shmid = shmget((key_t)shmkey, sizeof(struct shmexport_t), (int)(IPC_CREAT|0666));
+    if (shmid == -1 && errno == EINVAL) {
+	/*
+	 * A smaller segment left over from an older daemon holds the
+	 * key.  Mark it for removal, so readers still attached keep
+	 * theirs, and create ours afresh.
+	 */
+	int stale = shmget((key_t)shmkey, 0, 0);
+
+	if (stale != -1 && shmctl(stale, IPC_RMID, NULL) == 0) {
+	    gpsd_log(&context->errout, LOG_WARN,
+		     "removed stale SHM export segment %d\n", stale);
+	    shmid = shmget((key_t)shmkey, sizeof(struct shmexport_t),
+			   (int)(IPC_CREAT|0666));
+	}
+    }
     if (shmid == -1) {
 	gpsd_log(&context->errout, LOG_ERROR,
 		 "shmget(0x%lx, %zd, 0666) for SHM export failed: %s\n",
@@ -62,6 +92,24 @@ bool shm_acquire(struct gps_context_t *context)
     }
     context->shmid = shmid;
 
+    /*
+     * The segment may be left over from an earlier daemon instance.
+     * Clear it before publishing the version, so readers never see
+     * stale update numbers under the new sequence.
+     */
+    {
+	volatile struct shmexport_t *shared =
+	    (struct shmexport_t *)context->shmexport;
+
+	shared->version = 0;
+	memory_barrier();
+	(void)memset((void *)shared, '\0', sizeof(struct shmexport_t));
+	shared->devices = MAX_DEVICES;
+	shared->slots = SHM_EXPORT_SLOTS;
+	memory_barrier();
+	shared->version = SHM_EXPORT_VERSION;
+    }
+
     gpsd_log(&context->errout, LOG_PROG,
 	     "shmat() for SHM export succeeded, segment %d\n", shmid);
     return true;
@@ -85,41 +133,58 @@ void shm_release(struct gps_context_t *context)
     (void)shmdt((const void *)context->shmexport);
 }
 
-void shm_update(struct gps_context_t *context, struct gps_data_t *gpsdata)
-/* export an update to all listeners */
+void shm_update(struct gps_context_t *context, int index,
+		struct gps_data_t *gpsdata)
+/* export an update from device slot index to all listeners */
 {
     if (context->shmexport != NULL)
     {
-	static int tick;
+	static unsigned long sequence;
 	volatile struct shmexport_t *shared = (struct shmexport_t *)context->shmexport;
+	volatile struct shmexport_ring_t *ring = &shared->ring[index];
+	volatile struct shmexport_slot_t *slot =
+	    &ring->slot[ring->head % SHM_EXPORT_SLOTS];
+	unsigned long lock = slot->lock;
 
-	++tick;
+	++sequence;
 	/*
 	 * Following block of instructions must not be reordered, otherwise
 	 * havoc will ensue.
 	 *
-	 * This is a simple optimistic-concurrency technique.  We write
-	 * the second bookend first, then the data, then the first bookend.
-	 * Reader copies what it sees in normal order; that way, if we
-	 * start to write the segment during the read, the second bookend will
-	 * get clobbered first and the data can be detected as bad.
+	 * This is a sequence lock.  The slot's lock word goes odd before
+	 * the data is touched and even again afterwards.  A reader
+	 * samples the lock, copies, then samples it again; if the two
+	 * differ, or the first was odd, the copy may be torn and is
+	 * discarded.
 	 *
 	 * Of course many architectures, like Intel, make no guarantees
-	 * about the actual memory read or write order into RAM, so this
-         * is partly wishful thinking.  Thus the need for the memory_barriers()
-         * to enforce the required order.
+	 * about the actual memory read or write order into RAM, so the
+	 * memory_barrier() calls enforce the required order.
 	 */
-	shared->bookend2 = tick;
-	memory_barrier();
-	shared->gpsdata = *gpsdata;
+	slot->lock = lock + 1;
 	memory_barrier();
+	slot->sequence = sequence;
+	slot->set = gpsdata->set;
+	gps_shm_copy((struct gps_data_t *)&slot->gpsdata, gpsdata,
+		     gpsdata->set);
 #ifndef USE_QT
-	shared->gpsdata.gps_fd = SHM_PSEUDO_FD;
+	slot->gpsdata.gps_fd = SHM_PSEUDO_FD;
 #else
-	shared->gpsdata.gps_fd = (void *)(intptr_t)SHM_PSEUDO_FD;
+	slot->gpsdata.gps_fd = (void *)(intptr_t)SHM_PSEUDO_FD;
 #endif /* USE_QT */
 	memory_barrier();
-	shared->bookend1 = tick;
+	slot->lock = lock + 2;
+	ring->head++;
+	shared->sequence = sequence;
+	memory_barrier();
+	shared->wakeup++;
+	memory_barrier();
+#ifdef HAVE_LINUX_FUTEX_H
+	/* skip the system call when nobody is asleep */
+	if (shared->waiters > 0)
+	    (void)syscall(SYS_futex, &shared->wakeup, FUTEX_WAKE, INT_MAX,
+			  NULL, NULL, 0);
+#endif /* HAVE_LINUX_FUTEX_H */
     }
 }
 
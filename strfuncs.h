@@ -11,6 +11,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 #include "compiler.h"
 
 
@@ -43,4 +44,132 @@ static inline void str_rstrip_char(char *str, char ch)
     }
 }
 
+/*
+ * A string cursor appends to a fixed-size buffer while keeping track of
+ * where the text ends, so building up a long report doesn't rescan it
+ * with strlen() at every field the way str_appendf() does.  Like
+ * snprintf() it truncates silently and always leaves the buffer
+ * NUL-terminated.  The buffer size must be nonzero.
+ */
+struct strcursor_t {
+    char *buf;
+    size_t size;	/* allocated size of buf */
+    size_t len;		/* length of the text so far */
+};
+
+
+static inline void strc_init(struct strcursor_t *c, char *buf, size_t size)
+{
+    c->buf = buf;
+    c->size = size;
+    c->len = 0;
+    buf[0] = '\0';
+}
+
+
+static inline void strc_putn(struct strcursor_t *c, const char *s, size_t n)
+{
+    if (n > c->size - 1 - c->len)
+        n = c->size - 1 - c->len;
+    memcpy(c->buf + c->len, s, n);
+    c->len += n;
+    c->buf[c->len] = '\0';
+}
+
+
+static inline void strc_puts(struct strcursor_t *c, const char *s)
+{
+    strc_putn(c, s, strlen(s));
+}
+
+
+static inline void strc_vprintf(struct strcursor_t *c, const char *format, va_list ap)
+{
+    int n = vsnprintf(c->buf + c->len, c->size - c->len, format, ap);
+
+    if (n > 0)
+        c->len += ((size_t)n < c->size - c->len) ? (size_t)n : c->size - 1 - c->len;
+}
+
+
+PRINTF_FUNC(2, 3)
+static inline void strc_printf(struct strcursor_t *c, const char *format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+    strc_vprintf(c, format, ap);
+    va_end(ap);
+}
+
+
+static inline void strc_int(struct strcursor_t *c, long long v)
+/* same as printf %lld, without the format interpretation */
+{
+    char digits[24];
+    char *dp = digits + sizeof(digits);
+    unsigned long long u = (v < 0) ? 0ULL - (unsigned long long)v : (unsigned long long)v;
+
+    do {
+        *--dp = (char)('0' + u % 10);
+        u /= 10;
+    } while (u != 0);
+    if (v < 0)
+        *--dp = '-';
+    strc_putn(c, dp, (size_t)(digits + sizeof(digits) - dp));
+}
+
+
+static inline void strc_fixed(struct strcursor_t *c, double d, int places)
+/* same as printf %.*f for places 0..9, mostly without printf */
+{
+    static const double scale[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+    };
+
+    if (places >= 0 && places < (int)(sizeof(scale) / sizeof(scale[0]))
+        && isfinite(d)) {
+        double x = fabs(d) * scale[places];
+
+        /*
+         * printf rounds the exact binary value.  The product carries at
+         * most half an ulp of error, so unless it lands too near a tie to
+         * tell which way the exact value rounds, we can do the same.
+         */
+        if (x < 4503599627370496.0) {	/* 2^52, frac is then exact */
+            double whole = floor(x);
+            double frac = x - whole;
+
+            if (fabs(frac - 0.5) > x * 4e-16 + 1e-300) {
+                unsigned long long n = (unsigned long long)whole + (frac > 0.5);
+                char digits[32];
+                char *dp = digits + sizeof(digits);
+                int i;
+
+                for (i = 0; i < places; i++) {
+                    *--dp = (char)('0' + n % 10);
+                    n /= 10;
+                }
+                if (places > 0)
+                    *--dp = '.';
+                do {
+                    *--dp = (char)('0' + n % 10);
+                    n /= 10;
+                } while (n != 0);
+                if (signbit(d))
+                    *--dp = '-';
+                strc_putn(c, dp, (size_t)(digits + sizeof(digits) - dp));
+                return;
+            }
+        }
+    }
+    strc_printf(c, "%.*f", places, d);
+}
+
+
+static inline void strc_rstrip_char(struct strcursor_t *c, char ch)
+{
+    if (c->len != 0 && c->buf[c->len - 1] == ch)
+        c->buf[--c->len] = '\0';
+}
+
 #endif /* _GPSD_STRFUNCS_H_ */
@@ -0,0 +1,234 @@
+/*
+ * Unit test for the binary report records in binexport.c.
+ *
+ * TPV and SKY reports are packed by binary_data_report() as the daemon
+ * would send them and unpacked by gps_unpack_binary() as libgps would
+ * read them; what comes out must match what went in.  Records from a
+ * different API, layout or byte order, and records whose length does
+ * not match, must be ignored.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include "gpsd.h"
+#include "libgps.h"
+
+#ifdef SOCKET_EXPORT_ENABLE
+
+static int failures;
+static bool quiet = false;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+	(void)printf("FAILED: %s\n", what);
+	++failures;
+    }
+}
+
+static void fake_session(struct gps_device_t *session)
+/* a device with a 3D fix and a few satellites in view */
+{
+    struct gps_data_t *datap = &session->gpsdata;
+    int i;
+
+    memset(session, '\0', sizeof(*session));
+    (void)strlcpy(datap->dev.path, "/dev/ttyUSB0", sizeof(datap->dev.path));
+    datap->status = STATUS_DGPS_FIX;
+    datap->fix.time = 1425274353.438;
+    datap->fix.mode = MODE_3D;
+    datap->fix.ept = 0.005;
+    datap->fix.latitude = 37.371192;
+    datap->fix.longitude = -122.014965;
+    datap->fix.altitude = 42.5;
+    datap->fix.epx = 3.1;
+    datap->fix.epy = 4.2;
+    datap->fix.epv = 7.7;
+    datap->fix.track = 271.5;
+    datap->fix.speed = 1.25;
+    datap->fix.climb = -0.5;
+    datap->fix.epd = 12.0;
+    datap->fix.eps = 0.6;
+    datap->fix.epc = 1.4;
+    datap->skyview_time = 1425274353.0;
+    datap->dop.xdop = 0.8;
+    datap->dop.ydop = 0.9;
+    datap->dop.pdop = 1.6;
+    datap->dop.hdop = 1.1;
+    datap->dop.vdop = 1.2;
+    datap->dop.tdop = 0.7;
+    datap->dop.gdop = 1.8;
+    datap->satellites_visible = 5;
+    for (i = 0; i < datap->satellites_visible; i++) {
+	datap->skyview[i].PRN = (short)(3 + i * 7);
+	datap->skyview[i].elevation = (short)(10 + i * 15);
+	datap->skyview[i].azimuth = (short)(40 * i);
+	datap->skyview[i].ss = 30.0 + i;
+	datap->skyview[i].used = (i % 2) == 0;
+    }
+}
+
+static size_t unpack_records(char *buf, size_t len, struct gps_data_t *out)
+/* feed every record in buf to the client side; return how many */
+{
+    size_t count = 0;
+
+    while (len >= sizeof(struct binary_header_t)) {
+	struct binary_header_t header;
+	size_t reclen;
+
+	memcpy(&header, buf, sizeof(header));
+	reclen = sizeof(header) + header.length;
+	if (reclen > len)
+	    break;
+	(void)gps_unpack_binary(buf, reclen, out);
+	buf += reclen;
+	len -= reclen;
+	++count;
+    }
+    return count;
+}
+
+static void roundtrip_check(void)
+/* a TPV and a SKY must come through unchanged */
+{
+    struct gps_device_t session;
+    struct gps_data_t *in = &session.gpsdata;
+    static struct gps_data_t out;
+    char buf[sizeof(struct binary_header_t) * 2 + GPS_PATH_MAX * 2
+	     + sizeof(struct binary_tpv_t) + sizeof(struct binary_sky_t)];
+    size_t len;
+    int i;
+
+    fake_session(&session);
+    len = binary_data_report(REPORT_IS | SATELLITE_SET, &session,
+			     buf, sizeof(buf));
+    check(len > 0, "binary_data_report() wrote TPV and SKY");
+    memset(&out, '\0', sizeof(out));
+    check(unpack_records(buf, len, &out) == 2, "two records unpacked");
+
+    check(strcmp(out.dev.path, in->dev.path) == 0, "device path");
+    check((out.set & STATUS_SET) != 0, "TPV sets STATUS_SET");
+    check((out.set & SATELLITE_SET) != 0, "SKY sets SATELLITE_SET");
+    check(out.status == STATUS_DGPS_FIX, "status");
+    check(out.fix.time == in->fix.time, "fix.time");
+    check(out.fix.mode == in->fix.mode, "fix.mode");
+    check(out.fix.ept == in->fix.ept, "fix.ept");
+    check(out.fix.latitude == in->fix.latitude, "fix.latitude");
+    check(out.fix.longitude == in->fix.longitude, "fix.longitude");
+    check(out.fix.altitude == in->fix.altitude, "fix.altitude");
+    check(out.fix.epx == in->fix.epx, "fix.epx");
+    check(out.fix.epy == in->fix.epy, "fix.epy");
+    check(out.fix.epv == in->fix.epv, "fix.epv");
+    check(out.fix.track == in->fix.track, "fix.track");
+    check(out.fix.speed == in->fix.speed, "fix.speed");
+    check(out.fix.climb == in->fix.climb, "fix.climb");
+    check(out.fix.epd == in->fix.epd, "fix.epd");
+    check(out.fix.eps == in->fix.eps, "fix.eps");
+    check(out.fix.epc == in->fix.epc, "fix.epc");
+
+    check(out.skyview_time == in->skyview_time, "skyview_time");
+    check(memcmp(&out.dop, &in->dop, sizeof(out.dop)) == 0, "DOPs");
+    check(out.satellites_visible == 5, "satellites_visible");
+    check(out.satellites_used == 3, "satellites_used");
+    for (i = 0; i < in->satellites_visible; i++) {
+	check(out.skyview[i].PRN == in->skyview[i].PRN, "skyview PRN");
+	check(out.skyview[i].elevation == in->skyview[i].elevation,
+	      "skyview elevation");
+	check(out.skyview[i].azimuth == in->skyview[i].azimuth,
+	      "skyview azimuth");
+	check(out.skyview[i].ss == in->skyview[i].ss, "skyview ss");
+	check(out.skyview[i].used == in->skyview[i].used, "skyview used");
+    }
+    check(out.skyview[in->satellites_visible].PRN == 0,
+	  "no satellites past the ones shipped");
+}
+
+static void reject_check(void)
+/* foreign or damaged records must leave the client untouched */
+{
+    struct gps_device_t session;
+    static struct gps_data_t out;
+    char buf[sizeof(struct binary_header_t) + GPS_PATH_MAX
+	     + sizeof(struct binary_tpv_t)];
+    struct binary_header_t header;
+    size_t len;
+
+    fake_session(&session);
+    len = binary_data_report(REPORT_IS, &session, buf, sizeof(buf));
+    check(len > 0, "binary_data_report() wrote TPV");
+    memcpy(&header, buf, sizeof(header));
+
+    /* the other byte order or a different gps_data_t */
+    memset(&out, '\0', sizeof(out));
+    ((struct binary_header_t *)buf)->check = ~BINARY_CHECK;
+    (void)gps_unpack_binary(buf, len, &out);
+    check(out.set == 0 && out.fix.mode == 0, "bad check word ignored");
+    memcpy(buf, &header, sizeof(header));
+
+    /* another record layout */
+    ((struct binary_header_t *)buf)->layout = BINARY_LAYOUT + 1;
+    (void)gps_unpack_binary(buf, len, &out);
+    check(out.set == 0 && out.fix.mode == 0, "other layout ignored");
+    memcpy(buf, &header, sizeof(header));
+
+    /* another API major version */
+    ((struct binary_header_t *)buf)->api = GPSD_API_MAJOR_VERSION + 1;
+    (void)gps_unpack_binary(buf, len, &out);
+    check(out.set == 0 && out.fix.mode == 0, "other API ignored");
+    memcpy(buf, &header, sizeof(header));
+
+    /* a length that runs past the record */
+    ((struct binary_header_t *)buf)->length = 0xffffffffU;
+    (void)gps_unpack_binary(buf, len, &out);
+    check(out.set == 0 && out.fix.mode == 0, "overlong length ignored");
+    memcpy(buf, &header, sizeof(header));
+
+    /* a record cut short */
+    (void)gps_unpack_binary(buf, len - 1, &out);
+    check(out.set == 0 && out.fix.mode == 0, "truncated record ignored");
+
+    /* and the record itself is still good */
+    (void)gps_unpack_binary(buf, len, &out);
+    check(out.fix.mode == MODE_3D, "intact record unpacked");
+}
+
+int main(int argc, char *argv[])
+{
+    int option;
+
+    while ((option = getopt(argc, argv, "q")) != -1) {
+	switch (option) {
+	case 'q':
+	    quiet = true;
+	    break;
+	default:
+	    (void)fprintf(stderr, "usage: test_binary [-q]\n");
+	    exit(EXIT_FAILURE);
+	}
+    }
+
+    roundtrip_check();
+    reject_check();
+
+    if (!quiet || failures > 0)
+	(void)printf("%d failures.\n", failures);
+    exit(failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+#else
+
+int main(void)
+{
+    (void)puts("Socket export is not compiled in.");
+    exit(EXIT_SUCCESS);
+}
+
+#endif /* SOCKET_EXPORT_ENABLE */
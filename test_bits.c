@@ -10,6 +10,7 @@
 #include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <time.h>
 #include "bits.h"
 
 static unsigned char buf[80];
@@ -108,11 +109,158 @@ struct unsigned_test
     char *description;
 };
 
+static uint64_t slowbits(const unsigned char *bitvec, size_t len,
+			 size_t start, unsigned int width)
+/* reference extraction, one bit at a time, zeros past the end */
+{
+    uint64_t fld = 0;
+    size_t i;
+
+    for (i = start; i < start + width; i++) {
+	unsigned int bit = 0;
+
+	if (i / CHAR_BIT < len)
+	    bit = (bitvec[i / CHAR_BIT] >> (7 - i % CHAR_BIT)) & 1;
+	fld = (fld << 1) | bit;
+    }
+    return fld;
+}
+
+static bool bitreader_check(bool quiet)
+/* compare the streaming reader with the reference over random fields */
+{
+    unsigned char data[67];
+    struct bitreader_t br;
+    unsigned long seed = 1;
+    unsigned int i, round, failures = 0;
+
+    for (round = 0; round < 1000; round++) {
+	size_t start, len;
+
+	for (i = 0; i < sizeof(data); i++) {
+	    seed = seed * 1103515245 + 12345;
+	    data[i] = (unsigned char)(seed >> 16);
+	}
+	/* short buffers exercise the byte-at-a-time tail */
+	len = (round % 2 == 0) ? sizeof(data) : round % 11;
+	start = round % 13;
+	bitreader_init(&br, data, len);
+	bitreader_seek(&br, start);
+	while (bitreader_tell(&br) < len * CHAR_BIT + 70) {
+	    size_t pos = bitreader_tell(&br);
+	    unsigned int width;
+	    uint64_t want, got;
+
+	    seed = seed * 1103515245 + 12345;
+	    width = (unsigned int)(seed >> 16) % 65;
+	    want = slowbits(data, len, pos, width);
+	    if (width > 0 && (seed >> 24) % 2 == 0) {
+		uint64_t sign = 1ULL << (width - 1);
+
+		got = (uint64_t)bitreader_sbits(&br, width);
+		want = (want ^ sign) - sign;
+	    } else
+		got = bitreader_ubits(&br, width);
+	    if (got != want) {
+		if (failures++ < 10)
+		    (void)printf("bitreader at %zu width %u of %zu bytes: "
+				 "%" PRIx64 " should be %" PRIx64 "\n",
+				 pos, width, len, got, want);
+	    } else if (pos + width <= len * CHAR_BIT
+		       && ubits(data, (unsigned int)pos, width, false)
+		       != slowbits(data, len, pos, width)) {
+		if (failures++ < 10)
+		    (void)printf("ubits at %zu width %u FAILED\n", pos, width);
+	    }
+	}
+    }
+    if (!quiet || failures > 0)
+	(void)printf("bitreader: %u failures in 1000 rounds\n", failures);
+    return failures == 0;
+}
+
+static double bench_seconds(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bitreader_benchmark(unsigned int passes)
+/* fields per second through ubits() and the streaming reader */
+{
+    /* a mix of AIS and RTCM3 MSM field widths */
+    static const unsigned int widths[] = {6, 2, 30, 4, 1, 28, 27, 12, 9, 22,
+					  15, 10, 8, 14, 20, 24, 3, 6, 6, 6};
+#define NWIDTHS	(sizeof(widths) / sizeof(widths[0]))
+    static unsigned char data[4096];
+    const size_t nbits = sizeof(data) * CHAR_BIT - 64;
+    struct bitreader_t br;
+    uint64_t sum1 = 0, sum2 = 0, sum3 = 0;
+    unsigned long fields = 0;
+    unsigned long seed = 1;
+    double start, t1, t2, t3;
+    unsigned int i, pass;
+
+    for (i = 0; i < sizeof(data); i++) {
+	seed = seed * 1103515245 + 12345;
+	data[i] = (unsigned char)(seed >> 16);
+    }
+
+    start = bench_seconds();
+    for (pass = 0; pass < passes; pass++) {
+	size_t pos = 0;
+
+	for (i = 0; pos < nbits; i = (i + 1) % NWIDTHS) {
+	    sum1 += ubits(data, (unsigned int)pos, widths[i], false);
+	    pos += widths[i];
+	    fields++;
+	}
+    }
+    t1 = bench_seconds() - start;
+
+    start = bench_seconds();
+    for (pass = 0; pass < passes; pass++) {
+	bitreader_init(&br, data, sizeof(data));
+	for (i = 0; bitreader_tell(&br) < nbits; i = (i + 1) % NWIDTHS)
+	    sum2 += bitreader_ubits(&br, widths[i]);
+    }
+    t2 = bench_seconds() - start;
+
+    /* the AIS decoder seeks to every field by its offset */
+    start = bench_seconds();
+    for (pass = 0; pass < passes; pass++) {
+	size_t pos = 0;
+
+	bitreader_init(&br, data, sizeof(data));
+	for (i = 0; pos < nbits; i = (i + 1) % NWIDTHS) {
+	    bitreader_seek(&br, pos);
+	    sum3 += bitreader_ubits(&br, widths[i]);
+	    pos += widths[i];
+	}
+    }
+    t3 = bench_seconds() - start;
+#undef NWIDTHS
+
+    if (sum1 != sum2 || sum1 != sum3)
+	(void)puts("benchmark checksums differ");
+    (void)printf("%lu fields: ubits() %.1f Mfields/s, "
+		 "bitreader %.1f Mfields/s, seeking %.1f Mfields/s\n",
+		 fields, fields / t1 / 1e6, fields / t2 / 1e6,
+		 fields / t3 / 1e6);
+}
+
 int main(int argc, char *argv[])
 {
     bool failures = false;
     bool quiet = (argc > 1) && (strcmp(argv[1], "--quiet") == 0);
 
+    if (argc > 2 && strcmp(argv[1], "-b") == 0) {
+	bitreader_benchmark((unsigned int)atoi(argv[2]));
+	exit(EXIT_SUCCESS);
+    }
+
     struct unsigned_test *up, unsigned_tests[] = {
 	/* tests using the big buffer */
 	{buf, 0,  1,  0,    false, "first bit of first byte"},
@@ -209,6 +357,8 @@ int main(int argc, char *argv[])
 			 success ? "succeeded" : "FAILED");
     }
 
+    if (!bitreader_check(quiet))
+	failures = true;
 
     shiftleft(buf, 28, 30);
     if (!quiet)
@@ -10,6 +10,12 @@
 #include <iostream>
 
 #include <getopt.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <time.h>
 
 #include "libgpsmm.h"
 #include "gpsdclient.c"
@@ -107,6 +113,110 @@ static void libgps_dump_state(struct gps_data_t *collect)
     }
 }
 
+#if __cplusplus >= 201103L
+/*
+ * Benchmark: a child process plays gpsd, streaming canned TPV and SKY
+ * reports over a local TCP socket, and the parent times reading them
+ * through gpsmm, which copies gps_data_t on every read, and through
+ * gps::session, by read() and by dispatch() to an observer.
+ */
+static const char bench_tpv[] = "{\"class\":\"TPV\",\"device\":\"/dev/ttyUSB0\",\"mode\":3,\"time\":\"2016-05-10T12:21:19.000Z\",\"ept\":0.005,\"lat\":46.498203637,\"lon\":7.568074350,\"alt\":1327.689,\"epx\":15.319,\"epy\":17.054,\"epv\":124.484,\"track\":10.3797,\"speed\":0.091,\"climb\":-0.085}\r\n";
+static const char bench_sky[] = "{\"class\":\"SKY\",\"device\":\"/dev/ttyUSB0\",\"time\":\"2016-05-10T12:21:19.000Z\",\"hdop\":1.20,\"vdop\":2.30,\"pdop\":2.60,\"satellites\":[{\"PRN\":10,\"el\":45,\"az\":196,\"ss\":34,\"used\":true},{\"PRN\":29,\"el\":67,\"az\":310,\"ss\":40,\"used\":true},{\"PRN\":28,\"el\":59,\"az\":108,\"ss\":42,\"used\":true},{\"PRN\":26,\"el\":51,\"az\":304,\"ss\":43,\"used\":true},{\"PRN\":8,\"el\":44,\"az\":58,\"ss\":41,\"used\":true},{\"PRN\":27,\"el\":16,\"az\":66,\"ss\":39,\"used\":true},{\"PRN\":21,\"el\":10,\"az\":301,\"ss\":0,\"used\":false}]}\r\n";
+
+static pid_t bench_feed(int listener, unsigned int count)
+/* fork a child that streams count canned reports to the next client */
+{
+    pid_t pid = fork();
+
+    if (pid == 0) {
+	std::string block;
+	int fd = accept(listener, NULL, NULL);
+
+	for (unsigned int i = 0; i < 64; i++)
+	    block += (i % 2 == 0) ? bench_tpv : bench_sky;
+	for (unsigned int sent = 0; fd >= 0 && sent < count; sent += 64)
+	    if (write(fd, block.data(), block.size()) != (ssize_t)block.size())
+		break;
+	_exit(0);
+    }
+    return pid;
+}
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+class bench_counter : public gps::observer {
+public:
+    bench_counter() : count(0), used(0) {}
+    void on_fix(const gps::fix &fix, const struct gps_data_t &) override {
+	count++;
+	used += (fix.mode == MODE_3D);
+    }
+    void on_sky(const gps::sky_view &sky) override {
+	count++;
+	for (const struct satellite_t &sat : sky)
+	    used += sat.used;
+    }
+    void on_other(const struct gps_data_t &) override { count++; }
+    unsigned long count, used;
+};
+
+static void benchmark(unsigned int count)
+{
+    struct sockaddr_in addr;
+    socklen_t addrlen = sizeof(addr);
+    char port[16];
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (listener < 0
+	|| bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0
+	|| listen(listener, 4) != 0
+	|| getsockname(listener, (struct sockaddr *)&addr, &addrlen) != 0) {
+	cerr << "can't set up the benchmark socket.\n";
+	exit(EXIT_FAILURE);
+    }
+    (void)snprintf(port, sizeof(port), "%u", ntohs(addr.sin_port));
+    (void)printf("gpsmm copies %zu bytes of gps_data_t per read\n",
+		 sizeof(struct gps_data_t));
+
+    for (int mode = 0; mode < 3; mode++) {
+	static const char *names[] = {
+	    "gpsmm::read()", "gps::session::read()", "gps::session::dispatch()"
+	};
+	unsigned long n = 0;
+	pid_t pid = bench_feed(listener, count);
+	double start = bench_now();
+
+	if (mode == 0) {
+	    gpsmm gps_rec("127.0.0.1", port);
+	    struct gps_data_t *data;
+	    while (gps_rec.waiting(5000000) && (data = gps_rec.read()) != NULL)
+		n += (data->set & PACKET_SET) != 0;
+	} else if (mode == 1) {
+	    gps::session session("127.0.0.1", port);
+	    for (const struct gps_data_t &data : session.updates())
+		n += (data.set & PACKET_SET) != 0;
+	} else {
+	    gps::session session("127.0.0.1", port);
+	    bench_counter counter;
+	    while (session.dispatch(counter) >= 0)
+		continue;
+	    n = counter.count;
+	}
+	(void)printf("%-26s %lu messages, %.3f usec each\n", names[mode], n,
+		     (bench_now() - start) * 1e6 / (n ? n : 1));
+	(void)waitpid(pid, NULL, 0);
+    }
+    (void)close(listener);
+}
+#endif /* __cplusplus >= 201103L */
 
 int main(int argc, char *argv[])
 {
@@ -117,15 +227,20 @@ int main(int argc, char *argv[])
     // But for this test program we don't want extra dependencies
     // Hence use C style getopt for (build) simplicity
     int option;
-    while ((option = getopt(argc, argv, "l:h?")) != -1) {
+    while ((option = getopt(argc, argv, "b:l:h?")) != -1) {
         switch (option) {
+#if __cplusplus >= 201103L
+        case 'b':
+            benchmark(atoi(optarg));
+            exit(EXIT_SUCCESS);
+#endif
         case 'l':
             looper = atoi(optarg);
             break;
         case '?':
         case 'h':
         default:
-            cout << "usage: " << argv[0] << " [-l n]\n";
+            cout << "usage: " << argv[0] << " [-l n] [-b n]\n";
             exit(EXIT_FAILURE);
             break;
         }
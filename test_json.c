@@ -10,6 +10,7 @@
 #include <string.h>
 #include <stddef.h>
 #include <getopt.h>
+#include <time.h>
 
 #include "gpsd.h"
 #include "gps_json.h"
@@ -267,8 +268,41 @@ static const struct json_array_t json_array_15 = {
     .count = &realcount,
     .maxlen = sizeof(realstore)/sizeof(realstore[0]),
 };
+
+/* Case 16: out-of-order attributes, with defaults for the rest */
+
+static const char *json_str16 = "{\"zeta\":7,\"dest\":3,\"alpha\":2.5}";
+static double alpha;
+static int zeta, omega;
+static union {
+    struct {
+	int lon, lat;
+    } area;
+    unsigned int dest;
+} u16;
+
+static const struct json_attr_t json_attrs_16[] = {
+    {"alpha", t_real,     .addr.real = &alpha,         .dflt.real = 1.0},
+    {"lon",   t_integer,  .addr.integer = &u16.area.lon, .dflt.integer = -1},
+    {"lat",   t_integer,  .addr.integer = &u16.area.lat, .dflt.integer = -1},
+    {"dest",  t_uinteger, .addr.uinteger = &u16.dest,  .dflt.uinteger = 0},
+    {"omega", t_integer,  .addr.integer = &omega,      .dflt.integer = 9},
+    {"zeta",  t_integer,  .addr.integer = &zeta,       .dflt.integer = 0},
+    {NULL},
+};
 #endif /* JSON_MINIMAL */
 
+/* Case 17: test parsing of WATCH report filters */
+
+static const char *json_strWATCH = "{\"class\":\"WATCH\",\
+\"enable\":true,\"json\":true,\"classes\":[\"TPV\",\"AIS\"],\
+\"fields\":[\"lat\",\"lon\",\"speed\"],\"interval\":0.5}";
+
+/* Case 18: WATCH with pps after device */
+
+static const char *json_strWATCHpps = "{\"class\":\"WATCH\",\
+\"device\":\"/dev/ttyUSB0\",\"pps\":true}";
+
 /* *INDENT-ON* */
 
 static void jsontest(int i)
@@ -403,7 +437,12 @@ static void jsontest(int i)
 	break;
 
 #ifdef JSON_MINIMAL
-#define MAXTEST 12
+    case 13:
+    case 14:
+    case 15:
+    case 16:
+	/* these need the full parser */
+	break;
 #else
     case 13:
 	status = json_read_array(json_strInt, &json_array_Int, NULL);
@@ -432,38 +471,121 @@ static void jsontest(int i)
 	assert_real("realstore[3]", realstore[3], 0);
 	break;
 
-#define MAXTEST 15
+    case 16:
+	status = json_read_object(json_str16, json_attrs_16, NULL);
+	assert_real("alpha", alpha, 2.5);
+	assert_integer("zeta", zeta, 7);
+	assert_integer("omega", omega, 9);
+	/* the default for lon shares storage with dest and must not win */
+	assert_uinteger("dest", u16.dest, 3);
+	assert_integer("lat", u16.area.lat, -1);
+	break;
+
 #endif /* JSON_MINIMAL */
 
+    case 17:
+	status = json_watch_read(json_strWATCH, &gpsdata.policy, NULL);
+	assert_case(17, status);
+	assert_boolean("enable", gpsdata.policy.watcher, true);
+	assert_uinteger("classes", gpsdata.policy.classes,
+			CLASS_TPV | CLASS_AIS);
+	assert_uinteger("fields", gpsdata.policy.fields,
+			TPV_LAT | TPV_LON | TPV_SPEED);
+	assert_real("interval", gpsdata.policy.interval, 0.5);
+	break;
+
+    case 18:
+	status = json_watch_read(json_strWATCHpps, &gpsdata.policy, NULL);
+	assert_case(18, status);
+	assert_string("device", gpsdata.policy.devpath, "/dev/ttyUSB0");
+	assert_boolean("pps", gpsdata.policy.pps, true);
+	break;
+
+#define MAXTEST 18
+
     default:
 	(void)fputs("Unknown test number\n", stderr);
 	exit(EXIT_FAILURE);
     }
 }
 
+/*
+ * Benchmark: unpack every JSON line of the given files, as a client
+ * would, for enough rounds to get a stable figure.
+ */
+#define BENCH_ROUNDS	200
+#define BENCH_MAXLINES	20000
+
+static void benchmark(int nfiles, char *files[])
+{
+    static char *lines[BENCH_MAXLINES];
+    struct timespec start, now;
+    int i, nlines = 0, failures = 0;
+    double elapsed;
+
+    for (i = 0; i < nfiles; i++) {
+	char buf[GPS_JSON_RESPONSE_MAX];
+	FILE *fp = fopen(files[i], "r");
+
+	if (fp == NULL) {
+	    (void)fprintf(stderr, "can't open %s\n", files[i]);
+	    exit(EXIT_FAILURE);
+	}
+	while (fgets(buf, sizeof(buf), fp) != NULL
+	       && nlines < BENCH_MAXLINES)
+	    if (buf[0] == '{')
+		lines[nlines++] = strdup(buf);
+	(void)fclose(fp);
+    }
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < BENCH_ROUNDS * nlines; i++)
+	if (libgps_json_unpack(lines[i % nlines], &gpsdata, NULL) != 0)
+	    failures++;
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    elapsed = (double)(now.tv_sec - start.tv_sec)
+	+ (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+
+    (void)printf("%d objects x %d rounds: %.3f us per object, "
+		 "%d unparsed\n",
+		 nlines, BENCH_ROUNDS, elapsed * 1e6 / (BENCH_ROUNDS * nlines),
+		 failures / BENCH_ROUNDS);
+    for (i = 0; i < nlines; i++)
+	free(lines[i]);
+}
+
 int main(int argc UNUSED, char *argv[]UNUSED)
 {
     int option;
     int individual = 0;
+    bool bench = false;
 
-    while ((option = getopt(argc, argv, "hn:D:?")) != -1) {
+    while ((option = getopt(argc, argv, "bhn:D:?")) != -1) {
 	switch (option) {
 #ifdef CLIENTDEBUG_ENABLE
 	case 'D':
 	    gps_enable_debug(atoi(optarg), stdout);
 	    break;
 #endif
+	case 'b':
+	    bench = true;
+	    break;
 	case 'n':
 	    individual = atoi(optarg);
 	    break;
 	case '?':
 	case 'h':
 	default:
-	    (void)fputs("usage: test_json [-D lvl]\n", stderr);
+	    (void)fputs("usage: test_json [-D lvl] [-b file...]\n", stderr);
 	    exit(EXIT_FAILURE);
 	}
     }
 
+    if (bench) {
+	benchmark(argc - optind, argv + optind);
+	exit(EXIT_SUCCESS);
+    }
+
     (void)fprintf(stderr, "JSON unit test ");
 
     if (individual)
@@ -9,6 +9,7 @@
 #include <ctype.h>
 #include <sys/types.h>
 #include <fcntl.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "gpsd.h"
@@ -245,6 +246,41 @@ static struct map singletests[] = {
 	.garbage_offset = 0,
 	.type = RTCM3_PACKET,
     },
+    {
+	.legend = "NMEA packet with lower-case checksum",
+	.test = "$GPGGA,110534.994,4002.1425,N,07531.2585,W,0,00,50.0,172.7,M,-33.8,M,0.0,0000*7a\r\n",
+	.testlen = 82,
+	.garbage_offset = 0,
+	.type = NMEA_PACKET,
+    },
+    {
+	.legend = "AIVDM packet with checksum",
+	.test = "!AIVDM,1,1,,A,15RTgt0PAso;90TKcjM8h6g208CQ,0*4A\r\n",
+	.testlen = 49,
+	.garbage_offset = 0,
+	.type = AIVDM_PACKET,
+    },
+    {
+	.legend = "AIVDM packet from an NMEA 4.0 base station",
+	.test = "!ABVDM,1,1,,B,15RTgt0PAso;90TKcjM8h6g208CQ,0*42\r\n",
+	.testlen = 49,
+	.garbage_offset = 0,
+	.type = AIVDM_PACKET,
+    },
+    {
+	.legend = "AIVDM packet with wrong checksum",
+	.test = "!AIVDM,1,1,,A,15RTgt0PAso;90TKcjM8h6g208CQ,0*4B\r\n",
+	.testlen = 49,
+	.garbage_offset = 0,
+	.type = BAD_PACKET,
+    },
+    {
+	.legend = "NMEA packet with wrong lower-case checksum",
+	.test = "$GPGGA,110534.994,4002.1425,N,07531.2585,W,0,00,50.0,172.7,M,-33.8,M,0.0,0000*7b\r\n",
+	.testlen = 82,
+	.garbage_offset = 0,
+	.type = BAD_PACKET,
+    },
 };
 /* *INDENT-ON* */
 
@@ -304,6 +340,73 @@ static void runon_test(struct map *mp)
     } while (st > 0);
 }
 
+static void lexer_benchmark(const char *logfile)
+/* time the lexer over a log, clean and with bursts of line noise */
+{
+    static const int noise_percent[] = {0, 10, 50};
+    static unsigned char clean[1 << 20];
+    FILE *fp;
+    size_t cleanlen;
+    unsigned int i;
+
+    if ((fp = fopen(logfile, "rb")) == NULL) {
+	(void)fprintf(stderr, "test_packet: can't open %s\n", logfile);
+	exit(EXIT_FAILURE);
+    }
+    cleanlen = fread(clean, 1, sizeof(clean), fp);
+    (void)fclose(fp);
+
+    for (i = 0; i < sizeof(noise_percent) / sizeof(noise_percent[0]); i++) {
+	static struct gps_lexer_t lexer;
+	FILE *tmp = tmpfile();
+	unsigned long seed = 1, packets = 0, bytes = 0, noisylen;
+	struct timespec start, end;
+	size_t n;
+	int round;
+	double elapsed;
+
+	if (tmp == NULL) {
+	    (void)fputs("test_packet: can't create temporary file\n", stderr);
+	    exit(EXIT_FAILURE);
+	}
+	/* line noise comes in bursts between the clean records */
+	for (n = 0; n < cleanlen; n++) {
+	    (void)fputc(clean[n], tmp);
+	    if (clean[n] == '\n' && noise_percent[i] > 0) {
+		int burst = noise_percent[i] * 2;
+
+		while (burst-- > 0) {
+		    seed = seed * 1103515245 + 12345;
+		    (void)fputc((int)((seed >> 16) & 0x7f) | 0x80, tmp);
+		}
+	    }
+	}
+	(void)fflush(tmp);
+	noisylen = (unsigned long)ftell(tmp);
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &start);
+	for (round = 0; round < 20; round++) {
+	    ssize_t st;
+
+	    (void)lseek(fileno(tmp), 0, SEEK_SET);
+	    lexer_init(&lexer);
+	    lexer.errout.debug = verbose;
+	    while ((st = packet_get(fileno(tmp), &lexer)) > 0)
+		if (lexer.outbuflen > 0)
+		    packets++;
+	    bytes += noisylen;
+	}
+	(void)clock_gettime(CLOCK_MONOTONIC, &end);
+	(void)fclose(tmp);
+
+	elapsed = (end.tv_sec - start.tv_sec)
+	    + (end.tv_nsec - start.tv_nsec) / 1e9;
+	(void)printf("%3d%% noise: %lu packets, %.1f MB/s\n",
+		     noise_percent[i], packets / 20,
+		     bytes / elapsed / 1e6);
+    }
+}
+
 static int property_check(void)
 {
     const struct gps_type_t **dp;
@@ -376,8 +479,11 @@ int main(int argc, char *argv[])
     int option, singletest = 0;
 
     verbose = 0;
-    while ((option = getopt(argc, argv, "ce:t:v:")) != -1) {
+    while ((option = getopt(argc, argv, "b:ce:t:v:")) != -1) {
 	switch (option) {
+	case 'b':
+	    lexer_benchmark(optarg);
+	    exit(EXIT_SUCCESS);
 	case 'c':
 	    exit(property_check());
 	case 'e':
@@ -0,0 +1,220 @@
+/*
+ * Unit test and micro-benchmark for the string cursor in strfuncs.h.
+ *
+ * The check compares strc_int() and strc_fixed() byte for byte with
+ * the printf conversions they replace.  With -b it also times building
+ * a large SKY-style report with str_appendf() against the cursor,
+ * checking that both produce the same bytes.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "gpsd_config.h"
+#include "os_compat.h"		/* for strlcpy(), strlcat() */
+#include "strfuncs.h"
+
+static int failures;
+static bool quiet = false;
+
+static void check(const char *what, const char *got, const char *expected)
+{
+    if (strcmp(got, expected) != 0) {
+	(void)printf("%s: got %s, expected %s\n", what, got, expected);
+	++failures;
+    }
+}
+
+static void check_fixed(double d, int places)
+{
+    char got[64], expected[64];
+    struct strcursor_t c;
+
+    strc_init(&c, got, sizeof(got));
+    strc_fixed(&c, d, places);
+    (void)snprintf(expected, sizeof(expected), "%.*f", places, d);
+    check("strc_fixed", got, expected);
+    if (c.len != strlen(got)) {
+	(void)printf("strc_fixed: length %zu for %s\n", c.len, got);
+	++failures;
+    }
+}
+
+static void check_int(long long v)
+{
+    char got[32], expected[32];
+    struct strcursor_t c;
+
+    strc_init(&c, got, sizeof(got));
+    strc_int(&c, v);
+    (void)snprintf(expected, sizeof(expected), "%lld", v);
+    check("strc_int", got, expected);
+}
+
+static void unit_tests(void)
+{
+    static const double edges[] = {
+	0.0, -0.0, 0.5, -0.5, 1.5, 2.5, 0.125, 0.005, 0.015, 0.045,
+	1.0005, 0.0004999, 89.999999999, -179.9999999995, 12345.6785,
+	1e-12, -1e-12, 4503599.6, 1e15, -1e15, 1e300, -1e300,
+	HUGE_VAL, -HUGE_VAL, NAN,
+    };
+    static const long long ints[] = {
+	0, 1, -1, 9, 10, -10, 2147483647LL, -2147483648LL,
+	9223372036854775807LL, -9223372036854775807LL - 1,
+    };
+    char small[8];
+    struct strcursor_t c;
+    unsigned int i;
+    int places;
+
+    for (i = 0; i < sizeof(ints) / sizeof(ints[0]); i++)
+	check_int(ints[i]);
+    for (i = 0; i < sizeof(edges) / sizeof(edges[0]); i++)
+	for (places = 0; places <= 10; places++)
+	    check_fixed(edges[i], places);
+
+    /* typical report magnitudes: coordinates, altitudes, errors */
+    srand(2947);
+    for (i = 0; i < 200000; i++) {
+	double mag = pow(10.0, (rand() % 12) - 5);
+	double d = ((double)rand() / RAND_MAX - 0.5) * 2 * mag;
+
+	check_fixed(d, rand() % 10);
+	/* exact ties, which printf rounds to even */
+	check_fixed((double)(rand() % 100000) / 8.0, 2);
+    }
+
+    /* truncation behaves like snprintf */
+    strc_init(&c, small, sizeof(small));
+    strc_puts(&c, "abc");
+    strc_printf(&c, "%d", 12345);
+    check("strc_printf truncation", small, "abc1234");
+    strc_int(&c, 7);
+    strc_fixed(&c, 3.25, 2);
+    check("strc_int truncation", small, "abc1234");
+    strc_rstrip_char(&c, '4');
+    check("strc_rstrip_char", small, "abc123");
+    if (c.len != strlen(small)) {
+	(void)printf("truncated length %zu, expected %zu\n",
+		     c.len, strlen(small));
+	++failures;
+    }
+}
+
+static double elapsed(const struct timespec *start)
+{
+    struct timespec now;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec)
+	+ (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+#define SATS	72
+#define ROUNDS	20000
+
+static void sky_appendf(char *reply, size_t replylen)
+{
+    int i;
+
+    (void)strlcpy(reply, "{\"class\":\"SKY\",\"device\":\"/dev/ttyUSB0\",",
+		  replylen);
+    str_appendf(reply, replylen, "\"xdop\":%.2f,\"ydop\":%.2f,", 0.87, 1.13);
+    (void)strlcat(reply, "\"satellites\":[", replylen);
+    for (i = 0; i < SATS; i++)
+	str_appendf(reply, replylen,
+		    "{\"PRN\":%d,\"el\":%d,\"az\":%d,\"ss\":%.0f,\"used\":%s},",
+		    i + 1, (i * 7) % 90, (i * 37) % 360, 20.0 + i % 30,
+		    (i % 3) ? "true" : "false");
+    str_rstrip_char(reply, ',');
+    (void)strlcat(reply, "]}\r\n", replylen);
+}
+
+static void sky_cursor(char *reply, size_t replylen)
+{
+    struct strcursor_t c;
+    int i;
+
+    strc_init(&c, reply, replylen);
+    strc_puts(&c, "{\"class\":\"SKY\",\"device\":\"/dev/ttyUSB0\",");
+    strc_puts(&c, "\"xdop\":");
+    strc_fixed(&c, 0.87, 2);
+    strc_puts(&c, ",\"ydop\":");
+    strc_fixed(&c, 1.13, 2);
+    strc_puts(&c, ",\"satellites\":[");
+    for (i = 0; i < SATS; i++) {
+	strc_puts(&c, "{\"PRN\":");
+	strc_int(&c, i + 1);
+	strc_puts(&c, ",\"el\":");
+	strc_int(&c, (i * 7) % 90);
+	strc_puts(&c, ",\"az\":");
+	strc_int(&c, (i * 37) % 360);
+	strc_puts(&c, ",\"ss\":");
+	strc_fixed(&c, 20.0 + i % 30, 0);
+	strc_puts(&c, (i % 3) ? ",\"used\":true}," : ",\"used\":false},");
+    }
+    strc_rstrip_char(&c, ',');
+    strc_puts(&c, "]}\r\n");
+}
+
+static void benchmark(void)
+{
+    static char old[8192], new[8192];
+    struct timespec start;
+    double t_old, t_new;
+    int i;
+
+    sky_appendf(old, sizeof(old));
+    sky_cursor(new, sizeof(new));
+    check("SKY report", new, old);
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < ROUNDS; i++)
+	sky_appendf(old, sizeof(old));
+    t_old = elapsed(&start);
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < ROUNDS; i++)
+	sky_cursor(new, sizeof(new));
+    t_new = elapsed(&start);
+
+    (void)printf("%d-satellite SKY, %zu bytes: str_appendf %.2f us, "
+		 "cursor %.2f us (%.1fx)\n",
+		 SATS, strlen(old),
+		 t_old * 1e6 / ROUNDS, t_new * 1e6 / ROUNDS, t_old / t_new);
+}
+
+int main(int argc, char *argv[])
+{
+    bool bench = false;
+    int option;
+
+    while ((option = getopt(argc, argv, "bq")) != -1) {
+	switch (option) {
+	case 'b':
+	    bench = true;
+	    break;
+	case 'q':
+	    quiet = true;
+	    break;
+	default:
+	    (void)fprintf(stderr, "usage: test_strfuncs [-b] [-q]\n");
+	    exit(EXIT_FAILURE);
+	}
+    }
+
+    unit_tests();
+    if (bench)
+	benchmark();
+
+    if (!quiet || failures > 0)
+	(void)printf("%d failures.\n", failures);
+    exit(failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,340 @@
+/*
+ * Unit test and benchmark for the time-export channels in timehint.c.
+ *
+ * The check compares ntp_leap_month() with gmtime_r(), then drives one
+ * channel into a private SHM segment and a chrony socket of our own,
+ * including chronyd showing up late and restarting.  With -b a fake PPS
+ * source feeds many channels at once and the cost of each sample is
+ * reported, with logging off and on.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+
+/* mkdtemp() needs _XOPEN_SOURCE 700 */
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "gpsd.h"
+#include "ntpshm.h"
+#include "timespec.h"
+
+#ifdef NTPSHM_ENABLE
+
+#define SOCK_MAGIC 0x534f434b
+/* what chronyd's SOCK refclock reads, as laid out in timehint.c */
+struct sock_sample {
+    struct timeval tv;
+    double offset;
+    int pulse;
+    int leap;
+    int _pad;
+    int magic;
+};
+
+#define BENCH_EDGES	2000	/* fake PPS edges per benchmark run */
+#define BENCH_MAXSEGS	256
+
+static int failures;
+static bool quiet = false;
+static struct gpsd_errout_t errout;
+
+static void discard_report(const char *buf)
+/* throw away log output; the benchmark only wants its cost */
+{
+    (void)buf;
+}
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+	(void)printf("FAILED: %s\n", what);
+	++failures;
+    }
+}
+
+static void leap_month_check(void)
+/* ntp_leap_month() must agree with gmtime_r() on every month boundary */
+{
+    time_t t;
+
+    /* a prime step lands on every hour of the day over the years */
+    for (t = -2208988800LL; t < 4102444800LL; t += 86400 * 3 + 3607) {
+	struct tm tm;
+	bool expected;
+
+	(void)gmtime_r(&t, &tm);
+	expected = tm.tm_mon == 5 || tm.tm_mon == 11;
+	if (ntp_leap_month(t) != expected) {
+	    (void)printf("ntp_leap_month(%lld) is %d, month is %d\n",
+			 (long long)t, !expected, tm.tm_mon + 1);
+	    ++failures;
+	    return;
+	}
+    }
+    /* both sides of the edges of June */
+    check(!ntp_leap_month(1496275199), "2017-05-31T23:59:59 is not June");
+    check(ntp_leap_month(1496275200), "2017-06-01T00:00:00 is June");
+    check(ntp_leap_month(1498867199), "2017-06-30T23:59:59 is June");
+    check(!ntp_leap_month(1498867200), "2017-07-01T00:00:00 is not June");
+}
+
+#ifdef PPS_ENABLE
+static int chrony_listen(const char *path)
+/* play chronyd: bind the SOCK refclock socket */
+{
+    struct sockaddr_un addr;
+    int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+
+    if (fd == -1)
+	return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    (void)strlcpy(addr.sun_path, path, sizeof(addr.sun_path));
+    (void)unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+	(void)close(fd);
+	return -1;
+    }
+    return fd;
+}
+
+static bool chrony_receive(int fd, struct sock_sample *sample)
+/* pick up one sample, if one is waiting */
+{
+    return recv(fd, sample, sizeof(*sample), MSG_DONTWAIT)
+	== (ssize_t)sizeof(*sample);
+}
+
+static void fake_edge(struct timedelta_t *td, time_t sec, long jitter_ns)
+/* the PPS edge at sec, as seen by a system clock off by jitter_ns */
+{
+    td->real.tv_sec = sec;
+    td->real.tv_nsec = 0;
+    td->clock.tv_sec = sec;
+    td->clock.tv_nsec = jitter_ns;
+    TS_NORM(&td->clock);
+}
+
+static void export_check(const char *dir)
+/* one channel through SHM and chrony, with chronyd coming and going */
+{
+    static struct shmTime shm;
+    struct time_export_t export;
+    struct sock_sample sample;
+    struct timedelta_t td;
+    char path[GPS_PATH_MAX];
+    int chronyfd;
+    time_t june = 1497484800;		/* 2017-06-15 */
+
+    (void)snprintf(path, sizeof(path), "%s/chrony.test.sock", dir);
+    time_export_init(&export, "test", &shm, -30, path);
+
+    /* no chronyd yet: SHM still gets the sample */
+    fake_edge(&td, june, 1500);
+    check(time_export_put(&errout, &export, &td, LEAP_ADDSECOND),
+	  "SHM sample shipped without chronyd");
+    check(export.chronyfd == -1, "no chrony connection without chronyd");
+    check(shm.valid == 1 && shm.count == 2, "SHM segment written once");
+    check(shm.clockTimeStampSec == june && shm.receiveTimeStampNSec == 1500,
+	  "SHM times");
+    check(shm.precision == -30, "SHM precision set up front");
+    check(shm.leap == LEAP_ADDSECOND, "leap warning kept in June");
+
+    /* chronyd starts; it is picked up once the retry interval passes */
+    chronyfd = chrony_listen(path);
+    check(chronyfd != -1, "chrony socket bound");
+    fake_edge(&td, june + 1, -700);
+    (void)time_export_put(&errout, &export, &td, LEAP_ADDSECOND);
+    check(export.chronyfd == -1, "no reconnection before the retry time");
+    fake_edge(&td, june + 9, -700);
+    (void)time_export_put(&errout, &export, &td, LEAP_ADDSECOND);
+    check(export.chronyfd != -1, "late chronyd connected");
+    check(chrony_receive(chronyfd, &sample), "chronyd got the sample");
+    check(sample.magic == SOCK_MAGIC && sample.leap == LEAP_ADDSECOND,
+	  "chrony sample header");
+    check(sample.tv.tv_sec == june + 8 && sample.tv.tv_usec == 999999,
+	  "chrony sample clock time");
+    check(sample.offset > 699e-9 && sample.offset < 701e-9,
+	  "chrony sample offset");
+
+    /* chronyd restarts: the next sample finds the old peer gone */
+    (void)close(chronyfd);
+    (void)unlink(path);
+    fake_edge(&td, june + 10, 0);
+    (void)time_export_put(&errout, &export, &td, LEAP_NOWARNING);
+    check(export.chronyfd == -1, "lost chronyd noticed");
+    chronyfd = chrony_listen(path);
+    fake_edge(&td, june + 11, 0);
+    (void)time_export_put(&errout, &export, &td, LEAP_NOWARNING);
+    check(export.chronyfd != -1, "restarted chronyd reconnected at once");
+    check(chrony_receive(chronyfd, &sample)
+	  && sample.tv.tv_sec == june + 11, "restarted chronyd got the sample");
+
+    /* out of June and December, leap warnings are held back */
+    fake_edge(&td, june + 30 * 86400, 0);
+    (void)time_export_put(&errout, &export, &td, LEAP_ADDSECOND);
+    check(shm.leap == LEAP_NOWARNING, "SHM leap warning dropped in July");
+    check(chrony_receive(chronyfd, &sample)
+	  && sample.leap == LEAP_NOWARNING, "chrony leap warning dropped");
+
+    time_export_close(&export);
+    check(export.chronyfd == -1 && export.shm == NULL, "channel closed");
+    (void)close(chronyfd);
+    (void)unlink(path);
+}
+
+static double elapsed(const struct timespec *start)
+{
+    struct timespec now;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void benchmark_run(const char *what, struct time_export_t *exports,
+			  int nsegs, const int *chronyfds)
+/* feed every channel BENCH_EDGES fake PPS edges and report the cost */
+{
+    struct pps_hist_t hist;
+    struct sock_sample sample;
+    struct timespec start;
+    unsigned long seed = 1, received = 0;
+    double total;
+    int edge, i;
+
+    memset(&hist, 0, sizeof(hist));
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+    for (edge = 0; edge < BENCH_EDGES; edge++) {
+	for (i = 0; i < nsegs; i++) {
+	    struct timedelta_t td;
+	    struct timespec before, after;
+
+	    /* each device sees the edge with its own few us of jitter */
+	    seed = seed * 1103515245 + 12345;
+	    fake_edge(&td, 1497484800 + edge, (long)(seed >> 16) % 5000);
+	    (void)clock_gettime(CLOCK_MONOTONIC, &before);
+	    (void)time_export_put(&errout, &exports[i], &td, LEAP_NOWARNING);
+	    (void)clock_gettime(CLOCK_MONOTONIC, &after);
+	    pps_hist_add(&hist, timespec_diff_ns(after, before));
+	}
+	/* chronyd reads each of its sockets once a second */
+	if (chronyfds != NULL)
+	    for (i = 0; i < nsegs; i++)
+		while (chrony_receive(chronyfds[i], &sample))
+		    received++;
+    }
+    total = elapsed(&start);
+
+    (void)printf("%-16s %d channels: %.0f samples/s, "
+		 "p50 %lld ns, p99 %lld ns, max %lld ns",
+		 what, nsegs, hist.count / total,
+		 pps_hist_quantile(&hist, 0.5),
+		 pps_hist_quantile(&hist, 0.99), hist.max);
+    if (chronyfds != NULL)
+	(void)printf(", chronyd got %lu", received);
+    (void)putchar('\n');
+}
+
+static void benchmark(const char *dir, int nsegs)
+{
+    static struct shmTime shm[BENCH_MAXSEGS];
+    static struct time_export_t exports[BENCH_MAXSEGS];
+    static char paths[BENCH_MAXSEGS][GPS_PATH_MAX];
+    static int chronyfds[BENCH_MAXSEGS];
+    int i;
+
+    for (i = 0; i < nsegs; i++)
+	time_export_init(&exports[i], "bench", &shm[i], -30, NULL);
+    benchmark_run("SHM", exports, nsegs, NULL);
+    errout.debug = LOG_RAW;
+    benchmark_run("SHM, logging", exports, nsegs, NULL);
+    errout.debug = LOG_ERROR;
+
+    /* one chronyd refclock socket per device, as in a real setup */
+    for (i = 0; i < nsegs; i++) {
+	(void)snprintf(paths[i], sizeof(paths[i]),
+		       "%s/chrony.bench%d.sock", dir, i);
+	chronyfds[i] = chrony_listen(paths[i]);
+	time_export_init(&exports[i], "bench", &shm[i], -30, paths[i]);
+    }
+    benchmark_run("SHM and chrony", exports, nsegs, chronyfds);
+    for (i = 0; i < nsegs; i++) {
+	time_export_close(&exports[i]);
+	(void)close(chronyfds[i]);
+	(void)unlink(paths[i]);
+    }
+}
+#endif /* PPS_ENABLE */
+
+int main(int argc, char *argv[])
+{
+    char dir[] = "/tmp/test_timehintXXXXXX";
+    bool bench = false;
+    int nsegs = 16;
+    int option;
+
+    while ((option = getopt(argc, argv, "bn:q")) != -1) {
+	switch (option) {
+	case 'b':
+	    bench = true;
+	    break;
+	case 'n':
+	    nsegs = atoi(optarg);
+	    if (nsegs < 1 || nsegs > BENCH_MAXSEGS) {
+		(void)fprintf(stderr, "test_timehint: 1 to %d channels\n",
+			      BENCH_MAXSEGS);
+		exit(EXIT_FAILURE);
+	    }
+	    break;
+	case 'q':
+	    quiet = true;
+	    break;
+	default:
+	    (void)fprintf(stderr, "usage: test_timehint [-b] [-n nsegs] [-q]\n");
+	    exit(EXIT_FAILURE);
+	}
+    }
+
+    errout.debug = LOG_ERROR;
+    errout.report = discard_report;
+    errout.label = "test_timehint";
+    if (mkdtemp(dir) == NULL) {
+	(void)fprintf(stderr, "test_timehint: mkdtemp: %s\n", strerror(errno));
+	exit(EXIT_FAILURE);
+    }
+
+    leap_month_check();
+#ifdef PPS_ENABLE
+    export_check(dir);
+    if (bench)
+	benchmark(dir, nsegs);
+#else
+    (void)bench;	/* nothing to benchmark without chrony */
+#endif /* PPS_ENABLE */
+    (void)rmdir(dir);
+
+    if (!quiet || failures > 0)
+	(void)printf("%d failures.\n", failures);
+    exit(failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+#else
+
+int main(void)
+{
+    (void)puts("NTPSHM support is not compiled in.");
+    exit(EXIT_SUCCESS);
+}
+
+#endif /* NTPSHM_ENABLE */
@@ -219,53 +219,15 @@ void ntpshm_session_init(struct gps_device_t *session)
 {
 #ifdef NTPSHM_ENABLE
     /* mark NTPD shared memory segments as unused */
-    session->shm_clock = NULL;
+    time_export_init(&session->clock_export, session->gpsdata.dev.path,
+		     NULL, 0, NULL);
 #endif /* NTPSHM_ENABLE */
 #ifdef PPS_ENABLE
-    session->shm_pps = NULL;
+    time_export_init(&session->pps_export, session->gpsdata.dev.path,
+		     NULL, 0, NULL);
 #endif	/* PPS_ENABLE */
 }
 
-int ntpshm_put(struct gps_device_t *session, volatile struct shmTime *shmseg, struct timedelta_t *td)
-/* put a received fix time into shared memory for NTP */
-{
-    char real_str[TIMESPEC_LEN];
-    char clock_str[TIMESPEC_LEN];
-
-    /* Any NMEA will be about -1 or -2. Garmin GPS-18/USB is around -6 or -7. */
-    int precision = -20; /* default precision, 1 micro sec */
-
-    if (shmseg == NULL) {
-	gpsd_log(&session->context->errout, LOG_RAW, "NTP:PPS: missing shm\n");
-	return 0;
-    }
-
-#ifdef PPS_ENABLE
-    if (shmseg == session->shm_pps) {
-        /* precision is a floor so do not make it tight */
-        if ( source_usb == session->sourcetype ) {
-	    /* if PPS over USB, then precision = -20, 1 micro sec  */
-	    precision = -20;
-        } else {
-	    /* likely PPS over serial, precision = -30, 1 nano sec */
-	    precision = -30;
-        }
-    }
-#endif	/* PPS_ENABLE */
-
-    ntp_write(shmseg, td, precision, session->context->leap_notify);
-
-    timespec_str( &td->real, real_str, sizeof(real_str) );
-    timespec_str( &td->clock, clock_str, sizeof(clock_str) );
-    gpsd_log(&session->context->errout, LOG_PROG,
-	     "NTP: ntpshm_put(%s,%d) %s @ %s\n",
-	     session->gpsdata.dev.path,
-	     precision,
-	     real_str, clock_str);
-
-    return 1;
-}
-
 #ifdef PPS_ENABLE
 #define SOCK_MAGIC 0x534f434b
 struct sock_sample {
@@ -278,70 +240,52 @@ struct sock_sample {
     int magic;      /* must be SOCK_MAGIC */
 };
 
-static void init_hook(struct gps_device_t *session)
-/* for chrony SOCK interface, which allows nSec timekeeping */
+#define CHRONY_RETRY	8	/* seconds between reconnection attempts */
+
+#ifndef MSG_DONTWAIT
+#define MSG_DONTWAIT	0
+#endif /* MSG_DONTWAIT */
+
+static void chrony_connect(const struct gpsd_errout_t *errout,
+			   struct time_export_t *export, time_t now)
+/* try to (re)connect to the chrony socket, at most every CHRONY_RETRY s */
 {
-    /* open the chrony socket */
-    char chrony_path[GPS_PATH_MAX];
+    /* only the first attempt is worth the attention of a PROG log */
+    int loglevel = export->chrony_retry == 0 ? LOG_PROG : LOG_RAW;
 
-    session->chronyfd = -1;
-    if ( 0 == getuid() ) {
-	/* this case will fire on command-line devices;
-	 * they're opened before priv-dropping.  Matters because
-         * only root can use /var/run.
-	 */
-	(void)snprintf(chrony_path, sizeof (chrony_path),
-		"/var/run/chrony.%s.sock", basename(session->gpsdata.dev.path));
-    } else {
-	(void)snprintf(chrony_path, sizeof (chrony_path),
-		"/tmp/chrony.%s.sock", 	basename(session->gpsdata.dev.path));
-    }
+    /* a clock stepped backwards mustn't postpone the retry indefinitely */
+    if (now < export->chrony_retry && export->chrony_retry <= now + CHRONY_RETRY)
+	return;
+    export->chrony_retry = now + CHRONY_RETRY;
 
-    if (access(chrony_path, F_OK) != 0) {
-	gpsd_log(&session->context->errout, LOG_PROG,
+    /* checking first is cheaper than a failed socket()/connect() pair */
+    if (access(export->chrony_path, F_OK) != 0) {
+	gpsd_log(errout, loglevel,
 		"PPS:%s chrony socket %s doesn't exist\n",
-		session->gpsdata.dev.path, chrony_path);
-    } else {
-	session->chronyfd = netlib_localsocket(chrony_path, SOCK_DGRAM);
-	if (session->chronyfd < 0)
-	    gpsd_log(&session->context->errout, LOG_PROG,
-		     "PPS:%s connect chrony socket failed: %s, error: %d, errno: %d/%s\n",
-		     session->gpsdata.dev.path,
-		     chrony_path, session->chronyfd, errno, strerror(errno));
-	else
-	    gpsd_log(&session->context->errout, LOG_RAW,
-		     "PPS:%s using chrony socket: %s\n",
-		     session->gpsdata.dev.path, chrony_path);
+		export->device, export->chrony_path);
+	return;
     }
+    export->chronyfd = netlib_localsocket(export->chrony_path, SOCK_DGRAM);
+    if (export->chronyfd < 0) {
+	gpsd_log(errout, loglevel,
+		 "PPS:%s connect chrony socket failed: %s, error: %d, errno: %d/%s\n",
+		 export->device, export->chrony_path,
+		 export->chronyfd, errno, strerror(errno));
+	export->chronyfd = -1;
+    } else
+	gpsd_log(errout, LOG_PROG,
+		 "PPS:%s using chrony socket: %s\n",
+		 export->device, export->chrony_path);
 }
 
-
 /* td is the real time and clock time of the edge */
 /* offset is actual_ts - clock_ts */
-static void chrony_send(struct gps_device_t *session, struct timedelta_t *td)
+static void chrony_send(const struct gpsd_errout_t *errout,
+			struct time_export_t *export,
+			struct timedelta_t *td, int leap_notify)
 {
-    char real_str[TIMESPEC_LEN];
-    char clock_str[TIMESPEC_LEN];
     struct timespec offset;
     struct sock_sample sample;
-    struct tm tm;
-    int leap_notify = session->context->leap_notify;
-
-    /*
-     * insist that leap seconds only happen in june and december
-     * GPS emits leap pending for 3 months prior to insertion
-     * NTP expects leap pending for only 1 month prior to insertion
-     * Per http://bugs.ntp.org/1090
-     *
-     * ITU-R TF.460-6, Section 2.1, says lappe seconds can be primarily
-     * in Jun/Dec but may be in March or September
-     */
-    (void)gmtime_r( &(td->real.tv_sec), &tm);
-    if ( 5 != tm.tm_mon && 11 != tm.tm_mon ) {
-        /* Not june, not December, no way */
-        leap_notify = LEAP_NOWARNING;
-    }
-
 
     /* chrony expects tv-sec since Jan 1970 */
     sample.pulse = 0;
@@ -357,12 +301,142 @@ static void chrony_send(struct gps_device_t *session, struct timedelta_t *td)
     sample.offset = TSTONS( &offset );
     sample._pad = 0;
 
-    timespec_str( &td->real, real_str, sizeof(real_str) );
-    timespec_str( &td->clock, clock_str, sizeof(clock_str) );
-    gpsd_log(&session->context->errout, LOG_RAW,
-	     "PPS chrony_send %s @ %s Offset: %0.9f\n",
-	     real_str, clock_str, sample.offset);
-    (void)send(session->chronyfd, &sample, sizeof (sample), 0);
+    if (errout->debug >= LOG_RAW) {
+	char real_str[TIMESPEC_LEN];
+	char clock_str[TIMESPEC_LEN];
+
+	timespec_str( &td->real, real_str, sizeof(real_str) );
+	timespec_str( &td->clock, clock_str, sizeof(clock_str) );
+	gpsd_log(errout, LOG_RAW,
+		 "PPS chrony_send %s @ %s Offset: %0.9f\n",
+		 real_str, clock_str, sample.offset);
+    }
+    /* never let a stalled chronyd hold up the PPS thread */
+    if (send(export->chronyfd, &sample, sizeof (sample), MSG_DONTWAIT) == -1) {
+	if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS)
+	    export->chrony_lost++;
+	else {
+	    /* chronyd went away; its socket will be back when it restarts */
+	    gpsd_log(errout, LOG_WARN,
+		     "PPS:%s chrony socket %s lost: %s\n",
+		     export->device, export->chrony_path, strerror(errno));
+	    (void)close(export->chronyfd);
+	    export->chronyfd = -1;
+	    export->chrony_retry = 0;
+	}
+    }
+}
+#endif	/* PPS_ENABLE */
+
+void time_export_init(struct time_export_t *export, const char *device,
+		      volatile struct shmTime *shm, int precision,
+		      const char *chrony_path)
+/* set up an export channel; a NULL or empty chrony_path means no chrony */
+{
+    export->shm = shm;
+    export->precision = precision;
+    export->device = device;
+#ifdef PPS_ENABLE
+    export->chronyfd = -1;
+    export->chrony_path[0] = '\0';
+    if (chrony_path != NULL)
+	(void)strlcpy(export->chrony_path, chrony_path,
+		      sizeof(export->chrony_path));
+    export->chrony_retry = 0;
+    export->chrony_lost = 0;
+#endif /* PPS_ENABLE */
+}
+
+bool time_export_put(const struct gpsd_errout_t *errout,
+		     struct time_export_t *export,
+		     struct timedelta_t *td, int leap_notify)
+/* ship one sample to ntpd and/or chrony; false if it went nowhere */
+{
+    bool shipped = false;
+
+    if (export->shm != NULL) {
+	ntp_write(export->shm, td, export->precision, leap_notify);
+	shipped = true;
+
+	/* formatting the times costs more than the write; skip it if quiet */
+	if (errout->debug >= LOG_PROG) {
+	    char real_str[TIMESPEC_LEN];
+	    char clock_str[TIMESPEC_LEN];
+
+	    timespec_str( &td->real, real_str, sizeof(real_str) );
+	    timespec_str( &td->clock, clock_str, sizeof(clock_str) );
+	    gpsd_log(errout, LOG_PROG,
+		     "NTP: ntpshm_put(%s,%d) %s @ %s\n",
+		     export->device, export->precision,
+		     real_str, clock_str);
+	}
+    }
+
+#ifdef PPS_ENABLE
+    if (export->chrony_path[0] != '\0') {
+	if (export->chronyfd < 0)
+	    chrony_connect(errout, export, td->clock.tv_sec);
+	if (export->chronyfd >= 0) {
+	    /*
+	     * insist that leap seconds only happen in june and december
+	     * GPS emits leap pending for 3 months prior to insertion
+	     * NTP expects leap pending for only 1 month prior to insertion
+	     * Per http://bugs.ntp.org/1090
+	     */
+	    chrony_send(errout, export, td,
+			ntp_leap_month(td->real.tv_sec)
+			    ? leap_notify : LEAP_NOWARNING);
+	    shipped = true;
+	}
+    }
+#endif /* PPS_ENABLE */
+
+    return shipped;
+}
+
+void time_export_close(struct time_export_t *export)
+/* release what an export channel holds, except its SHM segment */
+{
+#ifdef PPS_ENABLE
+    /* no reconnecting from a report already in flight */
+    export->chrony_path[0] = '\0';
+    if (export->chronyfd != -1) {
+	(void)close(export->chronyfd);
+	export->chronyfd = -1;
+    }
+#endif /* PPS_ENABLE */
+    export->shm = NULL;
+}
+
+int ntpshm_put(struct gps_device_t *session, struct time_export_t *export,
+	       struct timedelta_t *td)
+/* put a received fix time into shared memory for NTP */
+{
+    if (export->shm == NULL) {
+	gpsd_log(&session->context->errout, LOG_RAW, "NTP:PPS: missing shm\n");
+	return 0;
+    }
+
+    return (int)time_export_put(&session->context->errout, export, td,
+				session->context->leap_notify);
+}
+
+#ifdef PPS_ENABLE
+static void chrony_path_init(struct gps_device_t *session,
+			     char *chrony_path, size_t len)
+/* where chronyd's SOCK refclock for this device would be */
+{
+    if ( 0 == getuid() ) {
+	/* this case will fire on command-line devices;
+	 * they're opened before priv-dropping.  Matters because
+         * only root can use /var/run.
+	 */
+	(void)snprintf(chrony_path, len,
+		"/var/run/chrony.%s.sock", basename(session->gpsdata.dev.path));
+    } else {
+	(void)snprintf(chrony_path, len,
+		"/tmp/chrony.%s.sock", 	basename(session->gpsdata.dev.path));
+    }
 }
 
 static char *report_hook(volatile struct pps_thread_t *pps_thread,
@@ -393,13 +467,11 @@ static char *report_hook(volatile struct pps_thread_t *pps_thread,
     }
 
     /* FIXME?  how to log socket AND shm reported? */
+    (void)time_export_put(&session->context->errout, &session->pps_export,
+			  td, session->context->leap_notify);
     log1 = "accepted";
-    if ( 0 <= session->chronyfd ) {
+    if (0 <= session->pps_export.chronyfd)
 	log1 = "accepted chrony sock";
-	chrony_send(session, td);
-    }
-    if (session->shm_pps != NULL)
-	(void)ntpshm_put(session, session->shm_pps, td);
 
     /* session context might have a hook set, too */
     if (session->context->pps_hook != NULL)
@@ -412,17 +484,15 @@ static char *report_hook(volatile struct pps_thread_t *pps_thread,
 void ntpshm_link_deactivate(struct gps_device_t *session)
 /* release ntpshm storage for a session */
 {
-    if (session->shm_clock != NULL) {
-	(void)ntpshm_free(session->context, session->shm_clock);
-	session->shm_clock = NULL;
+    if (session->clock_export.shm != NULL) {
+	(void)ntpshm_free(session->context, session->clock_export.shm);
+	time_export_close(&session->clock_export);
     }
 #if defined(PPS_ENABLE)
-    if (session->shm_pps != NULL) {
+    if (session->pps_export.shm != NULL) {
 	pps_thread_deactivate(&session->pps_thread);
-	if (session->chronyfd != -1)
-	    (void)close(session->chronyfd);
-	(void)ntpshm_free(session->context, session->shm_pps);
-	session->shm_pps = NULL;
+	(void)ntpshm_free(session->context, session->pps_export.shm);
+	time_export_close(&session->pps_export);
     }
 #endif	/* PPS_ENABLE */
 }
@@ -436,13 +506,17 @@ void ntpshm_link_activate(struct gps_device_t *session)
 
     if (session->sourcetype != source_pps ) {
 	/* allocate a shared-memory segment for "NMEA" time data */
-	session->shm_clock = ntpshm_alloc(session->context);
+	volatile struct shmTime *shm = ntpshm_alloc(session->context);
 
-	if (session->shm_clock == NULL) {
+	if (shm == NULL) {
 	    gpsd_log(&session->context->errout, LOG_WARN,
 		     "NTP: ntpshm_alloc() failed\n");
 	    return;
         }
+	/* Any NMEA will be about -1 or -2. Garmin GPS-18/USB is around -6 or -7. */
+	/* default precision, 1 micro sec */
+	time_export_init(&session->clock_export, session->gpsdata.dev.path,
+			 shm, -20, NULL);
     }
 
 #if defined(PPS_ENABLE)
@@ -453,11 +527,24 @@ void ntpshm_link_activate(struct gps_device_t *session)
 	 * for the 1pps time data and launch a thread to capture the 1pps
 	 * transitions
 	 */
-	if ((session->shm_pps = ntpshm_alloc(session->context)) == NULL) {
+	volatile struct shmTime *shm = ntpshm_alloc(session->context);
+
+	if (shm == NULL) {
 	    gpsd_log(&session->context->errout, LOG_WARN,
 		     "PPS: ntpshm_alloc(1) failed\n");
 	} else {
-	    init_hook(session);
+	    /* for chrony SOCK interface, which allows nSec timekeeping */
+	    char chrony_path[GPS_PATH_MAX];
+
+	    chrony_path_init(session, chrony_path, sizeof(chrony_path));
+	    /*
+	     * precision is a floor so do not make it tight: PPS over USB
+	     * is about 1 micro sec, PPS over serial about 1 nano sec
+	     */
+	    time_export_init(&session->pps_export, session->gpsdata.dev.path,
+			     shm,
+			     source_usb == session->sourcetype ? -20 : -30,
+			     chrony_path);
 	    session->pps_thread.report_hook = report_hook;
 	    #ifdef MAGIC_HAT_ENABLE
 	    /*